@@ -0,0 +1,312 @@
+#include <stdarg.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "base/AsyncLogging.h"
+#include "base/LogFile.h"
+#include "base/LinuxWin.h"
+#include "base/Timestamp.h"
+
+namespace MuduoPlus
+{
+    const size_t AsyncLogging::kStagingSize;
+    const size_t AsyncLogging::kMaxLineSize;
+
+    std::atomic<AsyncLogging*> AsyncLogging::s_defaultLogger_(nullptr);
+    std::atomic<uint64_t> AsyncLogging::s_nextId_(0);
+
+    /// Single-producer single-consumer byte ring, the producer is the
+    /// owning logging thread and the consumer is the backend thread.
+    class AsyncLogging::StagingBuffer : NonCopyable
+    {
+    public:
+        StagingBuffer()
+            : retired_(false),
+              head_(0),
+              tail_(0)
+        {
+        }
+
+        bool tryPush(const char* data, size_t len)
+        {
+            size_t head = head_.load(std::memory_order_relaxed);
+            size_t tail = tail_.load(std::memory_order_acquire);
+
+            if(kStagingSize - (head - tail) < len)
+            {
+                return false;
+            }
+
+            size_t pos = head % kStagingSize;
+            size_t first = (std::min)(len, kStagingSize - pos);
+            memcpy(storage_ + pos, data, first);
+            memcpy(storage_, data + first, len - first);
+            head_.store(head + len, std::memory_order_release);
+
+            return true;
+        }
+
+        size_t readableBytes() const
+        {
+            return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+        }
+
+        size_t popTo(std::vector<char>& out)
+        {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            size_t head = head_.load(std::memory_order_acquire);
+            size_t n = head - tail;
+
+            if(n == 0)
+            {
+                return 0;
+            }
+
+            size_t pos = tail % kStagingSize;
+            size_t first = (std::min)(n, kStagingSize - pos);
+            out.insert(out.end(), storage_ + pos, storage_ + pos + first);
+            out.insert(out.end(), storage_, storage_ + (n - first));
+            tail_.store(head, std::memory_order_release);
+
+            return n;
+        }
+
+        std::atomic<bool>   retired_;   // owning thread has exited
+
+    private:
+        std::atomic<size_t> head_;
+        std::atomic<size_t> tail_;
+        char                storage_[kStagingSize];
+    };
+
+    namespace
+    {
+        struct ThreadBufferHolder
+        {
+            ThreadBufferHolder()
+                : owner(0)
+            {
+            }
+
+            ~ThreadBufferHolder()
+            {
+                if(buffer)
+                {
+                    buffer->retired_ = true;
+                }
+            }
+
+            uint64_t                        owner;  // AsyncLogging::id_
+            AsyncLogging::StagingBufferPtr  buffer;
+        };
+
+        thread_local ThreadBufferHolder t_bufferHolder;
+    }
+
+    AsyncLogging::AsyncLogging(const std::string& basename,
+                               size_t rollSize,
+                               int flushIntervalMs,
+                               const std::string& extension)
+        : id_(++s_nextId_),
+          basename_(basename),
+          extension_(extension),
+          rollSize_(rollSize),
+          flushIntervalMs_(flushIntervalMs),
+          running_(false),
+          stalled_(0),
+          written_(0)
+    {
+    }
+
+    AsyncLogging::~AsyncLogging()
+    {
+        AsyncLogging* self = this;
+
+        if(s_defaultLogger_.compare_exchange_strong(self, nullptr))
+        {
+            LogPrintFunc printer = &AsyncLogging::printFunc;
+            LogPrinter.compare_exchange_strong(printer, nullptr);
+        }
+
+        if(running_)
+        {
+            stop();
+        }
+    }
+
+    void AsyncLogging::start()
+    {
+        assert(!running_);
+        running_ = true;
+        thread_.reset(new std::thread(std::bind(&AsyncLogging::threadFunc, this)));
+    }
+
+    void AsyncLogging::stop()
+    {
+        running_ = false;
+        cond_.notify_one();
+
+        if(thread_ && thread_->joinable())
+        {
+            thread_->join();
+        }
+    }
+
+    void AsyncLogging::setAsDefaultPrinter()
+    {
+        s_defaultLogger_.store(this, std::memory_order_release);
+        LogPrinter.store(&AsyncLogging::printFunc, std::memory_order_release);
+    }
+
+    AsyncLogging::StagingBuffer* AsyncLogging::threadBuffer()
+    {
+        if(t_bufferHolder.owner != id_)
+        {
+            if(t_bufferHolder.buffer)
+            {
+                t_bufferHolder.buffer->retired_ = true;
+            }
+
+            StagingBufferPtr buffer = std::make_shared<StagingBuffer>();
+            {
+                LockGuarder(mutex_);
+                buffers_.push_back(buffer);
+            }
+
+            t_bufferHolder.owner = id_;
+            t_bufferHolder.buffer = buffer;
+        }
+
+        return t_bufferHolder.buffer.get();
+    }
+
+    void AsyncLogging::append(const char* logline, size_t len)
+    {
+        len = (std::min)(len, kMaxLineSize);
+        StagingBuffer* buffer = threadBuffer();
+
+        if(!buffer->tryPush(logline, len))
+        {
+            stalled_.fetch_add(1, std::memory_order_relaxed);
+
+            do
+            {
+                if(!running_)
+                {
+                    return;
+                }
+
+                cond_.notify_one();
+                std::this_thread::yield();
+            }
+            while(!buffer->tryPush(logline, len));
+        }
+
+        // wake the backend early only when the ring is getting full
+        if(buffer->readableBytes() > kStagingSize / 2)
+        {
+            cond_.notify_one();
+        }
+    }
+
+    size_t AsyncLogging::drain(std::vector<char>& batch)
+    {
+        std::vector<StagingBufferPtr> buffers;
+        {
+            LockGuarder(mutex_);
+            buffers = buffers_;
+        }
+
+        size_t total = 0;
+
+        for(auto &pos : buffers)
+        {
+            total += pos->popTo(batch);
+        }
+
+        {
+            // release the rings of exited threads once they are empty
+            LockGuarder(mutex_);
+            buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                          [](const StagingBufferPtr & buffer)
+            {
+                return buffer->retired_ && buffer->readableBytes() == 0;
+            }), buffers_.end());
+        }
+
+        return total;
+    }
+
+    void AsyncLogging::threadFunc()
+    {
+        LogFile output(basename_, rollSize_, extension_);
+        std::vector<char> batch;
+        batch.reserve(kStagingSize * 4);
+
+        while(running_)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait_for(lock, std::chrono::milliseconds(flushIntervalMs_));
+            }
+
+            if(drain(batch) > 0)
+            {
+                output.append(batch.data(), batch.size());
+                written_.fetch_add(batch.size(), std::memory_order_relaxed);
+                batch.clear();
+            }
+
+            output.flush();
+        }
+
+        if(drain(batch) > 0)
+        {
+            output.append(batch.data(), batch.size());
+            written_.fetch_add(batch.size(), std::memory_order_relaxed);
+        }
+
+        output.flush();
+    }
+
+    void AsyncLogging::printFunc(LogType type, const char *format, ...)
+    {
+        AsyncLogging* logger = s_defaultLogger_.load(std::memory_order_acquire);
+
+        if(!logger)
+        {
+            return;
+        }
+
+        // formatting the date is the expensive part, do it once per second
+        thread_local time_t t_lastSecond = 0;
+        thread_local char   t_time[32] = { 0 };
+        thread_local int    t_tid = GetCurrThreadID();
+
+        Timestamp now = Timestamp::now();
+        time_t seconds = now.secondsSinceEpoch();
+
+        if(seconds != t_lastSecond)
+        {
+            t_lastSecond = seconds;
+            std::string formatted = Timestamp::fromUnixTime(seconds).toFormattedString(false);
+            snprintf(t_time, sizeof(t_time), "%s", formatted.c_str());
+        }
+
+        char line[kMaxLineSize];
+        int micro = static_cast<int>(now.microSecondsSinceEpoch() % Timestamp::kMicroSecPerSec);
+        int n = snprintf(line, sizeof(line), "%s.%06d %d %s ", t_time, micro, t_tid,
+                         logTypeName(type));
+
+        va_list args;
+        va_start(args, format);
+        int m = vsnprintf(line + n, sizeof(line) - n - 1, format, args);
+        va_end(args);
+
+        size_t len = n + (std::max)(0, (std::min)(m, (int)(sizeof(line) - n - 2)));
+        line[len++] = '\n';
+
+        logger->append(line, len);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/define.h"
+#include "base/NonCopyable.h"
+#include "base/Logger.h"
+
+namespace MuduoPlus
+{
+    /// Asynchronous file logger.
+    ///
+    /// Every logging thread formats into its own lock-free single-producer
+    /// staging ring, the backend thread swaps the filled rings out into one
+    /// batch and writes it to a rolling LogFile, so I/O threads never touch
+    /// stdio or a shared lock on the logging path.
+    ///
+    /// @code
+    /// AsyncLogging log("/var/log/server", 500 * 1024 * 1024);
+    /// log.start();
+    /// log.setAsDefaultPrinter();   // LOG_PRINT now goes to the files
+    /// @endcode
+    class AsyncLogging : NonCopyable
+    {
+    public:
+        static const size_t kStagingSize = 256 * 1024;
+        static const size_t kMaxLineSize = 4096;
+
+        AsyncLogging(const std::string& basename,
+                     size_t rollSize,
+                     int flushIntervalMs = 1000,
+                     const std::string& extension = ".log");
+        ~AsyncLogging();
+
+        /// Append one formatted line, thread safe and lock free after the
+        /// first call of each thread.
+        void append(const char* logline, size_t len);
+
+        void start();
+        void stop();
+
+        /// Route LogPrinter to this logger. It must outlive the loops and
+        /// every other thread that may still log, a call racing the
+        /// destructor would use a destroyed logger.
+        void setAsDefaultPrinter();
+
+        /// Times a producer had to wait for the backend to drain its ring.
+        uint64_t stalledCount() const
+        {
+            return stalled_.load(std::memory_order_relaxed);
+        }
+
+        uint64_t writtenBytes() const
+        {
+            return written_.load(std::memory_order_relaxed);
+        }
+
+        static void printFunc(LogType type, const char *format, ...);
+
+        class StagingBuffer;
+        typedef std::shared_ptr<StagingBuffer> StagingBufferPtr;
+
+    private:
+        StagingBuffer*  threadBuffer();
+        size_t          drain(std::vector<char>& batch);
+        void            threadFunc();
+
+        const uint64_t              id_;    // addresses are reused, ids are not
+        const std::string           basename_;
+        const std::string           extension_;
+        const size_t                rollSize_;
+        const int                   flushIntervalMs_;
+        std::atomic<bool>           running_;
+        std::atomic<uint64_t>       stalled_;
+        std::atomic<uint64_t>       written_;
+        std::unique_ptr<std::thread> thread_;
+        std::mutex                  mutex_;
+        std::condition_variable     cond_;
+        std::vector<StagingBufferPtr> buffers_;  // @GuardedBy mutex_
+
+        static std::atomic<AsyncLogging*>   s_defaultLogger_;
+        static std::atomic<uint64_t>        s_nextId_;
+    };
+}
@@ -0,0 +1,76 @@
+#include "base/BinaryLogging.h"
+#include "base/LinuxWin.h"
+
+namespace MuduoPlus
+{
+    std::atomic<BinaryLogging*> BinaryLogging::s_defaultLogger_(nullptr);
+
+    BinaryLogging::BinaryLogging(const std::string& basename,
+                                 size_t rollSize,
+                                 int flushIntervalMs)
+        : backend_(basename, rollSize, flushIntervalMs, ".blog"),
+          dictFile_(nullptr)
+    {
+        char buf[32] = { 0 };
+        snprintf(buf, sizeof(buf), ".%d.dict", GetCurrProcessID());
+        dictFileName_ = basename + buf;
+    }
+
+    BinaryLogging::~BinaryLogging()
+    {
+        BinaryLogging* self = this;
+
+        if(s_defaultLogger_.compare_exchange_strong(self, nullptr))
+        {
+            LogRecordFunc recorder = &BinaryLogging::recordFunc;
+            LogRecorder.compare_exchange_strong(recorder, nullptr);
+        }
+
+        stop();
+    }
+
+    void BinaryLogging::start()
+    {
+        dictFile_ = fopen(dictFileName_.c_str(), "wb");
+
+        if(!dictFile_)
+        {
+            fprintf(stderr, "BinaryLogging::start() open %s failed %s\n",
+                    dictFileName_.c_str(), GetLastErrorText().c_str());
+        }
+        else
+        {
+            LogRecord::setFormatFile(dictFile_);
+        }
+
+        backend_.start();
+    }
+
+    void BinaryLogging::stop()
+    {
+        backend_.stop();
+
+        if(dictFile_)
+        {
+            LogRecord::setFormatFile(nullptr);
+            fclose(dictFile_);
+            dictFile_ = nullptr;
+        }
+    }
+
+    void BinaryLogging::setAsDefaultRecorder()
+    {
+        s_defaultLogger_.store(this, std::memory_order_release);
+        LogRecorder.store(&BinaryLogging::recordFunc, std::memory_order_release);
+    }
+
+    void BinaryLogging::recordFunc(const char *record, size_t len)
+    {
+        BinaryLogging* logger = s_defaultLogger_.load(std::memory_order_acquire);
+
+        if(logger)
+        {
+            logger->backend_.append(record, len);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdio.h>
+#include <atomic>
+#include <string>
+
+#include "base/AsyncLogging.h"
+#include "base/LogRecord.h"
+#include "base/NonCopyable.h"
+
+namespace MuduoPlus
+{
+    /// Deferred-formatting logger.
+    ///
+    /// LOG_PRINT stores the call site's format id and raw arguments as a
+    /// binary LogRecord into the AsyncLogging staging rings, no printf work
+    /// is done on the logging thread.  Format strings go once into
+    /// "<basename>.<pid>.dict", records into "<basename>.<date>.<pid>.blog",
+    /// and tools/LogDecoder turns both back into text.
+    class BinaryLogging : NonCopyable
+    {
+    public:
+        BinaryLogging(const std::string& basename,
+                      size_t rollSize,
+                      int flushIntervalMs = 1000);
+        ~BinaryLogging();
+
+        void start();
+        void stop();
+
+        /// Route LogRecorder to this logger, LogPrinter is bypassed while set.
+        /// Like AsyncLogging's default printer it must outlive every thread
+        /// that may still log.
+        void setAsDefaultRecorder();
+
+        const std::string& dictFileName() const
+        {
+            return dictFileName_;
+        }
+
+        uint64_t stalledCount() const
+        {
+            return backend_.stalledCount();
+        }
+
+        static void recordFunc(const char *record, size_t len);
+
+    private:
+        AsyncLogging    backend_;
+        std::string     dictFileName_;
+        FILE*           dictFile_;
+
+        static std::atomic<BinaryLogging*>  s_defaultLogger_;
+    };
+}
@@ -7,7 +7,7 @@ int GetLastErrorCode()
 #ifdef WIN32
     int errorCode = GetLastError();
 #else
-    errorCode = errno;
+    int errorCode = errno;
 #endif
 
     return errorCode;
@@ -87,3 +87,12 @@ int GetCurrThreadID()
     return static_cast<pid_t>(::syscall(SYS_gettid));;
 #endif
 }
+
+int GetCurrProcessID()
+{
+#ifdef WIN32
+    return GetCurrentProcessId();
+#else
+    return static_cast<int>(::getpid());
+#endif
+}
@@ -15,6 +15,7 @@ int     gettimeofday(struct timeval *tp, void *tzp);
 #endif
 
 int         GetCurrThreadID();
+int         GetCurrProcessID();
 
 int         GetLastErrorCode();
 std::string GetErrorText(int errcode);
@@ -0,0 +1,119 @@
+#include "base/LogFile.h"
+#include "base/LinuxWin.h"
+
+namespace MuduoPlus
+{
+    LogFile::LogFile(const std::string& basename, size_t rollSize,
+                     const std::string& extension)
+        : basename_(basename),
+          extension_(extension),
+          rollSize_(rollSize),
+          fp_(nullptr),
+          writtenBytes_(0),
+          startOfPeriod_(0),
+          lastRoll_(0)
+    {
+        rollFile();
+    }
+
+    LogFile::~LogFile()
+    {
+        if(fp_)
+        {
+            fclose(fp_);
+        }
+    }
+
+    void LogFile::append(const char* data, size_t len)
+    {
+        if(!fp_)
+        {
+            return;
+        }
+
+        size_t n = fwrite(data, 1, len, fp_);
+
+        if(n != len)
+        {
+            fprintf(stderr, "LogFile::append() failed %s\n", GetLastErrorText().c_str());
+        }
+
+        writtenBytes_ += n;
+
+        if(writtenBytes_ > rollSize_)
+        {
+            rollFile();
+        }
+        else
+        {
+            time_t now = ::time(NULL);
+            time_t thisPeriod = now / kRollPerSeconds * kRollPerSeconds;
+
+            if(thisPeriod != startOfPeriod_)
+            {
+                rollFile();
+            }
+        }
+    }
+
+    void LogFile::flush()
+    {
+        if(fp_)
+        {
+            fflush(fp_);
+        }
+    }
+
+    bool LogFile::rollFile()
+    {
+        time_t now = ::time(NULL);
+
+        // file names have second resolution, don't clobber the current one
+        if(now <= lastRoll_)
+        {
+            return false;
+        }
+
+        std::string filename = getLogFileName(now);
+        FILE* fp = fopen(filename.c_str(), "ab");
+
+        if(!fp)
+        {
+            fprintf(stderr, "LogFile::rollFile() open %s failed %s\n",
+                    filename.c_str(), GetLastErrorText().c_str());
+            return false;
+        }
+
+        if(fp_)
+        {
+            fclose(fp_);
+        }
+
+        fp_ = fp;
+        setvbuf(fp_, buffer_, _IOFBF, sizeof(buffer_));
+        lastRoll_ = now;
+        startOfPeriod_ = now / kRollPerSeconds * kRollPerSeconds;
+        writtenBytes_ = 0;
+
+        return true;
+    }
+
+    std::string LogFile::getLogFileName(time_t now) const
+    {
+        char timebuf[32] = { 0 };
+        struct tm tm;
+
+#ifdef WIN32
+        gmtime_s(&tm, &now);
+#else
+        gmtime_r(&now, &tm);
+#endif
+
+        strftime(timebuf, sizeof(timebuf), ".%Y%m%d-%H%M%S.", &tm);
+
+        char pidbuf[32] = { 0 };
+        snprintf(pidbuf, sizeof(pidbuf), "%d", GetCurrProcessID());
+
+        return basename_ + timebuf + pidbuf + extension_;
+    }
+}
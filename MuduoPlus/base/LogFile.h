@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+#include "base/NonCopyable.h"
+
+namespace MuduoPlus
+{
+    /// Append-only log file that rolls over by size and by day.
+    ///
+    /// Not thread safe, owned by the AsyncLogging backend thread.
+    class LogFile : NonCopyable
+    {
+    public:
+        LogFile(const std::string& basename, size_t rollSize,
+                const std::string& extension = ".log");
+        ~LogFile();
+
+        void append(const char* data, size_t len);
+        void flush();
+        bool rollFile();
+
+        size_t writtenBytes() const
+        {
+            return writtenBytes_;
+        }
+
+    private:
+        static const int kRollPerSeconds = 60 * 60 * 24;
+
+        std::string getLogFileName(time_t now) const;
+
+        const std::string   basename_;
+        const std::string   extension_;
+        const size_t        rollSize_;
+        FILE*               fp_;
+        size_t              writtenBytes_;
+        time_t              startOfPeriod_;
+        time_t              lastRoll_;
+        char                buffer_[64 * 1024];
+    };
+}
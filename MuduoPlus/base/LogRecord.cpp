@@ -0,0 +1,163 @@
+#include <mutex>
+
+#include "base/LogRecord.h"
+#include "base/LinuxWin.h"
+#include "base/Timestamp.h"
+
+namespace MuduoPlus
+{
+    std::atomic<LogRecordFunc> LogRecorder(nullptr);
+
+    namespace LogRecord
+    {
+        namespace
+        {
+            struct FormatRegistry
+            {
+                FormatRegistry()
+                    : file(nullptr)
+                {
+                }
+
+                std::mutex                  mutex;
+                std::vector<FormatEntry>    formats;
+                FILE*                       file;
+            };
+
+            FormatRegistry& registry()
+            {
+                static FormatRegistry s_registry;
+                return s_registry;
+            }
+
+            // dictionary entry: id, type, line, file length, file, format length, format
+            void writeFormat(FILE* fp, const FormatEntry& entry)
+            {
+                uint32_t fields[3] = { entry.id, (uint32_t)entry.type, (uint32_t)entry.line };
+                uint32_t fileLen = (uint32_t)entry.file.size();
+                uint32_t formatLen = (uint32_t)entry.format.size();
+
+                fwrite(fields, sizeof fields, 1, fp);
+                fwrite(&fileLen, sizeof fileLen, 1, fp);
+                fwrite(entry.file.data(), 1, fileLen, fp);
+                fwrite(&formatLen, sizeof formatLen, 1, fp);
+                fwrite(entry.format.data(), 1, formatLen, fp);
+            }
+
+            bool readString(FILE* fp, std::string& str)
+            {
+                uint32_t len = 0;
+
+                if(fread(&len, sizeof len, 1, fp) != 1)
+                {
+                    return false;
+                }
+
+                str.resize(len);
+                return len == 0 || fread(&str[0], 1, len, fp) == len;
+            }
+        }
+
+        Encoder::Encoder(uint32_t formatId)
+            : len_(sizeof(Header)),
+              truncated_(false)
+        {
+            thread_local int32_t t_tid = GetCurrThreadID();
+
+            Header header;
+            header.length = 0;
+            header.formatId = formatId;
+            header.microSeconds = Timestamp::now().microSecondsSinceEpoch();
+            header.tid = t_tid;
+            header.reserved = 0;
+            memcpy(buf_, &header, sizeof header);
+        }
+
+        const char* Encoder::finish()
+        {
+            uint32_t length = static_cast<uint32_t>(len_);
+            memcpy(buf_, &length, sizeof length);
+            return buf_;
+        }
+
+        uint32_t registerFormat(int type, const char* format, const char* file, int line)
+        {
+            FormatRegistry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+
+            FormatEntry entry;
+            entry.id = static_cast<uint32_t>(reg.formats.size());
+            entry.type = type;
+            entry.line = line;
+            entry.file = file;
+            entry.format = format;
+            reg.formats.push_back(entry);
+
+            if(reg.file)
+            {
+                writeFormat(reg.file, entry);
+                fflush(reg.file);
+            }
+
+            return entry.id;
+        }
+
+        void setFormatFile(FILE* fp)
+        {
+            FormatRegistry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+
+            reg.file = fp;
+
+            if(fp)
+            {
+                for(auto &pos : reg.formats)
+                {
+                    writeFormat(fp, pos);
+                }
+
+                fflush(fp);
+            }
+        }
+
+        bool loadFormats(const std::string& path, std::vector<FormatEntry>& formats)
+        {
+            FILE* fp = fopen(path.c_str(), "rb");
+
+            if(!fp)
+            {
+                return false;
+            }
+
+            while(true)
+            {
+                uint32_t fields[3] = { 0 };
+
+                if(fread(fields, sizeof fields, 1, fp) != 1)
+                {
+                    break;
+                }
+
+                FormatEntry entry;
+                entry.id = fields[0];
+                entry.type = (int)fields[1];
+                entry.line = (int)fields[2];
+
+                if(!readString(fp, entry.file) || !readString(fp, entry.format))
+                {
+                    break;
+                }
+
+                if(formats.size() <= entry.id)
+                {
+                    formats.resize(entry.id + 1);
+                }
+
+                formats[entry.id] = entry;
+            }
+
+            fclose(fp);
+            return true;
+        }
+    }
+}
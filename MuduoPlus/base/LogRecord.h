@@ -0,0 +1,219 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace MuduoPlus
+{
+    typedef void(*LogRecordFunc)(const char *record, size_t len);
+
+    /// When set, LOG_PRINT stores binary records through it instead of
+    /// formatting with LogPrinter, see BinaryLogging. May be changed while
+    /// other threads log.
+    extern  std::atomic<LogRecordFunc> LogRecorder;
+
+    /// Binary log record encoding used by the deferred-formatting mode.
+    ///
+    /// A record is a Header followed by the raw arguments, each one tagged
+    /// with its ArgType.  The format string itself is registered once per
+    /// call site and identified by formatId, it never enters the record.
+    /// Records use host byte order, decode them on the same architecture.
+    namespace LogRecord
+    {
+        enum ArgType
+        {
+            kInt64 = 1,
+            kUint64,
+            kDouble,
+            kString,
+            kPointer,
+        };
+
+        struct Header
+        {
+            uint32_t    length;         // whole record, header included
+            uint32_t    formatId;
+            int64_t     microSeconds;   // since epoch
+            int32_t     tid;
+            int32_t     reserved;
+        };
+
+        static const size_t kMaxRecordSize = 4096;
+        static const size_t kMaxStringSize = 1024;
+        static const int    kMaxLogTypes = 8;
+
+        struct FormatEntry
+        {
+            uint32_t    id;
+            int         type;
+            int         line;
+            std::string file;
+            std::string format;
+        };
+
+        /// Registers a call site and returns its id, thread safe.
+        uint32_t registerFormat(int type, const char* format, const char* file, int line);
+
+        /// Id of a call site at level type, registered on first use. ids is
+        /// the call site's table with a slot per level holding id + 1, so a
+        /// call site with a runtime level records the level it logged at.
+        inline uint32_t formatId(std::atomic<uint32_t>* ids, int type, const char* format,
+                                 const char* file, int line)
+        {
+            std::atomic<uint32_t>& slot = ids[static_cast<unsigned>(type) % kMaxLogTypes];
+            uint32_t id = slot.load(std::memory_order_acquire);
+
+            // threads racing here both register, either id decodes the same
+            if(id == 0)
+            {
+                id = registerFormat(type, format, file, line) + 1;
+                slot.store(id, std::memory_order_release);
+            }
+
+            return id - 1;
+        }
+
+        /// Writes every registered format to fp, and keeps appending new
+        /// registrations to it until called again with nullptr.
+        void setFormatFile(FILE* fp);
+
+        /// Reads a format dictionary written through setFormatFile.
+        bool loadFormats(const std::string& path, std::vector<FormatEntry>& formats);
+
+        class Encoder
+        {
+        public:
+            explicit Encoder(uint32_t formatId);
+
+            // arguments past kMaxRecordSize are dropped, never reordered
+            void put(uint8_t tag, const void* data, size_t len)
+            {
+                if(truncated_ || len_ + 1 + len > kMaxRecordSize)
+                {
+                    truncated_ = true;
+                    return;
+                }
+
+                buf_[len_++] = static_cast<char>(tag);
+                memcpy(buf_ + len_, data, len);
+                len_ += len;
+            }
+
+            void putString(const char* str)
+            {
+                if(!str)
+                {
+                    str = "(null)";
+                }
+
+                size_t n = strlen(str);
+                n = n > kMaxStringSize ? kMaxStringSize : n;
+
+                if(truncated_ || len_ + 1 + sizeof(uint32_t) + n > kMaxRecordSize)
+                {
+                    truncated_ = true;
+                    return;
+                }
+
+                uint32_t n32 = static_cast<uint32_t>(n);
+                buf_[len_++] = static_cast<char>(kString);
+                memcpy(buf_ + len_, &n32, sizeof n32);
+                len_ += sizeof n32;
+                memcpy(buf_ + len_, str, n);
+                len_ += n;
+            }
+
+            const char* finish();
+
+            size_t size() const
+            {
+                return len_;
+            }
+
+        private:
+            char    buf_[kMaxRecordSize];
+            size_t  len_;
+            bool    truncated_;
+        };
+
+        template<typename T>
+        typename std::enable_if < std::is_integral<T>::value && std::is_signed<T>::value >::type
+        encodeArg(Encoder& enc, T value)
+        {
+            int64_t v = static_cast<int64_t>(value);
+            enc.put(kInt64, &v, sizeof v);
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_enum<T>::value>::type
+        encodeArg(Encoder& enc, T value)
+        {
+            int64_t v = static_cast<int64_t>(value);
+            enc.put(kInt64, &v, sizeof v);
+        }
+
+        template<typename T>
+        typename std::enable_if < std::is_integral<T>::value && std::is_unsigned<T>::value >::type
+        encodeArg(Encoder& enc, T value)
+        {
+            uint64_t v = static_cast<uint64_t>(value);
+            enc.put(kUint64, &v, sizeof v);
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_floating_point<T>::value>::type
+        encodeArg(Encoder& enc, T value)
+        {
+            double v = static_cast<double>(value);
+            enc.put(kDouble, &v, sizeof v);
+        }
+
+        inline void encodeArg(Encoder& enc, const char* value)
+        {
+            enc.putString(value);
+        }
+
+        inline void encodeArg(Encoder& enc, char* value)
+        {
+            enc.putString(value);
+        }
+
+        template<typename T>
+        void encodeArg(Encoder& enc, const T* value)
+        {
+            uint64_t v = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+            enc.put(kPointer, &v, sizeof v);
+        }
+
+        inline void encodeArgs(Encoder&)
+        {
+        }
+
+        template<typename T, typename... Args>
+        void encodeArgs(Encoder& enc, const T& first, const Args&... rest)
+        {
+            encodeArg(enc, first);
+            encodeArgs(enc, rest...);
+        }
+
+        template<typename... Args>
+        void record(uint32_t formatId, const Args&... args)
+        {
+            Encoder enc(formatId);
+            encodeArgs(enc, args...);
+            const char* data = enc.finish();
+
+            LogRecordFunc recorder = LogRecorder.load(std::memory_order_acquire);
+
+            if(recorder)
+            {
+                recorder(data, enc.size());
+            }
+        }
+    }
+}
@@ -2,5 +2,30 @@
 
 namespace MuduoPlus
 {
-    LogPrintFunc LogPrinter = nullptr;
-}
\ No newline at end of file
+    std::atomic<LogPrintFunc> LogPrinter(nullptr);
+    LogType      LogLevel = LogType_Debug;
+
+    const char* logTypeName(LogType type)
+    {
+        switch(type)
+        {
+            case LogType_Debug:
+                return "DEBUG";
+
+            case LogType_Info:
+                return "INFO ";
+
+            case LogType_Warn:
+                return "WARN ";
+
+            case LogType_Error:
+                return "ERROR";
+
+            case LogType_Fatal:
+                return "FATAL";
+
+            default:
+                return "UNKWN";
+        }
+    }
+}
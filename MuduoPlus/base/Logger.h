@@ -1,21 +1,90 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 
+#include "base/LogRecord.h"
+
+// Compile-time minimum log level, as the integer value of a LogType.
+// LOG_PRINT calls below it fold to dead code, and the per-level macros
+// LOG_DEBUG .. LOG_ERROR below it expand to nothing at all.
+#ifndef MUDUO_MIN_LOG_LEVEL
+#define MUDUO_MIN_LOG_LEVEL 0
+#endif
+
 namespace MuduoPlus
 {
 
     enum LogType
     {
-        LogType_Info,
         LogType_Debug,
+        LogType_Info,
         LogType_Warn,
         LogType_Error,
         LogType_Fatal,
     };
 
     typedef void(*LogPrintFunc)(LogType type, const char *format, ...);
-    extern  LogPrintFunc LogPrinter;
+    // may be changed while other threads log, a printer that forwards to
+    // an object such as AsyncLogging needs that object to outlive them
+    extern  std::atomic<LogPrintFunc> LogPrinter;
+
+    // runtime minimum log level, LogType_Debug by default
+    extern  LogType LogLevel;
+
+    inline void setLogLevel(LogType level)
+    {
+        LogLevel = level;
+    }
+
+    const char* logTypeName(LogType type);
+
+// arguments are only evaluated when the level passes both filters,
+// a LogRecorder takes precedence over LogPrinter and defers formatting.
+// The recorder registers format once per call site and level, so format
+// has to be a string literal, type may be chosen at run time
+#define LOG_PRINT(type, format, ...)    \
+    do \
+    { \
+        if ((type) >= MUDUO_MIN_LOG_LEVEL && (type) >= MuduoPlus::LogLevel) \
+        { \
+            if (MuduoPlus::LogRecorder.load(std::memory_order_relaxed)) \
+            { \
+                static std::atomic<uint32_t> muduoLogFormatIds[MuduoPlus::LogRecord::kMaxLogTypes]; \
+                MuduoPlus::LogRecord::record( \
+                    MuduoPlus::LogRecord::formatId(muduoLogFormatIds, type, "" format, \
+                                                   __FILE__, __LINE__), \
+                    ##__VA_ARGS__); \
+            } \
+            else if (MuduoPlus::LogPrintFunc muduoLogPrinter = \
+                         MuduoPlus::LogPrinter.load(std::memory_order_acquire)) \
+            { \
+                muduoLogPrinter(type, format, ##__VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#if MUDUO_MIN_LOG_LEVEL <= 0
+#define LOG_DEBUG(format, ...)  LOG_PRINT(MuduoPlus::LogType_Debug, format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...)  do {} while (0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= 1
+#define LOG_INFO(format, ...)   LOG_PRINT(MuduoPlus::LogType_Info, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...)   do {} while (0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= 2
+#define LOG_WARN(format, ...)   LOG_PRINT(MuduoPlus::LogType_Warn, format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...)   do {} while (0)
+#endif
 
-#define LOG_PRINT(type, format, ...)    if (LogPrinter) LogPrinter(type, format, ##__VA_ARGS__)
-}
\ No newline at end of file
+#if MUDUO_MIN_LOG_LEVEL <= 3
+#define LOG_ERROR(format, ...)  LOG_PRINT(MuduoPlus::LogType_Error, format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...)  do {} while (0)
+#endif
+}
@@ -0,0 +1,108 @@
+#include "base/Metrics.h"
+
+#ifdef WIN32
+#include <intrin.h>
+#endif
+
+namespace MuduoPlus
+{
+    const int Histogram::kSubBucketBits;
+    const int Histogram::kSubBuckets;
+    const int Histogram::kMaxExponent;
+    const int Histogram::kBucketCount;
+
+    namespace
+    {
+        int highestBit(uint64_t value)
+        {
+#ifdef WIN32
+            unsigned long index = 0;
+            _BitScanReverse64(&index, value);
+            return static_cast<int>(index);
+#else
+            return 63 - __builtin_clzll(value);
+#endif
+        }
+    }
+
+    Histogram::Histogram()
+        : count_(0),
+          sum_(0)
+    {
+        for(int i = 0; i < kBucketCount; ++i)
+        {
+            buckets_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // values below kSubBuckets get a bucket each, above that bucket
+    // (shift + 1) * kSubBuckets + sub covers [(kSubBuckets + sub) << shift,
+    // (kSubBuckets + sub + 1) << shift)
+    int Histogram::bucketIndex(uint64_t value)
+    {
+        if(value < static_cast<uint64_t>(kSubBuckets))
+        {
+            return static_cast<int>(value);
+        }
+
+        int shift = highestBit(value) - kSubBucketBits;
+        int index = (shift + 1) * kSubBuckets + static_cast<int>(value >> shift) - kSubBuckets;
+
+        return index < kBucketCount ? index : kBucketCount - 1;
+    }
+
+    uint64_t Histogram::bucketUpperBound(int index)
+    {
+        if(index < kSubBuckets)
+        {
+            return static_cast<uint64_t>(index);
+        }
+
+        int shift = index / kSubBuckets - 1;
+        uint64_t sub = static_cast<uint64_t>(index % kSubBuckets);
+
+        return ((kSubBuckets + sub + 1) << shift) - 1;
+    }
+
+    uint64_t Histogram::cumulativeCount(int index) const
+    {
+        uint64_t total = 0;
+
+        for(int i = 0; i <= index && i < kBucketCount; ++i)
+        {
+            total += bucketCount(i);
+        }
+
+        return total;
+    }
+
+    uint64_t Histogram::percentile(double q) const
+    {
+        uint64_t total = 0;
+
+        for(int i = 0; i < kBucketCount; ++i)
+        {
+            total += bucketCount(i);
+        }
+
+        if(total == 0)
+        {
+            return 0;
+        }
+
+        uint64_t target = static_cast<uint64_t>(q * total);
+        uint64_t seen = 0;
+
+        for(int i = 0; i < kBucketCount; ++i)
+        {
+            seen += bucketCount(i);
+
+            if(seen > target || seen == total)
+            {
+                return bucketUpperBound(i);
+            }
+        }
+
+        return bucketUpperBound(kBucketCount - 1);
+    }
+}
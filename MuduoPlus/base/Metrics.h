@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "base/NonCopyable.h"
+
+namespace MuduoPlus
+{
+    /// Monotonic counter with a single writer.
+    ///
+    /// add() must only be called from the owning thread, it is a plain
+    /// load/store so it costs no locked instruction; any thread may read.
+    class Counter : NonCopyable
+    {
+    public:
+        Counter()
+            : value_(0)
+        {
+        }
+
+        void add(uint64_t n)
+        {
+            value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        uint64_t value() const
+        {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<uint64_t> value_;
+    };
+
+    /// Gauge with a single writer, same threading rules as Counter.
+    class Gauge : NonCopyable
+    {
+    public:
+        Gauge()
+            : value_(0)
+        {
+        }
+
+        void set(int64_t v)
+        {
+            value_.store(v, std::memory_order_relaxed);
+        }
+
+        void add(int64_t n)
+        {
+            value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        int64_t value() const
+        {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<int64_t> value_;
+    };
+
+    /// Log-linear histogram in the spirit of HdrHistogram.
+    ///
+    /// Every power of two is split into kSubBuckets linear buckets, which
+    /// bounds the relative error to 1/kSubBuckets over the whole range.
+    /// Single writer, readers see a slightly torn but monotonic snapshot.
+    class Histogram : NonCopyable
+    {
+    public:
+        static const int kSubBucketBits = 3;
+        static const int kSubBuckets = 1 << kSubBucketBits;
+        static const int kMaxExponent = 48;
+        static const int kBucketCount = (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+        Histogram();
+
+        void record(uint64_t value)
+        {
+            int index = bucketIndex(value);
+            buckets_[index].store(buckets_[index].load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+            count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        uint64_t count() const
+        {
+            return count_.load(std::memory_order_relaxed);
+        }
+
+        uint64_t sum() const
+        {
+            return sum_.load(std::memory_order_relaxed);
+        }
+
+        uint64_t bucketCount(int index) const
+        {
+            return buckets_[index].load(std::memory_order_relaxed);
+        }
+
+        /// Number of recorded values <= bucketUpperBound(index).
+        uint64_t cumulativeCount(int index) const;
+
+        /// Smallest bucket upper bound with at least q of the values below it.
+        uint64_t percentile(double q) const;
+
+        static int      bucketIndex(uint64_t value);
+        static uint64_t bucketUpperBound(int index);
+
+    private:
+        std::atomic<uint64_t> buckets_[kBucketCount];
+        std::atomic<uint64_t> count_;
+        std::atomic<uint64_t> sum_;
+    };
+}
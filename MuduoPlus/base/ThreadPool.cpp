@@ -70,11 +70,11 @@ namespace MuduoPlus
         }
         else
         {
-            LockGuarder(mutex_);
+            // one lock for the wait, a second one on mutex_ would self deadlock
+            std::unique_lock<std::mutex> uniLock(mutex_);
 
             while(isFull())
             {
-                std::unique_lock<std::mutex> uniLock(mutex_);
                 notFull_.wait(uniLock);
             }
 
@@ -87,12 +87,11 @@ namespace MuduoPlus
 
     ThreadPool::Task ThreadPool::take()
     {
-        LockGuarder(mutex_);
+        std::unique_lock<std::mutex> uniLock(mutex_);
 
         // always use a while-loop, due to spurious wakeup
         while(queue_.empty() && running_)
         {
-            std::unique_lock<std::mutex> uniLock(mutex_);
             notEmpty_.wait(uniLock);
         }
 
@@ -1,4 +1,5 @@
 #include <inttypes.h>
+#include <chrono>
 
 #include "base/Timestamp.h"
 #include "base/define.h"
@@ -49,6 +50,12 @@ std::string Timestamp::toFormattedString(bool showMicroseconds) const
     return buf;
 }
 
+Timestamp Timestamp::monotonic()
+{
+    return Timestamp(std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
 Timestamp Timestamp::now()
 {
     struct timeval tv;
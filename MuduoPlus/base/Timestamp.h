@@ -68,6 +68,10 @@ namespace MuduoPlus
         }
 
         static Timestamp now();
+        /// steady_clock (CLOCK_MONOTONIC), does not follow wall clock
+        /// changes. Its epoch is arbitrary, use it for differences and
+        /// deadlines only.
+        static Timestamp monotonic();
 
         double secondFromNow()
         {
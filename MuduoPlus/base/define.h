@@ -17,9 +17,17 @@
 #include <arpa/inet.h>
 #include <sys/syscall.h>
 #include <netinet/tcp.h>
+#include <sys/uio.h>
+#include <errno.h>
 
 #endif
 
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+#include <map>
+#include <algorithm>
+
 //#include <assert.h>
 
 //#include "Logger.h"
@@ -0,0 +1,137 @@
+// Throughput and caller latency of LOG_PRINT through AsyncLogging and
+// BinaryLogging, compared with a synchronous stdio printer.
+//
+// usage: AsyncLoggingBench [threads] [messagesPerThread] [logBasename]
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "base/AsyncLogging.h"
+#include "base/BinaryLogging.h"
+#include "base/Logger.h"
+#include "base/Timestamp.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    FILE* g_syncFile = nullptr;
+
+    void syncPrint(LogType type, const char *format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        fprintf(g_syncFile, "%s %s ", Timestamp::now().toFormattedString().c_str(),
+                logTypeName(type));
+        vfprintf(g_syncFile, format, args);
+        fputc('\n', g_syncFile);
+        va_end(args);
+    }
+
+    int64_t nowNanos()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // every producer records the cost of each call, as an I/O loop would pay it
+    void runCase(const char* name, int numThreads, int messages)
+    {
+        std::vector<std::vector<int64_t>> latencies(numThreads);
+        std::vector<std::thread> threads;
+        int64_t start = nowNanos();
+
+        for(int t = 0; t < numThreads; ++t)
+        {
+            threads.push_back(std::thread([ &, t]()
+            {
+                std::vector<int64_t>& samples = latencies[t];
+                samples.reserve(messages);
+
+                for(int i = 0; i < messages; ++i)
+                {
+                    int64_t before = nowNanos();
+                    LOG_PRINT(LogType_Info, "fd[%d] read %d bytes from conn %s#%d",
+                              i & 1023, i, "bench-127.0.0.1:2007", t);
+                    samples.push_back(nowNanos() - before);
+                }
+            }));
+        }
+
+        for(auto &pos : threads)
+        {
+            pos.join();
+        }
+
+        int64_t elapsed = nowNanos() - start;
+        std::vector<int64_t> all;
+
+        for(auto &pos : latencies)
+        {
+            all.insert(all.end(), pos.begin(), pos.end());
+        }
+
+        std::sort(all.begin(), all.end());
+        size_t total = all.size();
+
+        printf("%-8s threads=%d msgs=%zu msgs_per_sec=%.0f "
+               "p50_ns=%lld p99_ns=%lld p999_ns=%lld max_ns=%lld\n",
+               name, numThreads, total, total * 1e9 / elapsed,
+               (long long)all[total / 2], (long long)all[total * 99 / 100],
+               (long long)all[total * 999 / 1000], (long long)all[total - 1]);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+    int messages = argc > 2 ? atoi(argv[2]) : 200000;
+    const char* basename = argc > 3 ? argv[3] : "/tmp/AsyncLoggingBench";
+
+    g_syncFile = fopen("/dev/null", "w");
+
+    if(!g_syncFile)
+    {
+        fprintf(stderr, "open /dev/null failed\n");
+        return 1;
+    }
+
+    LogPrinter = syncPrint;
+    runCase("sync", numThreads, messages);
+
+    {
+        AsyncLogging logger(basename, 512 * 1024 * 1024);
+        logger.start();
+        logger.setAsDefaultPrinter();
+        runCase("async", numThreads, messages);
+        logger.stop();
+        printf("async    stalled=%llu written_bytes=%llu\n",
+               (unsigned long long)logger.stalledCount(),
+               (unsigned long long)logger.writtenBytes());
+    }
+
+    {
+        BinaryLogging logger(basename, 512 * 1024 * 1024);
+        logger.start();
+        logger.setAsDefaultRecorder();
+        runCase("binary", numThreads, messages);
+        LogRecorder = nullptr;
+        logger.stop();
+        printf("binary   stalled=%llu dict=%s\n",
+               (unsigned long long)logger.stalledCount(), logger.dictFileName().c_str());
+    }
+
+    // filtered calls must not pay for formatting
+    LogPrinter = syncPrint;
+    setLogLevel(LogType_Warn);
+    runCase("filtered", numThreads, messages);
+
+    fclose(g_syncFile);
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Large transfer bandwidth over loopback. Clients write chunks back to back,
+// refilling on every write complete, and the server discards what it reads.
+// readBudget=N caps what the server reads per connection and read event.
+// readLimit, serverReadLimit and writeLimit are token bucket rates in bytes
+// per second for the server's reads per connection, its reads of all
+// connections together and the clients' writes, with a fifth of a second
+// of burst. tls=1 runs the transfer over TLS with cert and key, a self
+// signed pair made with the openssl command when not given, kernel_tx
+// counts the clients whose sending the kernel took over.
+//
+// usage: BandwidthBench [connections=1] [chunkSize=65536] [serverThreads=1]
+//                       [clientThreads=1] [warmupMs=500] [durationMs=3000] [port=20073]
+//                       [poller=epoll] [readBudget=0] [readLimit=0] [serverReadLimit=0]
+//                       [writeLimit=0] [tls=0] [cert=] [key=]
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/TcpClient.h"
+#include "net/TcpServer.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>       g_measuring(false);
+    std::atomic<uint64_t>   g_received(0);
+    std::string             g_chunk;
+    double                  g_writeLimit = 0;
+    std::atomic<int>        g_kernelTx(0);
+
+    void onServerMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+    {
+        if(g_measuring.load(std::memory_order_relaxed))
+        {
+            g_received.fetch_add(buf->readableBytes(), std::memory_order_relaxed);
+        }
+
+        buf->retrieveAll();
+    }
+
+    void sendChunk(const TcpConnectionPtr& conn)
+    {
+        conn->send(g_chunk.data(), static_cast<int>(g_chunk.size()));
+    }
+
+    void onClientConnection(const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            if(g_writeLimit > 0)
+            {
+                conn->addRateLimiter(kLimitWriteBytes,
+                                     std::make_shared<TokenBucket>(g_writeLimit, g_writeLimit / 5));
+            }
+
+#ifdef MUDUO_HAVE_OPENSSL
+
+            if(conn->tlsSession() && conn->tlsSession()->kernelTx())
+            {
+                ++g_kernelTx;
+            }
+
+#endif
+            sendChunk(conn);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "BandwidthBench [connections=1] [chunkSize=65536] "
+                     "[serverThreads=1] [clientThreads=1] [warmupMs=500] [durationMs=3000] "
+                     "[port=20073] [poller=epoll] [readBudget=0] [readLimit=0] "
+                     "[serverReadLimit=0] [writeLimit=0] [tls=0] [cert=] [key=]");
+    int connections = static_cast<int>(args.getInt("connections", 1));
+    size_t chunkSize = static_cast<size_t>(args.getInt("chunkSize", 65536));
+    int serverThreads = static_cast<int>(args.getInt("serverThreads", 1));
+    int clientThreads = static_cast<int>(args.getInt("clientThreads", 1));
+    int64_t warmupMs = args.getInt("warmupMs", 500);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20073));
+    size_t readBudget = static_cast<size_t>(args.getInt("readBudget", 0));
+    double readLimit = static_cast<double>(args.getInt("readLimit", 0));
+    double serverReadLimit = static_cast<double>(args.getInt("serverReadLimit", 0));
+    g_writeLimit = static_cast<double>(args.getInt("writeLimit", 0));
+    bool tls = args.getInt("tls", 0) != 0;
+    std::string certFile = args.getString("cert", "");
+    std::string keyFile = args.getString("key", "");
+    Bench::selectPoller(args);
+    args.check();
+
+#ifdef MUDUO_HAVE_OPENSSL
+    TlsContextPtr serverTls;
+    TlsContextPtr clientTls;
+
+    if(tls)
+    {
+        if(certFile.empty())
+        {
+            certFile = "/tmp/BandwidthBench-cert.pem";
+            keyFile = "/tmp/BandwidthBench-key.pem";
+            std::string command = "openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=localhost"
+                                  " -keyout " + keyFile + " -out " + certFile + " 2>/dev/null";
+
+            if(system(command.c_str()) != 0)
+            {
+                fprintf(stderr, "making a certificate failed, pass cert and key\n");
+                return 1;
+            }
+        }
+
+        serverTls = TlsContext::newServer(certFile, keyFile);
+        clientTls = TlsContext::newClient();
+
+        if(!serverTls || !clientTls)
+        {
+            return 1;
+        }
+
+        clientTls->setVerifyPeer(false);
+    }
+#else
+    if(tls)
+    {
+        fprintf(stderr, "tls needs a build with OpenSSL\n");
+        return 1;
+    }
+#endif
+
+    Bench::raiseFdLimit();
+    g_chunk.assign(chunkSize, 'x');
+
+    EventLoop loop;
+    InetAddress serverAddr("127.0.0.1", port);
+    TcpServer server(&loop, serverAddr, "BandwidthBench");
+    server.setMessageCallback(std::bind(onServerMessage, std::placeholders::_1,
+                                        std::placeholders::_2, std::placeholders::_3));
+    server.setConnectionRateLimit(kLimitReadBytes, readLimit, readLimit / 5);
+
+    if(serverReadLimit > 0)
+    {
+        server.setServerRateLimit(kLimitReadBytes, serverReadLimit, serverReadLimit / 5);
+    }
+
+#ifdef MUDUO_HAVE_OPENSSL
+    server.setTlsContext(serverTls);
+#endif
+    server.setThreadNum(serverThreads);
+    server.setThreadInitCallback([readBudget](EventLoop * serverLoop)
+    {
+        serverLoop->setReadBudget(readBudget);
+    });
+    server.start();
+
+    EventLoopThreadPool clientPool(&loop, "BandwidthBenchClient");
+    clientPool.setThreadNum(clientThreads);
+    clientPool.start();
+    std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+    std::vector<std::unique_ptr<TcpClient>> clients;
+
+    for(int i = 0; i < connections; ++i)
+    {
+        clients.emplace_back(new TcpClient(clientLoops[i % clientLoops.size()], serverAddr,
+                                           "BandwidthBench#" + std::to_string(i)));
+#ifdef MUDUO_HAVE_OPENSSL
+        clients.back()->setTlsContext(clientTls, "localhost");
+#endif
+        clients.back()->setConnectionCallback(onClientConnection);
+        clients.back()->setWriteCompleteCallback(sendChunk);
+        clients.back()->connect();
+    }
+
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs);
+    uint64_t received = g_received.load();
+
+    Bench::Report report("bandwidth");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("connections", static_cast<int64_t>(connections));
+    report.add("chunk_size", static_cast<int64_t>(chunkSize));
+    report.add("server_threads", static_cast<int64_t>(serverThreads));
+    report.add("client_threads", static_cast<int64_t>(clientThreads));
+    report.add("read_budget", static_cast<int64_t>(readBudget));
+    report.add("read_limit", static_cast<int64_t>(readLimit));
+    report.add("server_read_limit", static_cast<int64_t>(serverReadLimit));
+    report.add("write_limit", static_cast<int64_t>(g_writeLimit));
+
+    if(tls)
+    {
+        report.add("tls", static_cast<int64_t>(1));
+        report.add("kernel_tx", static_cast<int64_t>(g_kernelTx.load()));
+    }
+
+    report.add("bytes", static_cast<int64_t>(received));
+    report.add("mib_per_sec", received * 1e9 / elapsed / (1024 * 1024));
+    report.add("gbit_per_sec", received * 8.0 / elapsed);
+    report.print();
+
+    Bench::finish();
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+// Helpers shared by the net benchmarks.
+//
+// Every benchmark takes key=value arguments, unknown keys are rejected so a
+// typo can not silently fall back to a default, and prints one result line
+// of key=value pairs starting with bench=<name>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/Metrics.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/Poller.h"
+#include "net/SocketOps.h"
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+namespace MuduoPlus
+{
+    namespace Bench
+    {
+        inline int64_t nowNanos()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /// User plus system CPU time of the whole process, 0 where unknown.
+        inline int64_t cpuNanos()
+        {
+#ifndef WIN32
+            struct rusage usage;
+
+            if(getrusage(RUSAGE_SELF, &usage) == 0)
+            {
+                return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000LL +
+                       (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+            }
+
+#endif
+            return 0;
+        }
+
+        /// Many connections need more descriptors than the usual soft limit.
+        inline void raiseFdLimit()
+        {
+#ifndef WIN32
+            struct rlimit limit;
+
+            if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+            {
+                limit.rlim_cur = limit.rlim_max;
+                setrlimit(RLIMIT_NOFILE, &limit);
+            }
+
+#endif
+        }
+
+        /// Loop threads are still running when a benchmark is done and the
+        /// library has no orderly shutdown for them, so skip the teardown.
+        inline void finish()
+        {
+            fflush(stdout);
+            fflush(stderr);
+            _Exit(0);
+        }
+
+        /// Runs loop until the measurement window is over. measuring is true
+        /// from warmupMs to warmupMs + durationMs, the measured nanoseconds
+        /// are returned. cpu, if given, gets the process CPU time spent in
+        /// the window.
+        inline int64_t runWindow(EventLoop* loop, std::atomic<bool>* measuring,
+                                 int64_t warmupMs, int64_t durationMs, int64_t* cpu = NULL)
+        {
+            int64_t elapsed = 0;
+            std::thread control([ &]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(warmupMs));
+                int64_t start = nowNanos();
+                int64_t cpuStart = cpuNanos();
+                measuring->store(true);
+                std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+                measuring->store(false);
+                elapsed = nowNanos() - start;
+
+                if(cpu)
+                {
+                    *cpu = cpuNanos() - cpuStart;
+                }
+
+                loop->quit();
+            });
+
+            loop->loop();
+            control.join();
+            return elapsed;
+        }
+
+        /// Blocking connection for the thread-per-connection clients, -1 on error.
+        inline socket_t connectBlocking(InetAddress serverAddr)
+        {
+            socket_t fd = SocketOps::createSocket();
+
+            if(fd < 0)
+            {
+                return -1;
+            }
+
+            if(SocketOps::connect(fd, &serverAddr.getSockAddr(), serverAddr.getSockAddrLen()) < 0)
+            {
+                SocketOps::closeSocket(fd);
+                return -1;
+            }
+
+            SocketOps::setTcpNoDelay(fd, true);
+            return fd;
+        }
+
+        class Args
+        {
+        public:
+            Args(int argc, char* argv[], const char* usage)
+                : usage_(usage)
+            {
+                for(int i = 1; i < argc; ++i)
+                {
+                    const char* eq = strchr(argv[i], '=');
+
+                    if(!eq)
+                    {
+                        fail(argv[i]);
+                    }
+
+                    values_[std::string(argv[i], eq - argv[i])] = eq + 1;
+                }
+            }
+
+            int64_t getInt(const char* key, int64_t defaultValue)
+            {
+                known_.push_back(key);
+                auto it = values_.find(key);
+                return it == values_.end() ? defaultValue : atoll(it->second.c_str());
+            }
+
+            std::string getString(const char* key, const char* defaultValue)
+            {
+                known_.push_back(key);
+                auto it = values_.find(key);
+                return it == values_.end() ? defaultValue : it->second;
+            }
+
+            /// Call after all get*(), exits on unknown keys.
+            void check()
+            {
+                for(auto &pos : values_)
+                {
+                    bool found = false;
+
+                    for(auto &key : known_)
+                    {
+                        found = found || pos.first == key;
+                    }
+
+                    if(!found)
+                    {
+                        fail(pos.first.c_str());
+                    }
+                }
+            }
+
+        private:
+            void fail(const char* arg)
+            {
+                fprintf(stderr, "bad argument '%s'\nusage: %s\n", arg, usage_);
+                exit(1);
+            }
+
+            const char*                         usage_;
+            std::map<std::string, std::string>  values_;
+            std::vector<std::string>            known_;
+        };
+
+        /// poller=<backend> picks the Poller of every loop the benchmark
+        /// creates, see Poller::newPoller. Call before the loops exist.
+        inline void selectPoller(Args& args)
+        {
+            Poller::setDefaultBackend(args.getString("poller", Poller::defaultBackend().c_str()));
+        }
+
+        /// One line of key=value pairs in the order they were added.
+        class Report
+        {
+        public:
+            explicit Report(const char* name)
+            {
+                line_ = "bench=";
+                line_ += name;
+            }
+
+            void add(const char* key, int64_t value)
+            {
+                char buf[64];
+                snprintf(buf, sizeof buf, "%lld", (long long)value);
+                append(key, buf);
+            }
+
+            void add(const char* key, double value)
+            {
+                char buf[64];
+                snprintf(buf, sizeof buf, "%.1f", value);
+                append(key, buf);
+            }
+
+            void add(const char* key, const std::string& value)
+            {
+                append(key, value.c_str());
+            }
+
+            /// p50/p99/p999/max of histograms recorded in nanoseconds,
+            /// reported in microseconds.
+            void addLatency(const std::vector<const Histogram*>& histograms)
+            {
+                static const double kQuantiles[] = { 0.5, 0.99, 0.999, 1.0 };
+                static const char* kKeys[] = { "p50_us", "p99_us", "p999_us", "max_us" };
+                uint64_t buckets[Histogram::kBucketCount] = { 0 };
+                uint64_t total = 0;
+
+                for(auto &pos : histograms)
+                {
+                    for(int i = 0; i < Histogram::kBucketCount; ++i)
+                    {
+                        buckets[i] += pos->bucketCount(i);
+                        total += pos->bucketCount(i);
+                    }
+                }
+
+                for(int q = 0; q < 4; ++q)
+                {
+                    uint64_t target = static_cast<uint64_t>(kQuantiles[q] * total);
+                    uint64_t seen = 0;
+                    uint64_t bound = 0;
+
+                    for(int i = 0; i < Histogram::kBucketCount && total > 0; ++i)
+                    {
+                        seen += buckets[i];
+
+                        if(seen > target || seen == total)
+                        {
+                            bound = Histogram::bucketUpperBound(i);
+                            break;
+                        }
+                    }
+
+                    add(kKeys[q], bound / 1000.0);
+                }
+            }
+
+            void print()
+            {
+                printf("%s\n", line_.c_str());
+                fflush(stdout);
+            }
+
+        private:
+            void append(const char* key, const char* value)
+            {
+                line_ += " ";
+                line_ += key;
+                line_ += "=";
+                line_ += value;
+            }
+
+            std::string line_;
+        };
+    }
+}
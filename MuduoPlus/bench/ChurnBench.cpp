@@ -0,0 +1,121 @@
+// Connection churn over loopback. The server closes every connection as
+// soon as it is established, blocking clients reset it and connect again
+// right after they see the close.
+//
+// usage: ChurnBench [clients=4] [serverThreads=1] [warmupMs=500]
+//                   [durationMs=3000] [port=20071] [poller=epoll]
+
+#include <memory>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>       g_measuring(false);
+    std::atomic<int64_t>    g_failed(0);
+
+    void onServerConnection(const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            conn->forceClose();
+        }
+    }
+
+    void clientFunc(InetAddress serverAddr, Histogram* latency, Counter* completed)
+    {
+        char buf[64];
+
+        for(;;)
+        {
+            int64_t start = Bench::nowNanos();
+            socket_t fd = Bench::connectBlocking(serverAddr);
+
+            if(fd < 0)
+            {
+                ++g_failed;
+                continue;
+            }
+
+            while(::recv(fd, buf, sizeof buf, 0) > 0)
+                ;
+
+            // answer the server's FIN with a reset, otherwise the server side
+            // TIME_WAITs collide with reused ephemeral ports within seconds
+            struct linger lingerOpt;
+            lingerOpt.l_onoff = 1;
+            lingerOpt.l_linger = 0;
+            setsockopt(fd, SOL_SOCKET, SO_LINGER, (const char*)&lingerOpt, sizeof lingerOpt);
+            SocketOps::closeSocket(fd);
+
+            if(g_measuring.load(std::memory_order_relaxed))
+            {
+                latency->record(Bench::nowNanos() - start);
+                completed->add(1);
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "ChurnBench [clients=4] [serverThreads=1] [warmupMs=500] "
+                     "[durationMs=3000] [port=20071] [poller=epoll]");
+    int clients = static_cast<int>(args.getInt("clients", 4));
+    int serverThreads = static_cast<int>(args.getInt("serverThreads", 1));
+    int64_t warmupMs = args.getInt("warmupMs", 500);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20071));
+    Bench::selectPoller(args);
+    args.check();
+
+    Bench::raiseFdLimit();
+
+    EventLoop loop;
+    InetAddress serverAddr("127.0.0.1", port);
+    TcpServer server(&loop, serverAddr, "ChurnBench");
+    server.setConnectionCallback(onServerConnection);
+    server.setThreadNum(serverThreads);
+    server.start();
+
+    std::vector<std::unique_ptr<Histogram>> latencies;
+    std::vector<std::unique_ptr<Counter>> counters;
+
+    for(int i = 0; i < clients; ++i)
+    {
+        latencies.emplace_back(new Histogram);
+        counters.emplace_back(new Counter);
+        std::thread(clientFunc, serverAddr, latencies.back().get(),
+                    counters.back().get()).detach();
+    }
+
+    // connections closed after the window never reach the stopped accept
+    // loop, so the clients are not joined, finish() ends them
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs);
+
+    uint64_t completed = 0;
+    std::vector<const Histogram*> histograms;
+
+    for(int i = 0; i < clients; ++i)
+    {
+        completed += counters[i]->value();
+        histograms.push_back(latencies[i].get());
+    }
+
+    Bench::Report report("churn");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("clients", static_cast<int64_t>(clients));
+    report.add("server_threads", static_cast<int64_t>(serverThreads));
+    report.add("conns", static_cast<int64_t>(completed));
+    report.add("conns_per_sec", completed * 1e9 / elapsed);
+    report.add("failed", g_failed.load());
+    report.addLatency(histograms);
+    report.print();
+
+    Bench::finish();
+}
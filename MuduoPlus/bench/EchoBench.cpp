@@ -0,0 +1,261 @@
+// Echo ping-pong over loopback. Every client connection keeps one message
+// in flight and records its round trip time. transport=tcp6 runs it over
+// ::1 against a dual-stack [::] listener, unix or seqpacket over an abstract
+// unix socket. parts=N makes the server answer with N sends per message,
+// like header and body, deferredFlush=1 coalesces them on the server loops.
+// busyPollUs=N busy polls the server and client loops for N microseconds
+// after activity. server=coroutine echoes with a Coroutine.h handler instead
+// of the message callback, built with MUDUO_WITH_COROUTINES.
+//
+// usage: EchoBench [connections=100] [size=64] [serverThreads=1]
+//                  [clientThreads=1] [warmupMs=500] [durationMs=3000] [port=20070]
+//                  [poller=epoll] [transport=tcp] [parts=1] [deferredFlush=0]
+//                  [busyPollUs=0] [server=callback]
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpServer.h"
+
+#ifdef MUDUO_HAVE_COROUTINES
+#include "net/Coroutine.h"
+#endif
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>   g_measuring(false);
+    std::atomic<int>    g_connected(0);
+    size_t              g_parts = 1;
+
+    // one per client loop, only written by that loop
+    struct ClientStats
+    {
+        Histogram   rtt;
+        Counter     messages;
+    };
+
+    class Session : NonCopyable
+    {
+    public:
+        Session(EventLoop* loop, const InetAddress& serverAddr, const std::string& name,
+                size_t size, int socketType, ClientStats* stats)
+            : client_(loop, serverAddr, name),
+              message_(size, 'x'),
+              sentAt_(0),
+              stats_(stats)
+        {
+            client_.setSocketType(socketType);
+            client_.setConnectionCallback(
+                std::bind(&Session::onConnection, this, std::placeholders::_1));
+            client_.setMessageCallback(
+                std::bind(&Session::onMessage, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+        }
+
+        void connect()
+        {
+            client_.connect();
+        }
+
+    private:
+        void onConnection(const TcpConnectionPtr& conn)
+        {
+            if(conn->connected())
+            {
+                conn->setTcpNoDelay(true);
+                ++g_connected;
+                send(conn);
+            }
+        }
+
+        void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+        {
+            if(buf->readableBytes() < message_.size())
+            {
+                return;
+            }
+
+            buf->retrieve(message_.size());
+
+            if(g_measuring.load(std::memory_order_relaxed))
+            {
+                stats_->rtt.record(Bench::nowNanos() - sentAt_);
+                stats_->messages.add(1);
+            }
+
+            send(conn);
+        }
+
+        void send(const TcpConnectionPtr& conn)
+        {
+            sentAt_ = Bench::nowNanos();
+            conn->send(message_.data(), static_cast<int>(message_.size()));
+        }
+
+        TcpClient       client_;
+        std::string     message_;
+        int64_t         sentAt_;
+        ClientStats*    stats_;
+    };
+
+    void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        size_t len = buf->readableBytes();
+        size_t partSize = (len + g_parts - 1) / g_parts;
+
+        for(size_t offset = 0; offset < len; offset += partSize)
+        {
+            conn->send(buf->peek() + offset, static_cast<int>(std::min(partSize, len - offset)));
+        }
+
+        buf->retrieveAll();
+    }
+
+#ifdef MUDUO_HAVE_COROUTINES
+    Task<> coServerEcho(CoConnectionPtr conn)
+    {
+        while(Buffer* buf = co_await conn->readBuffer(1))
+        {
+            size_t len = buf->readableBytes();
+            size_t partSize = (len + g_parts - 1) / g_parts;
+            CoConnection::WriteAwaiter written = { NULL };
+
+            for(size_t offset = 0; offset < len; offset += partSize)
+            {
+                written = conn->write(StringPiece(buf->peek() + offset,
+                                                  static_cast<int>(std::min(partSize, len - offset))));
+            }
+
+            buf->retrieve(len);
+            co_await written;
+        }
+    }
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "EchoBench [connections=100] [size=64] [serverThreads=1] "
+                     "[clientThreads=1] [warmupMs=500] [durationMs=3000] [port=20070] "
+                     "[poller=epoll] [transport=tcp] [parts=1] [deferredFlush=0] "
+                     "[busyPollUs=0] [server=callback]");
+    int connections = static_cast<int>(args.getInt("connections", 100));
+    size_t size = static_cast<size_t>(args.getInt("size", 64));
+    int serverThreads = static_cast<int>(args.getInt("serverThreads", 1));
+    int clientThreads = static_cast<int>(args.getInt("clientThreads", 1));
+    int64_t warmupMs = args.getInt("warmupMs", 500);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20070));
+    std::string transport = args.getString("transport", "tcp");
+    g_parts = static_cast<size_t>(std::max<int64_t>(1, args.getInt("parts", 1)));
+    bool deferredFlush = args.getInt("deferredFlush", 0) != 0;
+    int64_t busyPollUs = args.getInt("busyPollUs", 0);
+    std::string serverKind = args.getString("server", "callback");
+    Bench::selectPoller(args);
+    args.check();
+
+#ifndef MUDUO_HAVE_COROUTINES
+
+    if(serverKind == "coroutine")
+    {
+        fprintf(stderr, "server=coroutine needs a build with MUDUO_WITH_COROUTINES\n");
+        return 1;
+    }
+
+#endif
+
+    int socketType = transport == "seqpacket" ? SOCK_SEQPACKET : SOCK_STREAM;
+
+    Bench::raiseFdLimit();
+
+    EventLoop loop;
+    InetAddress listenAddr = transport == "tcp6"
+                             ? InetAddress(port, false, true)
+                             : transport == "tcp"
+                             ? InetAddress("127.0.0.1", port)
+                             : InetAddress::fromUnixPath("@EchoBench." + std::to_string(port));
+    InetAddress serverAddr = transport == "tcp6" ? InetAddress("::1", port) : listenAddr;
+    TcpServer server(&loop, listenAddr, "EchoBench");
+    server.setSocketType(socketType);
+    server.setMessageCallback(std::bind(onServerMessage, std::placeholders::_1,
+                                        std::placeholders::_2, std::placeholders::_3));
+#ifdef MUDUO_HAVE_COROUTINES
+
+    if(serverKind == "coroutine")
+    {
+        coServe(&server, coServerEcho);
+    }
+
+#endif
+    server.setThreadNum(serverThreads);
+    server.setThreadInitCallback([deferredFlush, busyPollUs](EventLoop * serverLoop)
+    {
+        serverLoop->setDeferredFlush(deferredFlush);
+        serverLoop->setBusyPoll(busyPollUs);
+    });
+    server.start();
+
+    EventLoopThreadPool clientPool(&loop, "EchoBenchClient");
+    clientPool.setThreadNum(clientThreads);
+    clientPool.start([busyPollUs](EventLoop * clientLoop)
+    {
+        clientLoop->setBusyPoll(busyPollUs);
+    });
+    std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+
+    std::vector<std::unique_ptr<ClientStats>> stats;
+    std::vector<std::unique_ptr<Session>> sessions;
+
+    for(size_t i = 0; i < clientLoops.size(); ++i)
+    {
+        stats.emplace_back(new ClientStats);
+    }
+
+    for(int i = 0; i < connections; ++i)
+    {
+        size_t index = i % clientLoops.size();
+        sessions.emplace_back(new Session(clientLoops[index], serverAddr,
+                                          "EchoBench#" + std::to_string(i), size,
+                                          socketType, stats[index].get()));
+        sessions.back()->connect();
+    }
+
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs);
+
+    uint64_t messages = 0;
+    std::vector<const Histogram*> histograms;
+
+    for(auto &pos : stats)
+    {
+        messages += pos->messages.value();
+        histograms.push_back(&pos->rtt);
+    }
+
+    Bench::Report report("echo");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("transport", transport);
+    report.add("server", serverKind);
+    report.add("parts", static_cast<int64_t>(g_parts));
+    report.add("deferred_flush", static_cast<int64_t>(deferredFlush));
+    report.add("busy_poll_us", busyPollUs);
+    report.add("connections", static_cast<int64_t>(connections));
+    report.add("connected", static_cast<int64_t>(g_connected.load()));
+    report.add("size", static_cast<int64_t>(size));
+    report.add("server_threads", static_cast<int64_t>(serverThreads));
+    report.add("client_threads", static_cast<int64_t>(clientThreads));
+    report.add("msgs", static_cast<int64_t>(messages));
+    report.add("msgs_per_sec", messages * 1e9 / elapsed);
+    report.add("mib_per_sec", messages * size * 1e9 / elapsed / (1024 * 1024));
+    report.addLatency(histograms);
+    report.print();
+
+    Bench::finish();
+}
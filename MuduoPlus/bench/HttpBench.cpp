@@ -0,0 +1,275 @@
+// HTTP request rate over loopback. With client=blocking every client thread
+// keeps one keep-alive connection with one request in flight. With
+// client=async one HttpClient on the main loop keeps clients requests in
+// flight over at most connections pooled connections, pipeline of them
+// per connection. compress=N makes the server gzip bodies of at least N
+// bytes for the blocking clients, which send Accept-Encoding, the body is
+// then JSON-like text and wire_body_bytes shows what one took on the wire.
+//
+// usage: HttpBench [client=blocking] [clients=8] [connections=6] [pipeline=1]
+//                  [bodySize=64] [compress=0] [serverThreads=1] [warmupMs=500]
+//                  [durationMs=3000] [port=20072] [poller=epoll]
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/HttpClient.h"
+#include "net/HttpRequest.h"
+#include "net/HttpResponse.h"
+#include "net/HttpServer.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>       g_measuring(false);
+    std::atomic<bool>       g_running(true);
+    std::atomic<int64_t>    g_failed(0);
+    std::atomic<int64_t>    g_wireBodyBytes(0);
+    std::string             g_body;
+
+    void onRequest(const HttpRequest&, HttpResponse* resp)
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain");
+        resp->setBody(g_body);
+    }
+
+    // reads one response, pending keeps bytes that belong to the next one
+    bool readResponse(socket_t fd, std::string* pending)
+    {
+        char buf[16 * 1024];
+        size_t headerEnd = std::string::npos;
+        size_t expected = 0;
+
+        for(;;)
+        {
+            if(headerEnd == std::string::npos)
+            {
+                headerEnd = pending->find("\r\n\r\n");
+
+                if(headerEnd != std::string::npos)
+                {
+                    size_t pos = pending->find("Content-Length: ");
+
+                    if(pos == std::string::npos || pos > headerEnd)
+                    {
+                        return false;
+                    }
+
+                    int contentLength = atoi(pending->c_str() + pos + 16);
+                    g_wireBodyBytes.store(contentLength, std::memory_order_relaxed);
+                    expected = headerEnd + 4 + contentLength;
+                }
+            }
+
+            if(headerEnd != std::string::npos && pending->size() >= expected)
+            {
+                pending->erase(0, expected);
+                return true;
+            }
+
+            int n = ::recv(fd, buf, sizeof buf, 0);
+
+            if(n <= 0)
+            {
+                return false;
+            }
+
+            pending->append(buf, n);
+        }
+    }
+
+    void clientFunc(InetAddress serverAddr, Histogram* latency, Counter* completed)
+    {
+        static const char kRequest[] =
+            "GET /bench HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: Keep-Alive\r\n"
+            "Accept-Encoding: gzip\r\n\r\n";
+        std::string pending;
+        socket_t fd = Bench::connectBlocking(serverAddr);
+
+        while(g_running.load(std::memory_order_relaxed))
+        {
+            if(fd < 0)
+            {
+                ++g_failed;
+                return;
+            }
+
+            int64_t start = Bench::nowNanos();
+
+            if(SocketOps::send(fd, kRequest, sizeof kRequest - 1) != sizeof kRequest - 1
+                    || !readResponse(fd, &pending))
+            {
+                ++g_failed;
+                SocketOps::closeSocket(fd);
+                pending.clear();
+                fd = Bench::connectBlocking(serverAddr);
+                continue;
+            }
+
+            if(g_measuring.load(std::memory_order_relaxed))
+            {
+                latency->record(Bench::nowNanos() - start);
+                completed->add(1);
+            }
+        }
+
+        SocketOps::closeSocket(fd);
+    }
+
+    // one request, its callback sends the next
+    void asyncRequest(HttpClient* client, uint16_t port, Histogram* latency, Counter* completed)
+    {
+        int64_t start = Bench::nowNanos();
+
+        client->get("127.0.0.1", port, "/bench", [ = ](const HttpClientResponse & resp)
+        {
+            if(!resp.ok() || resp.statusCode() != 200 || resp.body().readableBytes() != g_body.size())
+            {
+                ++g_failed;
+            }
+            else if(g_measuring.load(std::memory_order_relaxed))
+            {
+                latency->record(Bench::nowNanos() - start);
+                completed->add(1);
+            }
+
+            if(g_running.load(std::memory_order_relaxed))
+            {
+                asyncRequest(client, port, latency, completed);
+            }
+        });
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "HttpBench [client=blocking] [clients=8] [connections=6] "
+                     "[pipeline=1] [bodySize=64] [compress=0] [serverThreads=1] [warmupMs=500] "
+                     "[durationMs=3000] [port=20072] [poller=epoll]");
+    std::string clientMode = args.getString("client", "blocking");
+    int clients = static_cast<int>(args.getInt("clients", 8));
+    int connections = static_cast<int>(args.getInt("connections", 6));
+    int pipeline = static_cast<int>(args.getInt("pipeline", 1));
+    size_t bodySize = static_cast<size_t>(args.getInt("bodySize", 64));
+    size_t compress = static_cast<size_t>(args.getInt("compress", 0));
+    int serverThreads = static_cast<int>(args.getInt("serverThreads", 1));
+    int64_t warmupMs = args.getInt("warmupMs", 500);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20072));
+    Bench::selectPoller(args);
+    args.check();
+
+    if(clientMode != "blocking" && clientMode != "async")
+    {
+        fprintf(stderr, "client is blocking or async\n");
+        return 1;
+    }
+
+#ifndef MUDUO_HAVE_ZLIB
+    if(compress > 0)
+    {
+        fprintf(stderr, "compress needs a build with zlib\n");
+        return 1;
+    }
+#endif
+
+    Bench::raiseFdLimit();
+
+    if(compress > 0)
+    {
+        for(int i = 0; g_body.size() < bodySize; ++i)
+        {
+            g_body += "{\"id\":" + std::to_string(i * 7919 % 100003) + ",\"name\":\"user" +
+                      std::to_string(i) + "\",\"active\":" + (i % 3 ? "true" : "false") + "},";
+        }
+
+        g_body.resize(bodySize);
+    }
+    else
+    {
+        g_body.assign(bodySize, 'x');
+    }
+
+    EventLoop loop;
+    InetAddress serverAddr("127.0.0.1", port);
+    HttpServer server(&loop, serverAddr, "HttpBench");
+    server.setHttpCallback(onRequest);
+#ifdef MUDUO_HAVE_ZLIB
+    server.setCompression(compress);
+#endif
+    server.setThreadNum(serverThreads);
+    server.start();
+
+    std::vector<std::unique_ptr<Histogram>> latencies;
+    std::vector<std::unique_ptr<Counter>> counters;
+    std::vector<std::thread> threads;
+    HttpClient client(&loop, "HttpBenchClient");
+    client.setMaxConnectionsPerHost(connections);
+    client.setMaxPipeline(pipeline);
+
+    for(int i = 0; i < clients; ++i)
+    {
+        latencies.emplace_back(new Histogram);
+        counters.emplace_back(new Counter);
+
+        if(clientMode == "async")
+        {
+            asyncRequest(&client, port, latencies.back().get(), counters.back().get());
+        }
+        else
+        {
+            threads.push_back(std::thread(clientFunc, serverAddr, latencies.back().get(),
+                                          counters.back().get()));
+        }
+    }
+
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs);
+    g_running = false;
+
+    for(auto &pos : threads)
+    {
+        pos.join();
+    }
+
+    uint64_t completed = 0;
+    std::vector<const Histogram*> histograms;
+
+    for(int i = 0; i < clients; ++i)
+    {
+        completed += counters[i]->value();
+        histograms.push_back(latencies[i].get());
+    }
+
+    Bench::Report report("http");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("client", clientMode);
+    report.add("clients", static_cast<int64_t>(clients));
+
+    if(clientMode == "async")
+    {
+        report.add("connections", static_cast<int64_t>(connections));
+        report.add("pipeline", static_cast<int64_t>(pipeline));
+    }
+
+    report.add("body_size", static_cast<int64_t>(bodySize));
+
+    if(compress > 0)
+    {
+        report.add("compress", static_cast<int64_t>(compress));
+        report.add("wire_body_bytes", g_wireBodyBytes.load());
+    }
+
+    report.add("server_threads", static_cast<int64_t>(serverThreads));
+    report.add("requests", static_cast<int64_t>(completed));
+    report.add("requests_per_sec", completed * 1e9 / elapsed);
+    report.add("failed", g_failed.load());
+    report.addLatency(histograms);
+    report.print();
+
+    Bench::finish();
+}
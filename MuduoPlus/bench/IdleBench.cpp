@@ -0,0 +1,237 @@
+// Idle kicking under load. Active connections ping-pong small messages while
+// silent ones wait to be closed by the server's read idle timeout.
+// mode=wheel uses TcpServer::setIdleTimeouts, mode=timer the classic way of
+// cancelling and re-adding a runAfter timer on every message, mode=off has
+// no idle handling. The p*_us latencies are how long after idleMs the
+// silent connections saw their close.
+//
+// usage: IdleBench [mode=wheel] [connections=1000] [silent=100] [idleMs=1000]
+//                  [size=64] [clientThreads=1] [warmupMs=500] [durationMs=3000]
+//                  [port=20077] [poller=epoll]
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>   g_measuring(false);
+    std::atomic<int>    g_silentClosed(0);
+    double              g_idleSeconds = 1.0;
+
+    struct ClientStats
+    {
+        Counter     messages;
+        Histogram   late;
+    };
+
+    class Session : NonCopyable
+    {
+    public:
+        Session(EventLoop* loop, const InetAddress& serverAddr, const std::string& name,
+                size_t size, bool silent, int64_t idleNanos, ClientStats* stats)
+            : client_(loop, serverAddr, name),
+              message_(size, 'x'),
+              silent_(silent),
+              idleNanos_(idleNanos),
+              connectedAt_(0),
+              stats_(stats)
+        {
+            client_.setConnectionCallback(
+                std::bind(&Session::onConnection, this, std::placeholders::_1));
+            client_.setMessageCallback(
+                std::bind(&Session::onMessage, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+        }
+
+        void connect()
+        {
+            client_.connect();
+        }
+
+    private:
+        void onConnection(const TcpConnectionPtr& conn)
+        {
+            if(conn->connected())
+            {
+                connectedAt_ = Bench::nowNanos();
+                conn->setTcpNoDelay(true);
+
+                if(!silent_)
+                {
+                    conn->send(message_);
+                }
+            }
+            else if(silent_)
+            {
+                // the server's clock starts a little earlier than ours
+                stats_->late.record(std::max<int64_t>(0, Bench::nowNanos() - connectedAt_ - idleNanos_));
+                ++g_silentClosed;
+            }
+        }
+
+        void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+        {
+            if(buf->readableBytes() < message_.size())
+            {
+                return;
+            }
+
+            buf->retrieve(message_.size());
+
+            if(g_measuring.load(std::memory_order_relaxed))
+            {
+                stats_->messages.add(1);
+            }
+
+            conn->send(message_);
+        }
+
+        TcpClient       client_;
+        std::string     message_;
+        bool            silent_;
+        int64_t         idleNanos_;
+        int64_t         connectedAt_;
+        ClientStats*    stats_;
+    };
+
+    void kickAfterIdle(const TcpConnectionPtr& conn)
+    {
+        std::weak_ptr<TcpConnection> weakConn = conn;
+        conn->setContext(conn->getLoop()->runAfter(g_idleSeconds, [weakConn]()
+        {
+            if(TcpConnectionPtr conn = weakConn.lock())
+            {
+                conn->forceClose();
+            }
+        }));
+    }
+
+    void onTimerConnection(const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            kickAfterIdle(conn);
+        }
+        else if(conn->getContext().Is<TimerId>())
+        {
+            conn->getLoop()->cancel(conn->getContext().AnyCast<TimerId>());
+        }
+    }
+
+    void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp, bool timerMode)
+    {
+        if(timerMode)
+        {
+            conn->getLoop()->cancel(conn->getContext().AnyCast<TimerId>());
+            kickAfterIdle(conn);
+        }
+
+        conn->send(buf->peek(), static_cast<int>(buf->readableBytes()));
+        buf->retrieveAll();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "IdleBench [mode=wheel] [connections=1000] [silent=100] "
+                     "[idleMs=1000] [size=64] [clientThreads=1] [warmupMs=500] "
+                     "[durationMs=3000] [port=20077] [poller=epoll]");
+    std::string mode = args.getString("mode", "wheel");
+    int connections = static_cast<int>(args.getInt("connections", 1000));
+    int silent = static_cast<int>(args.getInt("silent", 100));
+    int64_t idleMs = args.getInt("idleMs", 1000);
+    size_t size = static_cast<size_t>(args.getInt("size", 64));
+    int clientThreads = static_cast<int>(args.getInt("clientThreads", 1));
+    int64_t warmupMs = args.getInt("warmupMs", 500);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20077));
+    Bench::selectPoller(args);
+    args.check();
+
+    if(mode != "wheel" && mode != "timer" && mode != "off")
+    {
+        fprintf(stderr, "mode is wheel, timer or off\n");
+        return 1;
+    }
+
+    Bench::raiseFdLimit();
+    g_idleSeconds = idleMs / 1000.0;
+    bool timerMode = mode == "timer";
+
+    EventLoop loop;
+    InetAddress serverAddr("127.0.0.1", port);
+    TcpServer server(&loop, serverAddr, "IdleBench");
+    server.setMessageCallback(std::bind(onServerMessage, std::placeholders::_1,
+                                        std::placeholders::_2, std::placeholders::_3,
+                                        timerMode));
+
+    if(timerMode)
+    {
+        server.setConnectionCallback(onTimerConnection);
+    }
+    else if(mode == "wheel")
+    {
+        server.setIdleTimeouts(g_idleSeconds, 0, 0);
+    }
+
+    server.start();
+
+    EventLoopThreadPool clientPool(&loop, "IdleBenchClient");
+    clientPool.setThreadNum(clientThreads);
+    clientPool.start();
+    std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+
+    std::vector<std::unique_ptr<ClientStats>> stats;
+    std::vector<std::unique_ptr<Session>> sessions;
+
+    for(size_t i = 0; i < clientLoops.size(); ++i)
+    {
+        stats.emplace_back(new ClientStats);
+    }
+
+    for(int i = 0; i < connections + silent; ++i)
+    {
+        size_t index = i % clientLoops.size();
+        sessions.emplace_back(new Session(clientLoops[index], serverAddr,
+                                          "IdleBench#" + std::to_string(i), size,
+                                          i >= connections, idleMs * 1000000,
+                                          stats[index].get()));
+        sessions.back()->connect();
+    }
+
+    int64_t cpu = 0;
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs, &cpu);
+
+    uint64_t messages = 0;
+    std::vector<const Histogram*> histograms;
+
+    for(auto &pos : stats)
+    {
+        messages += pos->messages.value();
+        histograms.push_back(&pos->late);
+    }
+
+    Bench::Report report("idle");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("mode", mode);
+    report.add("connections", static_cast<int64_t>(connections));
+    report.add("silent", static_cast<int64_t>(silent));
+    report.add("idle_ms", idleMs);
+    report.add("msgs_per_sec", messages * 1e9 / elapsed);
+    report.add("cpu_us_per_msg", messages > 0 ? cpu / 1e3 / messages : 0.0);
+    report.add("silent_closed", static_cast<int64_t>(g_silentClosed.load()));
+    report.addLatency(histograms);
+    report.print();
+
+    Bench::finish();
+}
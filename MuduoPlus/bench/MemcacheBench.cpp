@@ -0,0 +1,327 @@
+// End to end cache workload against the memcached example served in
+// process. Every client connection first stores its share of the keys,
+// then keeps depth requests pipelined, a get for getRatio percent of them
+// and a set otherwise, on uniformly random keys. p*_us is the time from
+// sending a request to the end of its answer.
+//
+// usage: MemcacheBench [connections=10] [depth=8] [keys=10000] [valueSize=100]
+//                      [getRatio=90] [memoryMB=64] [shards=0]
+//                      [serverThreads=2] [clientThreads=2] [warmupMs=1000]
+//                      [durationMs=3000] [port=20080] [poller=epoll]
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "examples/memcached/MemcacheServer.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/TcpClient.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>   g_measuring(false);
+    std::atomic<int>    g_errors(0);
+
+    struct ClientStats
+    {
+        Counter     requests;
+        Counter     hits;
+        Counter     misses;
+        Histogram   latency;
+    };
+
+    class Session : NonCopyable
+    {
+    public:
+        Session(EventLoop* loop, const InetAddress& serverAddr, const std::string& name, int index,
+                int connections, int depth, int keys, size_t valueSize, int getRatio,
+                ClientStats* stats)
+            : client_(loop, serverAddr, name),
+              index_(index),
+              connections_(connections),
+              depth_(depth),
+              keys_(keys),
+              getRatio_(getRatio),
+              value_(valueSize, 'v'),
+              preloading_(0),
+              seed_(0x9e3779b97f4a7c15ULL * (index + 1)),
+              stats_(stats)
+        {
+            client_.setConnectionCallback(
+                std::bind(&Session::onConnection, this, std::placeholders::_1));
+            client_.setMessageCallback(
+                std::bind(&Session::onMessage, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+        }
+
+        void connect()
+        {
+            client_.connect();
+        }
+
+    private:
+        struct Pending
+        {
+            bool        get;
+            int64_t     sentAt;
+        };
+
+        void onConnection(const TcpConnectionPtr& conn)
+        {
+            if(!conn->connected())
+            {
+                return;
+            }
+
+            conn->setTcpNoDelay(true);
+
+            for(int key = index_; key < keys_; key += connections_)
+            {
+                sendSet(conn, key);
+                ++preloading_;
+            }
+
+            if(preloading_ == 0)
+            {
+                startWorkload(conn);
+            }
+        }
+
+        void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+        {
+            while(!pending_.empty())
+            {
+                const char* eol = buf->findEOL();
+
+                if(eol == NULL)
+                {
+                    return;
+                }
+
+                size_t lineLen = eol + 1 - buf->peek();
+                Pending request = pending_.front();
+                bool hit = false;
+
+                if(request.get && buf->readableBytes() > 6 && memcmp(buf->peek(), "VALUE ", 6) == 0)
+                {
+                    const char* bytesAt = eol;
+
+                    while(bytesAt > buf->peek() && bytesAt[-1] != ' ')
+                    {
+                        --bytesAt;
+                    }
+
+                    size_t total = lineLen + static_cast<size_t>(atol(bytesAt)) + 2 + 5;
+
+                    if(buf->readableBytes() < total)
+                    {
+                        return;
+                    }
+
+                    if(memcmp(buf->peek() + total - 5, "END\r\n", 5) != 0)
+                    {
+                        ++g_errors;
+                    }
+
+                    buf->retrieve(total);
+                    hit = true;
+                }
+                else
+                {
+                    if(memcmp(buf->peek(), request.get ? "END\r\n" : "STORED\r\n", lineLen) != 0)
+                    {
+                        ++g_errors;
+                    }
+
+                    buf->retrieve(lineLen);
+                }
+
+                pending_.pop_front();
+
+                if(preloading_ > 0)
+                {
+                    if(--preloading_ == 0)
+                    {
+                        startWorkload(conn);
+                    }
+
+                    continue;
+                }
+
+                if(g_measuring.load(std::memory_order_relaxed))
+                {
+                    stats_->requests.add(1);
+                    stats_->latency.record(Bench::nowNanos() - request.sentAt);
+
+                    if(request.get)
+                    {
+                        (hit ? stats_->hits : stats_->misses).add(1);
+                    }
+                }
+
+                sendNext(conn);
+            }
+        }
+
+        void startWorkload(const TcpConnectionPtr& conn)
+        {
+            for(int i = 0; i < depth_; ++i)
+            {
+                sendNext(conn);
+            }
+        }
+
+        void sendNext(const TcpConnectionPtr& conn)
+        {
+            int key = static_cast<int>(next() % keys_);
+
+            if(static_cast<int>(next() % 100) < getRatio_)
+            {
+                request_.assign("get ");
+                appendKey(key);
+                request_.append("\r\n");
+                pending_.push_back(Pending { true, Bench::nowNanos() });
+                conn->send(request_);
+            }
+            else
+            {
+                sendSet(conn, key);
+            }
+        }
+
+        void sendSet(const TcpConnectionPtr& conn, int key)
+        {
+            char tail[32];
+            snprintf(tail, sizeof tail, " 0 0 %zu\r\n", value_.size());
+            request_.assign("set ");
+            appendKey(key);
+            request_.append(tail).append(value_).append("\r\n");
+            pending_.push_back(Pending { false, Bench::nowNanos() });
+            conn->send(request_);
+        }
+
+        void appendKey(int key)
+        {
+            char text[32];
+            snprintf(text, sizeof text, "key:%08d", key);
+            request_.append(text);
+        }
+
+        uint64_t next()
+        {
+            // xorshift64
+            seed_ ^= seed_ << 13;
+            seed_ ^= seed_ >> 7;
+            seed_ ^= seed_ << 17;
+            return seed_;
+        }
+
+        TcpClient           client_;
+        int                 index_;
+        int                 connections_;
+        int                 depth_;
+        int                 keys_;
+        int                 getRatio_;
+        std::string         value_;
+        std::string         request_;
+        std::deque<Pending> pending_;
+        int                 preloading_;    // stores of the preload not answered yet
+        uint64_t            seed_;
+        ClientStats*        stats_;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "MemcacheBench [connections=10] [depth=8] [keys=10000] "
+                     "[valueSize=100] [getRatio=90] [memoryMB=64] [shards=0] "
+                     "[serverThreads=2] [clientThreads=2] [warmupMs=1000] "
+                     "[durationMs=3000] [port=20080] [poller=epoll]");
+    int connections = static_cast<int>(args.getInt("connections", 10));
+    int depth = static_cast<int>(args.getInt("depth", 8));
+    int keys = static_cast<int>(args.getInt("keys", 10000));
+    size_t valueSize = static_cast<size_t>(args.getInt("valueSize", 100));
+    int getRatio = static_cast<int>(args.getInt("getRatio", 90));
+    size_t memoryMB = static_cast<size_t>(args.getInt("memoryMB", 64));
+    int shards = static_cast<int>(args.getInt("shards", 0));
+    int serverThreads = static_cast<int>(args.getInt("serverThreads", 2));
+    int clientThreads = static_cast<int>(args.getInt("clientThreads", 2));
+    int64_t warmupMs = args.getInt("warmupMs", 1000);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20080));
+    Bench::selectPoller(args);
+    args.check();
+
+    Bench::raiseFdLimit();
+
+    EventLoop loop;
+    InetAddress serverAddr("127.0.0.1", port);
+    MemcacheServer server(&loop, serverAddr, memoryMB * 1024 * 1024, shards);
+    server.setThreadNum(serverThreads);
+    server.start();
+
+    EventLoopThreadPool clientPool(&loop, "MemcacheBenchClient");
+    clientPool.setThreadNum(clientThreads);
+    clientPool.start();
+    std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+
+    std::vector<std::unique_ptr<ClientStats>> stats;
+    std::vector<std::unique_ptr<Session>> sessions;
+
+    for(size_t i = 0; i < clientLoops.size(); ++i)
+    {
+        stats.emplace_back(new ClientStats);
+    }
+
+    for(int i = 0; i < connections; ++i)
+    {
+        size_t index = i % clientLoops.size();
+        sessions.emplace_back(new Session(clientLoops[index], serverAddr,
+                                          "MemcacheBench#" + std::to_string(i), i, connections,
+                                          depth, keys, valueSize, getRatio, stats[index].get()));
+        Session* session = sessions.back().get();
+        clientLoops[index]->runInLoop([session]()
+        {
+            session->connect();
+        });
+    }
+
+    int64_t cpu = 0;
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs, &cpu);
+
+    uint64_t requests = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    std::vector<const Histogram*> histograms;
+
+    for(auto &pos : stats)
+    {
+        requests += pos->requests.value();
+        hits += pos->hits.value();
+        misses += pos->misses.value();
+        histograms.push_back(&pos->latency);
+    }
+
+    CacheShard::Stats cache = server.stats();
+
+    Bench::Report report("memcache");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("connections", static_cast<int64_t>(connections));
+    report.add("depth", static_cast<int64_t>(depth));
+    report.add("keys", static_cast<int64_t>(keys));
+    report.add("valueSize", static_cast<int64_t>(valueSize));
+    report.add("getRatio", static_cast<int64_t>(getRatio));
+    report.add("ops_per_sec", requests * 1e9 / elapsed);
+    report.add("cpu_us_per_op", requests > 0 ? cpu / 1e3 / requests : 0.0);
+    report.add("hit_rate", hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0);
+    report.add("evictions", static_cast<int64_t>(cache.evictions));
+    report.add("errors", static_cast<int64_t>(g_errors.load()));
+    report.addLatency(histograms);
+    report.print();
+
+    Bench::finish();
+}
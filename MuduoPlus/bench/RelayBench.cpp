@@ -0,0 +1,171 @@
+// Relay from a fast producer to a slow consumer over loopback. The producer
+// writes chunks back to back into a relay, which forwards them to a sink
+// that only reads readMs out of every 10 milliseconds. backpressure=1 pauses
+// the relay's reads from the producer above highMark queued bytes until the
+// output drained to lowMark, backpressure=0 lets the relay queue whatever
+// arrives. Compare peak_queued, the most output the relay held.
+//
+// usage: RelayBench [backpressure=1] [chunkSize=65536] [readMs=1]
+//                   [highMark=4194304] [lowMark=1048576] [warmupMs=500]
+//                   [durationMs=3000] [port=20076]
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "BenchCommon.h"
+#include "net/TcpClient.h"
+#include "net/TcpServer.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>   g_measuring(false);
+    uint64_t            g_received = 0;
+    size_t              g_peakQueued = 0;
+    std::string         g_chunk;
+    TcpConnectionPtr    g_inbound;      // producer side of the relay
+    TcpConnectionPtr    g_outbound;     // sink side of the relay
+    TcpConnectionPtr    g_sinkConn;
+
+    void onSinkMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+    {
+        if(g_measuring.load(std::memory_order_relaxed))
+        {
+            g_received += buf->readableBytes();
+        }
+
+        buf->retrieveAll();
+    }
+
+    void onRelayMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+    {
+        if(!g_outbound)
+        {
+            return;     // held in the input buffer until the sink is up
+        }
+
+        g_outbound->send(buf->peek(), static_cast<int>(buf->readableBytes()));
+        buf->retrieveAll();
+        g_peakQueued = std::max(g_peakQueued, g_outbound->pendingOutputBytes());
+    }
+
+    void sendChunk(const TcpConnectionPtr& conn)
+    {
+        conn->send(g_chunk.data(), static_cast<int>(g_chunk.size()));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "RelayBench [backpressure=1] [chunkSize=65536] [readMs=1] "
+                     "[highMark=4194304] [lowMark=1048576] [warmupMs=500] "
+                     "[durationMs=3000] [port=20076]");
+    bool backpressure = args.getInt("backpressure", 1) != 0;
+    size_t chunkSize = static_cast<size_t>(args.getInt("chunkSize", 65536));
+    int64_t readMs = args.getInt("readMs", 1);
+    size_t highMark = static_cast<size_t>(args.getInt("highMark", 4 * 1024 * 1024));
+    size_t lowMark = static_cast<size_t>(args.getInt("lowMark", 1024 * 1024));
+    int64_t warmupMs = args.getInt("warmupMs", 500);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20076));
+    args.check();
+
+    g_chunk.assign(chunkSize, 'x');
+
+    EventLoop loop;
+    InetAddress relayAddr("127.0.0.1", port);
+    InetAddress sinkAddr("127.0.0.1", static_cast<uint16_t>(port + 1));
+
+    TcpServer sink(&loop, sinkAddr, "RelayBenchSink");
+    sink.setConnectionCallback([](const TcpConnectionPtr & conn)
+    {
+        g_sinkConn = conn->connected() ? conn : TcpConnectionPtr();
+    });
+    sink.setMessageCallback(std::bind(onSinkMessage, std::placeholders::_1,
+                                      std::placeholders::_2, std::placeholders::_3));
+    sink.start();
+
+    // the sink reads readMs out of every 10ms
+    loop.runEvery(0.01, [&loop, readMs]()
+    {
+        if(g_sinkConn && readMs < 10)
+        {
+            g_sinkConn->startRead();
+            loop.runAfter(readMs / 1000.0, []()
+            {
+                if(g_sinkConn)
+                {
+                    g_sinkConn->stopRead();
+                }
+            });
+        }
+    });
+
+    TcpClient relayOut(&loop, sinkAddr, "RelayBenchOut");
+    relayOut.setConnectionCallback([ = ](const TcpConnectionPtr & conn)
+    {
+        if(!conn->connected())
+        {
+            g_outbound.reset();
+            return;
+        }
+
+        g_outbound = conn;
+        conn->setHighWaterMarkCallback(HighWaterMarkCallback(), highMark);
+        conn->setLowWaterMarkCallback(LowWaterMarkCallback(), lowMark);
+
+        if(backpressure && g_inbound)
+        {
+            conn->setBackpressureSource(g_inbound);
+        }
+    });
+
+    TcpServer relay(&loop, relayAddr, "RelayBench");
+    relay.setConnectionCallback([&relayOut](const TcpConnectionPtr & conn)
+    {
+        if(conn->connected())
+        {
+            g_inbound = conn;
+            relayOut.connect();
+        }
+        else
+        {
+            g_inbound.reset();
+        }
+    });
+    relay.setMessageCallback(std::bind(onRelayMessage, std::placeholders::_1,
+                                       std::placeholders::_2, std::placeholders::_3));
+    relay.start();
+
+    TcpClient producer(&loop, relayAddr, "RelayBenchProducer");
+    producer.setConnectionCallback([](const TcpConnectionPtr & conn)
+    {
+        if(conn->connected())
+        {
+            sendChunk(conn);
+        }
+    });
+    producer.setWriteCompleteCallback(sendChunk);
+    producer.connect();
+
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs);
+
+    Bench::Report report("relay");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("backpressure", static_cast<int64_t>(backpressure));
+    report.add("chunk_size", static_cast<int64_t>(chunkSize));
+    report.add("read_ms", readMs);
+    report.add("high_mark", static_cast<int64_t>(highMark));
+    report.add("low_mark", static_cast<int64_t>(lowMark));
+    report.add("bytes", static_cast<int64_t>(g_received));
+    report.add("mib_per_sec", g_received * 1e9 / elapsed / (1024 * 1024));
+    report.add("peak_queued", static_cast<int64_t>(g_peakQueued));
+    report.print();
+
+    g_inbound.reset();
+    g_outbound.reset();
+    g_sinkConn.reset();
+    Bench::finish();
+}
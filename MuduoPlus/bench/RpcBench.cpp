@@ -0,0 +1,177 @@
+// RPC round trips. Every client connection keeps depth calls in flight to
+// an echo method, each completion sends the next call, so depth > 1 shows
+// what multiplexing calls over one connection buys. p*_us is the time from
+// call() to the callback.
+//
+// usage: RpcBench [connections=1] [depth=1] [size=64] [serverThreads=0]
+//                 [clientThreads=1] [warmupMs=500] [durationMs=3000]
+//                 [port=20079] [poller=epoll]
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/RpcClient.h"
+#include "net/RpcServer.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>   g_measuring(false);
+    std::atomic<int>    g_failed(0);
+
+    struct EchoMessage
+    {
+        int64_t     seq;
+        std::string payload;
+
+        template <typename Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Serialize("seq", seq);
+            ar.Serialize("payload", payload);
+        }
+    };
+
+    struct ClientStats
+    {
+        Counter     calls;
+        Histogram   latency;
+    };
+
+    class Session : NonCopyable
+    {
+    public:
+        Session(EventLoop* loop, const InetAddress& serverAddr, const std::string& name,
+                size_t size, ClientStats* stats)
+            : client_(loop, serverAddr, name),
+              stats_(stats)
+        {
+            request_.seq = 0;
+            request_.payload.assign(size, 'x');
+        }
+
+        void start(int depth)
+        {
+            client_.connect();
+
+            for(int i = 0; i < depth; ++i)
+            {
+                call();
+            }
+        }
+
+    private:
+        void call()
+        {
+            int64_t start = Bench::nowNanos();
+            ++request_.seq;
+
+            client_.call<EchoMessage, EchoMessage>("Bench", "echo", request_,
+                                                   [this, start](RpcStatus status, const EchoMessage&)
+            {
+                if(status != kRpcOk)
+                {
+                    ++g_failed;
+                    return;
+                }
+
+                if(g_measuring.load(std::memory_order_relaxed))
+                {
+                    stats_->calls.add(1);
+                    stats_->latency.record(Bench::nowNanos() - start);
+                }
+
+                call();
+            });
+        }
+
+        RpcClient       client_;
+        EchoMessage     request_;
+        ClientStats*    stats_;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "RpcBench [connections=1] [depth=1] [size=64] "
+                     "[serverThreads=0] [clientThreads=1] [warmupMs=500] "
+                     "[durationMs=3000] [port=20079] [poller=epoll]");
+    int connections = static_cast<int>(args.getInt("connections", 1));
+    int depth = static_cast<int>(args.getInt("depth", 1));
+    size_t size = static_cast<size_t>(args.getInt("size", 64));
+    int serverThreads = static_cast<int>(args.getInt("serverThreads", 0));
+    int clientThreads = static_cast<int>(args.getInt("clientThreads", 1));
+    int64_t warmupMs = args.getInt("warmupMs", 500);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20079));
+    Bench::selectPoller(args);
+    args.check();
+
+    Bench::raiseFdLimit();
+
+    EventLoop loop;
+    InetAddress serverAddr("127.0.0.1", port);
+    RpcServer server(&loop, serverAddr, "RpcBench");
+    server.registerMethod<EchoMessage, EchoMessage>("Bench", "echo",
+                                                   [](const EchoMessage& request, EchoMessage* response)
+    {
+        *response = request;
+    });
+    server.setThreadNum(serverThreads);
+    server.start();
+
+    EventLoopThreadPool clientPool(&loop, "RpcBenchClient");
+    clientPool.setThreadNum(clientThreads);
+    clientPool.start();
+    std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+
+    std::vector<std::unique_ptr<ClientStats>> stats;
+    std::vector<std::unique_ptr<Session>> sessions;
+
+    for(size_t i = 0; i < clientLoops.size(); ++i)
+    {
+        stats.emplace_back(new ClientStats);
+    }
+
+    for(int i = 0; i < connections; ++i)
+    {
+        size_t index = i % clientLoops.size();
+        sessions.emplace_back(new Session(clientLoops[index], serverAddr,
+                                          "RpcBench#" + std::to_string(i), size,
+                                          stats[index].get()));
+        Session* session = sessions.back().get();
+        clientLoops[index]->runInLoop([session, depth]()
+        {
+            session->start(depth);
+        });
+    }
+
+    int64_t cpu = 0;
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs, &cpu);
+
+    uint64_t calls = 0;
+    std::vector<const Histogram*> histograms;
+
+    for(auto &pos : stats)
+    {
+        calls += pos->calls.value();
+        histograms.push_back(&pos->latency);
+    }
+
+    Bench::Report report("rpc");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("connections", static_cast<int64_t>(connections));
+    report.add("depth", static_cast<int64_t>(depth));
+    report.add("size", static_cast<int64_t>(size));
+    report.add("calls_per_sec", calls * 1e9 / elapsed);
+    report.add("cpu_us_per_call", calls > 0 ? cpu / 1e3 / calls : 0.0);
+    report.add("failed", static_cast<int64_t>(g_failed.load()));
+    report.addLatency(histograms);
+    report.print();
+
+    Bench::finish();
+}
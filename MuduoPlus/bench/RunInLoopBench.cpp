@@ -0,0 +1,114 @@
+// Cross-thread runInLoop throughput: producer threads post functors to one
+// loop thread as fast as they can. A 1ms timer ticks on the loop meanwhile,
+// the latency columns are the gaps between its ticks, functorBudget=N caps
+// the functors run per iteration so the ticks get through the flood.
+//
+// usage: RunInLoopBench [producers=4] [functorsPerProducer=1000000] [functorBudget=0]
+
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/EventLoopThread.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    // only written by the loop thread
+    int64_t                 g_executed = 0;
+    int64_t                 g_lastTick = 0;
+    Histogram               g_tickGaps;
+    std::atomic<int64_t>    g_doneAt(0);
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "RunInLoopBench [producers=4] [functorsPerProducer=1000000] "
+                     "[functorBudget=0]");
+    int producers = static_cast<int>(args.getInt("producers", 4));
+    int64_t perProducer = args.getInt("functorsPerProducer", 1000000);
+    size_t functorBudget = static_cast<size_t>(args.getInt("functorBudget", 0));
+    args.check();
+
+    const int64_t total = producers * perProducer;
+    EventLoopThread loopThread;
+    EventLoop* loop = loopThread.startLoop();
+    std::atomic<bool> ticking(false);
+
+    loop->runInLoop([ &]()
+    {
+        loop->setFunctorBudget(functorBudget);
+        loop->runEvery(0.001, []()
+        {
+            int64_t now = Bench::nowNanos();
+
+            if(g_lastTick != 0)
+            {
+                g_tickGaps.record(now - g_lastTick);
+            }
+
+            g_lastTick = now;
+        });
+        ticking = true;
+    });
+
+    while(!ticking.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<int64_t> postNanos(producers);
+    int64_t start = Bench::nowNanos();
+
+    for(int i = 0; i < producers; ++i)
+    {
+        threads.push_back(std::thread([ &, i]()
+        {
+            int64_t begin = Bench::nowNanos();
+
+            for(int64_t n = 0; n < perProducer; ++n)
+            {
+                loop->runInLoop([ &]()
+                {
+                    if(++g_executed == total)
+                    {
+                        g_doneAt = Bench::nowNanos();
+                    }
+                });
+            }
+
+            postNanos[i] = Bench::nowNanos() - begin;
+        }));
+    }
+
+    for(auto &pos : threads)
+    {
+        pos.join();
+    }
+
+    while(g_doneAt.load() == 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    int64_t elapsed = g_doneAt.load() - start;
+    int64_t postTotal = 0;
+
+    for(auto &pos : postNanos)
+    {
+        postTotal += pos;
+    }
+
+    Bench::Report report("run_in_loop");
+    report.add("producers", static_cast<int64_t>(producers));
+    report.add("functor_budget", static_cast<int64_t>(functorBudget));
+    report.add("functors", total);
+    report.add("functors_per_sec", total * 1e9 / elapsed);
+    report.add("post_ns", static_cast<double>(postTotal) / total);
+    report.add("loop_iterations", static_cast<int64_t>(loop->metrics().iterations.value()));
+    report.addLatency(std::vector<const Histogram*>(1, &g_tickGaps));
+    report.print();
+
+    Bench::finish();
+}
@@ -0,0 +1,102 @@
+// Timer add and cancel throughput in the loop thread. Expirations are
+// spread with a fixed seed so every run builds the same timer queue.
+// Then fires timers=fired short timers, up to 200ms out, and reports how
+// late they ran against their deadline.
+//
+// usage: TimerBench [timers=200000] [rounds=5] [fired=2000]
+
+#include <algorithm>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/TimerId.h"
+
+using namespace MuduoPlus;
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "TimerBench [timers=200000] [rounds=5] [fired=2000]");
+    int timers = static_cast<int>(args.getInt("timers", 200000));
+    int rounds = static_cast<int>(args.getInt("rounds", 5));
+    int fired = static_cast<int>(args.getInt("fired", 2000));
+    args.check();
+
+    EventLoop loop;
+    std::vector<TimerId> ids;
+    std::vector<double> delays;
+    uint32_t seed = 12345;
+    int64_t addNanos = 0;
+    int64_t cancelNanos = 0;
+
+    ids.reserve(timers);
+
+    for(int i = 0; i < timers; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        delays.push_back(60.0 + (seed >> 16) % 3600);
+    }
+
+    // runAfter() and cancel() run inline, this is the loop thread
+    for(int round = 0; round < rounds; ++round)
+    {
+        int64_t start = Bench::nowNanos();
+
+        for(int i = 0; i < timers; ++i)
+        {
+            ids.push_back(loop.runAfter(delays[i], []() {}));
+        }
+
+        int64_t added = Bench::nowNanos();
+
+        for(auto &pos : ids)
+        {
+            loop.cancel(pos);
+        }
+
+        cancelNanos += Bench::nowNanos() - added;
+        addNanos += added - start;
+        ids.clear();
+    }
+
+    int64_t total = static_cast<int64_t>(timers) * rounds;
+    Bench::Report report("timer");
+    report.add("timers", static_cast<int64_t>(timers));
+    report.add("rounds", static_cast<int64_t>(rounds));
+    report.add("adds_per_sec", total * 1e9 / addNanos);
+    report.add("cancels_per_sec", total * 1e9 / cancelNanos);
+    report.add("add_ns", static_cast<double>(addNanos) / total);
+    report.add("cancel_ns", static_cast<double>(cancelNanos) / total);
+    report.print();
+
+    Histogram lateness;
+    int pending = fired;
+
+    for(int i = 0; i < fired; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        int64_t delayUs = 1000 + (seed >> 16) % 199000;
+        int64_t due = Bench::nowNanos() + delayUs * 1000;
+
+        loop.runAfter(delayUs / 1e6, [&, due]()
+        {
+            lateness.record(std::max<int64_t>(0, Bench::nowNanos() - due));
+
+            if(--pending == 0)
+            {
+                loop.quit();
+            }
+        });
+    }
+
+    if(fired > 0)
+    {
+        loop.loop();
+    }
+
+    Bench::Report lateReport("timer_lateness");
+    lateReport.add("fired", static_cast<int64_t>(fired));
+    lateReport.addLatency(std::vector<const Histogram*>(1, &lateness));
+    lateReport.print();
+
+    Bench::finish();
+}
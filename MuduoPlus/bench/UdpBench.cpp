@@ -0,0 +1,166 @@
+// UDP echo over loopback. Every client socket keeps a window of datagrams
+// in flight, each carrying its send time, and re-sends on every echo.
+//
+// usage: UdpBench [clients=4] [window=16] [size=64] [batch=64] [serverThreads=1]
+//                 [clientThreads=1] [warmupMs=500] [durationMs=3000] [port=20074]
+//                 [poller=epoll]
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/UdpServer.h"
+#include "net/UdpSocket.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>   g_measuring(false);
+
+    // one per client socket, only written by its loop
+    struct ClientStats
+    {
+        Histogram   rtt;
+        Counter     datagrams;
+    };
+
+    void onServerDatagrams(const UdpSocketPtr& socket, const std::vector<Datagram>& batch,
+                           Timestamp)
+    {
+        for(auto &datagram : batch)
+        {
+            socket->sendTo(datagram.peer, datagram.data, datagram.size);
+        }
+    }
+
+    void sendProbe(const UdpSocketPtr& socket, const InetAddress& serverAddr, std::string* message)
+    {
+        int64_t now = Bench::nowNanos();
+        memcpy(&(*message)[0], &now, sizeof(now));
+        socket->sendTo(serverAddr, message->data(), message->size());
+    }
+
+    void onClientDatagrams(const UdpSocketPtr& socket, const std::vector<Datagram>& batch,
+                           Timestamp, InetAddress serverAddr, std::string* message,
+                           ClientStats* stats)
+    {
+        int64_t now = Bench::nowNanos();
+
+        for(auto &datagram : batch)
+        {
+            if(g_measuring.load(std::memory_order_relaxed) && datagram.size >= sizeof(int64_t))
+            {
+                int64_t sentAt = 0;
+                memcpy(&sentAt, datagram.data, sizeof(sentAt));
+                stats->rtt.record(now - sentAt);
+                stats->datagrams.add(1);
+            }
+
+            sendProbe(socket, serverAddr, message);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "UdpBench [clients=4] [window=16] [size=64] [batch=64] "
+                     "[serverThreads=1] [clientThreads=1] [warmupMs=500] [durationMs=3000] "
+                     "[port=20074] [poller=epoll]");
+    int clients = static_cast<int>(args.getInt("clients", 4));
+    int window = static_cast<int>(args.getInt("window", 16));
+    size_t size = static_cast<size_t>(args.getInt("size", 64));
+    size_t batch = static_cast<size_t>(args.getInt("batch", 64));
+    int serverThreads = static_cast<int>(args.getInt("serverThreads", 1));
+    int clientThreads = static_cast<int>(args.getInt("clientThreads", 1));
+    int64_t warmupMs = args.getInt("warmupMs", 500);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20074));
+    Bench::selectPoller(args);
+    args.check();
+
+    size = std::max(size, sizeof(int64_t));
+
+    EventLoop loop;
+    InetAddress serverAddr("127.0.0.1", port);
+    UdpServer server(&loop, serverAddr, "UdpBench");
+    server.setDatagramCallback(onServerDatagrams);
+    server.setBatchSize(batch);
+    server.setThreadNum(serverThreads);
+    server.start();
+
+    EventLoopThreadPool clientPool(&loop, "UdpBenchClient");
+    clientPool.setThreadNum(clientThreads);
+    clientPool.start();
+
+    // server sockets open in their own loops, a window sent before that
+    // would be lost for good
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+    std::vector<std::unique_ptr<ClientStats>> stats;
+    std::vector<std::unique_ptr<std::string>> messages;
+    std::vector<UdpSocketPtr> sockets;
+
+    for(int i = 0; i < clients; ++i)
+    {
+        EventLoop* clientLoop = clientLoops[i % clientLoops.size()];
+        stats.emplace_back(new ClientStats);
+        messages.emplace_back(new std::string(size, 'x'));
+        UdpSocketPtr socket = std::make_shared<UdpSocket>(clientLoop, InetAddress("127.0.0.1", 0),
+                                                          "UdpBench#" + std::to_string(i));
+        socket->setBatchSize(batch);
+        socket->setDatagramCallback(std::bind(onClientDatagrams, std::placeholders::_1,
+                                              std::placeholders::_2, std::placeholders::_3,
+                                              serverAddr, messages.back().get(),
+                                              stats.back().get()));
+        sockets.push_back(socket);
+        std::string* message = messages.back().get();
+
+        clientLoop->runInLoop([socket, serverAddr, message, window]()
+        {
+            if(socket->open())
+            {
+                for(int n = 0; n < window; ++n)
+                {
+                    sendProbe(socket, serverAddr, message);
+                }
+            }
+        });
+    }
+
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs);
+
+    uint64_t datagrams = 0;
+    uint64_t dropped = 0;
+    std::vector<const Histogram*> histograms;
+
+    for(int i = 0; i < clients; ++i)
+    {
+        datagrams += stats[i]->datagrams.value();
+        dropped += sockets[i]->datagramsDropped();
+        histograms.push_back(&stats[i]->rtt);
+    }
+
+    for(auto &socket : server.sockets())
+    {
+        dropped += socket->datagramsDropped();
+    }
+
+    Bench::Report report("udp");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("clients", static_cast<int64_t>(clients));
+    report.add("window", static_cast<int64_t>(window));
+    report.add("size", static_cast<int64_t>(size));
+    report.add("batch", static_cast<int64_t>(batch));
+    report.add("server_threads", static_cast<int64_t>(serverThreads));
+    report.add("client_threads", static_cast<int64_t>(clientThreads));
+    report.add("datagrams", static_cast<int64_t>(datagrams));
+    report.add("datagrams_per_sec", datagrams * 1e9 / elapsed);
+    report.add("dropped", static_cast<int64_t>(dropped));
+    report.addLatency(histograms);
+    report.print();
+
+    Bench::finish();
+}
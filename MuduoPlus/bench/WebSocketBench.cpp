@@ -0,0 +1,281 @@
+// WebSocket message rate over loopback. Clients upgrade through HttpServer
+// and send masked frames. mode=echo has every client keep one message in
+// flight that the server sends back. mode=broadcast sends each message to
+// all clients, the next round starts once every client acknowledged the
+// last one, fanout=shared encodes a round once for all connections and
+// fanout=copy encodes and copies it per connection.
+//
+// usage: WebSocketBench [mode=echo] [fanout=shared] [connections=100] [size=1024]
+//                       [serverThreads=0] [clientThreads=1] [warmupMs=500]
+//                       [durationMs=3000] [port=20078] [poller=epoll]
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BenchCommon.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/HttpServer.h"
+#include "net/TcpClient.h"
+#include "net/WebSocket.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<bool>       g_measuring(false);
+    std::atomic<uint64_t>   g_messages(0);
+    std::atomic<uint64_t>   g_bytes(0);
+    std::atomic<int>        g_acks(0);
+    bool                    g_broadcast = false;
+    bool                    g_sharedFanout = true;
+    int                     g_connections = 0;
+    std::string             g_payload;
+    std::mutex              g_mutex;
+    std::vector<WebSocketConnectionPtr> g_clients;      // @GuardedBy g_mutex
+
+    // a client frame, masked as RFC 6455 requires
+    std::string maskedFrame(const std::string& payload)
+    {
+        static const uint8_t kKey[4] = { 0x12, 0x34, 0x56, 0x78 };
+        std::string frame;
+        WebSocketConnection::appendFrame(&frame, WebSocketConnection::kBinary, payload);
+        size_t header = frame.size() - payload.size();
+        frame[1] = static_cast<char>(frame[1] | 0x80);
+        frame.insert(header, reinterpret_cast<const char*>(kKey), 4);
+        WebSocketConnection::mask(&frame[header + 4], payload.size(), kKey);
+        return frame;
+    }
+
+    void nextRound()
+    {
+        if(g_sharedFanout)
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            WebSocketConnection::broadcast(g_clients, g_payload, true);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+
+            for(auto &pos : g_clients)
+            {
+                pos->send(g_payload, true);
+            }
+        }
+    }
+
+    void onOpen(const WebSocketConnectionPtr& ws, const HttpRequest&)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_clients.push_back(ws);
+
+        if(g_broadcast && static_cast<int>(g_clients.size()) == g_connections)
+        {
+            WebSocketConnection::broadcast(g_clients, g_payload, true);
+        }
+    }
+
+    void onServerMessage(const WebSocketConnectionPtr& ws, const StringPiece& message, bool binary)
+    {
+        if(!g_broadcast)
+        {
+            ws->send(message, binary);
+        }
+        else if(++g_acks == g_connections)
+        {
+            g_acks = 0;
+            nextRound();
+        }
+    }
+
+    class Session : NonCopyable
+    {
+    public:
+        Session(EventLoop* loop, const InetAddress& serverAddr, const std::string& name)
+            : client_(loop, serverAddr, name),
+              upgraded_(false),
+              frame_(maskedFrame(g_broadcast ? std::string(1, 'a') : g_payload))
+        {
+            client_.setConnectionCallback(
+                std::bind(&Session::onConnection, this, std::placeholders::_1));
+            client_.setMessageCallback(
+                std::bind(&Session::onMessage, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+        }
+
+        void connect()
+        {
+            client_.connect();
+        }
+
+    private:
+        void onConnection(const TcpConnectionPtr& conn)
+        {
+            if(conn->connected())
+            {
+                conn->setTcpNoDelay(true);
+                conn->send("GET /ws HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\n"
+                           "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                           "Sec-WebSocket-Version: 13\r\n\r\n");
+            }
+        }
+
+        void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+        {
+            if(!upgraded_)
+            {
+                const char* end = std::search(buf->peek(), buf->peek() + buf->readableBytes(),
+                                              "\r\n\r\n", "\r\n\r\n" + 4);
+
+                if(end == buf->peek() + buf->readableBytes())
+                {
+                    return;
+                }
+
+                buf->retrieveUntil(end + 4);
+                upgraded_ = true;
+
+                if(!g_broadcast)
+                {
+                    conn->send(frame_);
+                }
+            }
+
+            // server frames are unmasked
+            while(buf->readableBytes() >= 2)
+            {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(buf->peek());
+                size_t readable = buf->readableBytes();
+                size_t len = p[1] & 0x7F;
+                size_t header = 2;
+
+                if(len == 126)
+                {
+                    if(readable < 4)
+                    {
+                        break;
+                    }
+
+                    len = p[2] << 8 | p[3];
+                    header = 4;
+                }
+                else if(len == 127)
+                {
+                    if(readable < 10)
+                    {
+                        break;
+                    }
+
+                    len = 0;
+
+                    for(int i = 2; i < 10; ++i)
+                    {
+                        len = len << 8 | p[i];
+                    }
+
+                    header = 10;
+                }
+
+                if(readable < header + len)
+                {
+                    break;
+                }
+
+                buf->retrieve(header + len);
+
+                if(g_measuring.load(std::memory_order_relaxed))
+                {
+                    g_messages.fetch_add(1, std::memory_order_relaxed);
+                    g_bytes.fetch_add(len, std::memory_order_relaxed);
+                }
+
+                conn->send(frame_);
+            }
+        }
+
+        TcpClient       client_;
+        bool            upgraded_;
+        std::string     frame_;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    Bench::Args args(argc, argv, "WebSocketBench [mode=echo] [fanout=shared] [connections=100] "
+                     "[size=1024] [serverThreads=0] [clientThreads=1] [warmupMs=500] "
+                     "[durationMs=3000] [port=20078] [poller=epoll]");
+    std::string mode = args.getString("mode", "echo");
+    std::string fanout = args.getString("fanout", "shared");
+    g_connections = static_cast<int>(args.getInt("connections", 100));
+    size_t size = static_cast<size_t>(args.getInt("size", 1024));
+    int serverThreads = static_cast<int>(args.getInt("serverThreads", 0));
+    int clientThreads = static_cast<int>(args.getInt("clientThreads", 1));
+    int64_t warmupMs = args.getInt("warmupMs", 500);
+    int64_t durationMs = args.getInt("durationMs", 3000);
+    uint16_t port = static_cast<uint16_t>(args.getInt("port", 20078));
+    Bench::selectPoller(args);
+    args.check();
+
+    if((mode != "echo" && mode != "broadcast") || (fanout != "shared" && fanout != "copy"))
+    {
+        fprintf(stderr, "mode is echo or broadcast, fanout is shared or copy\n");
+        return 1;
+    }
+
+    Bench::raiseFdLimit();
+    g_broadcast = mode == "broadcast";
+    g_sharedFanout = fanout == "shared";
+    g_payload.assign(size, 'x');
+
+    EventLoop loop;
+    InetAddress serverAddr("127.0.0.1", port);
+    HttpServer server(&loop, serverAddr, "WebSocketBench");
+    WebSocketOptions options;
+    options.pingInterval = 0;
+    server.setWebSocketHandler("/ws", onOpen, onServerMessage, WebSocketCloseCallback(), options);
+    server.setThreadNum(serverThreads);
+    server.start();
+
+    EventLoopThreadPool clientPool(&loop, "WebSocketBenchClient");
+    clientPool.setThreadNum(clientThreads);
+    clientPool.start();
+    std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+    std::vector<std::unique_ptr<Session>> sessions;
+
+    for(int i = 0; i < g_connections; ++i)
+    {
+        sessions.emplace_back(new Session(clientLoops[i % clientLoops.size()], serverAddr,
+                                          "WebSocketBench#" + std::to_string(i)));
+        sessions.back()->connect();
+    }
+
+    int64_t cpu = 0;
+    int64_t elapsed = Bench::runWindow(&loop, &g_measuring, warmupMs, durationMs, &cpu);
+    uint64_t messages = g_messages.load();
+
+    Bench::Report report("websocket");
+    report.add("poller", std::string(loop.pollerName()));
+    report.add("mode", mode);
+
+    if(g_broadcast)
+    {
+        report.add("fanout", fanout);
+    }
+
+    report.add("connections", static_cast<int64_t>(g_connections));
+    report.add("size", static_cast<int64_t>(size));
+    report.add("server_threads", static_cast<int64_t>(serverThreads));
+    report.add("msgs_per_sec", messages * 1e9 / elapsed);
+    report.add("mib_per_sec", g_bytes.load() * 1e9 / elapsed / (1024 * 1024));
+    report.add("cpu_us_per_msg", messages > 0 ? cpu / 1e3 / messages : 0.0);
+    report.print();
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_clients.clear();
+    }
+
+    Bench::finish();
+}
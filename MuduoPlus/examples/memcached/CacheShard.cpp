@@ -0,0 +1,479 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <new>
+
+#include "CacheShard.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        const size_t kInitialBuckets = 1 << 16;
+        const int kEvictTries = 50;     // pinned items skipped at an LRU tail
+        const size_t kMaxHeaderLen = 320;
+
+        bool expired(const Item* item, time_t now)
+        {
+            return item->expire != 0 && item->expire <= now;
+        }
+
+        bool parseNumber(const char* data, size_t len, uint64_t* value)
+        {
+            uint64_t result = 0;
+
+            if(len == 0 || len > 20)
+            {
+                return false;
+            }
+
+            for(size_t i = 0; i < len; ++i)
+            {
+                if(data[i] < '0' || data[i] > '9')
+                {
+                    return false;
+                }
+
+                uint64_t next = result * 10 + (data[i] - '0');
+
+                if(next / 10 != result)
+                {
+                    return false;
+                }
+
+                result = next;
+            }
+
+            *value = result;
+            return true;
+        }
+
+        int formatHeader(char* header, const StringPiece& key, uint32_t flags, size_t bytes)
+        {
+            return snprintf(header, kMaxHeaderLen, "VALUE %.*s %u %zu\r\n",
+                            key.size(), key.data(), flags, bytes);
+        }
+    }
+
+    uint64_t CacheShard::hash(const StringPiece& key)
+    {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ULL;
+
+        for(int i = 0; i < key.size(); ++i)
+        {
+            h ^= static_cast<unsigned char>(key[i]);
+            h *= 1099511628211ULL;
+        }
+
+        return h;
+    }
+
+    CacheShard::CacheShard(size_t memoryLimit)
+        : slabs_(memoryLimit),
+          buckets_(kInitialBuckets, static_cast<Item*>(NULL)),
+          lruHeads_(slabs_.classCount(), static_cast<Item*>(NULL)),
+          lruTails_(slabs_.classCount(), static_cast<Item*>(NULL)),
+          nextCas_(1)
+    {
+    }
+
+    CacheShard::~CacheShard()
+    {
+        // the chunks go with the slab pages
+    }
+
+    Item* CacheShard::get(const StringPiece& key, uint64_t hash, time_t now)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Item* item = find(key, hash, now);
+
+        if(item == NULL)
+        {
+            ++stats_.getMisses;
+            return NULL;
+        }
+
+        ++stats_.getHits;
+        ++item->refCount;
+        lruRemove(item);
+        lruPushFront(item);
+        return item;
+    }
+
+    void CacheShard::unpin(Item* item)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --item->refCount;
+
+        if(item->refCount == 0 && !item->linked)
+        {
+            release(item);
+        }
+    }
+
+    bool CacheShard::fits(const StringPiece& key, size_t bytes) const
+    {
+        char header[kMaxHeaderLen];
+        int headerLen = formatHeader(header, key, 0xffffffffu, bytes);
+        return slabs_.classOf(Item::totalSize(headerLen, bytes)) >= 0;
+    }
+
+    CacheShard::Result CacheShard::store(StoreMode mode, const StringPiece& key, uint64_t hash,
+                                         uint32_t flags, time_t expire, const StringPiece& data,
+                                         uint64_t cas, time_t now)
+    {
+        size_t bytes = static_cast<size_t>(data.size());
+        std::lock_guard<std::mutex> lock(mutex_);
+        Item* old = find(key, hash, now);
+        ++stats_.sets;
+
+        if((mode == kAdd && old) || ((mode == kReplace || mode == kAppend || mode == kPrepend) && !old))
+        {
+            return kNotStored;
+        }
+
+        if(mode == kCas)
+        {
+            if(!old)
+            {
+                return kNotFound;
+            }
+
+            if(old->cas != cas)
+            {
+                return kExists;
+            }
+        }
+
+        if(mode == kAppend || mode == kPrepend)
+        {
+            // keeps the old flags and expiry
+            flags = old->flags;
+            expire = old->expire;
+            bytes += old->bytes;
+        }
+
+        Item* item = allocate(key, flags, expire, bytes);
+
+        if(item == NULL)
+        {
+            return fits(key, bytes) ? kOutOfMemory : kTooLarge;
+        }
+
+        // the slab memory was reclaimed under this lock, old may be gone
+        old = find(key, hash, now);
+
+        if(mode == kAppend || mode == kPrepend)
+        {
+            if(old == NULL || old->bytes + static_cast<size_t>(data.size()) != bytes)
+            {
+                release(item);
+                return kNotStored;
+            }
+
+            char* out = item->data();
+
+            if(mode == kAppend)
+            {
+                memcpy(out, old->data(), old->bytes);
+                memcpy(out + old->bytes, data.data(), data.size());
+            }
+            else
+            {
+                memcpy(out, data.data(), data.size());
+                memcpy(out + data.size(), old->data(), old->bytes);
+            }
+        }
+        else
+        {
+            memcpy(item->data(), data.data(), bytes);
+        }
+
+        if(old)
+        {
+            unlink(old);
+        }
+
+        link(item, hash);
+        return kOk;
+    }
+
+    CacheShard::Result CacheShard::remove(const StringPiece& key, uint64_t hash, time_t now)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Item* item = find(key, hash, now);
+
+        if(item == NULL)
+        {
+            return kNotFound;
+        }
+
+        unlink(item);
+        return kOk;
+    }
+
+    CacheShard::Result CacheShard::incr(const StringPiece& key, uint64_t hash, bool increment,
+                                        uint64_t delta, time_t now, uint64_t* value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Item* old = find(key, hash, now);
+
+        if(old == NULL)
+        {
+            return kNotFound;
+        }
+
+        uint64_t current = 0;
+
+        if(!parseNumber(old->data(), old->bytes, &current))
+        {
+            return kNonNumeric;
+        }
+
+        current = increment ? current + delta : (current > delta ? current - delta : 0);
+
+        char text[32];
+        int len = snprintf(text, sizeof text, "%llu", static_cast<unsigned long long>(current));
+        uint32_t flags = old->flags;
+        time_t expire = old->expire;
+
+        // a new item, sends may be in flight from the old one
+        Item* item = allocate(key, flags, expire, len);
+
+        if(item == NULL)
+        {
+            return kOutOfMemory;
+        }
+
+        memcpy(item->data(), text, len);
+        old = find(key, hash, now);
+
+        if(old)
+        {
+            unlink(old);
+        }
+
+        link(item, hash);
+        *value = current;
+        return kOk;
+    }
+
+    CacheShard::Result CacheShard::touch(const StringPiece& key, uint64_t hash, time_t expire,
+                                         time_t now)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Item* item = find(key, hash, now);
+
+        if(item == NULL)
+        {
+            return kNotFound;
+        }
+
+        item->expire = expire;
+        return kOk;
+    }
+
+    void CacheShard::flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for(size_t i = 0; i < lruHeads_.size(); ++i)
+        {
+            while(lruHeads_[i])
+            {
+                unlink(lruHeads_[i]);
+            }
+        }
+    }
+
+    CacheShard::Stats CacheShard::stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    Item* CacheShard::find(const StringPiece& key, uint64_t hash, time_t now)
+    {
+        Item** link = &buckets_[hash & (buckets_.size() - 1)];
+
+        while(*link)
+        {
+            Item* item = *link;
+
+            if(item->keyLen == key.size() && memcmp(item->key(), key.data(), key.size()) == 0)
+            {
+                if(expired(item, now))
+                {
+                    unlink(item);
+                    return NULL;
+                }
+
+                return item;
+            }
+
+            link = &item->hashNext;
+        }
+
+        return NULL;
+    }
+
+    Item* CacheShard::allocate(const StringPiece& key, uint32_t flags, time_t expire, size_t bytes)
+    {
+        char header[kMaxHeaderLen];
+        int headerLen = formatHeader(header, key, flags, bytes);
+        int slabClass = slabs_.classOf(Item::totalSize(headerLen, bytes));
+
+        if(slabClass < 0)
+        {
+            return NULL;
+        }
+
+        void* chunk = allocateChunk(slabClass);
+
+        if(chunk == NULL)
+        {
+            return NULL;
+        }
+
+        Item* item = new(chunk) Item;
+        item->hashNext = NULL;
+        item->lruPrev = NULL;
+        item->lruNext = NULL;
+        item->cas = 0;
+        item->expire = expire;
+        item->flags = flags;
+        item->bytes = static_cast<uint32_t>(bytes);
+        item->refCount = 0;
+        item->headerLen = static_cast<uint16_t>(headerLen);
+        item->keyLen = static_cast<uint8_t>(key.size());
+        item->slabClass = static_cast<uint8_t>(slabClass);
+        item->linked = false;
+        memcpy(item->header(), header, headerLen);
+        item->data()[bytes] = '\r';
+        item->data()[bytes + 1] = '\n';
+        return item;
+    }
+
+    void* CacheShard::allocateChunk(int slabClass)
+    {
+        void* chunk = slabs_.allocate(slabClass);
+        Item* item = lruTails_[slabClass];
+        time_t now = ::time(NULL);
+
+        for(int tries = 0; chunk == NULL && item && tries < kEvictTries; ++tries)
+        {
+            Item* prev = item->lruPrev;
+
+            if(item->refCount == 0)
+            {
+                if(expired(item, now))
+                {
+                    ++stats_.reclaimed;
+                }
+                else
+                {
+                    ++stats_.evictions;
+                }
+
+                unlink(item);
+                chunk = slabs_.allocate(slabClass);
+            }
+
+            item = prev;
+        }
+
+        return chunk;
+    }
+
+    void CacheShard::link(Item* item, uint64_t hash)
+    {
+        Item*& bucket = buckets_[hash & (buckets_.size() - 1)];
+        item->hashNext = bucket;
+        bucket = item;
+        item->cas = nextCas_++;
+        item->linked = true;
+        lruPushFront(item);
+
+        ++stats_.currItems;
+        ++stats_.totalItems;
+        stats_.bytes += Item::totalSize(item->headerLen, item->bytes);
+
+        if(stats_.currItems > buckets_.size() + buckets_.size() / 2)
+        {
+            grow();
+        }
+    }
+
+    void CacheShard::unlink(Item* item)
+    {
+        Item** link = &buckets_[hash(StringPiece(item->key(), item->keyLen)) & (buckets_.size() - 1)];
+
+        while(*link != item)
+        {
+            link = &(*link)->hashNext;
+        }
+
+        *link = item->hashNext;
+        lruRemove(item);
+        item->linked = false;
+
+        --stats_.currItems;
+        stats_.bytes -= Item::totalSize(item->headerLen, item->bytes);
+
+        if(item->refCount == 0)
+        {
+            release(item);
+        }
+    }
+
+    void CacheShard::release(Item* item)
+    {
+        slabs_.free(item, item->slabClass);
+    }
+
+    void CacheShard::lruRemove(Item* item)
+    {
+        (item->lruPrev ? item->lruPrev->lruNext : lruHeads_[item->slabClass]) = item->lruNext;
+        (item->lruNext ? item->lruNext->lruPrev : lruTails_[item->slabClass]) = item->lruPrev;
+        item->lruPrev = NULL;
+        item->lruNext = NULL;
+    }
+
+    void CacheShard::lruPushFront(Item* item)
+    {
+        Item*& head = lruHeads_[item->slabClass];
+        item->lruPrev = NULL;
+        item->lruNext = head;
+
+        if(head)
+        {
+            head->lruPrev = item;
+        }
+        else
+        {
+            lruTails_[item->slabClass] = item;
+        }
+
+        head = item;
+    }
+
+    void CacheShard::grow()
+    {
+        std::vector<Item*> buckets(buckets_.size() * 2, static_cast<Item*>(NULL));
+
+        for(Item* item : buckets_)
+        {
+            while(item)
+            {
+                Item* next = item->hashNext;
+                Item*& bucket = buckets[hash(StringPiece(item->key(), item->keyLen)) & (buckets.size() - 1)];
+                item->hashNext = bucket;
+                bucket = item;
+                item = next;
+            }
+        }
+
+        buckets_.swap(buckets);
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include <mutex>
+#include <vector>
+
+#include "base/NonCopyable.h"
+#include "base/StringPiece.h"
+#include "Item.h"
+#include "SlabAllocator.h"
+
+namespace MuduoPlus
+{
+    /// One part of the cache, keys go to a shard by hash. A hash table with
+    /// chaining, items in slab chunks and an LRU list per slab class: when
+    /// a class is out of chunks and memory, its least recently used
+    /// unpinned items are evicted. All calls are thread safe, each shard has
+    /// its own mutex, so loops mostly take different ones.
+    ///
+    /// Times are absolute, in seconds since the epoch.
+    class CacheShard : NonCopyable
+    {
+    public:
+        enum StoreMode
+        {
+            kSet,
+            kAdd,
+            kReplace,
+            kAppend,
+            kPrepend,
+            kCas
+        };
+
+        enum Result
+        {
+            kOk,
+            kNotStored,
+            kExists,
+            kNotFound,
+            kNonNumeric,
+            kTooLarge,
+            kOutOfMemory
+        };
+
+        struct Stats
+        {
+            Stats()
+                : currItems(0),
+                  totalItems(0),
+                  bytes(0),
+                  getHits(0),
+                  getMisses(0),
+                  sets(0),
+                  evictions(0),
+                  reclaimed(0)
+            {
+            }
+
+            uint64_t currItems;
+            uint64_t totalItems;
+            uint64_t bytes;
+            uint64_t getHits;
+            uint64_t getMisses;
+            uint64_t sets;          // store calls, stored or not
+            uint64_t evictions;     // live items dropped for room
+            uint64_t reclaimed;     // expired items whose chunk was reused
+        };
+
+        static const size_t kMaxKeyLen = 250;
+
+        /// The hash choosing both the shard and the bucket.
+        static uint64_t hash(const StringPiece& key);
+
+        explicit CacheShard(size_t memoryLimit);
+        ~CacheShard();
+
+        /// The item pinned, so its chunk stays as it is until unpin, NULL on
+        /// a miss. Counts the hit or miss and marks it recently used.
+        Item* get(const StringPiece& key, uint64_t hash, time_t now);
+        void unpin(Item* item);
+
+        /// cas is checked by kCas only.
+        Result store(StoreMode mode, const StringPiece& key, uint64_t hash, uint32_t flags,
+                     time_t expire, const StringPiece& data, uint64_t cas, time_t now);
+        Result remove(const StringPiece& key, uint64_t hash, time_t now);
+        /// The new value in value, a decrement stops at 0.
+        Result incr(const StringPiece& key, uint64_t hash, bool increment, uint64_t delta,
+                    time_t now, uint64_t* value);
+        Result touch(const StringPiece& key, uint64_t hash, time_t expire, time_t now);
+        /// Drops every item, pinned ones once they are unpinned.
+        void flush();
+
+        Stats stats();
+
+        size_t memoryLimit() const
+        {
+            return slabs_.memoryLimit();
+        }
+
+        /// Whether data of bytes fits one chunk with key's header.
+        bool fits(const StringPiece& key, size_t bytes) const;
+
+    private:
+        Item* find(const StringPiece& key, uint64_t hash, time_t now);
+        Item* allocate(const StringPiece& key, uint32_t flags, time_t expire, size_t bytes);
+        void* allocateChunk(int slabClass);
+        void link(Item* item, uint64_t hash);
+        void unlink(Item* item);
+        void release(Item* item);
+        void lruRemove(Item* item);
+        void lruPushFront(Item* item);
+        void grow();
+
+        std::mutex mutex_;
+        SlabAllocator slabs_;
+        std::vector<Item*> buckets_;
+        std::vector<Item*> lruHeads_;   // most recently used first, per slab class
+        std::vector<Item*> lruTails_;
+        uint64_t nextCas_;
+        Stats stats_;
+    };
+}
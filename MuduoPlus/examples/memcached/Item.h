@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+namespace MuduoPlus
+{
+    /// A cache entry, the header of a slab chunk. The rest of the chunk
+    /// holds the entry as a GET answers it, so a hit is sent from here:
+    ///
+    ///     VALUE <key> <flags> <bytes>\r\n<data>\r\n
+    ///
+    /// Guarded by the mutex of its CacheShard.
+    struct Item
+    {
+        static const size_t kValuePrefixLen = 6;    // "VALUE "
+
+        Item*       hashNext;
+        Item*       lruPrev;
+        Item*       lruNext;
+        uint64_t    cas;
+        time_t      expire;         // 0 for never
+        uint32_t    flags;
+        uint32_t    bytes;          // of data, without its \r\n
+        uint32_t    refCount;       // sends in flight from the chunk
+        uint16_t    headerLen;      // "VALUE ...\r\n"
+        uint8_t     keyLen;
+        uint8_t     slabClass;
+        bool        linked;         // in the hash table and an LRU list
+
+        char* header()
+        {
+            return reinterpret_cast<char*>(this + 1);
+        }
+
+        const char* key()
+        {
+            return header() + kValuePrefixLen;
+        }
+
+        /// data, then \r\n
+        char* data()
+        {
+            return header() + headerLen;
+        }
+
+        /// The GET answer, header to the data's \r\n.
+        size_t responseLen() const
+        {
+            return headerLen + bytes + 2;
+        }
+
+        static size_t totalSize(size_t headerLen, size_t bytes)
+        {
+            return sizeof(Item) + headerLen + bytes + 2;
+        }
+    };
+}
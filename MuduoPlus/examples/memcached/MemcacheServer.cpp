@@ -0,0 +1,614 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/Logger.h"
+
+#include "net/EventLoop.h"
+#include "MemcacheServer.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        const size_t kMaxLineLen = 64 * 1024;
+        const time_t kMaxRelativeExpire = 60 * 60 * 24 * 30;    // 30 days, absolute beyond
+
+        bool parseUnsigned(const StringPiece& token, uint64_t* value)
+        {
+            uint64_t result = 0;
+
+            if(token.size() == 0 || token.size() > 20)
+            {
+                return false;
+            }
+
+            for(int i = 0; i < token.size(); ++i)
+            {
+                if(token[i] < '0' || token[i] > '9')
+                {
+                    return false;
+                }
+
+                uint64_t next = result * 10 + (token[i] - '0');
+
+                if(next / 10 != result)
+                {
+                    return false;
+                }
+
+                result = next;
+            }
+
+            *value = result;
+            return true;
+        }
+
+        bool parseSigned(const StringPiece& token, int64_t* value)
+        {
+            uint64_t magnitude = 0;
+            bool negative = token.size() > 0 && token[0] == '-';
+
+            if(!parseUnsigned(negative ? StringPiece(token.data() + 1, token.size() - 1) : token,
+                              &magnitude) || magnitude > INT64_MAX)
+            {
+                return false;
+            }
+
+            *value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+            return true;
+        }
+
+        /// exptime as the client sends it, 0 for never, negative for
+        /// already expired.
+        time_t absoluteExpire(int64_t exptime, time_t now)
+        {
+            if(exptime == 0)
+            {
+                return 0;
+            }
+
+            if(exptime < 0)
+            {
+                return 1;
+            }
+
+            return exptime > kMaxRelativeExpire ? static_cast<time_t>(exptime)
+                                                : now + static_cast<time_t>(exptime);
+        }
+
+        void split(const char* begin, const char* end, std::vector<StringPiece>* tokens)
+        {
+            tokens->clear();
+
+            while(begin < end)
+            {
+                while(begin < end && *begin == ' ')
+                {
+                    ++begin;
+                }
+
+                const char* start = begin;
+
+                while(begin < end && *begin != ' ')
+                {
+                    ++begin;
+                }
+
+                if(begin > start)
+                {
+                    tokens->push_back(StringPiece(start, static_cast<int>(begin - start)));
+                }
+            }
+        }
+
+        bool noreply(const std::vector<StringPiece>& tokens, size_t argc)
+        {
+            return tokens.size() == argc + 1 && tokens[argc] == "noreply";
+        }
+
+        void appendStat(std::string* out, const char* name, uint64_t value)
+        {
+            char line[128];
+            snprintf(line, sizeof line, "STAT %s %llu\r\n", name, static_cast<unsigned long long>(value));
+            out->append(line);
+        }
+
+        void reply(const TcpConnectionPtr& conn, const char* message)
+        {
+            conn->send(message, static_cast<int>(strlen(message)));
+        }
+
+        const char kStored[] = "STORED\r\n";
+        const char kNotStored[] = "NOT_STORED\r\n";
+        const char kExists[] = "EXISTS\r\n";
+        const char kNotFound[] = "NOT_FOUND\r\n";
+        const char kDeleted[] = "DELETED\r\n";
+        const char kTouched[] = "TOUCHED\r\n";
+        const char kEnd[] = "END\r\n";
+        const char kOk[] = "OK\r\n";
+        const char kError[] = "ERROR\r\n";
+        const char kBadFormat[] = "CLIENT_ERROR bad command line format\r\n";
+        const char kBadChunk[] = "CLIENT_ERROR bad data chunk\r\n";
+        const char kNonNumeric[] = "CLIENT_ERROR cannot increment or decrement non-numeric value\r\n";
+        const char kTooLarge[] = "SERVER_ERROR object too large for cache\r\n";
+        const char kOutOfMemory[] = "SERVER_ERROR out of memory storing object\r\n";
+    }
+
+    /// Per connection, in its context.
+    struct MemcacheServer::Session
+    {
+        Session()
+            : swallow(0)
+        {
+        }
+
+        size_t swallow;     // data of a refused store still to drop
+    };
+
+    const char* const MemcacheServer::kVersion = "1.6.0-muduoplus";
+
+    MemcacheServer::MemcacheServer(EventLoop* loop, const InetAddress& listenAddr,
+                                   size_t memoryLimit, int shards)
+        : memoryLimit_(memoryLimit),
+          shardCount_(shards),
+          numThreads_(0),
+          startTime_(::time(NULL)),
+          currConnections_(0),
+          totalConnections_(0),
+          server_(loop, listenAddr, "MemcacheServer")
+    {
+        server_.setConnectionCallback(std::bind(&MemcacheServer::onConnection, this,
+                                                std::placeholders::_1));
+        server_.setMessageCallback(std::bind(&MemcacheServer::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+        // the answers to one read leave in one writev
+        server_.setThreadInitCallback([](EventLoop* ioLoop)
+        {
+            ioLoop->setDeferredFlush(true);
+        });
+    }
+
+    MemcacheServer::~MemcacheServer()
+    {
+    }
+
+    void MemcacheServer::start()
+    {
+        if(shards_.empty())
+        {
+            int count = shardCount_ > 0 ? shardCount_ : std::max(numThreads_, 1);
+
+            for(int i = 0; i < count; ++i)
+            {
+                shards_.push_back(std::make_shared<CacheShard>(memoryLimit_ / count));
+            }
+        }
+
+        server_.start();
+    }
+
+    CacheShard::Stats MemcacheServer::stats() const
+    {
+        CacheShard::Stats total;
+
+        for(const std::shared_ptr<CacheShard>& shard : shards_)
+        {
+            CacheShard::Stats stats = shard->stats();
+            total.currItems += stats.currItems;
+            total.totalItems += stats.totalItems;
+            total.bytes += stats.bytes;
+            total.getHits += stats.getHits;
+            total.getMisses += stats.getMisses;
+            total.sets += stats.sets;
+            total.evictions += stats.evictions;
+            total.reclaimed += stats.reclaimed;
+        }
+
+        return total;
+    }
+
+    void MemcacheServer::onConnection(const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            conn->setContext(Session());
+            conn->setTcpNoDelay(true);
+            ++currConnections_;
+            ++totalConnections_;
+        }
+        else
+        {
+            --currConnections_;
+        }
+    }
+
+    void MemcacheServer::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        Session* session = &conn->getContext().AnyCast<Session>();
+        time_t now = ::time(NULL);
+
+        while(buf->readableBytes() > 0 && conn->connected())
+        {
+            if(session->swallow > 0)
+            {
+                size_t len = std::min(session->swallow, buf->readableBytes());
+                buf->retrieve(len);
+                session->swallow -= len;
+                continue;
+            }
+
+            const char* eol = buf->findEOL();
+
+            if(eol == NULL)
+            {
+                if(buf->readableBytes() > kMaxLineLen)
+                {
+                    LOG_PRINT(LogType_Warn, "MemcacheServer - line too long from %s",
+                              conn->name().c_str());
+                    reply(conn, "CLIENT_ERROR line too long\r\n");
+                    conn->gracefulClose();
+                }
+
+                break;
+            }
+
+            if(!processRequest(conn, session, buf, eol, now))
+            {
+                break;
+            }
+        }
+    }
+
+    bool MemcacheServer::processRequest(const TcpConnectionPtr& conn, Session* session, Buffer* buf,
+                                        const char* eol, time_t now)
+    {
+        // reused by the requests on this thread
+        thread_local std::vector<StringPiece> t_tokens;
+
+        const char* end = eol > buf->peek() && eol[-1] == '\r' ? eol - 1 : eol;
+        split(buf->peek(), end, &t_tokens);
+
+        if(t_tokens.empty())
+        {
+            reply(conn, kError);
+            buf->retrieveUntil(eol + 1);
+            return true;
+        }
+
+        const StringPiece& command = t_tokens[0];
+
+        if(command == "set" || command == "add" || command == "replace" || command == "append"
+                || command == "prepend" || command == "cas")
+        {
+            return processStore(conn, session, buf, eol, t_tokens, now);
+        }
+
+        if(command == "get" || command == "gets")
+        {
+            processGet(conn, t_tokens, command == "gets", now);
+        }
+        else if(command == "delete" && (t_tokens.size() == 2 || noreply(t_tokens, 2)))
+        {
+            uint64_t hash = CacheShard::hash(t_tokens[1]);
+            CacheShard::Result result = shardOf(hash)->remove(t_tokens[1], hash, now);
+
+            if(!noreply(t_tokens, 2))
+            {
+                reply(conn, result == CacheShard::kOk ? kDeleted : kNotFound);
+            }
+        }
+        else if((command == "incr" || command == "decr") && t_tokens.size() >= 3)
+        {
+            processIncr(conn, t_tokens, now);
+        }
+        else if(command == "touch" && t_tokens.size() >= 3)
+        {
+            int64_t exptime = 0;
+
+            if(!parseSigned(t_tokens[2], &exptime))
+            {
+                reply(conn, kBadFormat);
+            }
+            else
+            {
+                uint64_t hash = CacheShard::hash(t_tokens[1]);
+                CacheShard::Result result = shardOf(hash)->touch(t_tokens[1], hash,
+                                            absoluteExpire(exptime, now), now);
+
+                if(!noreply(t_tokens, 3))
+                {
+                    reply(conn, result == CacheShard::kOk ? kTouched : kNotFound);
+                }
+            }
+        }
+        else if(command == "flush_all")
+        {
+            processFlush(conn, t_tokens);
+        }
+        else if(command == "stats" && t_tokens.size() == 1)
+        {
+            processStats(conn);
+        }
+        else if(command == "version")
+        {
+            std::string version = std::string("VERSION ") + kVersion + "\r\n";
+            conn->send(version);
+        }
+        else if(command == "verbosity")
+        {
+            if(!noreply(t_tokens, 2))
+            {
+                reply(conn, kOk);
+            }
+        }
+        else if(command == "quit")
+        {
+            conn->gracefulClose();
+        }
+        else
+        {
+            reply(conn, kError);
+        }
+
+        buf->retrieveUntil(eol + 1);
+        return true;
+    }
+
+    bool MemcacheServer::processStore(const TcpConnectionPtr& conn, Session* session, Buffer* buf,
+                                      const char* eol, const std::vector<StringPiece>& tokens,
+                                      time_t now)
+    {
+        const StringPiece& command = tokens[0];
+        bool isCas = command == "cas";
+        size_t argc = isCas ? 6 : 5;
+        uint64_t flags = 0;
+        int64_t exptime = 0;
+        uint64_t bytes = 0;
+        uint64_t cas = 0;
+
+        if((tokens.size() != argc && !noreply(tokens, argc))
+                || static_cast<size_t>(tokens[1].size()) > CacheShard::kMaxKeyLen
+                || !parseUnsigned(tokens[2], &flags) || flags > UINT32_MAX
+                || !parseSigned(tokens[3], &exptime)
+                || !parseUnsigned(tokens[4], &bytes) || bytes > INT32_MAX
+                || (isCas && !parseUnsigned(tokens[5], &cas)))
+        {
+            reply(conn, kBadFormat);
+            buf->retrieveUntil(eol + 1);
+            return true;
+        }
+
+        StringPiece key = tokens[1];
+        bool quiet = noreply(tokens, argc);
+        uint64_t hash = CacheShard::hash(key);
+        const std::shared_ptr<CacheShard>& shard = shardOf(hash);
+
+        if(!shard->fits(key, bytes))
+        {
+            reply(conn, kTooLarge);
+            buf->retrieveUntil(eol + 1);
+            session->swallow = bytes + 2;
+            return true;
+        }
+
+        size_t lineLen = eol + 1 - buf->peek();
+
+        if(buf->readableBytes() < lineLen + bytes + 2)
+        {
+            return false;
+        }
+
+        const char* data = eol + 1;
+
+        if(data[bytes] != '\r' || data[bytes + 1] != '\n')
+        {
+            reply(conn, kBadChunk);
+            buf->retrieve(lineLen + bytes + 2);
+            return true;
+        }
+
+        CacheShard::StoreMode mode = CacheShard::kSet;
+
+        if(command == "add")
+        {
+            mode = CacheShard::kAdd;
+        }
+        else if(command == "replace")
+        {
+            mode = CacheShard::kReplace;
+        }
+        else if(command == "append")
+        {
+            mode = CacheShard::kAppend;
+        }
+        else if(command == "prepend")
+        {
+            mode = CacheShard::kPrepend;
+        }
+        else if(isCas)
+        {
+            mode = CacheShard::kCas;
+        }
+
+        CacheShard::Result result = shard->store(mode, key, hash, static_cast<uint32_t>(flags),
+                                    absoluteExpire(exptime, now),
+                                    StringPiece(data, static_cast<int>(bytes)), cas, now);
+
+        if(!quiet)
+        {
+            switch(result)
+            {
+            case CacheShard::kOk:
+                reply(conn, kStored);
+                break;
+            case CacheShard::kExists:
+                reply(conn, kExists);
+                break;
+            case CacheShard::kNotFound:
+                reply(conn, kNotFound);
+                break;
+            case CacheShard::kTooLarge:
+                reply(conn, kTooLarge);
+                break;
+            case CacheShard::kOutOfMemory:
+                reply(conn, kOutOfMemory);
+                break;
+            default:
+                reply(conn, kNotStored);
+                break;
+            }
+        }
+
+        buf->retrieve(lineLen + bytes + 2);
+        return true;
+    }
+
+    void MemcacheServer::processGet(const TcpConnectionPtr& conn, const std::vector<StringPiece>& tokens,
+                                    bool withCas, time_t now)
+    {
+        for(size_t i = 1; i < tokens.size(); ++i)
+        {
+            if(static_cast<size_t>(tokens[i].size()) > CacheShard::kMaxKeyLen)
+            {
+                continue;
+            }
+
+            uint64_t hash = CacheShard::hash(tokens[i]);
+            std::shared_ptr<CacheShard> shard = shardOf(hash);
+            Item* item = shard->get(tokens[i], hash, now);
+
+            if(item == NULL)
+            {
+                continue;
+            }
+
+            // unpinned once the connection wrote or dropped the chunk
+            std::shared_ptr<const void> pin(item, [shard](Item* pinned)
+            {
+                shard->unpin(pinned);
+            });
+
+            if(withCas)
+            {
+                char header[512];
+                int len = snprintf(header, sizeof header, "VALUE %.*s %u %u %llu\r\n",
+                                   tokens[i].size(), tokens[i].data(), item->flags, item->bytes,
+                                   static_cast<unsigned long long>(item->cas));
+                conn->send(header, len);
+                conn->sendShared(pin, item->data(), item->bytes + 2);
+            }
+            else
+            {
+                conn->sendShared(pin, item->header(), item->responseLen());
+            }
+        }
+
+        reply(conn, kEnd);
+    }
+
+    void MemcacheServer::processIncr(const TcpConnectionPtr& conn, const std::vector<StringPiece>& tokens,
+                                     time_t now)
+    {
+        uint64_t delta = 0;
+
+        if(!parseUnsigned(tokens[2], &delta) || (tokens.size() != 3 && !noreply(tokens, 3)))
+        {
+            reply(conn, kBadFormat);
+            return;
+        }
+
+        uint64_t hash = CacheShard::hash(tokens[1]);
+        uint64_t value = 0;
+        CacheShard::Result result = shardOf(hash)->incr(tokens[1], hash, tokens[0] == "incr", delta,
+                                    now, &value);
+
+        if(noreply(tokens, 3))
+        {
+            return;
+        }
+
+        if(result == CacheShard::kOk)
+        {
+            char line[32];
+            int len = snprintf(line, sizeof line, "%llu\r\n", static_cast<unsigned long long>(value));
+            conn->send(line, len);
+        }
+        else if(result == CacheShard::kNonNumeric)
+        {
+            reply(conn, kNonNumeric);
+        }
+        else if(result == CacheShard::kOutOfMemory)
+        {
+            reply(conn, kOutOfMemory);
+        }
+        else
+        {
+            reply(conn, kNotFound);
+        }
+    }
+
+    void MemcacheServer::processStats(const TcpConnectionPtr& conn)
+    {
+        CacheShard::Stats total = stats();
+        time_t now = ::time(NULL);
+        std::string out;
+
+        appendStat(&out, "uptime", static_cast<uint64_t>(now - startTime_));
+        appendStat(&out, "time", static_cast<uint64_t>(now));
+        out.append("STAT version ").append(kVersion).append("\r\n");
+        appendStat(&out, "curr_connections", static_cast<uint64_t>(currConnections_.load()));
+        appendStat(&out, "total_connections", totalConnections_.load());
+        appendStat(&out, "cmd_get", total.getHits + total.getMisses);
+        appendStat(&out, "cmd_set", total.sets);
+        appendStat(&out, "get_hits", total.getHits);
+        appendStat(&out, "get_misses", total.getMisses);
+        appendStat(&out, "curr_items", total.currItems);
+        appendStat(&out, "total_items", total.totalItems);
+        appendStat(&out, "bytes", total.bytes);
+        appendStat(&out, "evictions", total.evictions);
+        appendStat(&out, "reclaimed", total.reclaimed);
+        appendStat(&out, "limit_maxbytes", memoryLimit_);
+        appendStat(&out, "threads", static_cast<uint64_t>(std::max(numThreads_, 1)));
+        appendStat(&out, "shards", shards_.size());
+        out.append(kEnd);
+        conn->send(out);
+    }
+
+    void MemcacheServer::processFlush(const TcpConnectionPtr& conn, const std::vector<StringPiece>& tokens)
+    {
+        uint64_t delay = 0;
+        bool quiet = tokens.size() > 1 && tokens.back() == "noreply";
+        size_t argc = quiet ? tokens.size() - 1 : tokens.size();
+
+        if(argc > 2 || (argc == 2 && !parseUnsigned(tokens[1], &delay)))
+        {
+            reply(conn, kBadFormat);
+            return;
+        }
+
+        std::vector<std::shared_ptr<CacheShard>> shards = shards_;
+        auto flush = [shards]()
+        {
+            for(const std::shared_ptr<CacheShard>& shard : shards)
+            {
+                shard->flush();
+            }
+        };
+
+        if(delay == 0)
+        {
+            flush();
+        }
+        else
+        {
+            server_.getLoop()->runAfter(static_cast<double>(delay), flush);
+        }
+
+        if(!quiet)
+        {
+            reply(conn, kOk);
+        }
+    }
+}
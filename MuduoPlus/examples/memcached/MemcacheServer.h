@@ -0,0 +1,93 @@
+#pragma once
+
+#include <time.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/NonCopyable.h"
+#include "base/StringPiece.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+#include "CacheShard.h"
+
+namespace MuduoPlus
+{
+    /// A cache speaking the memcached text protocol: get, gets, set, add,
+    /// replace, append, prepend, cas, delete, incr, decr, touch, flush_all,
+    /// stats, version, verbosity and quit, with noreply. Requests of one
+    /// connection are parsed and answered in order as they arrive, so
+    /// clients may pipeline them, and the answers of one read leave in one
+    /// writev at the end of the loop iteration.
+    ///
+    /// A GET hit is sent from the item's slab chunk by reference, the item
+    /// stays pinned until the kernel took it.
+    ///
+    ///     MemcacheServer server(&loop, InetAddress(11211), 64 * 1024 * 1024, 0);
+    ///     server.setThreadNum(4);
+    ///     server.start();
+    class MemcacheServer : NonCopyable
+    {
+    public:
+        static const char* const kVersion;
+
+        /// memoryLimit is split evenly between shards, 0 shards for one
+        /// per I/O loop.
+        MemcacheServer(EventLoop* loop, const InetAddress& listenAddr, size_t memoryLimit,
+                       int shards);
+        ~MemcacheServer();
+
+        /// See TcpServer::setThreadNum.
+        /// Not thread safe, before @c start
+        void setThreadNum(int numThreads)
+        {
+            numThreads_ = numThreads;
+            server_.setThreadNum(numThreads);
+        }
+
+        /// For the settings MemcacheServer does not wrap, e.g. idle timeouts.
+        TcpServer& tcpServer()
+        {
+            return server_;
+        }
+
+        void start();
+
+        /// Summed over the shards, as the stats command reports them.
+        /// Valid after calling start().
+        CacheShard::Stats stats() const;
+
+    private:
+        struct Session;
+
+        void onConnection(const TcpConnectionPtr& conn);
+        void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+        /// False until buf holds all of the request.
+        bool processRequest(const TcpConnectionPtr& conn, Session* session, Buffer* buf,
+                            const char* eol, time_t now);
+        bool processStore(const TcpConnectionPtr& conn, Session* session, Buffer* buf, const char* eol,
+                          const std::vector<StringPiece>& tokens, time_t now);
+        void processGet(const TcpConnectionPtr& conn, const std::vector<StringPiece>& tokens,
+                        bool withCas, time_t now);
+        void processIncr(const TcpConnectionPtr& conn, const std::vector<StringPiece>& tokens,
+                         time_t now);
+        void processStats(const TcpConnectionPtr& conn);
+        void processFlush(const TcpConnectionPtr& conn, const std::vector<StringPiece>& tokens);
+
+        const std::shared_ptr<CacheShard>& shardOf(uint64_t hash) const
+        {
+            return shards_[(hash >> 32) % shards_.size()];
+        }
+
+        size_t memoryLimit_;
+        int shardCount_;
+        int numThreads_;
+        time_t startTime_;
+        std::vector<std::shared_ptr<CacheShard>> shards_;    // held by pinned items too
+        std::atomic<int> currConnections_;
+        std::atomic<uint64_t> totalConnections_;
+        TcpServer server_;
+    };
+}
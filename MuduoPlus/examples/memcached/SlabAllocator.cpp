@@ -0,0 +1,101 @@
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "SlabAllocator.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        const size_t kMinChunkSize = 64;
+        const double kGrowthFactor = 1.25;
+        const size_t kChunkAlign = 8;
+    }
+
+    SlabAllocator::SlabAllocator(size_t memoryLimit)
+        : memoryLimit_(memoryLimit)
+    {
+        size_t size = kMinChunkSize;
+
+        while(size < kPageSize / 2)
+        {
+            SlabClass slab;
+            slab.chunkSize = size;
+            classes_.push_back(slab);
+
+            size = static_cast<size_t>(size * kGrowthFactor);
+            size = (size + kChunkAlign - 1) & ~(kChunkAlign - 1);
+        }
+
+        SlabClass largest;
+        largest.chunkSize = kPageSize;
+        classes_.push_back(largest);
+    }
+
+    SlabAllocator::~SlabAllocator()
+    {
+        for(char* page : pages_)
+        {
+            ::free(page);
+        }
+    }
+
+    int SlabAllocator::classOf(size_t size) const
+    {
+        for(size_t i = 0; i < classes_.size(); ++i)
+        {
+            if(size <= classes_[i].chunkSize)
+            {
+                return static_cast<int>(i);
+            }
+        }
+
+        return -1;
+    }
+
+    void* SlabAllocator::allocate(int slabClass)
+    {
+        SlabClass& slab = classes_[slabClass];
+
+        if(slab.freeChunks.empty() && !grow(&slab))
+        {
+            return NULL;
+        }
+
+        void* chunk = slab.freeChunks.back();
+        slab.freeChunks.pop_back();
+        return chunk;
+    }
+
+    void SlabAllocator::free(void* chunk, int slabClass)
+    {
+        classes_[slabClass].freeChunks.push_back(chunk);
+    }
+
+    bool SlabAllocator::grow(SlabClass* slab)
+    {
+        if((pages_.size() + 1) * kPageSize > memoryLimit_)
+        {
+            return false;
+        }
+
+        char* page = static_cast<char*>(::malloc(kPageSize));
+
+        if(page == NULL)
+        {
+            return false;
+        }
+
+        pages_.push_back(page);
+        size_t count = kPageSize / slab->chunkSize;
+
+        // handed out from the front of the page first
+        for(size_t i = count; i > 0; --i)
+        {
+            slab->freeChunks.push_back(page + (i - 1) * slab->chunkSize);
+        }
+
+        return true;
+    }
+}
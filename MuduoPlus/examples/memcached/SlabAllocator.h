@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/NonCopyable.h"
+
+namespace MuduoPlus
+{
+    /// Fixed size chunks carved out of 1MB pages, in classes growing by a
+    /// factor of 1.25 from 64 bytes to a whole page. A chunk goes back to
+    /// the free list of its class, pages are never returned, so memory a
+    /// class took stays with it. Not thread safe.
+    class SlabAllocator : NonCopyable
+    {
+    public:
+        static const size_t kPageSize = 1024 * 1024;
+
+        explicit SlabAllocator(size_t memoryLimit);
+        ~SlabAllocator();
+
+        /// The smallest class holding size bytes, -1 if none does.
+        int classOf(size_t size) const;
+
+        /// A chunk of the class, NULL once its free list is empty and the
+        /// memory limit reached.
+        void* allocate(int slabClass);
+        void free(void* chunk, int slabClass);
+
+        size_t chunkSize(int slabClass) const
+        {
+            return classes_[slabClass].chunkSize;
+        }
+
+        size_t classCount() const
+        {
+            return classes_.size();
+        }
+
+        size_t memoryLimit() const
+        {
+            return memoryLimit_;
+        }
+
+        size_t allocatedPages() const
+        {
+            return pages_.size();
+        }
+
+    private:
+        struct SlabClass
+        {
+            size_t chunkSize;
+            std::vector<void*> freeChunks;
+        };
+
+        bool grow(SlabClass* slab);
+
+        size_t memoryLimit_;
+        std::vector<SlabClass> classes_;
+        std::vector<char*> pages_;
+    };
+}
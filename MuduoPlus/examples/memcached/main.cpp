@@ -0,0 +1,85 @@
+// A memcached compatible cache server.
+//
+// usage: MemcacheServer [port=11211] [threads=4] [memoryMB=64] [shards=0]
+//   threads   I/O loops besides the accepting one, 0 serves all in it
+//   shards    cache shards, 0 for one per I/O loop
+//
+// Speaks the text protocol, e.g. try it with
+//   printf 'set k 0 0 5\r\nhello\r\nget k\r\n' | nc -q1 127.0.0.1 11211
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "base/Logger.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "MemcacheServer.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    void printLog(LogType type, const char* format, ...)
+    {
+        va_list args;
+        fprintf(stderr, "%s ", logTypeName(type));
+        va_start(args, format);
+        vfprintf(stderr, format, args);
+        va_end(args);
+        fputc('\n', stderr);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int port = 11211;
+    int threads = 4;
+    long memoryMB = 64;
+    int shards = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const char* eq = strchr(argv[i], '=');
+        std::string key = eq ? std::string(argv[i], eq - argv[i]) : std::string(argv[i]);
+        const char* value = eq ? eq + 1 : "";
+
+        if(key == "port")
+        {
+            port = atoi(value);
+        }
+        else if(key == "threads")
+        {
+            threads = atoi(value);
+        }
+        else if(key == "memoryMB")
+        {
+            memoryMB = atol(value);
+        }
+        else if(key == "shards")
+        {
+            shards = atoi(value);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [port=11211] [threads=4] [memoryMB=64] [shards=0]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    LogPrinter = printLog;
+    setLogLevel(LogType_Info);
+
+    EventLoop loop;
+    MemcacheServer server(&loop, InetAddress(static_cast<uint16_t>(port)),
+                          static_cast<size_t>(memoryMB) * 1024 * 1024, shards);
+    server.setThreadNum(threads);
+    server.start();
+    LOG_PRINT(LogType_Info, "MemcacheServer %s listening on %d, %d threads, %ldMB",
+              MemcacheServer::kVersion, port, threads, memoryMB);
+    loop.loop();
+    return 0;
+}
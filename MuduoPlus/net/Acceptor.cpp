@@ -11,6 +11,8 @@ namespace MuduoPlus
         loop_           = loop;
         listenAddr_     = listenAddr;
         isReuseport_    = reuseport;
+        socketType_     = SOCK_STREAM;
+        dualStack_      = true;
         listenFd_       = -1;
         listenning_     = false;
     }
@@ -20,11 +22,20 @@ namespace MuduoPlus
         acceptChannelPtr_->disableAll();
         acceptChannelPtr_->remove();
         SocketOps::closeSocket(listenFd_);
+
+#ifndef WIN32
+
+        if(listenning_ && listenAddr_.isUnix() && listenAddr_.unixPath()[0] != '@')
+        {
+            ::unlink(listenAddr_.unixPath().c_str());
+        }
+
+#endif
     }
 
     void Acceptor::listen()
     {
-        socket_t fd = SocketOps::createSocket();
+        socket_t fd = SocketOps::createSocket(listenAddr_.family(), socketType_);
 
         if(fd < 0)
         {
@@ -33,7 +44,26 @@ namespace MuduoPlus
             return;
         }
 
-        if(!SocketOps::bindSocket(fd, &listenAddr_.getSockAddr()))
+        SocketOps::reuseListenSocket(fd);
+
+        // the system default for [::] differs between platforms and sysctls
+        if(listenAddr_.isIpv6() && SocketOps::setIpv6Only(fd, !dualStack_) < 0)
+        {
+            LOG_PRINT(LogType_Warn, "set IPV6_V6ONLY failed:%s %s:%d",
+                      GetLastErrorText().c_str(), __FUNCTION__, __LINE__);
+        }
+
+#ifndef WIN32
+
+        // a socket file left by an earlier run fails bind with EADDRINUSE
+        if(listenAddr_.isUnix() && listenAddr_.unixPath()[0] != '@')
+        {
+            ::unlink(listenAddr_.unixPath().c_str());
+        }
+
+#endif
+
+        if(!SocketOps::bindSocket(fd, &listenAddr_.getSockAddr(), listenAddr_.getSockAddrLen()))
         {
             LOG_PRINT(LogType_Fatal, "bind socket failed:%s %s:%d",
                       GetLastErrorText().c_str(), __FUNCTION__, __LINE__);
@@ -61,6 +91,14 @@ namespace MuduoPlus
         acceptChannelPtr_ = std::make_shared<Channel>(loop_, listenFd_);
         acceptChannelPtr_->setReadCallback(std::bind(&Acceptor::handleRead, this));
         acceptChannelPtr_->setOwner(shared_from_this());
+        acceptChannelPtr_->setName("Acceptor " + listenAddr_.toIpPort());
+        acceptChannelPtr_->setPriority(Channel::kHighPriority);
+
+        if(loop_->completionIo() && !listenAddr_.isUnix())
+        {
+            acceptChannelPtr_->setCompletionMode(Channel::kCompletionAccept);
+        }
+
         acceptChannelPtr_->enableReading();
         listenning_ = true;
 
@@ -76,12 +114,19 @@ err:
         loop_->assertInLoopThread();
         int errorCode = 0;
 
+        if(acceptChannelPtr_->completionMode() == Channel::kCompletionAccept)
+        {
+            handleAccepted();
+            return;
+        }
+
         while(true)
         {
-            InetAddress peerAddr;
-            sockaddr addr = {0};
+            sockaddr_storage addr;
+            socklen_t addrLen = sizeof(addr);
+            memset(&addr, 0, sizeof(addr));
 
-            socket_t newFd = SocketOps::accept(listenFd_, &addr);
+            socket_t newFd = SocketOps::accept(listenFd_, (sockaddr*)&addr, &addrLen);
 
             if(newFd < 0)
             {
@@ -90,7 +135,7 @@ err:
             }
 
             SocketOps::setSocketNoneBlocking(newFd);
-            peerAddr.setSockAddr(addr);
+            InetAddress peerAddr((sockaddr*)&addr, addrLen);
 
             if(newConnCallBack_)
             {
@@ -108,4 +153,46 @@ err:
                       GetErrorText(errorCode).c_str(), __FUNCTION__, __LINE__);
         }
     }
+
+    void Acceptor::handleAccepted()
+    {
+        // the poller accepted them already, non-blocking
+        for(auto &completion : acceptChannelPtr_->readCompletions())
+        {
+            socket_t newFd = completion.result;
+
+            if(newFd < 0)
+            {
+                if(!ERR_ACCEPT_RETRIABLE(-newFd))
+                {
+                    LOG_PRINT(LogType_Error, "accept socket failed:%s %s:%d",
+                              GetErrorText(-newFd).c_str(), __FUNCTION__, __LINE__);
+                }
+
+                continue;
+            }
+
+            sockaddr_storage addr;
+            socklen_t addrLen = sizeof(addr);
+            memset(&addr, 0, sizeof(addr));
+
+            // reset before it got here
+            if(::getpeername(newFd, (sockaddr*)&addr, &addrLen) < 0)
+            {
+                SocketOps::closeSocket(newFd);
+                continue;
+            }
+
+            InetAddress peerAddr((sockaddr*)&addr, addrLen);
+
+            if(newConnCallBack_)
+            {
+                newConnCallBack_(newFd, peerAddr);
+            }
+            else
+            {
+                SocketOps::closeSocket(newFd);
+            }
+        }
+    }
 }
\ No newline at end of file
@@ -26,6 +26,20 @@ namespace MuduoPlus
             newConnCallBack_ = cb;
         }
 
+        /// SOCK_STREAM by default, SOCK_SEQPACKET keeps message boundaries on
+        /// a unix socket. Before listen().
+        void setSocketType(int type)
+        {
+            socketType_ = type;
+        }
+
+        /// An IPv6 listen address takes IPv4 peers too (IPV6_V6ONLY off),
+        /// true by default. Before listen().
+        void setDualStack(bool on)
+        {
+            dualStack_ = on;
+        }
+
         void listen();
         bool listenning() const
         {
@@ -34,8 +48,11 @@ namespace MuduoPlus
 
     private:
         void handleRead();
+        void handleAccepted();
 
         bool                        isReuseport_;
+        int                         socketType_;
+        bool                        dualStack_;
         InetAddress                 listenAddr_;
         bool                        listenning_;
         EventLoop*                  loop_;
@@ -10,6 +10,7 @@
 #include "base/define.h"
 #include "base/LinuxWin.h"
 #include "Buffer.h"
+#include "base/Logger.h"
 
 namespace MuduoPlus
 {
@@ -18,6 +19,9 @@ namespace MuduoPlus
 
     const size_t Buffer::kCheapPrepend;
     const size_t Buffer::kInitialSize;
+#ifndef WIN32
+    const int Buffer::kMaxFdsPerRead;
+#endif
 
     bool Buffer::readFd(int fd)
     {
@@ -51,19 +55,39 @@ namespace MuduoPlus
         }
 
 #else
+        return readFd(fd, NULL);
+#endif
+    }
+
+#ifndef WIN32
+
+    bool Buffer::readFd(int fd, std::vector<int>* receivedFds, size_t maxBytes)
+    {
+        size_t total = 0;
 
         while(true)
         {
             char extrabuf[MAX_TO_READ_ONCE] = {0};
             struct iovec vec[2];
             const size_t writable = writableBytes();
+            // never ask the socket for more than the budget has left
+            const size_t left = maxBytes > 0 ? maxBytes - total : writable + sizeof(extrabuf);
             vec[0].iov_base = begin() + writerIndex_;
-            vec[0].iov_len = writable;
+            vec[0].iov_len = std::min(writable, left);
             vec[1].iov_base = extrabuf;
-            vec[1].iov_len = sizeof(extrabuf);
+            vec[1].iov_len = std::min(sizeof(extrabuf), left - vec[0].iov_len);
 
-            const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
-            const ssize_t n = readv(fd, vec, iovcnt);
+            const int iovcnt = (writable < sizeof(extrabuf) && vec[1].iov_len > 0) ? 2 : 1;
+            ssize_t n = 0;
+
+            if(receivedFds == NULL)
+            {
+                n = readv(fd, vec, iovcnt);
+            }
+            else
+            {
+                n = readMsg(fd, vec, iovcnt, receivedFds);
+            }
 
             if(n < 0)
             {
@@ -74,24 +98,68 @@ namespace MuduoPlus
             {
                 return false;
             }
-            else if(static_cast<size_t>(n) <= writable)
+            else if(static_cast<size_t>(n) <= vec[0].iov_len)
             {
-                // no more data
+                // no more data, or the budget is spent
                 writerIndex_ += n;
                 return true;
             }
             else
             {
-                writerIndex_ = buffer_.size();
-                append(extrabuf, n - writable);
+                writerIndex_ += vec[0].iov_len;
+                append(extrabuf, n - vec[0].iov_len);
+                total += n;
+
+                // the socket stays readable, the poller reports it again
+                if(maxBytes > 0 && total >= maxBytes)
+                {
+                    return true;
+                }
 
                 // go on read
             }
         }
+    }
+
+    ssize_t Buffer::readMsg(int fd, struct iovec* vec, int iovcnt, std::vector<int>* receivedFds)
+    {
+        char control[CMSG_SPACE(sizeof(int) * kMaxFdsPerRead)];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = vec;
+        msg.msg_iovlen = iovcnt;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+
+        if(n < 0)
+        {
+            return n;
+        }
+
+        for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                const int* fds = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+                receivedFds->insert(receivedFds->end(), fds, fds + count);
+            }
+        }
 
-#endif
+        if(msg.msg_flags & MSG_CTRUNC)
+        {
+            // the kernel closed the descriptors that did not fit
+            LOG_PRINT(LogType_Warn, "fd[%d] more than %d descriptors in one read, some lost",
+                      fd, kMaxFdsPerRead);
+        }
+
+        return n;
     }
 
+#endif
+
     /*bool Buffer::sendFd(int fd, int len)
     {
         while (true)
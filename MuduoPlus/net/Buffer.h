@@ -379,7 +379,20 @@ namespace MuduoPlus
         bool readFd(int fd);
         //bool sendFd(int fd, int len);
 
+#ifndef WIN32
+        /// Same as readFd(fd), descriptors passed with SCM_RIGHTS over a
+        /// unix socket are appended to receivedFds and owned by the caller.
+        /// A non zero maxBytes stops reading once that much has been read,
+        /// the rest is left in the socket.
+        bool readFd(int fd, std::vector<int>* receivedFds, size_t maxBytes = 0);
+#endif
+
     private:
+#ifndef WIN32
+        static const int kMaxFdsPerRead = 16;
+
+        ssize_t readMsg(int fd, struct iovec* vec, int iovcnt, std::vector<int>* receivedFds);
+#endif
 
         char* begin()
         {
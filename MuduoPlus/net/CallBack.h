@@ -15,6 +15,17 @@ namespace MuduoPlus
     typedef std::function<void(const TcpConnectionPtr&)> CloseCallback;
     typedef std::function<void(const TcpConnectionPtr&)> WriteCompleteCallback;
     typedef std::function<void(const TcpConnectionPtr&, size_t)> HighWaterMarkCallback;
+    typedef std::function<void(const TcpConnectionPtr&, size_t)> LowWaterMarkCallback;
+    // which deadline of a connection passed, see TcpConnection::setReadIdleTimeout
+    enum DeadlineKind
+    {
+        kDeadlineReadIdle,
+        kDeadlineWriteIdle,
+        kDeadlineLifetime
+    };
+    typedef std::function<void(const TcpConnectionPtr&, DeadlineKind)> DeadlineCallback;
+    // a descriptor received over a unix connection, the callback owns it
+    typedef std::function<void(const TcpConnectionPtr&, int fd)> FdCallback;
 
 // the data has been read to (buf, len)
     typedef std::function < void(const TcpConnectionPtr&,
@@ -15,7 +15,11 @@ namespace MuduoPlus
         : loop_(loop),
           fd_(fd),
           interestEvents_(kNoneEvent),
-          trigeredEvents_(kNoneEvent)
+          trigeredEvents_(kNoneEvent),
+          addedToLoop_(false),
+          priority_(kNormalPriority),
+          completionMode_(kNoCompletion),
+          writeResult_(0)
     {
     }
 
@@ -3,6 +3,7 @@
 #include <string>
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "base/Timestamp.h"
 
@@ -16,6 +17,24 @@ namespace MuduoPlus
         typedef std::function<void()> EventCallback;
         typedef std::function<void(Timestamp)> ReadEventCallback;
 
+        /// I/O a poller with completionIo does itself for the channel, the
+        /// callbacks get its results. Before the channel is first updated.
+        enum CompletionMode
+        {
+            kNoCompletion,
+            kCompletionRecv,    // reads of a connected socket, sends by submitSend
+            kCompletionAccept   // accepts of a listen socket
+        };
+
+        /// A completed recv or accept: result bytes at data, the accepted
+        /// fd, 0 for the end of the stream or -errno.
+        struct Completion
+        {
+            const char* data;
+            int         result;
+        };
+        typedef std::vector<Completion> CompletionList;
+
         Channel(EventLoop* loop, int fd);
         ~Channel();
 
@@ -53,6 +72,10 @@ namespace MuduoPlus
         {
             trigeredEvents_ = events;    // used by pollers
         }
+        int  trigeredEvents() const
+        {
+            return trigeredEvents_;
+        }
         bool isNoneEvent() const
         {
             return interestEvents_ == kNoneEvent;
@@ -68,15 +91,24 @@ namespace MuduoPlus
             interestEvents_ &= ~kReadEvent;
             update();
         }
+        // in completion mode it marks a send in flight, nothing to watch
         void enableWriting()
         {
             interestEvents_ |= kWriteEvent;
-            update();
+
+            if(completionMode_ == kNoCompletion)
+            {
+                update();
+            }
         }
         void disableWriting()
         {
             interestEvents_ &= ~kWriteEvent;
-            update();
+
+            if(completionMode_ == kNoCompletion)
+            {
+                update();
+            }
         }
         void enableErroring()
         {
@@ -115,6 +147,69 @@ namespace MuduoPlus
         void setOwner(std::weak_ptr<void> ptr);
         std::weak_ptr<void> getOwner();
 
+        /// Shown in slow callback reports.
+        void setName(const std::string& name)
+        {
+            name_ = name;
+        }
+        const std::string& name() const
+        {
+            return name_;
+        }
+
+        /// High priority channels are handled first in an iteration, for
+        /// the listen socket and the wakeup pipe ahead of data connections.
+        enum Priority
+        {
+            kHighPriority,
+            kNormalPriority
+        };
+
+        void setPriority(Priority priority)
+        {
+            priority_ = priority;
+        }
+        Priority priority() const
+        {
+            return priority_;
+        }
+
+        void setCompletionMode(CompletionMode mode)
+        {
+            completionMode_ = mode;
+        }
+        CompletionMode completionMode() const
+        {
+            return completionMode_;
+        }
+
+        /// Recvs or accepts of this iteration, in the read callback. The
+        /// data is the poller's until the next poll.
+        const CompletionList& readCompletions() const
+        {
+            return readCompletions_;
+        }
+        /// Bytes sent or -errno of the submitted send, in the write callback.
+        int  writeResult() const
+        {
+            return writeResult_;
+        }
+
+        // used by pollers
+        void addReadCompletion(const char* data, int result)
+        {
+            Completion completion = { data, result };
+            readCompletions_.push_back(completion);
+        }
+        void setWriteResult(int result)
+        {
+            writeResult_ = result;
+        }
+        void clearCompletions()
+        {
+            readCompletions_.clear();
+        }
+
         static const int kNoneEvent;
         static const int kReadEvent;
         static const int kWriteEvent;
@@ -132,6 +227,11 @@ namespace MuduoPlus
 
         std::weak_ptr<void> owner_;
         bool addedToLoop_;
+        Priority priority_;
+        std::string name_;
+        CompletionMode completionMode_;
+        CompletionList readCompletions_;
+        int        writeResult_;
 
         ReadEventCallback   readCallback_;
         EventCallback       writeCallback_;
@@ -0,0 +1,207 @@
+#include <assert.h>
+#include <zlib.h>
+#include <algorithm>
+
+#include "Compressor.h"
+#include "Buffer.h"
+#include "base/Logger.h"
+
+namespace MuduoPlus
+{
+    const size_t CompressorPool::kMaxIdle;
+
+    Compressor::Compressor(CompressionFormat format, int level)
+        : format_(format),
+          level_(level),
+          stream_(new z_stream_s())
+    {
+        // windowBits 15, plus 16 for the gzip wrapper
+        int windowBits = format == kCompressGzip ? 15 + 16 : 15;
+        int ret = deflateInit2(stream_.get(), level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
+
+        if(ret != Z_OK)
+        {
+            LOG_PRINT(LogType_Error, "Compressor - deflateInit2 failed:%d", ret);
+            stream_.reset();
+        }
+    }
+
+    Compressor::~Compressor()
+    {
+        if(stream_)
+        {
+            deflateEnd(stream_.get());
+        }
+    }
+
+    bool Compressor::compress(const char* data, size_t len, Buffer* out, bool finish)
+    {
+        if(!stream_)
+        {
+            return false;
+        }
+
+        z_stream_s* stream = stream_.get();
+        stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream->avail_in = static_cast<uInt>(len);
+
+        // room for all of it at once in the usual single piece case
+        out->ensureWritableBytes(finish ? deflateBound(stream, static_cast<uLong>(len)) : len / 2 + 64);
+        int ret = Z_OK;
+
+        for(;;)
+        {
+            stream->next_out = reinterpret_cast<Bytef*>(out->beginWrite());
+            stream->avail_out = static_cast<uInt>(out->writableBytes());
+            ret = deflate(stream, finish ? Z_FINISH : Z_NO_FLUSH);
+            out->hasWritten(out->writableBytes() - stream->avail_out);
+
+            if(ret == Z_STREAM_ERROR || ret == Z_STREAM_END ||
+                    (stream->avail_in == 0 && stream->avail_out > 0))
+            {
+                break;
+            }
+
+            out->ensureWritableBytes(4096);
+        }
+
+        if(ret == Z_STREAM_ERROR || (finish && ret != Z_STREAM_END))
+        {
+            LOG_PRINT(LogType_Error, "Compressor::compress - deflate failed:%d", ret);
+            deflateReset(stream);
+            return false;
+        }
+
+        if(finish)
+        {
+            deflateReset(stream);
+        }
+
+        return true;
+    }
+
+    Decompressor::Decompressor()
+        : stream_(new z_stream_s())
+    {
+        // windowBits 15, plus 32 to detect the gzip or zlib wrapper
+        int ret = inflateInit2(stream_.get(), 15 + 32);
+
+        if(ret != Z_OK)
+        {
+            LOG_PRINT(LogType_Error, "Decompressor - inflateInit2 failed:%d", ret);
+            stream_.reset();
+        }
+    }
+
+    Decompressor::~Decompressor()
+    {
+        if(stream_)
+        {
+            inflateEnd(stream_.get());
+        }
+    }
+
+    bool Decompressor::decompress(const char* data, size_t len, Buffer* out, size_t maxBytes)
+    {
+        if(!stream_)
+        {
+            return false;
+        }
+
+        z_stream_s* stream = stream_.get();
+        stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream->avail_in = static_cast<uInt>(len);
+        size_t produced = 0;
+        int ret = Z_OK;
+
+        while(ret == Z_OK)
+        {
+            if(produced >= maxBytes)
+            {
+                break;
+            }
+
+            out->ensureWritableBytes(std::min(maxBytes - produced, std::max<size_t>(len * 4, 4096)));
+            size_t room = std::min(out->writableBytes(), maxBytes - produced);
+            stream->next_out = reinterpret_cast<Bytef*>(out->beginWrite());
+            stream->avail_out = static_cast<uInt>(room);
+            ret = inflate(stream, Z_NO_FLUSH);
+            size_t n = room - stream->avail_out;
+            out->hasWritten(n);
+            produced += n;
+
+            // no progress possible, the input ended before the stream did
+            if(ret == Z_BUF_ERROR || (ret == Z_OK && stream->avail_in == 0 && stream->avail_out > 0))
+            {
+                break;
+            }
+        }
+
+        inflateReset(stream);
+        return ret == Z_STREAM_END;
+    }
+
+    CompressorPool::CompressorPool()
+    {
+    }
+
+    CompressorPool::~CompressorPool()
+    {
+    }
+
+    std::unique_ptr<Compressor> CompressorPool::acquire(CompressionFormat format, int level)
+    {
+        for(size_t i = compressors_.size(); i > 0; --i)
+        {
+            std::unique_ptr<Compressor>& pos = compressors_[i - 1];
+
+            if(pos->format() == format && pos->level() == level)
+            {
+                std::unique_ptr<Compressor> compressor(std::move(pos));
+                compressors_.erase(compressors_.begin() + (i - 1));
+                return compressor;
+            }
+        }
+
+        return std::unique_ptr<Compressor>(new Compressor(format, level));
+    }
+
+    void CompressorPool::release(std::unique_ptr<Compressor> compressor)
+    {
+        if(compressors_.size() < kMaxIdle)
+        {
+            compressors_.push_back(std::move(compressor));
+        }
+    }
+
+    std::unique_ptr<Decompressor> CompressorPool::acquireDecompressor()
+    {
+        if(decompressors_.empty())
+        {
+            return std::unique_ptr<Decompressor>(new Decompressor);
+        }
+
+        std::unique_ptr<Decompressor> decompressor(std::move(decompressors_.back()));
+        decompressors_.pop_back();
+        return decompressor;
+    }
+
+    void CompressorPool::release(std::unique_ptr<Decompressor> decompressor)
+    {
+        if(decompressors_.size() < kMaxIdle)
+        {
+            decompressors_.push_back(std::move(decompressor));
+        }
+    }
+
+    Buffer* CompressorPool::scratch()
+    {
+        if(!scratch_)
+        {
+            scratch_.reset(new Buffer);
+        }
+
+        scratch_->retrieveAll();
+        return scratch_.get();
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+// zlib streams for HttpServer response bodies and LengthHeaderCodec
+// payloads, built with MUDUO_WITH_ZLIB when zlib is found.
+
+#include <memory>
+#include <vector>
+
+#include "base/NonCopyable.h"
+
+struct z_stream_s;
+
+namespace MuduoPlus
+{
+    class Buffer;
+
+    enum CompressionFormat
+    {
+        kCompressGzip,      // RFC 1952, Content-Encoding: gzip
+        kCompressDeflate,   // RFC 1950 zlib stream, Content-Encoding: deflate
+    };
+
+    /// One deflate stream, reset rather than torn down between messages.
+    class Compressor : NonCopyable
+    {
+    public:
+        Compressor(CompressionFormat format, int level);
+        ~Compressor();
+
+        CompressionFormat format() const
+        {
+            return format_;
+        }
+
+        int level() const
+        {
+            return level_;
+        }
+
+        /// Appends the compressed form of data to out. Input may come in
+        /// pieces, finish ends the stream and readies the next one. False
+        /// on a zlib error, the stream is reset then.
+        bool compress(const char* data, size_t len, Buffer* out, bool finish);
+
+    private:
+        CompressionFormat format_;
+        int level_;
+        std::unique_ptr<z_stream_s> stream_;
+    };
+
+    /// One inflate stream, takes gzip and zlib input alike.
+    class Decompressor : NonCopyable
+    {
+    public:
+        Decompressor();
+        ~Decompressor();
+
+        /// Appends a whole compressed message to out, false if it is corrupt,
+        /// cut short or inflates to more than maxBytes.
+        bool decompress(const char* data, size_t len, Buffer* out, size_t maxBytes);
+
+    private:
+        std::unique_ptr<z_stream_s> stream_;
+    };
+
+    /// Idle streams of one EventLoop, a compression takes one and gives it
+    /// back instead of paying deflateInit's allocations every time. Loop
+    /// thread only, see EventLoop::compressorPool.
+    class CompressorPool : NonCopyable
+    {
+    public:
+        static const size_t kMaxIdle = 8;   // per kind
+
+        CompressorPool();
+        ~CompressorPool();
+
+        std::unique_ptr<Compressor> acquire(CompressionFormat format, int level);
+        void release(std::unique_ptr<Compressor> compressor);
+
+        std::unique_ptr<Decompressor> acquireDecompressor();
+        void release(std::unique_ptr<Decompressor> decompressor);
+
+        /// Scratch space for a compressed body, empty on return.
+        Buffer* scratch();
+
+    private:
+        std::vector<std::unique_ptr<Compressor>>    compressors_;
+        std::vector<std::unique_ptr<Decompressor>>  decompressors_;
+        std::unique_ptr<Buffer>                     scratch_;
+    };
+}
@@ -4,6 +4,7 @@
 #include "Connector.h"
 #include "EventLoop.h"
 #include "Channel.h"
+#include "Resolver.h"
 #include "base/Logger.h"
 
 namespace MuduoPlus
@@ -13,13 +14,30 @@ namespace MuduoPlus
     Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
         : loop_(loop),
           serverAddr_(serverAddr),
+          port_(serverAddr.port()),
+          nextAddress_(0),
+          resolving_(false),
           connect_(false),
           state_(kDisconnected),
-          retryDelayMs_(kInitRetryDelayMs)
+          retryDelayMs_(kInitRetryDelayMs),
+          socketType_(SOCK_STREAM)
     {
         //LOG_DEBUG << "ctor[" << this << "]";
     }
 
+    Connector::Connector(EventLoop* loop, const std::string& host, uint16_t port)
+        : loop_(loop),
+          host_(host),
+          port_(port),
+          nextAddress_(0),
+          resolving_(false),
+          connect_(false),
+          state_(kDisconnected),
+          retryDelayMs_(kInitRetryDelayMs),
+          socketType_(SOCK_STREAM)
+    {
+    }
+
     Connector::~Connector()
     {
         LOG_PRINT(LogType_Debug, "dtor[%p]", this);
@@ -37,13 +55,74 @@ namespace MuduoPlus
         loop_->assertInLoopThread();
         assert(state_ == kDisconnected);
 
-        if(connect_)
+        if(!connect_)
         {
+            LOG_PRINT(LogType_Debug, "do not connect");
+        }
+        else if(host_.empty())
+        {
+            connect();
+        }
+        else if(nextAddress_ < addresses_.size())
+        {
+            serverAddr_ = addresses_[nextAddress_++];
             connect();
         }
         else
         {
-            LOG_PRINT(LogType_Debug, "do not connect");
+            resolve();
+        }
+    }
+
+    std::string Connector::serverName() const
+    {
+        if(host_.empty())
+        {
+            return serverAddr_.toIpPort();
+        }
+
+        char buff[16] = { 0 };
+        snprintf(buff, sizeof(buff), ":%u", port_);
+        return host_ + buff;
+    }
+
+    void Connector::resolve()
+    {
+        if(resolving_)
+        {
+            return;
+        }
+
+        resolving_ = true;
+        std::weak_ptr<Connector> weakSelf(shared_from_this());
+
+        Resolver::instance().resolve(loop_, host_, port_,
+                                     [weakSelf](const std::vector<InetAddress>& addrs)
+        {
+            std::shared_ptr<Connector> self = weakSelf.lock();
+
+            if(self)
+            {
+                self->handleResolved(addrs);
+            }
+        });
+    }
+
+    void Connector::handleResolved(const std::vector<InetAddress>& addrs)
+    {
+        loop_->assertInLoopThread();
+        resolving_ = false;
+        addresses_ = addrs;
+        nextAddress_ = 0;
+
+        if(addresses_.empty())
+        {
+            LOG_PRINT(LogType_Warn, "Connector - can not resolve %s", host_.c_str());
+            retry(-1);
+        }
+        else if(state_ == kDisconnected)
+        {
+            startInLoop();
         }
     }
 
@@ -68,10 +147,11 @@ namespace MuduoPlus
 
     void Connector::connect()
     {
-        int sockFd = SocketOps::createSocket();
+        int sockFd = SocketOps::createSocket(serverAddr_.family(), socketType_);
         SocketOps::setSocketNoneBlocking(sockFd);
 
-        int ret = SocketOps::connect(sockFd, &serverAddr_.getSockAddr());
+        int ret = SocketOps::connect(sockFd, &serverAddr_.getSockAddr(),
+                                     serverAddr_.getSockAddrLen());
 
         if(ret == 0)  // connect success immediately
         {
@@ -106,6 +186,7 @@ namespace MuduoPlus
         loop_->assertInLoopThread();
         setState(kDisconnected);
         retryDelayMs_ = kInitRetryDelayMs;
+        nextAddress_ = addresses_.size();   // resolve again
         connect_ = true;
         startInLoop();
     }
@@ -192,18 +273,37 @@ namespace MuduoPlus
 
     void Connector::retry(int sockfd)
     {
-        SocketOps::closeSocket(sockfd);
+        if(sockfd >= 0)
+        {
+            SocketOps::closeSocket(sockfd);
+        }
+
         setState(kDisconnected);
 
-        if(connect_)
+        if(connect_ && nextAddress_ < addresses_.size())
+        {
+            // next address of the host right away, the delay is per round
+            LOG_PRINT(LogType_Info, "Connector::retry - %s failed, trying next address of %s",
+                      serverAddr_.toIpPort().c_str(), host_.c_str());
+            loop_->queueInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+        }
+        else if(connect_)
         {
-            LOG_PRINT(LogType_Info, "Connector::retry - Retry connecting to %s in %d milliseconds. ",
-                      serverAddr_.toIpPort().c_str(), retryDelayMs_);
+            if(connectFailedCallback_)
+            {
+                connectFailedCallback_();
+            }
+
+            if(connect_)
+            {
+                LOG_PRINT(LogType_Info, "Connector::retry - Retry connecting to %s in %d milliseconds. ",
+                          serverName().c_str(), retryDelayMs_);
 
-            loop_->runAfter(retryDelayMs_ / 1000.0,
-                            std::bind(&Connector::startInLoop, shared_from_this()));
+                loop_->runAfter(retryDelayMs_ / 1000.0,
+                                std::bind(&Connector::startInLoop, shared_from_this()));
 
-            retryDelayMs_ = (std::min)(retryDelayMs_ * 2, kMaxRetryDelayMs);
+                retryDelayMs_ = (std::min)(retryDelayMs_ * 2, kMaxRetryDelayMs);
+            }
         }
         else
         {
@@ -2,6 +2,8 @@
 
 #include <memory>
 #include <functional>
+#include <string>
+#include <vector>
 
 #include "base/NonCopyable.h"
 #include "InetAddress.h"
@@ -16,8 +18,13 @@ namespace MuduoPlus
     {
     public:
         typedef std::function<void(int sockfd)> NewConnectionCallback;
+        typedef std::function<void()> ConnectFailedCallback;
 
         Connector(EventLoop* loop, const InetAddress& serverAddr);
+        /// Resolves host with Resolver before every round of attempts and
+        /// tries the addresses in order, so an unreachable IPv6 address
+        /// falls through to IPv4.
+        Connector(EventLoop* loop, const std::string& host, uint16_t port);
         ~Connector();
 
         void setNewConnectionCallback(const NewConnectionCallback& cb)
@@ -25,14 +32,31 @@ namespace MuduoPlus
             newConnectionCallback_ = cb;
         }
 
+        /// Called when a round of attempts failed, every address of the host
+        /// included, before the delayed retry. The callback may stop().
+        void setConnectFailedCallback(const ConnectFailedCallback& cb)
+        {
+            connectFailedCallback_ = cb;
+        }
+
         void start();  // can be called in any thread
         void restart();  // must be called in loop thread
         void stop();  // can be called in any thread
 
+        /// The address being tried, unset before a host name resolved.
         const InetAddress& serverAddress() const
         {
             return serverAddr_;
         }
+        /// host:port as given, or the address.
+        std::string serverName() const;
+
+        /// SOCK_STREAM by default, SOCK_SEQPACKET for a unix server of that type.
+        /// Before start().
+        void setSocketType(int type)
+        {
+            socketType_ = type;
+        }
 
     private:
         enum States { kDisconnected, kConnecting, kConnected };
@@ -44,6 +68,8 @@ namespace MuduoPlus
             state_ = s;
         }
         void startInLoop();
+        void resolve();
+        void handleResolved(const std::vector<InetAddress>& addrs);
         void stopInLoop();
         void connect();
         void connecting(int sockfd);
@@ -55,10 +81,17 @@ namespace MuduoPlus
 
         EventLoop* loop_;
         InetAddress serverAddr_;
+        std::string host_;     // empty when constructed with an address
+        uint16_t port_;
+        std::vector<InetAddress> addresses_;   // last resolution
+        size_t nextAddress_;
+        bool resolving_;
         bool connect_; // atomic
         States state_;  // FIXME: use atomic variable
         std::unique_ptr<Channel> channelPtr_;
         NewConnectionCallback newConnectionCallback_;
+        ConnectFailedCallback connectFailedCallback_;
         int retryDelayMs_;
+        int socketType_;
     };
 }
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <new>
+
+#include "Coroutine.h"
+#include "TcpClient.h"
+#include "TcpServer.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        const size_t kFrameClassSize = 64;
+        const size_t kFrameClassCount = 64;    // pools frames up to 4KiB
+        const size_t kMaxFreeFrames = 1024;    // per class and thread
+
+        struct FreeFrame
+        {
+            FreeFrame* next;
+        };
+
+        struct FrameLists
+        {
+            FrameLists()
+            {
+                std::fill(heads, heads + kFrameClassCount, static_cast<FreeFrame*>(NULL));
+                std::fill(counts, counts + kFrameClassCount, 0);
+            }
+
+            ~FrameLists()
+            {
+                for(size_t i = 0; i < kFrameClassCount; ++i)
+                {
+                    while(heads[i])
+                    {
+                        FreeFrame* frame = heads[i];
+                        heads[i] = frame->next;
+                        ::operator delete(frame);
+                    }
+                }
+            }
+
+            FreeFrame*  heads[kFrameClassCount];
+            size_t      counts[kFrameClassCount];
+        };
+
+        thread_local FrameLists t_frames;
+    }
+
+    void* CoFramePool::allocate(size_t size)
+    {
+        size_t index = (size - 1) / kFrameClassSize;
+
+        if(index >= kFrameClassCount)
+        {
+            return ::operator new(size);
+        }
+
+        FreeFrame* frame = t_frames.heads[index];
+
+        if(frame)
+        {
+            t_frames.heads[index] = frame->next;
+            --t_frames.counts[index];
+            return frame;
+        }
+
+        return ::operator new((index + 1) * kFrameClassSize);
+    }
+
+    void CoFramePool::deallocate(void* frame, size_t size)
+    {
+        size_t index = (size - 1) / kFrameClassSize;
+
+        if(index >= kFrameClassCount || t_frames.counts[index] >= kMaxFreeFrames)
+        {
+            ::operator delete(frame);
+            return;
+        }
+
+        FreeFrame* freeFrame = static_cast<FreeFrame*>(frame);
+        freeFrame->next = t_frames.heads[index];
+        t_frames.heads[index] = freeFrame;
+        ++t_frames.counts[index];
+    }
+
+    CoConnectionPtr CoConnection::attach(const TcpConnectionPtr& conn)
+    {
+        conn->getLoop()->assertInLoopThread();
+
+        CoConnectionPtr coConn = std::make_shared<CoConnection>(conn);
+        std::weak_ptr<CoConnection> weakConn = coConn;
+
+        // weak, the connection must not keep its CoConnection alive
+        conn->setContext(weakConn);
+        conn->setMessageCallback([weakConn](const TcpConnectionPtr&, Buffer*, Timestamp)
+        {
+            if(CoConnectionPtr coConn = weakConn.lock())
+            {
+                coConn->onMessage();
+            }
+        });
+        return coConn;
+    }
+
+    void CoConnection::detach(const TcpConnectionPtr& conn)
+    {
+        Any& context = conn->getContext();
+
+        if(!context.Is<std::weak_ptr<CoConnection>>())
+        {
+            return;
+        }
+
+        if(CoConnectionPtr coConn = context.AnyCast<std::weak_ptr<CoConnection>>().lock())
+        {
+            coConn->onClosed();
+        }
+    }
+
+    CoConnection::CoConnection(const TcpConnectionPtr& conn)
+        : conn_(conn),
+          readWant_(0),
+          closed_(false)
+    {
+    }
+
+    CoConnection::~CoConnection()
+    {
+        if(!closed_)
+        {
+            conn_->gracefulClose();
+        }
+    }
+
+    CoConnection::WriteAwaiter CoConnection::write(const StringPiece& data)
+    {
+        if(!closed_)
+        {
+            conn_->send(data);
+        }
+
+        return WriteAwaiter{ this };
+    }
+
+    void CoConnection::close()
+    {
+        if(!closed_)
+        {
+            conn_->gracefulClose();
+            onClosed();
+        }
+    }
+
+    void CoConnection::onMessage()
+    {
+        if(reader_ && conn_->inputBuffer()->readableBytes() >= readWant_)
+        {
+            std::exchange(reader_, nullptr).resume();
+        }
+    }
+
+    void CoConnection::waitWriteComplete(std::coroutine_handle<> handle)
+    {
+        std::weak_ptr<CoConnection> weakConn = shared_from_this();
+        writer_ = handle;
+
+        // only while waiting, every completed send queues the callback
+        conn_->setWriteCompleteCallback([weakConn](const TcpConnectionPtr&)
+        {
+            if(CoConnectionPtr coConn = weakConn.lock())
+            {
+                coConn->onWriteComplete();
+            }
+        });
+    }
+
+    void CoConnection::onWriteComplete()
+    {
+        if(writer_ && conn_->pendingOutputBytes() == 0)
+        {
+            conn_->setWriteCompleteCallback(WriteCompleteCallback());
+            std::exchange(writer_, nullptr).resume();
+        }
+    }
+
+    void CoConnection::onClosed()
+    {
+        // the resumed coroutine may drop the last other reference
+        CoConnectionPtr guard = shared_from_this();
+        closed_ = true;
+
+        if(reader_)
+        {
+            std::exchange(reader_, nullptr).resume();
+        }
+
+        if(writer_)
+        {
+            std::exchange(writer_, nullptr).resume();
+        }
+    }
+
+    std::string CoConnection::take(size_t n)
+    {
+        Buffer* buf = conn_->inputBuffer();
+        n = std::min(n, buf->readableBytes());
+
+        std::string data(buf->peek(), n);
+        buf->retrieve(n);
+        return data;
+    }
+
+    void coServe(TcpServer* server, const CoHandler& handler)
+    {
+        server->setMessageCallback([](const TcpConnectionPtr&, Buffer*, Timestamp)
+        {
+        });
+        server->setConnectionCallback([handler](const TcpConnectionPtr & conn)
+        {
+            if(conn->connected())
+            {
+                handler(CoConnection::attach(conn)).detach();
+            }
+            else
+            {
+                CoConnection::detach(conn);
+            }
+        });
+    }
+
+    void CoConnectAwaiter::await_suspend(std::coroutine_handle<> handle)
+    {
+        std::shared_ptr<State> state = state_;
+        state->waiter = handle;
+
+        client_->setConnectionCallback([state](const TcpConnectionPtr & conn)
+        {
+            if(!conn->connected())
+            {
+                CoConnection::detach(conn);
+                return;
+            }
+
+            CoConnectionPtr coConn = CoConnection::attach(conn);
+
+            // a reconnect after the awaiting coroutine got its connection
+            // has no one to hand it to and closes again
+            if(state->waiter)
+            {
+                state->conn = coConn;
+                std::exchange(state->waiter, nullptr).resume();
+            }
+        });
+        client_->connect();
+    }
+}
@@ -0,0 +1,422 @@
+#pragma once
+
+// C++20 coroutines over the callback API, built with MUDUO_WITH_COROUTINES.
+//
+// A coroutine runs on the loop of the connection it works on and is resumed
+// right from that connection's callbacks, there is no scheduler and no
+// thread hop. Frames come from a per thread pool, a suspended read or write
+// allocates nothing.
+//
+//     Task<> echo(CoConnectionPtr conn)
+//     {
+//         for(std::string data = co_await conn->readSome(); !data.empty();
+//                 data = co_await conn->readSome())
+//         {
+//             co_await conn->write(data);
+//         }
+//     }
+//
+//     coServe(&server, echo);
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "base/NonCopyable.h"
+#include "base/StringPiece.h"
+#include "CallBack.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+
+namespace MuduoPlus
+{
+    class TcpClient;
+    class TcpServer;
+
+    /// Recycles coroutine frames of the calling thread by size class, so a
+    /// connection handler started per connection does not hit malloc.
+    class CoFramePool
+    {
+    public:
+        static void* allocate(size_t size);
+        static void  deallocate(void* frame, size_t size);
+    };
+
+    template<typename T = void> class Task;
+
+    namespace CoDetail
+    {
+        struct PromiseBase
+        {
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    PromiseBase& promise = handle.promise();
+
+                    if(promise.continuation_)
+                    {
+                        return promise.continuation_;
+                    }
+
+                    if(promise.detached_)
+                    {
+                        handle.destroy();
+                    }
+
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() noexcept
+                {
+                }
+            };
+
+            static void* operator new(size_t size)
+            {
+                return CoFramePool::allocate(size);
+            }
+
+            static void operator delete(void* frame, size_t size)
+            {
+                CoFramePool::deallocate(frame, size);
+            }
+
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            FinalAwaiter final_suspend() noexcept
+            {
+                return {};
+            }
+
+            // like the callbacks, an exception escaping a coroutine is fatal
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+
+            std::coroutine_handle<>     continuation_;
+            bool                        detached_ = false;
+        };
+
+        template<typename T>
+        struct Promise : PromiseBase
+        {
+            Task<T> get_return_object();
+
+            template<typename U>
+            void return_value(U&& value)
+            {
+                value_.emplace(std::forward<U>(value));
+            }
+
+            T result()
+            {
+                return std::move(*value_);
+            }
+
+            std::optional<T> value_;
+        };
+
+        template<>
+        struct Promise<void> : PromiseBase
+        {
+            Task<void> get_return_object();
+
+            void return_void()
+            {
+            }
+
+            void result()
+            {
+            }
+        };
+    }
+
+    /// Lazily started coroutine. co_await it from another coroutine, or
+    /// detach() it to run on its own, its frame then frees itself when it
+    /// finishes.
+    template<typename T>
+    class Task : NonCopyable
+    {
+    public:
+        typedef CoDetail::Promise<T> promise_type;
+        typedef std::coroutine_handle<promise_type> Handle;
+
+        explicit Task(Handle handle)
+            : handle_(handle)
+        {
+        }
+
+        Task(Task&& other) noexcept
+            : handle_(std::exchange(other.handle_, Handle()))
+        {
+        }
+
+        ~Task()
+        {
+            if(handle_)
+            {
+                handle_.destroy();
+            }
+        }
+
+        /// Runs the task on the calling thread up to its first suspension.
+        void detach()
+        {
+            Handle handle = std::exchange(handle_, Handle());
+            handle.promise().detached_ = true;
+            handle.resume();
+        }
+
+        struct Awaiter
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+            {
+                handle_.promise().continuation_ = continuation;
+                return handle_;
+            }
+
+            T await_resume()
+            {
+                return handle_.promise().result();
+            }
+
+            Handle handle_;
+        };
+
+        Awaiter operator co_await() &&
+        {
+            return Awaiter{ handle_ };
+        }
+
+    private:
+        Handle handle_;
+    };
+
+    namespace CoDetail
+    {
+        template<typename T>
+        Task<T> Promise<T>::get_return_object()
+        {
+            return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> Promise<void>::get_return_object()
+        {
+            return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+        }
+    }
+
+    class CoConnection;
+    typedef std::shared_ptr<CoConnection> CoConnectionPtr;
+
+    /// Awaitable side of a TcpConnection, loop thread only.
+    ///
+    /// It takes over the message and write complete callbacks of the
+    /// connection. The connection stays open while its CoConnection lives
+    /// and is closed when the last reference goes, usually with the handler
+    /// coroutine.
+    class CoConnection : NonCopyable,
+        public std::enable_shared_from_this<CoConnection>
+    {
+    public:
+        /// From the connection callback of an established connection.
+        static CoConnectionPtr attach(const TcpConnectionPtr& conn);
+        /// From the connection callback of a connection that went down,
+        /// wakes what waits on its CoConnection.
+        static void detach(const TcpConnectionPtr& conn);
+
+        explicit CoConnection(const TcpConnectionPtr& conn);
+        ~CoConnection();
+
+        const TcpConnectionPtr& connection() const
+        {
+            return conn_;
+        }
+
+        bool connected() const
+        {
+            return !closed_;
+        }
+
+        struct ReadAwaiter
+        {
+            bool await_ready() const
+            {
+                return self_->closed_ || self_->conn_->inputBuffer()->readableBytes() >= want_;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                self_->reader_ = handle;
+                self_->readWant_ = want_;
+            }
+
+            std::string await_resume()
+            {
+                return self_->take(all_ ? self_->conn_->inputBuffer()->readableBytes() : want_);
+            }
+
+            CoConnection*   self_;
+            size_t          want_;
+            bool            all_;
+        };
+
+        struct BufferAwaiter : ReadAwaiter
+        {
+            Buffer* await_resume() const
+            {
+                return self_->closed_ ? NULL : self_->conn_->inputBuffer();
+            }
+        };
+
+        struct WriteAwaiter
+        {
+            bool await_ready() const
+            {
+                return self_->closed_ || self_->conn_->pendingOutputBytes() == 0;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                self_->waitWriteComplete(handle);
+            }
+
+            bool await_resume() const
+            {
+                return !self_->closed_;
+            }
+
+            CoConnection*   self_;
+        };
+
+        /// co_await gives exactly n bytes, fewer only once the peer closed.
+        ReadAwaiter read(size_t n)
+        {
+            return ReadAwaiter{ this, n, false };
+        }
+
+        /// co_await gives what arrived, at least one byte, empty once the
+        /// peer closed.
+        ReadAwaiter readSome()
+        {
+            return ReadAwaiter{ this, 1, true };
+        }
+
+        /// co_await gives the input buffer once it holds n bytes, NULL once
+        /// the peer closed. The caller retrieves what it used, no copy.
+        BufferAwaiter readBuffer(size_t n)
+        {
+            return BufferAwaiter{ { this, n, false } };
+        }
+
+        /// Sends data right away, co_await resumes when the kernel took all
+        /// output and gives false if the connection went down first.
+        WriteAwaiter write(const StringPiece& data);
+
+        /// Closes after the queued output is written and wakes the waiters.
+        /// The socket goes with the last reference to the connection.
+        void close();
+
+    private:
+        void onMessage();
+        void waitWriteComplete(std::coroutine_handle<> handle);
+        void onWriteComplete();
+        void onClosed();
+        std::string take(size_t n);
+
+        TcpConnectionPtr            conn_;
+        std::coroutine_handle<>     reader_;
+        std::coroutine_handle<>     writer_;
+        size_t                      readWant_;
+        bool                        closed_;
+    };
+
+    typedef std::function<Task<>(CoConnectionPtr)> CoHandler;
+
+    /// Runs handler for every connection of server, on the connection's
+    /// loop. Replaces the server's connection and message callbacks, call
+    /// before start(). A capturing lambda must outlive its coroutines, a
+    /// plain function is the safe choice.
+    void coServe(TcpServer* server, const CoHandler& handler);
+
+    /// co_await resumes after ms milliseconds on loop, the calling thread's.
+    struct CoSleepAwaiter
+    {
+        bool await_ready() const
+        {
+            return seconds_ <= 0;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            loop_->runAfter(seconds_, [handle]()
+            {
+                handle.resume();
+            });
+        }
+
+        void await_resume() const
+        {
+        }
+
+        EventLoop*  loop_;
+        double      seconds_;
+    };
+
+    inline CoSleepAwaiter coSleep(EventLoop* loop, int64_t ms)
+    {
+        return CoSleepAwaiter{ loop, ms / 1000.0 };
+    }
+
+    /// co_await connects client and gives the connection once it is up,
+    /// client retries like connect() does. Replaces the client's
+    /// connection callback, in the client's loop thread.
+    struct CoConnectAwaiter
+    {
+        struct State
+        {
+            CoConnectionPtr             conn;
+            std::coroutine_handle<>     waiter;
+        };
+
+        bool await_ready() const
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        CoConnectionPtr await_resume()
+        {
+            return std::move(state_->conn);
+        }
+
+        TcpClient*              client_;
+        std::shared_ptr<State>  state_;
+    };
+
+    inline CoConnectAwaiter coConnect(TcpClient* client)
+    {
+        return CoConnectAwaiter{ client, std::make_shared<CoConnectAwaiter::State>() };
+    }
+}
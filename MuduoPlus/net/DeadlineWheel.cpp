@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <functional>
+
+#include "DeadlineWheel.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+
+namespace MuduoPlus
+{
+    DeadlineWheel::DeadlineWheel(EventLoop* loop)
+        : loop_(loop),
+          slots_(kSlotCount),
+          nextTick_(0),
+          size_(0),
+          ticking_(false)
+    {
+    }
+
+    DeadlineWheel::~DeadlineWheel()
+    {
+    }
+
+    void DeadlineWheel::add(const TcpConnectionPtr& conn, Timestamp deadline)
+    {
+        loop_->assertInLoopThread();
+
+        if(size_ == 0)
+        {
+            nextTick_ = loop_->cachedNow().microSecondsSinceEpoch() / kTickMicros;
+        }
+
+        // rounded up, a deadline inside a tick fires at its end
+        int64_t tick = (deadline.microSecondsSinceEpoch() + kTickMicros - 1) / kTickMicros;
+        tick = std::max(tick, nextTick_);
+        tick = std::min(tick, nextTick_ + static_cast<int64_t>(kSlotCount) - 1);
+
+        slots_[tick % kSlotCount].push_back(Entry(conn, deadline));
+        ++size_;
+
+        if(!ticking_)
+        {
+            ticking_ = true;
+            loop_->runAfter(kTickMicros / static_cast<double>(Timestamp::kMicroSecPerSec),
+                            std::bind(&DeadlineWheel::tick, this));
+        }
+    }
+
+    void DeadlineWheel::tick()
+    {
+        Timestamp now = loop_->cachedNow();
+        int64_t nowTick = now.microSecondsSinceEpoch() / kTickMicros;
+        int64_t endTick = std::min(nowTick + 1, nextTick_ + static_cast<int64_t>(kSlotCount));
+
+        while(nextTick_ < endTick && size_ > 0)
+        {
+            // entries re-added while checking go to later slots
+            expired_.swap(slots_[nextTick_ % kSlotCount]);
+            ++nextTick_;
+            size_ -= expired_.size();
+
+            for(auto &entry : expired_)
+            {
+                if(TcpConnectionPtr conn = entry.first.lock())
+                {
+                    conn->checkDeadlines(entry.second, now);
+                }
+            }
+
+            expired_.clear();
+        }
+
+        if(size_ > 0)
+        {
+            loop_->runAfter(kTickMicros / static_cast<double>(Timestamp::kMicroSecPerSec),
+                            std::bind(&DeadlineWheel::tick, this));
+        }
+        else
+        {
+            ticking_ = false;
+        }
+    }
+}
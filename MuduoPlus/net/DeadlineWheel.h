@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/NonCopyable.h"
+#include "base/Timestamp.h"
+#include "CallBack.h"
+
+namespace MuduoPlus
+{
+    class EventLoop;
+
+    /// Connection deadlines of one loop in a hashed timing wheel.
+    ///
+    /// A connection sits in the slot of its earliest deadline and only
+    /// records the time of its reads and writes, so activity costs a store
+    /// instead of a timer re-insert. When the slot comes up the connection
+    /// checks its deadlines against that time and goes into the slot of the
+    /// next one. Deadlines fire up to one tick late and further away than
+    /// the wheel turns are parked in its last slot. Loop thread only.
+    class DeadlineWheel : NonCopyable
+    {
+    public:
+        static const int64_t kTickMicros = 100 * 1000;
+        static const size_t kSlotCount = 512;
+
+        explicit DeadlineWheel(EventLoop* loop);
+        ~DeadlineWheel();
+
+        /// Calls TcpConnection::checkDeadlines of conn once deadline, a
+        /// monotonic time, passed.
+        void add(const TcpConnectionPtr& conn, Timestamp deadline);
+
+        /// Entries including superseded ones, see TcpConnection::armDeadlines.
+        size_t size() const
+        {
+            return size_;
+        }
+
+    private:
+        typedef std::pair<std::weak_ptr<TcpConnection>, Timestamp> Entry;
+
+        void tick();
+
+        EventLoop*  loop_;
+        std::vector<std::vector<Entry> > slots_;
+        std::vector<Entry> expired_;    // reused by tick
+        int64_t     nextTick_;          // first tick not processed yet
+        size_t      size_;
+        bool        ticking_;
+    };
+}
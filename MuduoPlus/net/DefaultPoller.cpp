@@ -0,0 +1,113 @@
+#include <stdlib.h>
+
+#include <mutex>
+
+#include "Poller.h"
+#include "base/Logger.h"
+
+#ifdef WIN32
+#include "Selector.h"
+#else
+#include "Epoller.h"
+#include "PollPoller.h"
+#endif
+
+#ifdef MUDUO_HAVE_IO_URING
+#include "IoUringPoller.h"
+#endif
+
+namespace MuduoPlus
+{
+    namespace
+    {
+#ifdef WIN32
+        const char* kPlatformBackend = "select";
+#else
+        const char* kPlatformBackend = "epoll";
+#endif
+
+        std::mutex& backendMutex()
+        {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        std::string& defaultBackendName()
+        {
+            static std::string name = ::getenv("MUDUO_POLLER") ? ::getenv("MUDUO_POLLER")
+                                                               : kPlatformBackend;
+            return name;
+        }
+    }
+
+    Poller* Poller::newPoller(const std::string& backend, EventLoop* loop)
+    {
+#ifdef WIN32
+
+        if(backend == "select")
+        {
+            return new Selector(loop);
+        }
+
+#else
+
+        if(backend == "epoll")
+        {
+            return new Epoller(loop);
+        }
+
+        if(backend == "poll")
+        {
+            return new PollPoller(loop);
+        }
+
+        if(backend == "uring")
+        {
+#ifdef MUDUO_HAVE_IO_URING
+            IoUringPoller* poller = new IoUringPoller(loop);
+
+            if(poller->valid())
+            {
+                return poller;
+            }
+
+            delete poller;
+            LOG_PRINT(LogType_Warn, "io_uring unavailable on this kernel");
+#else
+            LOG_PRINT(LogType_Warn, "built without io_uring");
+#endif
+            return NULL;
+        }
+
+#endif
+        LOG_PRINT(LogType_Warn, "unknown poller backend '%s'", backend.c_str());
+        return NULL;
+    }
+
+    Poller* Poller::newDefaultPoller(EventLoop* loop)
+    {
+        std::string backend = defaultBackend();
+        Poller* poller = newPoller(backend, loop);
+
+        if(poller == NULL)
+        {
+            LOG_PRINT(LogType_Warn, "poller '%s' not available, using %s",
+                      backend.c_str(), kPlatformBackend);
+            poller = newPoller(kPlatformBackend, loop);
+        }
+
+        return poller;
+    }
+
+    void Poller::setDefaultBackend(const std::string& backend)
+    {
+        std::lock_guard<std::mutex> guard(backendMutex());
+        defaultBackendName() = backend;
+    }
+
+    std::string Poller::defaultBackend()
+    {
+        std::lock_guard<std::mutex> guard(backendMutex());
+        return defaultBackendName();
+    }
+}
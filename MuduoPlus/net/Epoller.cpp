@@ -1,7 +1,23 @@
+#include <sys/ioctl.h>
+
 #include "Epoller.h"
 #include "base/Logger.h"
 #include "EventLoop.h"
 
+// linux/eventpoll.h has them since 6.9, older headers do not
+#ifndef EPIOCSPARAMS
+struct epoll_params
+{
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;
+};
+
+#define EPOLL_IOC_TYPE 0x8A
+#define EPIOCSPARAMS _IOW(EPOLL_IOC_TYPE, 0x01, struct epoll_params)
+#endif
+
 namespace MuduoPlus
 {
     Epoller::Epoller(EventLoop* loop)
@@ -22,7 +38,7 @@ namespace MuduoPlus
 
     void Epoller::poll(int timeoutMs, ChannelHolderList &activeChannelHolders)
     {
-        LOG_PRINT(LogType_Info, "fd total count %u", channelHolders_.size());
+        LOG_DEBUG("fd total count %u", channelHolders_.size());
 
         int numEvents = ::epoll_wait(epollfd_, &events_[0],
                                      static_cast<int>(events_.size()),
@@ -32,7 +48,7 @@ namespace MuduoPlus
 
         if(numEvents > 0)
         {
-            LOG_PRINT(LogType_Info, "epoll_wait %u events happended", numEvents);
+            LOG_DEBUG("epoll_wait %u events happended", numEvents);
             fillActiveChannelHolders(numEvents, activeChannelHolders);
 
             if((size_t)numEvents == events_.size())
@@ -42,7 +58,7 @@ namespace MuduoPlus
         }
         else if(numEvents == 0)
         {
-            LOG_PRINT(LogType_Info, "epoll_wait nothing happended");
+            LOG_DEBUG("epoll_wait nothing happended");
         }
         else
         {
@@ -54,6 +70,23 @@ namespace MuduoPlus
         }
     }
 
+    bool Epoller::setBusyPoll(int usec)
+    {
+        struct epoll_params params;
+        memset(&params, 0, sizeof(params));
+        params.busy_poll_usecs = usec;
+        params.busy_poll_budget = usec > 0 ? 8 : 0;     // the kernel's NAPI default
+        params.prefer_busy_poll = usec > 0 ? 1 : 0;
+
+        if(ioctl(epollfd_, EPIOCSPARAMS, &params) < 0)
+        {
+            LOG_PRINT(LogType_Warn, "epoll busy poll unavailable:%s", GetLastErrorText().c_str());
+            return false;
+        }
+
+        return true;
+    }
+
     void Epoller::updateChannel(Channel* pChannel)
     {
         Poller::assertInLoopThread();
@@ -81,9 +114,9 @@ namespace MuduoPlus
                 return;
             }
 
+            // loop internal channels such as the wakeup channel have no owner
             auto weakOwner = pChannel->getOwner();
             auto owner = weakOwner.lock();
-            assert(owner);
 
             ChannelHolder holder;
             holder.channel_ = pChannel;
@@ -142,13 +175,13 @@ namespace MuduoPlus
 
                 if(recvEvents)
                 {
-                    LOG_PRINT(LogType_Debug, "recvEvents:%d", recvEvents);
-                    pChannel->setRecvEvents(recvEvents);
+                    LOG_DEBUG("recvEvents:%d", recvEvents);
+                    pChannel->setTrigeredEvents(recvEvents);
                     activeChannelHolders.push_back(holder);
                 }
                 else
                 {
-                    LOG_PRINT(LogType_Debug, "none wait events");
+                    LOG_DEBUG("none wait events");
                 }
             }
             else
@@ -11,9 +11,16 @@ namespace MuduoPlus
         Epoller(EventLoop* loop);
         virtual ~Epoller();
 
+        virtual const char* name() const
+        {
+            return "epoll";
+        }
+
         virtual void poll(int timeoutMs, ChannelHolderList &activeChannelHolders);
         virtual void updateChannel(Channel* pChannel);
         virtual void removeChannel(Channel* pChannel);
+        /// EPIOCSPARAMS, needs Linux 6.9
+        virtual bool setBusyPoll(int usec);
 
     private:
         static const int kInitEventListSize = 16;
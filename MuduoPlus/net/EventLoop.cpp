@@ -1,30 +1,53 @@
+#include <algorithm>
 #include <limits.h>
+#include <stdio.h>
+#include <typeinfo>
 
 #include "base/LinuxWin.h"
 
 #include "EventLoop.h"
 #include "Channel.h"
+#include "DeadlineWheel.h"
+#ifdef MUDUO_HAVE_ZLIB
+#include "Compressor.h"
+#endif
 #include "TimerQueue.h"
 #include "SocketOps.h"
 #include "base/Logger.h"
 #include "base/define.h"
 
-#ifdef WIN32
-#include "Selector.h"
-#else
-#include "Epoller.h"
-#endif
+#include "Poller.h"
 
 namespace MuduoPlus
 {
+    namespace
+    {
+        // how often the wall clock is read to follow its changes
+        const int64_t kWallClockSyncNanos = 1000 * 1000 * 1000;
+
+        thread_local EventLoop* t_loopInThisThread = NULL;
+    }
 
     EventLoop::EventLoop()
+        : EventLoop(Poller::defaultBackend())
+    {
+    }
+
+    EventLoop::EventLoop(const std::string& pollerBackend)
         : looping_(false),
           pollReturned(false),
           quit_(false),
           eventHandling_(false),
           callingPendingFunctors_(false),
+          callingIterationEndFunctors_(false),
+          deferredFlush_(false),
+          readBudget_(0),
+          functorBudget_(0),
+          deferredBegin_(0),
+          busyPollNanos_(0),
+          kernelBusyPollUsec_(0),
           threadId_(GetCurrThreadID()),
+          metrics_(threadId_),
           timerQueue_(new TimerQueue(this))
     {
         /*LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_;
@@ -38,22 +61,31 @@ namespace MuduoPlus
             t_loopInThisThread = this;
         }*/
 
-#ifdef WIN32
-        poller_.reset(new Selector(this));
-#else
-        poller_.reset(new Epoller(this));
-#endif
+        poller_.reset(Poller::newPoller(pollerBackend, this));
+
+        if(!poller_)
+        {
+            poller_.reset(Poller::newDefaultPoller(this));
+        }
+
+        LOG_DEBUG("EventLoop uses poller %s", poller_->name());
+
+        if(t_loopInThisThread == NULL)
+        {
+            t_loopInThisThread = this;
+        }
 
         memset(wakeupFdPair_, 0, sizeof(wakeupFdPair_));
         SocketOps::createSocketPair(wakeupFdPair_);
 
         wakeupChannel_.reset(new Channel(this, wakeupFdPair_[1]));
+        wakeupChannel_->setName("wakeup");
+        wakeupChannel_->setPriority(Channel::kHighPriority);
         wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
         // we are always reading the wakeupfd
         wakeupChannel_->enableReading();
 
-        pollTimeoutMsec_ = INT_MAX;
-        timeOutCheckStamp_ = Timestamp::now();
+        cachedNow_ = Timestamp::monotonic();
     }
 
     EventLoop::~EventLoop()
@@ -64,7 +96,15 @@ namespace MuduoPlus
         wakeupChannel_->remove();
         SocketOps::closeSocket(wakeupFdPair_[0]);
         SocketOps::closeSocket(wakeupFdPair_[1]);
-        /*t_loopInThisThread = NULL;*/
+        if(t_loopInThisThread == this)
+        {
+            t_loopInThisThread = NULL;
+        }
+    }
+
+    EventLoop* EventLoop::getEventLoopOfCurrentThread()
+    {
+        return t_loopInThisThread;
     }
 
     void EventLoop::loop()
@@ -75,33 +115,92 @@ namespace MuduoPlus
         quit_ = false;  // FIXME: what if someone calls quit() before loop() ?
         //LOG_TRACE << "EventLoop " << this << " start looping";
 
+        int64_t lastActive = 0;
+        int64_t iterationEnd = LoopMetrics::nowNanos();
+        int64_t wallClockOffset = 0;     // micros from the monotonic to the wall clock
+        int64_t wallClockSyncedAt = iterationEnd - kWallClockSyncNanos;
+
         while(!quit_)
         {
+            // busy polling until busyPollNanos_ went by without events
+            bool spinning = busyPollNanos_ > 0 && iterationEnd - lastActive < busyPollNanos_;
             activeChannelHolders_.clear();
             pollReturned = false;
-            poller_->poll(pollTimeoutMsec_, activeChannelHolders_);
+            poller_->poll(deferredFunctors_.empty() && !spinning
+                          ? timerQueue_->pollTimeout(Timestamp(iterationEnd / 1000)) : 0,
+                          activeChannelHolders_);
             pollReturned = true;
             /*if (Logger::logLevel() <= Logger::TRACE)
             {
                 printActiveChannels();
             }*/
-            // TODO sort channel by priority
+            sortActiveChannels();
 
             eventHandling_ = true;
             /*for (ChannelHolderList::iterator it = activeChannelHolders_.begin();
                 it != activeChannelHolders_.end(); ++it)*/
-            pollReturnTime_ = Timestamp::now();
+            // the metrics clock is steady_clock too, one read serves both
+            int64_t iterationStart = LoopMetrics::nowNanos();
+            cachedNow_ = Timestamp(iterationStart / 1000);
+
+            // the receive time is wall clock, from the same read plus an
+            // offset taken once a second
+            if(iterationStart - wallClockSyncedAt >= kWallClockSyncNanos)
+            {
+                wallClockOffset = Timestamp::now().microSecondsSinceEpoch() - iterationStart / 1000;
+                wallClockSyncedAt = iterationStart;
+            }
+
+            pollReturnTime_ = Timestamp(iterationStart / 1000 + wallClockOffset);
+            int64_t callbackStart = iterationStart;
+
+            if(!activeChannelHolders_.empty())
+            {
+                lastActive = iterationStart;
+            }
+
+            if(spinning && activeChannelHolders_.empty())
+            {
+                metrics_.spinPolls.add(1);
+                metrics_.spinNanos.add(iterationStart - iterationEnd);
+            }
+            else if(spinning)
+            {
+                metrics_.spinHits.add(1);
+            }
+
+            stallDetector_.beginIteration(iterationStart);
+            metrics_.pollEvents.record(activeChannelHolders_.size());
+            metrics_.pollEventsTotal.add(activeChannelHolders_.size());
 
             for(auto &pos : activeChannelHolders_)
             {
                 Channel *pChannel = pos.channel_;
                 pChannel->handleEvent(pollReturnTime_);
+
+                int64_t callbackEnd = LoopMetrics::nowNanos();
+                metrics_.callbackNanos.record(callbackEnd - callbackStart);
+
+                if(stallDetector_.isSlow(callbackEnd - callbackStart))
+                {
+                    char buf[32];
+                    snprintf(buf, sizeof buf, " fd=%d", pChannel->fd());
+                    stallDetector_.recordSlow(pChannel->name() + buf, callbackEnd - callbackStart);
+                }
+
+                callbackStart = callbackEnd;
             }
 
             eventHandling_ = false;
             doPendingFunctors();
 
-            checkTimeOut();
+            timerQueue_->timeOut(cachedNow_);
+            doIterationEndFunctors();
+
+            iterationEnd = LoopMetrics::nowNanos();
+            metrics_.iterationNanos.record(iterationEnd - iterationStart);
+            metrics_.iterations.add(1);
+            stallDetector_.endIteration(iterationEnd);
         }
 
         //LOG_TRACE << "EventLoop " << this << " stop looping";
@@ -140,7 +239,21 @@ namespace MuduoPlus
             pendingFunctors_.push_back(cb);
         }
 
-        if(!isInLoopThread() || callingPendingFunctors_)
+        // only functors queued while handling events still run in this
+        // iteration, ones from functors, timers or the iteration end
+        // would wait for the next poll to return
+        if(!isInLoopThread() || !eventHandling_)
+        {
+            wakeup();
+        }
+    }
+
+    void EventLoop::runAtIterationEnd(const Functor& cb)
+    {
+        assertInLoopThread();
+        iterationEndFunctors_.push_back(cb);
+
+        if(callingIterationEndFunctors_)
         {
             wakeup();
         }
@@ -148,17 +261,27 @@ namespace MuduoPlus
 
     TimerId EventLoop::runAt(const Timestamp& time, const TimerCallback& cb)
     {
-        return timerQueue_->addTimer(cb, time, 0.0);
+        // wall clock deadline to monotonic, later clock changes do not move it
+        Timestamp when = Timestamp::monotonic().addMicroSeconds(
+                             static_cast<double>(microSecondDifference(time, Timestamp::now())));
+        return timerQueue_->addTimer(cb, when, 0.0);
     }
 
     TimerId EventLoop::runAfter(double delay, const TimerCallback& cb)
     {
-        return runAt(Timestamp::now().addSeconds(delay), cb);
+        return timerQueue_->addTimer(cb, Timestamp::monotonic().addSeconds(delay), 0.0);
     }
 
     TimerId EventLoop::runEvery(double interval, const TimerCallback& cb)
     {
-        return timerQueue_->addTimer(cb, Timestamp::now().addSeconds(interval), interval);
+        return timerQueue_->addTimer(cb, Timestamp::monotonic().addSeconds(interval), interval);
+    }
+
+    bool EventLoop::setKernelBusyPoll(int usec)
+    {
+        assertInLoopThread();
+        kernelBusyPollUsec_ = usec;
+        return poller_->setBusyPoll(usec);
     }
 
     void EventLoop::cancel(TimerId timerId)
@@ -166,18 +289,31 @@ namespace MuduoPlus
         return timerQueue_->cancel(timerId);
     }
 
-    void EventLoop::resetPollTimeOut(int msec)
+    DeadlineWheel& EventLoop::deadlineWheel()
     {
-        assert(msec >= 0);
+        assertInLoopThread();
+
+        if(!deadlineWheel_)
+        {
+            deadlineWheel_.reset(new DeadlineWheel(this));
+        }
+
+        return *deadlineWheel_;
+    }
 
-        pollTimeoutMsec_ = msec;
-        timeOutCheckStamp_ = Timestamp::now();
+#ifdef MUDUO_HAVE_ZLIB
+    CompressorPool& EventLoop::compressorPool()
+    {
+        assertInLoopThread();
 
-        if(!pollReturned)
+        if(!compressorPool_)
         {
-            wakeup();
+            compressorPool_.reset(new CompressorPool);
         }
+
+        return *compressorPool_;
     }
+#endif
 
     void EventLoop::updateChannel(Channel* channel)
     {
@@ -185,6 +321,7 @@ namespace MuduoPlus
         assertInLoopThread();
 
         poller_->updateChannel(channel);
+        metrics_.channels.set(poller_->channelCount());
     }
 
     void EventLoop::removeChannel(Channel* channel)
@@ -210,6 +347,7 @@ namespace MuduoPlus
         }
 
         poller_->removeChannel(channel);
+        metrics_.channels.set(poller_->channelCount());
     }
 
     bool EventLoop::hasChannel(Channel* channel)
@@ -220,6 +358,24 @@ namespace MuduoPlus
         return poller_->hasChannel(channel);
     }
 
+    bool EventLoop::completionIo() const
+    {
+        return poller_->completionIo();
+    }
+
+#ifndef WIN32
+    bool EventLoop::submitSend(Channel* channel, const struct iovec* vec, int count)
+    {
+        assertInLoopThread();
+        return poller_->submitSend(channel, vec, count);
+    }
+#endif
+
+    const char* EventLoop::pollerName() const
+    {
+        return poller_->name();
+    }
+
     void EventLoop::abortNotInLoopThread()
     {
         /*LOG_FATAL << "EventLoop::abortNotInLoopThread - EventLoop " << this
@@ -246,20 +402,6 @@ namespace MuduoPlus
         }
     }
 
-    void EventLoop::checkTimeOut()
-    {
-        Timestamp nowStamp = Timestamp::now();
-        long durationMsec = (long)millisecondDifference(nowStamp, timeOutCheckStamp_);
-
-        if((long)durationMsec >= pollTimeoutMsec_)
-        {
-            timerQueue_->timeOut();
-        }
-
-        timeOutCheckStamp_ = nowStamp;
-        pollTimeoutMsec_ -= durationMsec;
-    }
-
     void EventLoop::handleRead()
     {
         unsigned char buf[1024] = { 0 };
@@ -276,24 +418,100 @@ namespace MuduoPlus
 #endif
     }
 
+    void EventLoop::sortActiveChannels()
+    {
+        auto isHigh = [](const ChannelHolder & holder)
+        {
+            return holder.channel_->priority() == Channel::kHighPriority;
+        };
+        auto firstNormal = std::find_if_not(activeChannelHolders_.begin(),
+                                            activeChannelHolders_.end(), isHigh);
+
+        // mostly there is none, keep the poller's order then
+        if(std::find_if(firstNormal, activeChannelHolders_.end(), isHigh)
+                != activeChannelHolders_.end())
+        {
+            std::stable_partition(firstNormal, activeChannelHolders_.end(), isHigh);
+        }
+    }
+
     void EventLoop::doPendingFunctors()
     {
+        // what the budget left over runs before anything queued since
         std::vector<Functor> functors;
+        size_t begin = deferredBegin_;
+        functors.swap(deferredFunctors_);
+        deferredBegin_ = 0;
         callingPendingFunctors_ = true;
 
+        if(functors.empty())
         {
             LockGuarder(mutex_);
             functors.swap(pendingFunctors_);
         }
 
-        for(size_t i = 0; i < functors.size(); i++)
+        size_t end = functors.size();
+
+        if(functorBudget_ > 0 && end - begin > functorBudget_)
+        {
+            end = begin + functorBudget_;
+        }
+
+        metrics_.functorQueueDepth.set(functors.size() - begin);
+        metrics_.functorsDeferred.set(functors.size() - end);
+        metrics_.functorsTotal.add(end - begin);
+
+        bool timing = stallDetector_.enabled();
+
+        for(size_t i = begin; i < end; i++)
         {
+            if(!timing)
+            {
+                functors[i]();
+                continue;
+            }
+
+            int64_t start = LoopMetrics::nowNanos();
             functors[i]();
+            int64_t nanos = LoopMetrics::nowNanos() - start;
+
+            if(stallDetector_.isSlow(nanos))
+            {
+                stallDetector_.recordSlow(std::string("functor ") + functors[i].target_type().name(),
+                                          nanos);
+            }
+        }
+
+        if(end < functors.size())
+        {
+            // do not keep what the finished ones captured alive meanwhile
+            for(size_t i = begin; i < end; i++)
+            {
+                functors[i] = Functor();
+            }
+
+            deferredFunctors_.swap(functors);
+            deferredBegin_ = end;
         }
 
         callingPendingFunctors_ = false;
     }
 
+    void EventLoop::doIterationEndFunctors()
+    {
+        std::vector<Functor> functors;
+        functors.swap(iterationEndFunctors_);
+        callingIterationEndFunctors_ = true;
+
+        // a functor adding another one gets it run at the next iteration end
+        for(size_t i = 0; i < functors.size(); i++)
+        {
+            functors[i]();
+        }
+
+        callingIterationEndFunctors_ = false;
+    }
+
     void EventLoop::printActiveChannels() const
     {
         for(ChannelHolderList::const_iterator it = activeChannelHolders_.begin();
@@ -2,6 +2,7 @@
 
 #include <mutex>
 #include <functional>
+#include <string>
 #include <vector>
 
 #include "base/LinuxWin.h"
@@ -10,10 +11,14 @@
 #include "CallBack.h"
 #include "TimerId.h"
 #include "ChannelHolder.h"
+#include "LoopMetrics.h"
+#include "StallDetector.h"
 
 namespace MuduoPlus
 {
     class Channel;
+    class CompressorPool;
+    class DeadlineWheel;
     class Poller;
     class TimerQueue;
 
@@ -23,11 +28,16 @@ namespace MuduoPlus
         typedef std::function<void()> Functor;
 
         EventLoop();
+        /// Loop on the named Poller backend, see Poller::newPoller. Falls
+        /// back to the default backend if it is not available.
+        explicit EventLoop(const std::string& pollerBackend);
         ~EventLoop();
 
         void loop();
         void quit();
 
+        /// Wall clock time poll returned, the receive time of the
+        /// iteration's events. Derived from the cachedNow read.
         Timestamp   pollReturnTime() const
         {
             return pollReturnTime_;
@@ -35,12 +45,97 @@ namespace MuduoPlus
 
         void runInLoop(const Functor& cb);
         void queueInLoop(const Functor& cb);
+        /// Runs cb once at the end of the current iteration, after the
+        /// pending functors and timers. Loop thread only.
+        void runAtIterationEnd(const Functor& cb);
+
+        /// Connections on a deferred flush loop queue what they send during
+        /// an iteration and write it with one writev at its end, see
+        /// TcpConnection::flush. Merges SOCK_SEQPACKET records like any
+        /// queued output does. Before loop() or from the loop thread.
+        void setDeferredFlush(bool on)
+        {
+            deferredFlush_ = on;
+        }
+        bool deferredFlush() const
+        {
+            return deferredFlush_;
+        }
+
+        /// Bytes a connection reads per read event, 0 for no limit. What
+        /// is left stays in the socket, or in the connection when the
+        /// poller did the read, until later in the loop, so one busy peer
+        /// can not hold up the others. Before loop() or from the loop
+        /// thread.
+        void setReadBudget(size_t bytes)
+        {
+            readBudget_ = bytes;
+        }
+        size_t readBudget() const
+        {
+            return readBudget_;
+        }
 
+        /// Pending functors run per iteration, 0 for no limit. The rest run
+        /// first in the next iteration, which then polls without waiting.
+        /// Before loop() or from the loop thread.
+        void setFunctorBudget(size_t count)
+        {
+            functorBudget_ = count;
+        }
+        size_t functorBudget() const
+        {
+            return functorBudget_;
+        }
+
+        /// Busy polling: for spinMicros after an iteration with events the
+        /// loop polls without waiting instead of blocking, saving the wakeup
+        /// latency at the price of a busy core. 0, the default, always
+        /// blocks. The spin_* metrics tell how much of the spinning paid
+        /// off. Before loop() or from the loop thread.
+        void setBusyPoll(int64_t spinMicros)
+        {
+            busyPollNanos_ = spinMicros * 1000;
+        }
+        int64_t busyPoll() const
+        {
+            return busyPollNanos_ / 1000;
+        }
+
+        /// Kernel busy polling of usec: the epoll busy poll parameters where
+        /// the backend and kernel support them, and SO_BUSY_POLL on the
+        /// connections established afterwards. Returns whether the poller
+        /// took it. Loop thread only.
+        bool setKernelBusyPoll(int usec);
+        int kernelBusyPoll() const
+        {
+            return kernelBusyPollUsec_;
+        }
+
+        /// Timers run on the monotonic clock, a wall clock time for runAt is
+        /// converted once, so clock changes neither fire nor stall them.
         TimerId runAt(const Timestamp& time, const TimerCallback& cb);
         TimerId runAfter(double delay, const TimerCallback& cb);
         TimerId runEvery(double interval, const TimerCallback& cb);
         void    cancel(TimerId timerId);
-        void    resetPollTimeOut(int msec);
+
+        /// Monotonic time read once per iteration when poll returns, for
+        /// timeouts and idle checks on the hot path. It lags the real time
+        /// by the time spent in the iteration. Loop thread only.
+        Timestamp cachedNow() const
+        {
+            return cachedNow_;
+        }
+
+        /// Idle and lifetime deadlines of this loop's connections, created
+        /// on first use. Loop thread only.
+        DeadlineWheel& deadlineWheel();
+
+#ifdef MUDUO_HAVE_ZLIB
+        /// Reusable zlib streams of this loop, created on first use. Loop
+        /// thread only.
+        CompressorPool& compressorPool();
+#endif
 
         bool IsPollReturn() const
         {
@@ -50,6 +145,11 @@ namespace MuduoPlus
         void updateChannel(Channel* channel);
         void removeChannel(Channel* channel);
         bool hasChannel(Channel* channel);
+        /// See Poller::completionIo and Poller::submitSend.
+        bool completionIo() const;
+#ifndef WIN32
+        bool submitSend(Channel* channel, const struct iovec* vec, int count);
+#endif
 
         void assertInLoopThread()
         {
@@ -61,14 +161,33 @@ namespace MuduoPlus
 
         bool isInLoopThread() const
         {
-            return threadId_ == GetCurrentThreadId();
+            return threadId_ == GetCurrThreadID();
         }
 
+        /// The first EventLoop created in the calling thread, NULL in a
+        /// thread without one, e.g. to not block a thread that runs a loop.
+        static EventLoop* getEventLoopOfCurrentThread();
+
         bool eventHandling() const
         {
             return eventHandling_;
         }
 
+        /// Written by the loop thread only, see MetricsRegistry for reading.
+        LoopMetrics& metrics()
+        {
+            return metrics_;
+        }
+
+        /// Configure before loop() or from the loop thread.
+        StallDetector& stallDetector()
+        {
+            return stallDetector_;
+        }
+
+        /// Name of the Poller backend this loop runs on.
+        const char* pollerName() const;
+
         /*void setContext(const boost::any& context)
         {
             context_ = context;
@@ -86,9 +205,10 @@ namespace MuduoPlus
 
     private:
         void abortNotInLoopThread();
-        void checkTimeOut();
         void handleRead();
         void doPendingFunctors();
+        void doIterationEndFunctors();
+        void sortActiveChannels();
 
         void printActiveChannels() const;
 
@@ -99,12 +219,24 @@ namespace MuduoPlus
         bool                        quit_;
         bool                        eventHandling_;
         bool                        callingPendingFunctors_;
+        bool                        callingIterationEndFunctors_;
+        bool                        deferredFlush_;
+        size_t                      readBudget_;
+        size_t                      functorBudget_;
+        size_t                      deferredBegin_;        // next one to run in deferredFunctors_
+        int64_t                     busyPollNanos_;
+        int                         kernelBusyPollUsec_;
         const int                   threadId_;
-        int                         pollTimeoutMsec_;
-        Timestamp                   timeOutCheckStamp_;
+        LoopMetrics                 metrics_;
+        StallDetector               stallDetector_;
         Timestamp                   pollReturnTime_;
+        Timestamp                   cachedNow_;
         std::shared_ptr<Poller>     poller_;
         std::shared_ptr<TimerQueue> timerQueue_;
+        std::shared_ptr<DeadlineWheel> deadlineWheel_;
+#ifdef MUDUO_HAVE_ZLIB
+        std::shared_ptr<CompressorPool> compressorPool_;
+#endif
         socket_t                    wakeupFdPair_[2];
         std::shared_ptr<Channel>    wakeupChannel_;
         //boost::any                  context_;
@@ -113,5 +245,7 @@ namespace MuduoPlus
 
         std::mutex                  mutex_;
         std::vector<Functor>        pendingFunctors_;
+        std::vector<Functor>        iterationEndFunctors_; // loop thread only
+        std::vector<Functor>        deferredFunctors_;     // loop thread only, left by the budget
     };
 }
\ No newline at end of file
@@ -1,15 +1,18 @@
 #include "EventLoopThread.h"
 #include "EventLoop.h"
+#include "Poller.h"
 #include "base/define.h"
 
 namespace MuduoPlus
 {
-    EventLoopThread::EventLoopThread(const ThreadInitCallback& cb)
+    EventLoopThread::EventLoopThread(const ThreadInitCallback& cb,
+                                     const std::string& pollerBackend)
         : loop_(NULL),
           exiting_(false),
           /*threadPtr(std::bind(&EventLoopThread::threadFunc, this), name),*/
           mutex_(),
-          callback_(cb)
+          callback_(cb),
+          pollerBackend_(pollerBackend)
     {
     }
 
@@ -33,11 +36,10 @@ namespace MuduoPlus
         //threadPtr.start();
 
         {
-            LockGuarder(mutex_);
+            std::unique_lock<std::mutex> uniLock(mutex_);
 
             while(loop_ == NULL)
             {
-                std::unique_lock<std::mutex> uniLock(mutex_);
                 cond_.wait(uniLock);
             }
         }
@@ -47,7 +49,7 @@ namespace MuduoPlus
 
     void EventLoopThread::threadFunc()
     {
-        EventLoop loop;
+        EventLoop loop(pollerBackend_.empty() ? Poller::defaultBackend() : pollerBackend_);
 
         if(callback_)
         {
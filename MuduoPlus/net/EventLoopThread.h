@@ -18,7 +18,9 @@ namespace MuduoPlus
     public:
         typedef std::function<void(EventLoop*)> ThreadInitCallback;
 
-        EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback());
+        /// An empty pollerBackend uses Poller::defaultBackend().
+        EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(),
+                        const std::string& pollerBackend = std::string());
         ~EventLoopThread();
         EventLoop* startLoop();
 
@@ -31,5 +33,6 @@ namespace MuduoPlus
         std::mutex              mutex_;
         std::condition_variable cond_;
         ThreadInitCallback      callback_;
+        std::string             pollerBackend_;
     };
 }
\ No newline at end of file
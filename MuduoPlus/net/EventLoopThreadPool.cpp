@@ -29,7 +29,7 @@ namespace MuduoPlus
 
         for(int i = 0; i < numThreads_; ++i)
         {
-            auto loopThreadPtr = std::make_shared<EventLoopThread>(cb);
+            auto loopThreadPtr = std::make_shared<EventLoopThread>(cb, pollerBackend_);
             threads_.push_back(loopThreadPtr);
             loops_.push_back(loopThreadPtr->startLoop());
         }
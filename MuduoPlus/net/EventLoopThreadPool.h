@@ -23,6 +23,12 @@ namespace MuduoPlus
         {
             numThreads_ = numThreads;
         }
+        /// Poller backend of the pool's loops, Poller::defaultBackend() if
+        /// empty. Must be called before start().
+        void setPollerBackend(const std::string& backend)
+        {
+            pollerBackend_ = backend;
+        }
         void start(const ThreadInitCallback& cb = ThreadInitCallback());
 
         // valid after calling start()
@@ -48,6 +54,7 @@ namespace MuduoPlus
 
         EventLoop* baseLoop_;
         std::string name_;
+        std::string pollerBackend_;
         bool started_;
         int numThreads_;
         int next_;
@@ -0,0 +1,585 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "HttpClient.h"
+#include "HttpResponseParser.h"
+#include "Connector.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+#include "base/Logger.h"
+
+namespace MuduoPlus
+{
+    struct HttpClient::Call
+    {
+        Call()
+            : head(false),
+              idempotent(false),
+              retried(false),
+              done(false)
+        {
+        }
+
+        std::string wire;       // the request as sent
+        bool head;
+        bool idempotent;        // may be sent again, and pipelined
+        bool retried;
+        bool done;              // the callback ran
+        HttpResponseCallback cb;
+        TimerId timer;
+        std::weak_ptr<Connection> connection;  // while in flight
+    };
+
+    struct HttpClient::Connection
+    {
+        Host* host;
+        std::shared_ptr<Connector> connector;
+        TcpConnectionPtr conn;      // null while connecting
+        std::deque<CallPtr> inflight;
+        HttpResponseParser parser;  // for inflight.front()
+    };
+
+    struct HttpClient::Host
+    {
+        std::string name;
+        uint16_t port;
+        std::deque<CallPtr> waiting;
+        std::vector<ConnectionPtr> connections;
+    };
+
+    namespace
+    {
+        bool isIdempotent(const std::string& method)
+        {
+            return method == "GET" || method == "HEAD" || method == "PUT" ||
+                   method == "DELETE" || method == "OPTIONS" || method == "TRACE";
+        }
+
+        void ignoreConnection(const TcpConnectionPtr&)
+        {
+        }
+
+        void destroyConnection(EventLoop* loop, const TcpConnectionPtr& conn)
+        {
+            loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+        }
+
+        // Connector::stop queues work with a raw pointer, this functor
+        // queued after it keeps the connector alive until that ran
+        void stopConnector(EventLoop* loop, const std::shared_ptr<Connector>& connector)
+        {
+            connector->stop();
+            loop->queueInLoop([connector]()
+            {
+            });
+        }
+    }
+
+    HttpClient::HttpClient(EventLoop* loop, const std::string& name)
+        : loop_(loop),
+          name_(name),
+          maxConnectionsPerHost_(6),
+          maxPipeline_(1),
+          timeoutSeconds_(30),
+          idleSeconds_(60),
+          nextConnId_(1)
+    {
+    }
+
+    HttpClient::~HttpClient()
+    {
+        loop_->assertInLoopThread();
+
+        for(auto &pos : hosts_)
+        {
+            Host* host = pos.second.get();
+
+            for(auto &call : host->waiting)
+            {
+                loop_->cancel(call->timer);
+            }
+
+            for(auto &conn : host->connections)
+            {
+                for(auto &call : conn->inflight)
+                {
+                    loop_->cancel(call->timer);
+                }
+
+                if(conn->conn)
+                {
+                    conn->conn->setMessageCallback(defaultMessageCallback);
+                    conn->conn->setCloseCallback(
+                        std::bind(&destroyConnection, loop_, std::placeholders::_1));
+                    conn->conn->forceClose();
+                }
+                else
+                {
+                    stopConnector(loop_, conn->connector);
+                }
+            }
+        }
+    }
+
+    void HttpClient::get(const std::string& host, uint16_t port,
+                         const std::string& path, const HttpResponseCallback& cb)
+    {
+        HttpClientRequest req;
+        req.path = path;
+        request(host, port, req, cb);
+    }
+
+    void HttpClient::request(const std::string& host, uint16_t port,
+                             const HttpClientRequest& req, const HttpResponseCallback& cb)
+    {
+        CallPtr call(new Call);
+        call->head = req.method == "HEAD";
+        call->idempotent = isIdempotent(req.method);
+        call->cb = cb;
+
+        // serialized here, not on the loop thread
+        std::string& wire = call->wire;
+        wire.reserve(128 + req.path.size() + req.body.size());
+        wire += req.method;
+        wire += ' ';
+        wire += req.path;
+        wire += " HTTP/1.1\r\n";
+
+        if(req.headers.find("Host") == req.headers.end() &&
+                req.headers.find("host") == req.headers.end())
+        {
+            char portText[16] = { 0 };
+            snprintf(portText, sizeof(portText), ":%u", port);
+            wire += "Host: ";
+            wire += host.find(':') != std::string::npos ? "[" + host + "]" : host;
+            wire += port == 80 ? "" : portText;
+            wire += "\r\n";
+        }
+
+        for(auto &pos : req.headers)
+        {
+            wire += pos.first;
+            wire += ": ";
+            wire += pos.second;
+            wire += "\r\n";
+        }
+
+        if(!req.body.empty() || req.method == "POST" || req.method == "PUT")
+        {
+            char length[48] = { 0 };
+            snprintf(length, sizeof(length), "Content-Length: %zu\r\n", req.body.size());
+            wire += length;
+        }
+
+        wire += "\r\n";
+        wire += req.body;
+
+        loop_->runInLoop(std::bind(&HttpClient::requestInLoop, this, host, port, call));
+    }
+
+    void HttpClient::requestInLoop(const std::string& hostName, uint16_t port, const CallPtr& call)
+    {
+        loop_->assertInLoopThread();
+
+        char key[16] = { 0 };
+        snprintf(key, sizeof(key), ":%u", port);
+        std::unique_ptr<Host>& host = hosts_[hostName + key];
+
+        if(!host)
+        {
+            host.reset(new Host);
+            host->name = hostName;
+            host->port = port;
+        }
+
+        if(timeoutSeconds_ > 0)
+        {
+            call->timer = loop_->runAfter(timeoutSeconds_,
+                                          std::bind(&HttpClient::onTimeout, this, std::weak_ptr<Call>(call)));
+        }
+
+        host->waiting.push_back(call);
+        dispatch(host.get());
+    }
+
+    void HttpClient::dispatch(Host* host)
+    {
+        while(!host->waiting.empty())
+        {
+            CallPtr call = host->waiting.front();
+
+            if(call->done)
+            {
+                host->waiting.pop_front();
+                continue;
+            }
+
+            ConnectionPtr conn = pickConnection(host, *call);
+
+            if(!conn)
+            {
+                break;
+            }
+
+            host->waiting.pop_front();
+            send(conn, call);
+        }
+
+        if(host->waiting.empty() ||
+                host->connections.size() >= static_cast<size_t>(maxConnectionsPerHost_))
+        {
+            return;
+        }
+
+        // one new connection per waiting request up to the limit, the
+        // count stops there
+        size_t connecting = 0;
+
+        for(auto &conn : host->connections)
+        {
+            connecting += conn->conn ? 0 : 1;
+        }
+
+        size_t wanted = maxConnectionsPerHost_ - host->connections.size() + connecting;
+        size_t waiting = 0;
+
+        for(auto it = host->waiting.begin(); it != host->waiting.end() && waiting < wanted; ++it)
+        {
+            waiting += (*it)->done ? 0 : 1;
+        }
+
+        for(; connecting < waiting; ++connecting)
+        {
+            openConnection(host);
+        }
+    }
+
+    HttpClient::ConnectionPtr HttpClient::pickConnection(Host* host, const Call& call)
+    {
+        ConnectionPtr best;
+
+        for(auto &conn : host->connections)
+        {
+            if(!conn->conn || !conn->conn->connected())
+            {
+                continue;
+            }
+
+            size_t inflight = conn->inflight.size();
+
+            if(inflight >= static_cast<size_t>(maxPipeline_))
+            {
+                continue;
+            }
+
+            // a request that must not be repeated waits for an idle connection
+            if(inflight > 0 && (!call.idempotent || !conn->inflight.back()->idempotent))
+            {
+                continue;
+            }
+
+            if(!best || inflight < best->inflight.size())
+            {
+                best = conn;
+            }
+        }
+
+        return best;
+    }
+
+    void HttpClient::openConnection(Host* host)
+    {
+        ConnectionPtr conn(new Connection);
+        std::weak_ptr<Connection> weakConn(conn);
+        conn->host = host;
+        conn->connector.reset(new Connector(loop_, host->name, host->port));
+        conn->connector->setNewConnectionCallback(
+            std::bind(&HttpClient::onConnected, this, weakConn, std::placeholders::_1));
+        conn->connector->setConnectFailedCallback(
+            std::bind(&HttpClient::onConnectFailed, this, weakConn));
+        host->connections.push_back(conn);
+        conn->connector->start();
+    }
+
+    void HttpClient::send(const ConnectionPtr& conn, const CallPtr& call)
+    {
+        if(conn->inflight.empty())
+        {
+            conn->parser.reset(call->head);
+        }
+
+        call->connection = conn;
+        conn->inflight.push_back(call);
+        conn->conn->send(call->wire);
+    }
+
+    void HttpClient::finish(const CallPtr& call, const HttpClientResponse& response)
+    {
+        call->done = true;
+        call->connection.reset();
+
+        if(timeoutSeconds_ > 0)
+        {
+            loop_->cancel(call->timer);
+        }
+
+        HttpResponseCallback cb;
+        cb.swap(call->cb);
+        cb(response);
+    }
+
+    void HttpClient::onConnected(const std::weak_ptr<Connection>& weakConn, int sockfd)
+    {
+        loop_->assertInLoopThread();
+        ConnectionPtr conn = weakConn.lock();
+
+        if(!conn)
+        {
+            SocketOps::closeSocket(sockfd);
+            return;
+        }
+
+        InetAddress peerAddr(SocketOps::getPeerAddr(sockfd));
+        InetAddress localAddr(SocketOps::getLocalAddr(sockfd));
+        char buf[128];
+        snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
+        ++nextConnId_;
+
+        TcpConnectionPtr tcp(new TcpConnection(loop_, name_ + buf, sockfd, localAddr, peerAddr));
+        tcp->setConnectionCallback(ignoreConnection);
+        tcp->setMessageCallback(
+            std::bind(&HttpClient::onMessage, this, weakConn, std::placeholders::_2));
+        tcp->setCloseCallback(
+            std::bind(&HttpClient::onClose, this, weakConn, std::placeholders::_1));
+
+        if(idleSeconds_ > 0)
+        {
+            // only a connection without requests is idle, a slow response
+            // is up to the request timeout
+            tcp->setReadIdleTimeout(idleSeconds_);
+            tcp->setDeadlineCallback([weakConn](const TcpConnectionPtr & c, DeadlineKind)
+            {
+                ConnectionPtr conn = weakConn.lock();
+
+                if(!conn || conn->inflight.empty())
+                {
+                    c->forceClose();
+                }
+            });
+        }
+
+        conn->conn = tcp;
+        tcp->connectEstablished();
+        tcp->setTcpNoDelay(true);
+        dispatch(conn->host);
+    }
+
+    void HttpClient::onConnectFailed(const std::weak_ptr<Connection>& weakConn)
+    {
+        ConnectionPtr conn = weakConn.lock();
+
+        if(!conn)
+        {
+            return;
+        }
+
+        Host* host = conn->host;
+        LOG_PRINT(LogType_Warn, "HttpClient[%s] - can not connect to %s",
+                  name_.c_str(), conn->connector->serverName().c_str());
+
+        stopConnector(loop_, conn->connector);
+        removeConnection(conn.get());
+
+        for(auto &pos : host->connections)
+        {
+            if(pos->conn)
+            {
+                return;     // the live connections take the waiting requests
+            }
+        }
+
+        std::deque<CallPtr> waiting;
+        waiting.swap(host->waiting);
+
+        for(auto &call : waiting)
+        {
+            if(!call->done)
+            {
+                finish(call, HttpClientResponse(HttpClientResponse::kConnectFailed));
+            }
+        }
+    }
+
+    void HttpClient::onMessage(const std::weak_ptr<Connection>& weakConn, Buffer* buf)
+    {
+        ConnectionPtr conn = weakConn.lock();
+
+        if(!conn)
+        {
+            buf->retrieveAll();
+            return;
+        }
+
+        while(buf->readableBytes() > 0)
+        {
+            if(conn->inflight.empty())
+            {
+                LOG_PRINT(LogType_Warn, "HttpClient[%s] - %s sent data without a request",
+                          name_.c_str(), conn->conn->name().c_str());
+                buf->retrieveAll();
+                conn->conn->forceClose();
+                return;
+            }
+
+            CallPtr call = conn->inflight.front();
+
+            if(!conn->parser.parse(buf))
+            {
+                LOG_PRINT(LogType_Warn, "HttpClient[%s] - bad response from %s",
+                          name_.c_str(), conn->conn->name().c_str());
+                conn->inflight.pop_front();
+                conn->parser.reset(false);
+                buf->retrieveAll();
+                conn->conn->forceClose();
+
+                if(!call->done)
+                {
+                    finish(call, HttpClientResponse(HttpClientResponse::kBadResponse));
+                }
+
+                return;
+            }
+
+            if(!conn->parser.gotAll())
+            {
+                break;
+            }
+
+            HttpClientResponse response;
+            response.swap(conn->parser.response());
+            bool keepAlive = conn->parser.keepAlive();
+            conn->inflight.pop_front();
+            conn->parser.reset(!conn->inflight.empty() && conn->inflight.front()->head);
+
+            if(!keepAlive)
+            {
+                // what is pipelined behind it goes again on another connection
+                conn->conn->forceClose();
+            }
+
+            // a timed out request still had its response on the way
+            if(!call->done)
+            {
+                finish(call, response);
+            }
+
+            if(!keepAlive)
+            {
+                buf->retrieveAll();
+                return;
+            }
+        }
+
+        dispatch(conn->host);
+    }
+
+    void HttpClient::onClose(const std::weak_ptr<Connection>& weakConn, const TcpConnectionPtr& tcp)
+    {
+        loop_->assertInLoopThread();
+        destroyConnection(loop_, tcp);
+        ConnectionPtr conn = weakConn.lock();
+
+        if(!conn)
+        {
+            return;
+        }
+
+        Host* host = conn->host;
+        removeConnection(conn.get());
+
+        std::deque<CallPtr> inflight;
+        inflight.swap(conn->inflight);
+        bool responded = conn->parser.started();
+
+        if(!inflight.empty() && conn->parser.finishOnClose())
+        {
+            // the body ran to the end of the connection
+            CallPtr call = inflight.front();
+            inflight.pop_front();
+            responded = false;
+
+            if(!call->done)
+            {
+                finish(call, conn->parser.response());
+            }
+        }
+
+        // again in their order, ahead of the waiting ones
+        std::vector<CallPtr> failed;
+
+        for(auto it = inflight.rbegin(); it != inflight.rend(); ++it)
+        {
+            const CallPtr& call = *it;
+            bool partial = responded && call == inflight.front();
+
+            if(call->done)
+            {
+                continue;
+            }
+
+            if(call->idempotent && !call->retried && !partial)
+            {
+                call->retried = true;
+                call->connection.reset();
+                host->waiting.push_front(call);
+            }
+            else
+            {
+                failed.push_back(call);
+            }
+        }
+
+        for(auto it = failed.rbegin(); it != failed.rend(); ++it)
+        {
+            finish(*it, HttpClientResponse(HttpClientResponse::kConnectionClosed));
+        }
+
+        dispatch(host);
+    }
+
+    void HttpClient::onTimeout(const std::weak_ptr<Call>& weakCall)
+    {
+        CallPtr call = weakCall.lock();
+
+        if(!call || call->done)
+        {
+            return;
+        }
+
+        // the rest of its response would be taken for the next one's
+        ConnectionPtr conn = call->connection.lock();
+
+        if(conn && conn->conn)
+        {
+            conn->conn->forceClose();
+        }
+
+        LOG_PRINT(LogType_Info, "HttpClient[%s] - request timed out", name_.c_str());
+        finish(call, HttpClientResponse(HttpClientResponse::kTimeout));
+    }
+
+    void HttpClient::removeConnection(Connection* conn)
+    {
+        std::vector<ConnectionPtr>& connections = conn->host->connections;
+
+        for(size_t i = 0; i < connections.size(); ++i)
+        {
+            if(connections[i].get() == conn)
+            {
+                connections[i].swap(connections.back());
+                connections.pop_back();
+                break;
+            }
+        }
+    }
+}
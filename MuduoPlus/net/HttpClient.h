@@ -0,0 +1,122 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/NonCopyable.h"
+#include "HttpClientResponse.h"
+#include "TimerId.h"
+#include "CallBack.h"
+
+namespace MuduoPlus
+{
+    class Connector;
+    class EventLoop;
+
+    struct HttpClientRequest
+    {
+        HttpClientRequest()
+            : method("GET"),
+              path("/")
+        {
+        }
+
+        std::string method;
+        std::string path;       // with the query, "/search?q=muduo"
+        std::map<std::string, std::string> headers;     // Host is added
+        std::string body;       // Content-Length is added
+    };
+
+    typedef std::function<void(const HttpClientResponse&)> HttpResponseCallback;
+
+    /// Asynchronous HTTP/1.1 client on one loop.
+    ///
+    /// Connections are kept alive and pooled per host:port, a request goes
+    /// to an idle connection, is pipelined behind others up to
+    /// maxPipeline, or waits for a connection while maxConnectionsPerHost
+    /// are busy. Every request gets exactly one callback, on the loop
+    /// thread, with the response or the reason it failed. An idempotent
+    /// request on a connection that closed before any of its response
+    /// arrived, a stale keep-alive one usually, is sent again once.
+    ///
+    /// Plain http only, no redirects and no proxies.
+    class HttpClient : NonCopyable
+    {
+    public:
+        HttpClient(EventLoop* loop, const std::string& name);
+        /// In the loop thread. Pending requests are dropped without their
+        /// callbacks, do not destroy the client from one.
+        ~HttpClient();
+
+        /// Settings go before the first request.
+        void setMaxConnectionsPerHost(int n)
+        {
+            maxConnectionsPerHost_ = n;
+        }
+
+        /// Requests in flight on one connection, 1 turns pipelining off.
+        /// Only idempotent requests are pipelined.
+        void setMaxPipeline(int n)
+        {
+            maxPipeline_ = n;
+        }
+
+        /// From the request to the end of its response, 0 for none.
+        void setTimeout(double seconds)
+        {
+            timeoutSeconds_ = seconds;
+        }
+
+        /// A pooled connection without requests is closed after this long.
+        void setIdleTimeout(double seconds)
+        {
+            idleSeconds_ = seconds;
+        }
+
+        /// Thread safe. host is a name or an address.
+        void request(const std::string& host, uint16_t port,
+                     const HttpClientRequest& request, const HttpResponseCallback& cb);
+
+        void get(const std::string& host, uint16_t port,
+                 const std::string& path, const HttpResponseCallback& cb);
+
+        EventLoop* getLoop() const
+        {
+            return loop_;
+        }
+
+    private:
+        struct Call;
+        struct Connection;
+        struct Host;
+        typedef std::shared_ptr<Call> CallPtr;
+        typedef std::shared_ptr<Connection> ConnectionPtr;
+
+        void requestInLoop(const std::string& host, uint16_t port, const CallPtr& call);
+        void dispatch(Host* host);
+        ConnectionPtr pickConnection(Host* host, const Call& call);
+        void openConnection(Host* host);
+        void send(const ConnectionPtr& conn, const CallPtr& call);
+        void finish(const CallPtr& call, const HttpClientResponse& response);
+
+        void onConnected(const std::weak_ptr<Connection>& weakConn, int sockfd);
+        void onConnectFailed(const std::weak_ptr<Connection>& weakConn);
+        void onMessage(const std::weak_ptr<Connection>& weakConn, Buffer* buf);
+        void onClose(const std::weak_ptr<Connection>& weakConn, const TcpConnectionPtr& conn);
+        void onTimeout(const std::weak_ptr<Call>& weakCall);
+        void removeConnection(Connection* conn);
+
+        EventLoop* loop_;
+        const std::string name_;
+        int maxConnectionsPerHost_;
+        int maxPipeline_;
+        double timeoutSeconds_;
+        double idleSeconds_;
+        int nextConnId_;
+        std::map<std::string, std::unique_ptr<Host>> hosts_;   // by host:port
+    };
+}
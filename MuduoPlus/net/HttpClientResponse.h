@@ -0,0 +1,188 @@
+#pragma once
+
+#include <ctype.h>
+#include <map>
+#include <string>
+
+#include "base/Copyable.h"
+#include "Buffer.h"
+
+namespace MuduoPlus
+{
+    /// Response handed to an HttpClient callback.
+    class HttpClientResponse : public Copyable
+    {
+    public:
+        enum Error
+        {
+            kOk,
+            kConnectFailed,     // no connection to the host
+            kTimeout,           // no complete response within the timeout
+            kConnectionClosed,  // closed before the response was complete
+            kBadResponse,       // not parsable as HTTP/1.x, or over the size limits
+        };
+
+        HttpClientResponse()
+            : error_(kOk),
+              statusCode_(0),
+              minorVersion_(1)
+        {
+        }
+
+        explicit HttpClientResponse(Error error)
+            : error_(error),
+              statusCode_(0),
+              minorVersion_(1)
+        {
+        }
+
+        /// A response arrived, whatever its status code.
+        bool ok() const
+        {
+            return error_ == kOk;
+        }
+
+        Error error() const
+        {
+            return error_;
+        }
+
+        const char* errorString() const
+        {
+            switch(error_)
+            {
+                case kOk:
+                    return "ok";
+
+                case kConnectFailed:
+                    return "connect failed";
+
+                case kTimeout:
+                    return "timeout";
+
+                case kConnectionClosed:
+                    return "connection closed";
+
+                default:
+                    return "bad response";
+            }
+        }
+
+        void setError(Error error)
+        {
+            error_ = error;
+        }
+
+        int statusCode() const
+        {
+            return statusCode_;
+        }
+
+        const std::string& statusMessage() const
+        {
+            return statusMessage_;
+        }
+
+        void setStatus(int code, const std::string& message)
+        {
+            statusCode_ = code;
+            statusMessage_ = message;
+        }
+
+        /// 0 for HTTP/1.0, 1 for HTTP/1.1.
+        int minorVersion() const
+        {
+            return minorVersion_;
+        }
+
+        void setMinorVersion(int minor)
+        {
+            minorVersion_ = minor;
+        }
+
+        /// Field names are case insensitive, they are kept in lower case.
+        /// Repeated fields are joined with commas.
+        void addHeader(const char* start, const char* colon, const char* end)
+        {
+            std::string field(start, colon);
+
+            for(size_t i = 0; i < field.size(); ++i)
+            {
+                field[i] = static_cast<char>(tolower(static_cast<unsigned char>(field[i])));
+            }
+
+            ++colon;
+
+            while(colon < end && isspace(static_cast<unsigned char>(*colon)))
+            {
+                ++colon;
+            }
+
+            while(end > colon && isspace(static_cast<unsigned char>(end[-1])))
+            {
+                --end;
+            }
+
+            std::string& value = headers_[field];
+
+            if(!value.empty())
+            {
+                value += ", ";
+            }
+
+            value.append(colon, end);
+        }
+
+        std::string getHeader(const std::string& field) const
+        {
+            std::string key(field);
+
+            for(size_t i = 0; i < key.size(); ++i)
+            {
+                key[i] = static_cast<char>(tolower(static_cast<unsigned char>(key[i])));
+            }
+
+            std::map<std::string, std::string>::const_iterator it = headers_.find(key);
+            return it == headers_.end() ? std::string() : it->second;
+        }
+
+        const std::map<std::string, std::string>& headers() const
+        {
+            return headers_;
+        }
+
+        /// The body with any chunked transfer coding removed.
+        const Buffer& body() const
+        {
+            return body_;
+        }
+
+        Buffer* body()
+        {
+            return &body_;
+        }
+
+        std::string bodyAsString() const
+        {
+            return std::string(body_.peek(), body_.readableBytes());
+        }
+
+        void swap(HttpClientResponse& that)
+        {
+            std::swap(error_, that.error_);
+            std::swap(statusCode_, that.statusCode_);
+            std::swap(minorVersion_, that.minorVersion_);
+            statusMessage_.swap(that.statusMessage_);
+            headers_.swap(that.headers_);
+            body_.swap(that.body_);
+        }
+
+    private:
+        Error error_;
+        int statusCode_;
+        int minorVersion_;
+        std::string statusMessage_;
+        std::map<std::string, std::string> headers_;
+        Buffer body_;
+    };
+}
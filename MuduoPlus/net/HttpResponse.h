@@ -57,11 +57,27 @@ namespace MuduoPlus
             headers_[key] = value;
         }
 
+        std::string getHeader(const std::string& key) const
+        {
+            std::map<std::string, std::string>::const_iterator it = headers_.find(key);
+            return it == headers_.end() ? std::string() : it->second;
+        }
+
         void setBody(const std::string& body)
         {
             body_ = body;
         }
 
+        void setBody(const char* data, size_t len)
+        {
+            body_.assign(data, len);
+        }
+
+        const std::string& body() const
+        {
+            return body_;
+        }
+
         void appendToBuffer(Buffer* output) const;
 
     private:
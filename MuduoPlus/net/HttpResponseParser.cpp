@@ -0,0 +1,293 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "HttpResponseParser.h"
+#include "Buffer.h"
+
+namespace MuduoPlus
+{
+    const size_t HttpResponseParser::kMaxHeaderBytes;
+    const size_t HttpResponseParser::kMaxBodyBytes;
+
+    namespace
+    {
+        // a comma separated header value holds token, case insensitive
+        bool hasToken(std::string value, const char* token)
+        {
+            for(size_t i = 0; i < value.size(); ++i)
+            {
+                value[i] = static_cast<char>(tolower(static_cast<unsigned char>(value[i])));
+            }
+
+            return value.find(token) != std::string::npos;
+        }
+
+        bool parseSize(const std::string& text, int base, size_t* size)
+        {
+            const char* begin = text.c_str();
+
+            while(*begin == ' ' || *begin == '\t')
+            {
+                ++begin;
+            }
+
+            // strtoull takes a sign and negates, "-1" would be huge
+            if(!isxdigit(static_cast<unsigned char>(*begin)))
+            {
+                return false;
+            }
+
+            char* end = NULL;
+            errno = 0;
+            unsigned long long value = strtoull(begin, &end, base);
+
+            if(end == begin || errno == ERANGE ||
+                    (*end != '\0' && *end != ';' && *end != ' ' && *end != '\t'))
+            {
+                return false;
+            }
+
+            *size = static_cast<size_t>(value);
+            return true;
+        }
+    }
+
+    bool HttpResponseParser::processStatusLine(const char* begin, const char* end)
+    {
+        /*  HTTP/1.1 200 OK\r\n */
+        if(end - begin < 12 || !std::equal(begin, begin + 7, "HTTP/1.") || begin[8] != ' ')
+        {
+            return false;
+        }
+
+        if(begin[7] != '0' && begin[7] != '1')
+        {
+            return false;
+        }
+
+        int code = 0;
+
+        for(const char* p = begin + 9; p < begin + 12; ++p)
+        {
+            if(*p < '0' || *p > '9')
+            {
+                return false;
+            }
+
+            code = code * 10 + (*p - '0');
+        }
+
+        const char* message = begin + 12;
+
+        if(message < end && *message == ' ')
+        {
+            ++message;
+        }
+
+        response_.setMinorVersion(begin[7] - '0');
+        response_.setStatus(code, std::string(message, end));
+        return true;
+    }
+
+    bool HttpResponseParser::processHeadersEnd()
+    {
+        int code = response_.statusCode();
+
+        // interim responses, the final one follows on the same connection
+        if(code >= 100 && code < 200 && code != 101)
+        {
+            state_ = kExpectStatusLine;
+            headerBytes_ = 0;
+            HttpClientResponse dummy;
+            response_.swap(dummy);
+            return true;
+        }
+
+        std::string connection = response_.getHeader("connection");
+
+        if(response_.minorVersion() == 0)
+        {
+            keepAlive_ = hasToken(connection, "keep-alive");
+        }
+        else
+        {
+            keepAlive_ = !hasToken(connection, "close");
+        }
+
+        if(headRequest_ || code == 204 || code == 304 || code == 101)
+        {
+            state_ = kGotAll;
+        }
+        else if(hasToken(response_.getHeader("transfer-encoding"), "chunked"))
+        {
+            state_ = kExpectChunkSize;
+        }
+        else
+        {
+            std::string length = response_.getHeader("content-length");
+
+            if(length.empty())
+            {
+                state_ = kExpectClose;
+                keepAlive_ = false;
+            }
+            else if(!parseSize(length, 10, &remaining_) || remaining_ > kMaxBodyBytes)
+            {
+                return false;
+            }
+            else
+            {
+                state_ = remaining_ > 0 ? kExpectBody : kGotAll;
+            }
+        }
+
+        return true;
+    }
+
+    void HttpResponseParser::readBody(Buffer* buf)
+    {
+        size_t n = std::min(remaining_, buf->readableBytes());
+        response_.body()->append(buf->peek(), n);
+        buf->retrieve(n);
+        remaining_ -= n;
+    }
+
+// return false if any error
+    bool HttpResponseParser::parse(Buffer* buf)
+    {
+        bool ok = true;
+        bool hasMore = true;
+
+        if(buf->readableBytes() > 0)
+        {
+            started_ = true;
+        }
+
+        while(hasMore && ok)
+        {
+            if(state_ == kExpectStatusLine || state_ == kExpectHeaders || state_ == kExpectTrailers)
+            {
+                const char* crlf = buf->findCRLF();
+
+                if(!crlf)
+                {
+                    ok = headerBytes_ + buf->readableBytes() <= kMaxHeaderBytes;
+                    hasMore = false;
+                    continue;
+                }
+
+                headerBytes_ += crlf + 2 - buf->peek();
+                ok = headerBytes_ <= kMaxHeaderBytes;
+
+                if(!ok)
+                {
+                    continue;
+                }
+
+                if(state_ == kExpectStatusLine)
+                {
+                    ok = processStatusLine(buf->peek(), crlf);
+                    state_ = kExpectHeaders;
+                }
+                else if(crlf == buf->peek())
+                {
+                    // empty line, end of the headers or the trailers
+                    if(state_ == kExpectTrailers)
+                    {
+                        state_ = kGotAll;
+                    }
+                    else
+                    {
+                        ok = processHeadersEnd();
+                    }
+                }
+                else if(state_ == kExpectHeaders)
+                {
+                    const char* colon = std::find(buf->peek(), crlf, ':');
+                    ok = colon != crlf;
+
+                    if(ok)
+                    {
+                        response_.addHeader(buf->peek(), colon, crlf);
+                    }
+                }
+
+                // trailer fields are dropped
+                buf->retrieveUntil(crlf + 2);
+            }
+            else if(state_ == kExpectBody || state_ == kExpectChunkData)
+            {
+                readBody(buf);
+
+                if(remaining_ == 0)
+                {
+                    state_ = state_ == kExpectBody ? kGotAll : kExpectChunkEnd;
+                }
+                else
+                {
+                    hasMore = false;
+                }
+            }
+            else if(state_ == kExpectChunkSize)
+            {
+                const char* crlf = buf->findCRLF();
+
+                if(!crlf)
+                {
+                    // a size line is a few bytes plus extensions
+                    ok = buf->readableBytes() <= 1024;
+                    hasMore = false;
+                    continue;
+                }
+
+                ok = parseSize(std::string(buf->peek(), crlf), 16, &remaining_) &&
+                     remaining_ <= kMaxBodyBytes - response_.body()->readableBytes();
+                buf->retrieveUntil(crlf + 2);
+                state_ = remaining_ > 0 ? kExpectChunkData : kExpectTrailers;
+            }
+            else if(state_ == kExpectChunkEnd)
+            {
+                if(buf->readableBytes() < 2)
+                {
+                    hasMore = false;
+                    continue;
+                }
+
+                ok = buf->peek()[0] == '\r' && buf->peek()[1] == '\n';
+                buf->retrieve(2);
+                state_ = kExpectChunkSize;
+            }
+            else if(state_ == kExpectClose)
+            {
+                ok = buf->readableBytes() <= kMaxBodyBytes - response_.body()->readableBytes();
+
+                if(!ok)
+                {
+                    continue;
+                }
+
+                response_.body()->append(buf->peek(), buf->readableBytes());
+                buf->retrieveAll();
+                hasMore = false;
+            }
+            else
+            {
+                hasMore = false;
+            }
+        }
+
+        return ok;
+    }
+
+    bool HttpResponseParser::finishOnClose()
+    {
+        if(state_ == kExpectClose)
+        {
+            state_ = kGotAll;
+        }
+
+        return state_ == kGotAll;
+    }
+}
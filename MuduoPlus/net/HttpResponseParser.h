@@ -0,0 +1,97 @@
+#pragma once
+
+#include "HttpClientResponse.h"
+
+namespace MuduoPlus
+{
+    class Buffer;
+
+    /// Incremental HTTP/1.x response parser, the client side twin of
+    /// HttpContext. The body is framed by Content-Length, chunked transfer
+    /// coding or the end of the connection.
+    class HttpResponseParser
+    {
+    public:
+        enum HttpResponseParseState
+        {
+            kExpectStatusLine,
+            kExpectHeaders,
+            kExpectBody,
+            kExpectChunkSize,
+            kExpectChunkData,
+            kExpectChunkEnd,
+            kExpectTrailers,
+            kExpectClose,       // body runs until the server closes
+            kGotAll,
+        };
+
+        static const size_t kMaxHeaderBytes = 64 * 1024;
+        /// Larger bodies fail the parse, whatever frames them.
+        static const size_t kMaxBodyBytes = 64 * 1024 * 1024;
+
+        HttpResponseParser()
+            : state_(kExpectStatusLine),
+              headRequest_(false),
+              keepAlive_(true),
+              started_(false),
+              remaining_(0),
+              headerBytes_(0)
+        {
+        }
+
+        /// For the next response, a response to HEAD has no body whatever
+        /// its headers say.
+        void reset(bool headRequest)
+        {
+            state_ = kExpectStatusLine;
+            headRequest_ = headRequest;
+            keepAlive_ = true;
+            started_ = false;
+            remaining_ = 0;
+            headerBytes_ = 0;
+            HttpClientResponse dummy;
+            response_.swap(dummy);
+        }
+
+        // return false if any error
+        bool parse(Buffer* buf);
+
+        /// The connection ended, true if that completed the response.
+        bool finishOnClose();
+
+        bool gotAll() const
+        {
+            return state_ == kGotAll;
+        }
+
+        /// Some of the response arrived already.
+        bool started() const
+        {
+            return started_;
+        }
+
+        /// The connection can carry another request after this response.
+        bool keepAlive() const
+        {
+            return keepAlive_;
+        }
+
+        HttpClientResponse& response()
+        {
+            return response_;
+        }
+
+    private:
+        bool processStatusLine(const char* begin, const char* end);
+        bool processHeadersEnd();
+        void readBody(Buffer* buf);
+
+        HttpResponseParseState state_;
+        bool headRequest_;
+        bool keepAlive_;
+        bool started_;
+        size_t remaining_;      // of the body or the current chunk
+        size_t headerBytes_;
+        HttpClientResponse response_;
+    };
+}
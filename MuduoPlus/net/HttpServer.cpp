@@ -1,10 +1,16 @@
 #include "base/Logger.h"
 
+#include "EventLoop.h"
 #include "TcpConnection.h"
 #include "HttpServer.h"
 #include "HttpContext.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "LoopMetrics.h"
+
+#ifdef MUDUO_HAVE_ZLIB
+#include "Compressor.h"
+#endif
 
 namespace MuduoPlus
 {
@@ -16,12 +22,88 @@ namespace MuduoPlus
         resp->setCloseConnection(true);
     }
 
+    namespace
+    {
+        std::string lowerCase(std::string value)
+        {
+            for(size_t i = 0; i < value.size(); ++i)
+            {
+                value[i] = static_cast<char>(tolower(static_cast<unsigned char>(value[i])));
+            }
+
+            return value;
+        }
+
+        // header names are case insensitive, HttpRequest keeps them as sent
+        std::string findHeader(const HttpRequest& req, const char* field)
+        {
+            for(auto &pos : req.headers())
+            {
+                if(lowerCase(pos.first) == field)
+                {
+                    return pos.second;
+                }
+            }
+
+            return std::string();
+        }
+
+        // the coding Accept-Encoding prefers of ours, gzip over deflate,
+        // false if it allows neither
+        bool acceptedCoding(const std::string& acceptEncoding, bool* gzip)
+        {
+            bool acceptGzip = false;
+            bool acceptDeflate = false;
+            bool acceptAny = false;
+            size_t start = 0;
+
+            while(start < acceptEncoding.size())
+            {
+                size_t end = acceptEncoding.find(',', start);
+                end = end == std::string::npos ? acceptEncoding.size() : end;
+                std::string item = lowerCase(acceptEncoding.substr(start, end - start));
+                start = end + 1;
+
+                size_t semicolon = item.find(';');
+                std::string coding = item.substr(0, semicolon);
+                coding.erase(0, coding.find_first_not_of(" \t"));
+                coding.erase(coding.find_last_not_of(" \t") + 1);
+
+                // "gzip;q=0" refuses it
+                size_t q = semicolon == std::string::npos ? semicolon : item.find("q=", semicolon);
+
+                if(q != std::string::npos && atof(item.c_str() + q + 2) <= 0)
+                {
+                    continue;
+                }
+
+                acceptGzip = acceptGzip || coding == "gzip" || coding == "x-gzip";
+                acceptDeflate = acceptDeflate || coding == "deflate";
+                acceptAny = acceptAny || coding == "*";
+            }
+
+            *gzip = acceptGzip || acceptAny;
+            return acceptGzip || acceptDeflate || acceptAny;
+        }
+
+        // media that is compressed already gains nothing
+        bool compressibleType(const std::string& contentType)
+        {
+            std::string type = lowerCase(contentType);
+            return type.empty() || type.compare(0, 5, "text/") == 0 ||
+                   type.find("json") != std::string::npos || type.find("xml") != std::string::npos ||
+                   type.find("javascript") != std::string::npos;
+        }
+    }
+
     HttpServer::HttpServer(EventLoop* loop,
                            const InetAddress& listenAddr,
                            const std::string& name,
                            TcpServer::Option option)
         : server_(loop, listenAddr, name, option),
-          httpCallback_(defaultHttpCallback)
+          httpCallback_(defaultHttpCallback),
+          compressMinBytes_(0),
+          compressLevel_(6)
     {
         server_.setConnectionCallback(
             std::bind(&HttpServer::onConnection, this,
@@ -50,22 +132,52 @@ namespace MuduoPlus
         {
             conn->setContext(HttpContext());
         }
+        else if(conn->getContext().Is<WebSocketConnectionPtr>())
+        {
+            WebSocketConnectionPtr ws = conn->getContext().AnyCast<WebSocketConnectionPtr>();
+            ws->handleClose();
+        }
     }
 
     void HttpServer::onMessage(const TcpConnectionPtr& conn,
                                Buffer* buf,
                                Timestamp receiveTime)
     {
-        HttpContext &context = conn->getContext().AnyCast<HttpContext>();
-
-        if(!context.parseRequest(buf, receiveTime))
+        if(conn->getContext().Is<WebSocketConnectionPtr>())
         {
-            conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
-            conn->gracefulClose();
+            WebSocketConnectionPtr ws = conn->getContext().AnyCast<WebSocketConnectionPtr>();
+            ws->handleData(buf);
+            return;
+        }
+        else if(conn->getContext().IsNull())
+        {
+            buf->retrieveAll();     // a WebSocket connection on its way out
+            return;
         }
 
-        if(context.gotAll())
+        HttpContext &context = conn->getContext().AnyCast<HttpContext>();
+
+        // pipelined requests arrive in the same read
+        while(conn->connected())
         {
+            if(!context.parseRequest(buf, receiveTime))
+            {
+                conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
+                conn->gracefulClose();
+                break;
+            }
+
+            if(!context.gotAll())
+            {
+                break;
+            }
+
+            // the context is gone once the connection upgraded
+            if(upgradeWebSocket(conn, context.request(), buf))
+            {
+                break;
+            }
+
             onRequest(conn, context.request());
             context.reset();
         }
@@ -77,7 +189,24 @@ namespace MuduoPlus
         bool close = connection == "close" ||
                      (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive");
         HttpResponse response(close);
-        httpCallback_(req, &response);
+
+        if(!metricsPath_.empty() && req.path() == metricsPath_)
+        {
+            response.setStatusCode(HttpResponse::k200Ok);
+            response.setStatusMessage("OK");
+            response.setContentType("text/plain; version=0.0.4");
+            response.setBody(MetricsRegistry::instance().scrape());
+        }
+        else
+        {
+            httpCallback_(req, &response);
+        }
+
+        if(compressMinBytes_ > 0)
+        {
+            compressBody(conn, req, &response);
+        }
+
         Buffer buf;
         response.appendToBuffer(&buf);
         conn->send(buf.peek(), buf.readableBytes());
@@ -87,4 +216,90 @@ namespace MuduoPlus
             conn->gracefulClose();
         }
     }
+
+    bool HttpServer::upgradeWebSocket(const TcpConnectionPtr& conn, const HttpRequest& req, Buffer* buf)
+    {
+        if(webSocketPath_.empty() || req.path() != webSocketPath_ ||
+                lowerCase(findHeader(req, "upgrade")).find("websocket") == std::string::npos)
+        {
+            return false;
+        }
+
+        std::string key = findHeader(req, "sec-websocket-key");
+
+        if(key.empty() || findHeader(req, "sec-websocket-version") != "13" ||
+                lowerCase(findHeader(req, "connection")).find("upgrade") == std::string::npos)
+        {
+            conn->send("HTTP/1.1 400 Bad Request\r\nSec-WebSocket-Version: 13\r\n\r\n");
+            conn->gracefulClose();
+            return true;
+        }
+
+        conn->send("HTTP/1.1 101 Switching Protocols\r\n"
+                   "Upgrade: websocket\r\n"
+                   "Connection: Upgrade\r\n"
+                   "Sec-WebSocket-Accept: " + WebSocketConnection::acceptKey(key) + "\r\n\r\n");
+
+        HttpRequest request(req);
+        WebSocketConnectionPtr ws = std::make_shared<WebSocketConnection>(
+                                        conn, webSocketOptions_, webSocketMessageCallback_, webSocketCloseCallback_);
+        conn->setContext(ws);
+        ws->start();
+
+        if(webSocketOpenCallback_)
+        {
+            webSocketOpenCallback_(ws, request);
+        }
+
+        // frames sent right behind the handshake
+        if(buf->readableBytes() > 0)
+        {
+            ws->handleData(buf);
+        }
+
+        return true;
+    }
+
+    void HttpServer::compressBody(const TcpConnectionPtr& conn, const HttpRequest& req,
+                                  HttpResponse* response)
+    {
+#ifdef MUDUO_HAVE_ZLIB
+        const std::string& body = response->body();
+
+        if(body.size() < compressMinBytes_ || !response->getHeader("Content-Encoding").empty() ||
+                !compressibleType(response->getHeader("Content-Type")))
+        {
+            return;
+        }
+
+        // caches keep the variants apart
+        response->addHeader("Vary", "Accept-Encoding");
+        bool gzip = false;
+
+        if(!acceptedCoding(findHeader(req, "accept-encoding"), &gzip))
+        {
+            return;
+        }
+
+        CompressorPool& pool = conn->getLoop()->compressorPool();
+        std::unique_ptr<Compressor> compressor = pool.acquire(gzip ? kCompressGzip : kCompressDeflate,
+                compressLevel_);
+        Buffer* out = pool.scratch();
+        bool ok = compressor->compress(body.data(), body.size(), out, true);
+        pool.release(std::move(compressor));
+
+        if(ok && out->readableBytes() < body.size())
+        {
+            LoopMetrics& metrics = conn->getLoop()->metrics();
+            metrics.compressInBytes.add(body.size());
+            metrics.compressOutBytes.add(out->readableBytes());
+            response->setBody(out->peek(), out->readableBytes());
+            response->addHeader("Content-Encoding", gzip ? "gzip" : "deflate");
+        }
+#else
+        (void)conn;
+        (void)req;
+        (void)response;
+#endif
+    }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "TcpServer.h"
+#include "WebSocket.h"
 #include "base/NonCopyable.h"
 
 namespace MuduoPlus
@@ -37,6 +38,48 @@ namespace MuduoPlus
             httpCallback_ = cb;
         }
 
+        /// Serve MetricsRegistry::scrape() at path, empty disables it.
+        /// Not thread safe, call before start().
+        void setMetricsPath(const std::string& path)
+        {
+            metricsPath_ = path;
+        }
+
+        /// Upgrades WebSocket requests for path, the connection then belongs
+        /// to the callbacks. Not thread safe, call before start().
+        void setWebSocketHandler(const std::string& path,
+                                 const WebSocketOpenCallback& openCallback,
+                                 const WebSocketMessageCallback& messageCallback,
+                                 const WebSocketCloseCallback& closeCallback = WebSocketCloseCallback(),
+                                 const WebSocketOptions& options = WebSocketOptions())
+        {
+            webSocketPath_ = path;
+            webSocketOpenCallback_ = openCallback;
+            webSocketMessageCallback_ = messageCallback;
+            webSocketCloseCallback_ = closeCallback;
+            webSocketOptions_ = options;
+        }
+
+#ifdef MUDUO_HAVE_ZLIB
+        /// Compresses response bodies of at least minBytes with gzip or
+        /// deflate as the request's Accept-Encoding allows, 0 turns it off.
+        /// The streams come from each loop's CompressorPool. Not thread
+        /// safe, call before start().
+        void setCompression(size_t minBytes, int level = 6)
+        {
+            compressMinBytes_ = minBytes;
+            compressLevel_ = level;
+        }
+#endif
+
+#ifdef MUDUO_HAVE_OPENSSL
+        /// Serves HTTPS, see TcpServer::setTlsContext.
+        void setTlsContext(const TlsContextPtr& context)
+        {
+            server_.setTlsContext(context);
+        }
+#endif
+
         void setThreadNum(int numThreads)
         {
             server_.setThreadNum(numThreads);
@@ -50,8 +93,18 @@ namespace MuduoPlus
                        Buffer* buf,
                        Timestamp receiveTime);
         void onRequest(const TcpConnectionPtr&, const HttpRequest&);
+        bool upgradeWebSocket(const TcpConnectionPtr& conn, const HttpRequest& req, Buffer* buf);
+        void compressBody(const TcpConnectionPtr& conn, const HttpRequest& req, HttpResponse* response);
 
         TcpServer server_;
         HttpCallback httpCallback_;
+        std::string metricsPath_;
+        std::string webSocketPath_;
+        WebSocketOpenCallback webSocketOpenCallback_;
+        WebSocketMessageCallback webSocketMessageCallback_;
+        WebSocketCloseCallback webSocketCloseCallback_;
+        WebSocketOptions webSocketOptions_;
+        size_t compressMinBytes_;
+        int compressLevel_;
     };
 }
\ No newline at end of file
@@ -2,87 +2,270 @@
 
 #include <string>
 #include <stdint.h>
+#include <stddef.h>
 #include <memory.h>
 
 #include "base/LinuxWin.h"
 
+#ifndef WIN32
+#include <sys/un.h>
+#endif
+
 namespace MuduoPlus
 {
 
+    /// Socket address of an AF_INET or AF_INET6 endpoint or, outside
+    /// Windows, of an AF_UNIX path. Storage is sockaddr_storage sized, so
+    /// anything accept(2) or recvmsg(2) fill in fits.
     class InetAddress
     {
     public:
         InetAddress()
         {
             memset(&addr_, 0, sizeof(addr_));
+            addrLen_ = sizeof(sockaddr_in);
         }
 
+        /// Numeric address, dotted IPv4 or an IPv6 literal with or without
+        /// brackets. Host names go through Resolver.
         InetAddress(std::string ip, uint16_t port)
         {
             memset(&addr_, 0, sizeof(addr_));
 
-            addr_.sin_family = AF_INET;
-            addr_.sin_addr.s_addr = inet_addr(ip.c_str());
-            addr_.sin_port = htons(port);
+            if(ip.size() > 2 && ip[0] == '[' && ip[ip.size() - 1] == ']')
+            {
+                ip = ip.substr(1, ip.size() - 2);
+            }
+
+            if(ip.find(':') != std::string::npos)
+            {
+                addr_.in6.sin6_family = AF_INET6;
+                inet_pton(AF_INET6, ip.c_str(), &addr_.in6.sin6_addr);
+                addr_.in6.sin6_port = htons(port);
+                addrLen_ = sizeof(sockaddr_in6);
+            }
+            else
+            {
+                addr_.in4.sin_family = AF_INET;
+                addr_.in4.sin_addr.s_addr = inet_addr(ip.c_str());
+                addr_.in4.sin_port = htons(port);
+                addrLen_ = sizeof(sockaddr_in);
+            }
+        }
+
+        /// Wildcard (or loopback) address to listen on. With ipv6 this is
+        /// [::], which also takes IPv4 peers on a dual-stack Acceptor.
+        explicit InetAddress(uint16_t port, bool loopbackOnly = false, bool ipv6 = false)
+        {
+            memset(&addr_, 0, sizeof(addr_));
+
+            if(ipv6)
+            {
+                addr_.in6.sin6_family = AF_INET6;
+                addr_.in6.sin6_addr = loopbackOnly ? in6addr_loopback : in6addr_any;
+                addr_.in6.sin6_port = htons(port);
+                addrLen_ = sizeof(sockaddr_in6);
+            }
+            else
+            {
+                addr_.in4.sin_family = AF_INET;
+                addr_.in4.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+                addr_.in4.sin_port = htons(port);
+                addrLen_ = sizeof(sockaddr_in);
+            }
         }
 
         InetAddress(const struct sockaddr_in& addr)
-            : addr_(addr)
         {
+            memset(&addr_, 0, sizeof(addr_));
+            addr_.in4 = addr;
+            addrLen_ = sizeof(sockaddr_in);
+        }
 
+        InetAddress(const struct sockaddr_in6& addr)
+        {
+            memset(&addr_, 0, sizeof(addr_));
+            addr_.in6 = addr;
+            addrLen_ = sizeof(sockaddr_in6);
         }
 
         InetAddress(const struct sockaddr& addr)
         {
-            addr_ = *(sockaddr_in*)&addr;
+            memset(&addr_, 0, sizeof(addr_));
+            setSockAddr(addr);
         }
 
+        /// Any family, as filled in by accept(2), getsockname(2) or
+        /// getaddrinfo(3).
+        InetAddress(const struct sockaddr* addr, socklen_t len)
+        {
+            memset(&addr_, 0, sizeof(addr_));
+            addrLen_ = std::min(len, static_cast<socklen_t>(sizeof(addr_)));
+            memcpy(&addr_, addr, addrLen_);
+        }
+
+#ifndef WIN32
+        /// AF_UNIX address. A leading '@' names a Linux abstract socket,
+        /// which has no file in the file system.
+        static InetAddress fromUnixPath(const std::string& path)
+        {
+            InetAddress addr;
+            size_t len = std::min(path.size(), sizeof(addr.addr_.un.sun_path) - 1);
+
+            addr.addr_.un.sun_family = AF_UNIX;
+            memcpy(addr.addr_.un.sun_path, path.data(), len);
+
+            if(len > 0 && path[0] == '@')
+            {
+                addr.addr_.un.sun_path[0] = '\0';
+                addr.addrLen_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len);
+            }
+            else
+            {
+                addr.addrLen_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len + 1);
+            }
+
+            return addr;
+        }
+#endif
+
     public:
         struct sockaddr_in& getSockAddrIn()
         {
-            return addr_;
+            return addr_.in4;
         }
         void                setSockAddrIn(const struct sockaddr_in& addr)
         {
-            addr_ = addr;
+            addr_.in4 = addr;
+            addrLen_ = sizeof(sockaddr_in);
         }
 
         struct sockaddr&    getSockAddr()
         {
-            return *(sockaddr *)&addr_;
+            return addr_.sa;
         }
+        const struct sockaddr& getSockAddr() const
+        {
+            return addr_.sa;
+        }
+        /// AF_INET or AF_INET6, the length follows from the family.
         void                setSockAddr(const struct sockaddr& addr)
         {
-            addr_ = *(sockaddr_in*)&addr;
+            if(addr.sa_family == AF_INET6)
+            {
+                addr_.in6 = *(const sockaddr_in6*)&addr;
+                addrLen_ = sizeof(sockaddr_in6);
+            }
+            else
+            {
+                addr_.in4 = *(const sockaddr_in*)&addr;
+                addrLen_ = sizeof(sockaddr_in);
+            }
+        }
+        socklen_t           getSockAddrLen() const
+        {
+            return addrLen_;
+        }
+
+        int                 family() const
+        {
+            return addr_.sa.sa_family;
+        }
+        bool                isIpv6() const
+        {
+            return family() == AF_INET6;
+        }
+        bool                isUnix() const
+        {
+#ifndef WIN32
+            return family() == AF_UNIX;
+#else
+            return false;
+#endif
+        }
+
+        /// Path of an AF_UNIX address, '@' first for an abstract one, empty
+        /// for an unnamed socket.
+        std::string         unixPath() const
+        {
+#ifndef WIN32
+            size_t offset = offsetof(sockaddr_un, sun_path);
+
+            if(!isUnix() || addrLen_ <= offset)
+            {
+                return std::string();
+            }
+
+            if(addr_.un.sun_path[0] == '\0')
+            {
+                return "@" + std::string(addr_.un.sun_path + 1, addrLen_ - offset - 1);
+            }
+
+            return std::string(addr_.un.sun_path);
+#else
+            return std::string();
+#endif
         }
 
+        /// IPv4 only, network byte order.
         uint32_t            addrIp() const
         {
-            return addr_.sin_addr.s_addr;
+            return addr_.in4.sin_addr.s_addr;
         }
+        /// Network byte order, sin_port and sin6_port share the offset.
         uint16_t            addrPort() const
         {
-            return addr_.sin_port;
+            return isIpv6() ? addr_.in6.sin6_port : addr_.in4.sin_port;
         }
 
         std::string	        ip() const
         {
-            std::string s(inet_ntoa(addr_.sin_addr));
-            return s;
+            if(isUnix())
+            {
+                return unixPath();
+            }
+
+            char buff[INET6_ADDRSTRLEN] = { 0 };
+
+            if(isIpv6())
+            {
+                inet_ntop(AF_INET6, (void*)&addr_.in6.sin6_addr, buff, sizeof(buff));
+            }
+            else
+            {
+                inet_ntop(AF_INET, (void*)&addr_.in4.sin_addr, buff, sizeof(buff));
+            }
+
+            return buff;
         }
         uint16_t            port() const
         {
-            return  ntohs(addr_.sin_port);
+            return isUnix() ? 0 : ntohs(addrPort());
         }
 
         std::string         toIpPort() const
         {
+            if(isUnix())
+            {
+                return "unix:" + unixPath();
+            }
+
             char buff[100] = { 0 };
-            snprintf(buff, 100, "%s:%u", ip().c_str(), port());
+            snprintf(buff, 100, isIpv6() ? "[%s]:%u" : "%s:%u", ip().c_str(), port());
             return buff;
         }
 
     private:
-        struct sockaddr_in addr_;
+        union
+        {
+            struct sockaddr     sa;
+            struct sockaddr_in  in4;
+            struct sockaddr_in6 in6;
+            struct sockaddr_storage storage;
+#ifndef WIN32
+            struct sockaddr_un  un;
+#endif
+        }           addr_;
+        socklen_t   addrLen_;
     };
 }
@@ -0,0 +1,855 @@
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "IoUringPoller.h"
+#include "base/Logger.h"
+#include "EventLoop.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        // completions nobody waits for: poll removals and cancels
+        const uint64_t kIgnoreData = UINT64_MAX;
+        const uint32_t kGenerationMask = 0xffffff;
+
+        int64_t nowMs()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    const unsigned IoUringPoller::kRingEntries;
+    const unsigned IoUringPoller::kBufferCount;
+    const unsigned IoUringPoller::kBufferSize;
+    const unsigned IoUringPoller::kMaxFixedFiles;
+    const int      IoUringPoller::kMaxSendIovecs;
+
+    IoUringPoller::IoUringPoller(EventLoop* loop)
+        : Poller(loop),
+          ringFd_(-1),
+          pendingSqes_(0),
+          sqLocalTail_(0),
+          nextGeneration_(1),
+          pollRound_(0),
+          completionIo_(false),
+          multishot_(true),
+          bufferRing_(MAP_FAILED),
+          buffers_(static_cast<char*>(MAP_FAILED)),
+          bufferTail_(0),
+          sqRingPtr_(MAP_FAILED),
+          sqRingSize_(0),
+          cqRingPtr_(MAP_FAILED),
+          cqRingSize_(0),
+          sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+          sqesSize_(0)
+    {
+        if(!setupRing())
+        {
+            LOG_PRINT(LogType_Error, "io_uring setup failed:%s", GetLastErrorText().c_str());
+        }
+        else if(!(completionIo_ = setupCompletion()))
+        {
+            LOG_PRINT(LogType_Info, "io_uring completion I/O unavailable, polling readiness only:%s",
+                      GetLastErrorText().c_str());
+        }
+    }
+
+    IoUringPoller::~IoUringPoller()
+    {
+        // the ring goes first, it may still write to the buffers
+        if(ringFd_ >= 0)
+        {
+            SocketOps::closeSocket(ringFd_);
+        }
+
+        if(buffers_ != MAP_FAILED)
+        {
+            munmap(buffers_, kBufferCount * kBufferSize);
+        }
+
+        if(bufferRing_ != MAP_FAILED)
+        {
+            munmap(bufferRing_, kBufferCount * sizeof(io_uring_buf));
+        }
+
+        if(sqes_ != MAP_FAILED)
+        {
+            munmap(sqes_, sqesSize_);
+        }
+
+        if(cqRingPtr_ != MAP_FAILED && cqRingPtr_ != sqRingPtr_)
+        {
+            munmap(cqRingPtr_, cqRingSize_);
+        }
+
+        if(sqRingPtr_ != MAP_FAILED)
+        {
+            munmap(sqRingPtr_, sqRingSize_);
+        }
+    }
+
+    bool IoUringPoller::setupRing()
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = -1;
+
+#ifdef IORING_SETUP_DEFER_TASKRUN
+        // only the loop thread submits and completions are only needed
+        // when it waits, so the kernel runs them then instead of
+        // interrupting it, needs 6.1
+        params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, kRingEntries, &params));
+#endif
+
+        if(fd < 0)
+        {
+            memset(&params, 0, sizeof(params));
+            fd = static_cast<int>(syscall(__NR_io_uring_setup, kRingEntries, &params));
+        }
+
+        if(fd < 0)
+        {
+            return false;
+        }
+
+        // the poll timeout is passed to io_uring_enter, needs 5.11
+        if(!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+        {
+            SocketOps::closeSocket(fd);
+            errno = ENOSYS;
+            return false;
+        }
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        if(params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        }
+
+        sqRingPtr_ = mmap(NULL, sqRingSize_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+        if(sqRingPtr_ == MAP_FAILED)
+        {
+            SocketOps::closeSocket(fd);
+            return false;
+        }
+
+        if(params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            cqRingPtr_ = sqRingPtr_;
+        }
+        else
+        {
+            cqRingPtr_ = mmap(NULL, cqRingSize_, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        }
+
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE,
+                                                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+
+        if(cqRingPtr_ == MAP_FAILED || sqes_ == MAP_FAILED)
+        {
+            SocketOps::closeSocket(fd);
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sqRingPtr_);
+        char* cq = static_cast<char*>(cqRingPtr_);
+
+        sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sqEntries_ = params.sq_entries;
+        cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        sqLocalTail_ = *sqTail_;
+
+        ringFd_ = fd;
+        return true;
+    }
+
+    bool IoUringPoller::setupCompletion()
+    {
+#ifdef IORING_RECV_MULTISHOT
+        // a sparse fixed file table indexed by fd, up to the fd limit
+        struct rlimit limit;
+
+        if(getrlimit(RLIMIT_NOFILE, &limit) < 0)
+        {
+            return false;
+        }
+
+        unsigned slots = static_cast<unsigned>(std::min<rlim_t>(limit.rlim_cur, kMaxFixedFiles));
+        io_uring_rsrc_register files;
+        memset(&files, 0, sizeof(files));
+        files.nr = slots;
+        files.flags = IORING_RSRC_REGISTER_SPARSE;
+
+        if(syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_FILES2, &files, sizeof(files)) < 0)
+        {
+            return false;
+        }
+
+        fileSlots_.assign(slots, -1);
+
+        // receive buffers the kernel picks from, one group for all channels
+        bufferRing_ = mmap(NULL, kBufferCount * sizeof(io_uring_buf), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        buffers_ = static_cast<char*>(mmap(NULL, kBufferCount * kBufferSize, PROT_READ | PROT_WRITE,
+                                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+
+        if(bufferRing_ == MAP_FAILED || buffers_ == MAP_FAILED)
+        {
+            return false;
+        }
+
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<uint64_t>(bufferRing_);
+        reg.ring_entries = kBufferCount;
+        reg.bgid = 0;
+
+        if(syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            return false;
+        }
+
+        for(unsigned i = 0; i < kBufferCount; ++i)
+        {
+            usedBuffers_.push_back(static_cast<uint16_t>(i));
+        }
+
+        recycleBuffers();
+        return true;
+#else
+        errno = ENOSYS;
+        return false;
+#endif
+    }
+
+    void IoUringPoller::provideBuffer(uint16_t bufferId)
+    {
+        // io_uring_buf_ring's flexible array is offset in C++, index the
+        // entries directly, the tail is the reserved field of the first
+        io_uring_buf* buf = static_cast<io_uring_buf*>(bufferRing_) +
+                            (bufferTail_ & (kBufferCount - 1));
+        buf->addr = reinterpret_cast<uint64_t>(buffers_ + static_cast<size_t>(bufferId) * kBufferSize);
+        buf->len = kBufferSize;
+        buf->bid = bufferId;
+        ++bufferTail_;
+    }
+
+    void IoUringPoller::recycleBuffers()
+    {
+        if(usedBuffers_.empty())
+        {
+            return;
+        }
+
+        for(auto bufferId : usedBuffers_)
+        {
+            provideBuffer(bufferId);
+        }
+
+        usedBuffers_.clear();
+        __atomic_store_n(&static_cast<io_uring_buf*>(bufferRing_)->resv, bufferTail_, __ATOMIC_RELEASE);
+    }
+
+    io_uring_sqe* IoUringPoller::getSqe()
+    {
+        if(sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+        {
+            // ring full, hand the batch to the kernel without waiting
+            submit(0, NULL);
+        }
+
+        unsigned index = sqLocalTail_ & sqMask_;
+        io_uring_sqe* sqe = &sqes_[index];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqArray_[index] = index;
+        ++sqLocalTail_;
+        ++pendingSqes_;
+
+        return sqe;
+    }
+
+    int IoUringPoller::submit(unsigned minComplete, __kernel_timespec* timeout)
+    {
+        __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+
+        unsigned flags = 0;
+        io_uring_getevents_arg arg;
+
+        if(minComplete > 0)
+        {
+            memset(&arg, 0, sizeof(arg));
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<uint64_t>(timeout);
+            flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        }
+
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, ringFd_, pendingSqes_,
+                                           minComplete, flags,
+                                           minComplete > 0 ? &arg : NULL,
+                                           minComplete > 0 ? sizeof(arg) : 0));
+
+        if(ret > 0)
+        {
+            pendingSqes_ -= ret;
+        }
+
+        return ret;
+    }
+
+    void IoUringPoller::armPoll(int fd, PollState& state, uint32_t events)
+    {
+        state.generation = nextGeneration_++;
+        state.events = events;
+        state.armed = true;
+
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = events;
+        sqe->user_data = userData(kOpPoll, fd, state.generation);
+    }
+
+    void IoUringPoller::cancelPoll(int fd, const PollState& state)
+    {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = userData(kOpPoll, fd, state.generation);
+        sqe->user_data = kIgnoreData;
+    }
+
+    void IoUringPoller::cancelRequest(uint64_t userData)
+    {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = userData;
+        sqe->user_data = kIgnoreData;
+    }
+
+    void IoUringPoller::updateFile(int fd)
+    {
+        // runs in order with the requests queued after it in the batch
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_FILES_UPDATE;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(&fileSlots_[fd]);
+        sqe->len = 1;
+        sqe->off = static_cast<uint64_t>(fd);
+        sqe->user_data = userData(kOpFilesUpdate, fd, 0);
+    }
+
+    void IoUringPoller::armCompletion(int fd, PollState& state, Channel* pChannel)
+    {
+#ifdef IORING_RECV_MULTISHOT
+        bool wanted = pChannel->isReading() && !state.ended;
+
+        if(!wanted)
+        {
+            // what it received meanwhile still comes
+            if(state.recvLive && !state.recvCancelled)
+            {
+                cancelRequest(userData(state.recvOp, fd, state.recvGeneration));
+                state.recvCancelled = true;
+            }
+
+            return;
+        }
+
+        // a cancelled recv has to end first, a second one could reorder
+        if(state.recvLive)
+        {
+            return;
+        }
+
+        state.recvGeneration = nextGeneration_++;
+        state.recvLive = true;
+        state.recvCancelled = false;
+
+        io_uring_sqe* sqe = getSqe();
+        sqe->fd = fd;
+        sqe->flags = state.fixedFile ? IOSQE_FIXED_FILE : 0;
+
+        if(pChannel->completionMode() == Channel::kCompletionAccept)
+        {
+            state.recvOp = kOpAccept;
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        }
+        else
+        {
+            state.recvOp = kOpRecv;
+            sqe->opcode = IORING_OP_RECV;
+            sqe->ioprio = multishot_ ? IORING_RECV_MULTISHOT : 0;
+            sqe->flags |= IOSQE_BUFFER_SELECT;
+            sqe->buf_group = 0;
+        }
+
+        sqe->user_data = userData(state.recvOp, fd, state.recvGeneration);
+#endif
+    }
+
+    bool IoUringPoller::submitSend(Channel* pChannel, const struct iovec* vec, int count)
+    {
+        Poller::assertInLoopThread();
+        auto it = pollStates_.find(pChannel->fd());
+
+        if(it == pollStates_.end() || !it->second.completion || it->second.sendLive || count <= 0)
+        {
+            return false;
+        }
+
+        int fd = pChannel->fd();
+        PollState& state = it->second;
+
+        if(!state.send)
+        {
+            state.send.reset(new SendState);
+        }
+
+        // the caller sends the rest after a short result
+        SendState& send = *state.send;
+        count = std::min(count, kMaxSendIovecs);
+        memcpy(send.vec, vec, count * sizeof(struct iovec));
+        memset(&send.msg, 0, sizeof(send.msg));
+        send.msg.msg_iov = send.vec;
+        send.msg.msg_iovlen = count;
+
+        state.sendGeneration = nextGeneration_++;
+        state.sendLive = true;
+
+        io_uring_sqe* sqe = getSqe();
+        sqe->fd = fd;
+        sqe->flags = state.fixedFile ? IOSQE_FIXED_FILE : 0;
+        sqe->msg_flags = MSG_NOSIGNAL;
+
+        // a plain send skips importing the iovec
+        if(count == 1)
+        {
+            sqe->opcode = IORING_OP_SEND;
+            sqe->addr = reinterpret_cast<uint64_t>(vec[0].iov_base);
+            sqe->len = static_cast<uint32_t>(vec[0].iov_len);
+        }
+        else
+        {
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->addr = reinterpret_cast<uint64_t>(&send.msg);
+            sqe->len = 1;
+        }
+
+        sqe->user_data = userData(kOpSend, fd, state.sendGeneration);
+        return true;
+    }
+
+    void IoUringPoller::queueRearm(int fd, PollState& state)
+    {
+        if(!state.queued)
+        {
+            state.queued = true;
+            rearmList_.push_back(fd);
+        }
+    }
+
+    void IoUringPoller::poll(int timeoutMs, ChannelHolderList &activeChannelHolders)
+    {
+        LOG_DEBUG("fd total count %u", channelHolders_.size());
+        ++pollRound_;
+
+        // the callbacks of the last iteration are done with the received data
+        if(completionIo_)
+        {
+            recycleBuffers();
+        }
+
+        // several changes of one channel in an iteration end up as one request
+        for(auto fd : rearmList_)
+        {
+            auto it = pollStates_.find(fd);
+            auto holder = channelHolders_.find(fd);
+
+            if(it == pollStates_.end() || !it->second.queued || holder == channelHolders_.end())
+            {
+                continue;
+            }
+
+            it->second.queued = false;
+
+            if(it->second.completion)
+            {
+                armCompletion(fd, it->second, holder->second.channel_);
+                continue;
+            }
+
+            uint32_t events = holder->second.channel_->getEpEvents();
+
+            if(!it->second.armed && events != 0)
+            {
+                armPoll(fd, it->second, events);
+            }
+        }
+
+        rearmList_.clear();
+
+        int64_t deadline = timeoutMs >= 0 ? nowMs() + timeoutMs : -1;
+
+        for(;;)
+        {
+            __kernel_timespec* timeout = NULL;
+
+            if(deadline >= 0)
+            {
+                int64_t remaining = std::max<int64_t>(deadline - nowMs(), 0);
+                timeout_.tv_sec = remaining / 1000;
+                timeout_.tv_nsec = (remaining % 1000) * 1000000;
+                timeout = &timeout_;
+            }
+
+            int ret = submit(1, timeout);
+            int errorCode = GetLastErrorCode();
+            size_t before = activeChannelHolders.size();
+
+            reapCompletions(activeChannelHolders);
+
+            if(ret < 0)
+            {
+                if(errorCode != ETIME && errorCode != EINTR && errorCode != EBUSY)
+                {
+                    LOG_PRINT(LogType_Error, "io_uring_enter failed:%s", GetErrorText(errorCode).c_str());
+                }
+
+                break;
+            }
+
+            // only completions of removed requests, keep waiting
+            if(activeChannelHolders.size() > before || (deadline >= 0 && nowMs() >= deadline))
+            {
+                break;
+            }
+        }
+
+        if(activeChannelHolders.empty())
+        {
+            LOG_DEBUG("io_uring nothing happended");
+        }
+    }
+
+    void IoUringPoller::reapCompletions(ChannelHolderList &activeChannelHolders)
+    {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+
+        for(; head != tail; ++head)
+        {
+            const io_uring_cqe* cqe = &cqes_[head & cqMask_];
+
+            // returned at the next poll whoever received into it
+            if(cqe->flags & IORING_CQE_F_BUFFER)
+            {
+                usedBuffers_.push_back(static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+
+            if(cqe->user_data == kIgnoreData)
+            {
+                continue;
+            }
+
+            Op op = static_cast<Op>(cqe->user_data >> 56);
+            int fd = static_cast<int>(static_cast<uint32_t>(cqe->user_data));
+            uint32_t generation = static_cast<uint32_t>(cqe->user_data >> 32) & kGenerationMask;
+            auto it = pollStates_.find(fd);
+            PollState* state = it != pollStates_.end() ? &it->second : NULL;
+
+            switch(op)
+            {
+            case kOpPoll:
+                reapPoll(fd, state, generation, cqe->res, activeChannelHolders);
+                break;
+
+            case kOpRecv:
+            case kOpAccept:
+                reapRecv(fd, state, generation, cqe, activeChannelHolders);
+                break;
+
+            case kOpSend:
+                reapSend(fd, state, generation, cqe, activeChannelHolders);
+                break;
+
+            default:
+                if(cqe->res < 0)
+                {
+                    LOG_PRINT(LogType_Error, "io_uring fixed file update fd[%d] failed:%s", fd,
+                              GetErrorText(-cqe->res).c_str());
+                }
+
+                break;
+            }
+        }
+
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    }
+
+    void IoUringPoller::reapPoll(int fd, PollState* state, uint32_t generation, int result,
+                                 ChannelHolderList &activeChannelHolders)
+    {
+        // completion of a poll that was removed or replaced since
+        if(state == NULL || (state->generation & kGenerationMask) != generation || !state->armed)
+        {
+            return;
+        }
+
+        state->armed = false;
+        queueRearm(fd, *state);
+
+        int pollEvents = result < 0 ? POLLERR : result;
+        int recvEvents = Channel::kNoneEvent;
+
+        if(pollEvents & (POLLIN | POLLPRI | POLLRDHUP))
+        {
+            recvEvents |= Channel::kReadEvent;
+        }
+
+        if(pollEvents & POLLOUT)
+        {
+            recvEvents |= Channel::kWriteEvent;
+        }
+
+        if(pollEvents & (POLLERR | POLLHUP))
+        {
+            recvEvents |= Channel::kErrorEvent;
+        }
+
+        if(recvEvents)
+        {
+            activate(fd, *state, recvEvents, activeChannelHolders);
+        }
+    }
+
+    void IoUringPoller::reapRecv(int fd, PollState* state, uint32_t generation,
+                                 const io_uring_cqe* cqe, ChannelHolderList &activeChannelHolders)
+    {
+        // of a removed channel, its buffer is recycled anyway
+        if(state == NULL || (state->recvGeneration & kGenerationMask) != generation || !state->recvLive)
+        {
+            return;
+        }
+
+        // without more to come poll arms the next one if still reading
+        if(!(cqe->flags & IORING_CQE_F_MORE))
+        {
+            state->recvLive = false;
+            queueRearm(fd, *state);
+        }
+
+        int result = cqe->res;
+
+        // cancelled, or out of buffers until the next poll recycles them
+        if(result == -ECANCELED || result == -ENOBUFS)
+        {
+            return;
+        }
+
+        if(result == -EINVAL && multishot_ && state->recvOp == kOpRecv)
+        {
+            LOG_PRINT(LogType_Info, "io_uring multishot recv unsupported, receiving one by one");
+            multishot_ = false;
+            return;
+        }
+
+        const char* data = NULL;
+
+        if(state->recvOp == kOpRecv)
+        {
+            if(result == 0)
+            {
+                state->ended = true;
+            }
+            else if(result > 0)
+            {
+                data = buffers_ + static_cast<size_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT) * kBufferSize;
+            }
+        }
+
+        if(Channel* channel = activate(fd, *state, Channel::kReadEvent, activeChannelHolders))
+        {
+            channel->addReadCompletion(data, result);
+        }
+    }
+
+    void IoUringPoller::reapSend(int fd, PollState* state, uint32_t generation,
+                                 const io_uring_cqe* cqe, ChannelHolderList &activeChannelHolders)
+    {
+        if(state == NULL || (state->sendGeneration & kGenerationMask) != generation || !state->sendLive)
+        {
+            // the kernel is done with the data of a removed channel
+            orphanSends_.erase(cqe->user_data);
+            return;
+        }
+
+        state->sendLive = false;
+
+        if(Channel* channel = activate(fd, *state, Channel::kWriteEvent, activeChannelHolders))
+        {
+            channel->setWriteResult(cqe->res);
+        }
+    }
+
+    Channel* IoUringPoller::activate(int fd, PollState& state, int events,
+                                     ChannelHolderList &activeChannelHolders)
+    {
+        auto holder = channelHolders_.find(fd);
+
+        if(holder == channelHolders_.end())
+        {
+            return NULL;
+        }
+
+        Channel* channel = holder->second.channel_;
+
+        // a channel with several completions is reported once
+        if(state.activeRound != pollRound_)
+        {
+            state.activeRound = pollRound_;
+            channel->clearCompletions();
+            channel->setTrigeredEvents(events);
+            activeChannelHolders.push_back(holder->second);
+        }
+        else
+        {
+            channel->setTrigeredEvents(channel->trigeredEvents() | events);
+        }
+
+        return channel;
+    }
+
+    void IoUringPoller::updateChannel(Channel* pChannel)
+    {
+        Poller::assertInLoopThread();
+        int fd = pChannel->fd();
+
+        if(!hasChannel(pChannel))
+        {
+            // loop internal channels such as the wakeup channel have no owner
+            ChannelHolder holder;
+            holder.channel_ = pChannel;
+            holder.ower_ = pChannel->getOwner().lock();
+            channelHolders_[fd] = holder;
+
+            PollState& state = pollStates_[fd];
+            state = PollState();
+
+            if(completionIo_ && pChannel->completionMode() != Channel::kNoCompletion)
+            {
+                state.completion = true;
+
+                if(static_cast<size_t>(fd) < fileSlots_.size())
+                {
+                    fileSlots_[fd] = fd;
+                    state.fixedFile = true;
+                    updateFile(fd);
+                }
+            }
+        }
+
+        PollState& state = pollStates_[fd];
+
+        // recvs follow the read interest, sends are submitted
+        if(state.completion)
+        {
+            if(pChannel->isReading() != (state.recvLive && !state.recvCancelled))
+            {
+                queueRearm(fd, state);
+            }
+
+            return;
+        }
+
+        uint32_t events = pChannel->getEpEvents();
+
+        if(state.armed)
+        {
+            if(state.events == events)
+            {
+                return;
+            }
+
+            cancelPoll(fd, state);
+            state.armed = false;
+        }
+
+        if(events != 0)
+        {
+            queueRearm(fd, state);
+        }
+    }
+
+    void IoUringPoller::removeChannel(Channel* pChannel)
+    {
+        Poller::assertInLoopThread();
+        int fd = pChannel->fd();
+
+        auto holder = channelHolders_.find(fd);
+        assert(holder != channelHolders_.end());
+        std::shared_ptr<void> owner = holder->second.ower_;
+        channelHolders_.erase(holder);
+
+        auto it = pollStates_.find(fd);
+
+        if(it != pollStates_.end())
+        {
+            PollState& state = it->second;
+
+            if(state.armed)
+            {
+                cancelPoll(fd, state);
+            }
+
+            if(state.recvLive && !state.recvCancelled)
+            {
+                cancelRequest(userData(state.recvOp, fd, state.recvGeneration));
+            }
+
+            // the kernel may still read the data, its owner stays until
+            // the send completes
+            if(state.sendLive)
+            {
+                uint64_t data = userData(kOpSend, fd, state.sendGeneration);
+                cancelRequest(data);
+                state.send->owner = owner;
+                orphanSends_[data] = std::move(state.send);
+            }
+
+            if(state.fixedFile)
+            {
+                fileSlots_[fd] = -1;
+                updateFile(fd);
+            }
+
+            pollStates_.erase(it);
+        }
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include <memory>
+
+#include "Poller.h"
+#include "Channel.h"
+
+namespace MuduoPlus
+{
+    /// Poller on io_uring, without liburing.
+    ///
+    /// Channels in completion mode have their I/O done by the ring: a
+    /// multishot recv into a ring of provided buffers while reading, a
+    /// multishot accept on a listen socket and sendmsg for what
+    /// submitSend hands over, all on fixed files. Other channels, the
+    /// wakeup and timer fds, are watched with one-shot IORING_OP_POLL_ADD
+    /// requests, re-armed after each event so the semantics stay level
+    /// triggered like Epoller. Requests, re-arms and the poll timeout are
+    /// queued as SQEs and go to the kernel together with the wait, so an
+    /// iteration costs one io_uring_enter. Kernels before 5.19 only get
+    /// the polls.
+    class IoUringPoller : public Poller
+    {
+    public:
+        IoUringPoller(EventLoop* loop);
+        virtual ~IoUringPoller();
+
+        virtual const char* name() const
+        {
+            return "uring";
+        }
+
+        /// False if the kernel refused io_uring_setup, e.g. under seccomp.
+        bool valid() const
+        {
+            return ringFd_ >= 0;
+        }
+
+        virtual bool completionIo() const
+        {
+            return completionIo_;
+        }
+
+        virtual void poll(int timeoutMs, ChannelHolderList &activeChannelHolders);
+        virtual void updateChannel(Channel* pChannel);
+        virtual void removeChannel(Channel* pChannel);
+        virtual bool submitSend(Channel* pChannel, const struct iovec* vec, int count);
+
+    private:
+        static const unsigned kRingEntries = 1024;
+        static const unsigned kBufferCount = 256;       // a power of 2
+        static const unsigned kBufferSize = 16 * 1024;
+        static const unsigned kMaxFixedFiles = 65536;
+        static const int      kMaxSendIovecs = 64;
+
+        // what a request does, in the top byte of its user_data
+        enum Op
+        {
+            kOpPoll,
+            kOpRecv,
+            kOpAccept,
+            kOpSend,
+            kOpFilesUpdate
+        };
+
+        // read by the kernel until the send completes, then only reused
+        struct SendState
+        {
+            struct msghdr           msg;
+            struct iovec            vec[kMaxSendIovecs];
+            std::shared_ptr<void>   owner;      // keeps the data of a removed channel alive
+        };
+        typedef std::unique_ptr<SendState> SendStatePtr;
+
+        struct PollState
+        {
+            uint32_t    generation;     // tells completions of older polls apart
+            uint32_t    events;         // poll mask the armed request waits for
+            bool        armed;
+            bool        queued;         // sitting in rearmList_
+            // completion mode
+            bool        completion;
+            bool        fixedFile;      // registered at the index of its fd
+            bool        recvLive;       // a recv or accept is in the kernel
+            bool        recvCancelled;
+            bool        ended;          // end of stream, no recv again
+            bool        sendLive;
+            Op          recvOp;
+            uint32_t    recvGeneration;
+            uint32_t    sendGeneration;
+            uint32_t    activeRound;    // last poll that reported the channel
+            SendStatePtr send;
+        };
+
+        bool setupRing();
+        bool setupCompletion();
+        io_uring_sqe* getSqe();
+        int  submit(unsigned minComplete, __kernel_timespec* timeout);
+        void armPoll(int fd, PollState& state, uint32_t events);
+        void cancelPoll(int fd, const PollState& state);
+        void cancelRequest(uint64_t userData);
+        void queueRearm(int fd, PollState& state);
+        void armCompletion(int fd, PollState& state, Channel* pChannel);
+        void updateFile(int fd);
+        void provideBuffer(uint16_t bufferId);
+        void recycleBuffers();
+        void reapCompletions(ChannelHolderList &activeChannelHolders);
+        void reapPoll(int fd, PollState* state, uint32_t generation, int result,
+                      ChannelHolderList &activeChannelHolders);
+        void reapRecv(int fd, PollState* state, uint32_t generation, const io_uring_cqe* cqe,
+                      ChannelHolderList &activeChannelHolders);
+        void reapSend(int fd, PollState* state, uint32_t generation, const io_uring_cqe* cqe,
+                      ChannelHolderList &activeChannelHolders);
+        Channel* activate(int fd, PollState& state, int events,
+                          ChannelHolderList &activeChannelHolders);
+
+        // op, 24 bits of generation and the fd
+        static uint64_t userData(Op op, int fd, uint32_t generation)
+        {
+            return (static_cast<uint64_t>(op) << 56) |
+                   (static_cast<uint64_t>(generation & 0xffffff) << 32) | static_cast<uint32_t>(fd);
+        }
+
+        typedef std::map<int, PollState> PollStateMap;
+        typedef std::map<uint64_t, SendStatePtr> SendStateMap;
+
+        int                 ringFd_;
+        unsigned            pendingSqes_;      // queued but not yet seen by the kernel
+        unsigned            sqLocalTail_;      // published to sqTail_ on submit
+        uint32_t            nextGeneration_;
+        uint32_t            pollRound_;
+        PollStateMap        pollStates_;
+        std::vector<int>    rearmList_;
+
+        // completion mode
+        bool                completionIo_;
+        bool                multishot_;         // off once the kernel refused a multishot recv
+        void*               bufferRing_;
+        char*               buffers_;
+        uint16_t            bufferTail_;
+        std::vector<uint16_t> usedBuffers_;     // go back to the ring at the next poll
+        std::vector<int>    fileSlots_;         // fixed file table, read by FILES_UPDATE requests
+        SendStateMap        orphanSends_;       // of removed channels, by user_data
+
+        // mapped rings
+        void*               sqRingPtr_;
+        size_t              sqRingSize_;
+        void*               cqRingPtr_;
+        size_t              cqRingSize_;
+        io_uring_sqe*       sqes_;
+        size_t              sqesSize_;
+
+        unsigned*           sqHead_;
+        unsigned*           sqTail_;
+        unsigned            sqMask_;
+        unsigned*           sqArray_;
+        unsigned            sqEntries_;
+        unsigned*           cqHead_;
+        unsigned*           cqTail_;
+        unsigned            cqMask_;
+        io_uring_cqe*       cqes_;
+
+        __kernel_timespec   timeout_;
+    };
+}
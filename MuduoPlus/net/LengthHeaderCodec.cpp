@@ -0,0 +1,154 @@
+#include <algorithm>
+
+#include "base/Logger.h"
+
+#include "LengthHeaderCodec.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "LoopMetrics.h"
+#include "TcpConnection.h"
+
+#ifdef MUDUO_HAVE_ZLIB
+#include "Compressor.h"
+#endif
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        const uint32_t kCompressedFlag = 0x80000000u;
+
+#ifdef MUDUO_HAVE_ZLIB
+        // a loop's pool is not shared with other threads, so those keep
+        // their own
+        CompressorPool& compressorPool(EventLoop* loop)
+        {
+            if(loop->isInLoopThread())
+            {
+                return loop->compressorPool();
+            }
+
+            thread_local CompressorPool t_pool;
+            return t_pool;
+        }
+#endif
+    }
+
+    LengthHeaderCodec::LengthHeaderCodec(const StringMessageCallback& callback,
+                                         size_t maxMessageBytes)
+        : messageCallback_(callback),
+          maxMessageBytes_(std::min<size_t>(maxMessageBytes, kCompressedFlag - 1)),
+          compressMinBytes_(0),
+          compressLevel_(6)
+    {
+    }
+
+    void LengthHeaderCodec::onMessage(const TcpConnectionPtr& conn, Buffer* buf,
+                                      Timestamp receiveTime)
+    {
+        while(buf->readableBytes() >= kHeaderLen && conn->connected())
+        {
+            uint32_t header = static_cast<uint32_t>(buf->peekInt32());
+            size_t len = header & ~kCompressedFlag;
+
+            if(len > maxMessageBytes_)
+            {
+                LOG_PRINT(LogType_Error, "LengthHeaderCodec - invalid length %u from %s",
+                          header, conn->name().c_str());
+                conn->forceClose();
+                break;
+            }
+
+            if(buf->readableBytes() < kHeaderLen + len)
+            {
+                break;
+            }
+
+            const char* data = buf->peek() + kHeaderLen;
+
+            if(header & kCompressedFlag)
+            {
+                Buffer message;
+
+                if(!inflate(conn, data, len, &message))
+                {
+                    conn->forceClose();
+                    break;
+                }
+
+                buf->retrieve(kHeaderLen + len);
+                messageCallback_(conn, StringPiece(message.peek(),
+                                                   static_cast<int>(message.readableBytes())),
+                                 receiveTime);
+            }
+            else
+            {
+                messageCallback_(conn, StringPiece(data, static_cast<int>(len)), receiveTime);
+                buf->retrieve(kHeaderLen + len);
+            }
+        }
+    }
+
+    bool LengthHeaderCodec::inflate(const TcpConnectionPtr& conn, const char* data, size_t len,
+                                    Buffer* out)
+    {
+#ifdef MUDUO_HAVE_ZLIB
+        CompressorPool& pool = conn->getLoop()->compressorPool();
+        std::unique_ptr<Decompressor> decompressor = pool.acquireDecompressor();
+        bool ok = decompressor->decompress(data, len, out, maxMessageBytes_);
+        pool.release(std::move(decompressor));
+
+        if(ok)
+        {
+            return true;
+        }
+
+        LOG_PRINT(LogType_Error, "LengthHeaderCodec - corrupt compressed message from %s",
+                  conn->name().c_str());
+#else
+        (void)data;
+        (void)len;
+        (void)out;
+        LOG_PRINT(LogType_Error, "LengthHeaderCodec - compressed message from %s, built without zlib",
+                  conn->name().c_str());
+#endif
+        return false;
+    }
+
+    void LengthHeaderCodec::send(const TcpConnectionPtr& conn, const StringPiece& message)
+    {
+        size_t len = static_cast<size_t>(message.size());
+
+#ifdef MUDUO_HAVE_ZLIB
+        if(compressMinBytes_ > 0 && len >= compressMinBytes_)
+        {
+            EventLoop* loop = conn->getLoop();
+            CompressorPool& pool = compressorPool(loop);
+            std::unique_ptr<Compressor> compressor = pool.acquire(kCompressDeflate, compressLevel_);
+            Buffer* out = pool.scratch();
+            bool ok = compressor->compress(message.data(), len, out, true);
+            pool.release(std::move(compressor));
+
+            if(ok && out->readableBytes() < len)
+            {
+                // the loop's counters have a single writer
+                if(loop->isInLoopThread())
+                {
+                    LoopMetrics& metrics = loop->metrics();
+                    metrics.compressInBytes.add(len);
+                    metrics.compressOutBytes.add(out->readableBytes());
+                }
+
+                out->prependInt32(static_cast<int32_t>(out->readableBytes() | kCompressedFlag));
+                conn->send(out->peek(), static_cast<int>(out->readableBytes()));
+                return;
+            }
+        }
+#endif
+
+        Buffer frame;
+        frame.append(message.data(), len);
+        frame.prependInt32(static_cast<int32_t>(len));
+        conn->send(frame.peek(), static_cast<int>(frame.readableBytes()));
+    }
+}
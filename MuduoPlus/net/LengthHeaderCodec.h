@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "base/NonCopyable.h"
+#include "base/StringPiece.h"
+#include "base/Timestamp.h"
+#include "CallBack.h"
+
+namespace MuduoPlus
+{
+    class Buffer;
+
+    /// Frames messages with a 4 byte big endian length. With compression on,
+    /// messages of at least minBytes go out as zlib streams with the top bit
+    /// of the length set, peers decode both forms either way.
+    ///
+    ///     LengthHeaderCodec codec(onStringMessage);
+    ///     server.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage,
+    ///                                         &codec, _1, _2, _3));
+    ///     codec.send(conn, "hello");
+    class LengthHeaderCodec : NonCopyable
+    {
+    public:
+        /// The message is only valid during the call.
+        typedef std::function<void(const TcpConnectionPtr&, const StringPiece& message,
+                                   Timestamp)> StringMessageCallback;
+
+        static const size_t kHeaderLen = sizeof(int32_t);
+
+        explicit LengthHeaderCodec(const StringMessageCallback& callback,
+                                   size_t maxMessageBytes = 64 * 1024 * 1024);
+
+#ifdef MUDUO_HAVE_ZLIB
+        /// Compresses messages of at least minBytes, 0 turns it off. Not
+        /// thread safe, call before traffic starts.
+        void setCompression(size_t minBytes, int level = 6)
+        {
+            compressMinBytes_ = minBytes;
+            compressLevel_ = level;
+        }
+#endif
+
+        /// A message callback, decodes every complete frame in buf. A frame
+        /// over maxMessageBytes or one that does not inflate closes the
+        /// connection.
+        void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+
+        /// Thread safe, a sender outside the connection's loop compresses
+        /// with streams of its own thread.
+        void send(const TcpConnectionPtr& conn, const StringPiece& message);
+
+    private:
+        bool inflate(const TcpConnectionPtr& conn, const char* data, size_t len, Buffer* out);
+
+        StringMessageCallback   messageCallback_;
+        size_t                  maxMessageBytes_;
+        size_t                  compressMinBytes_;
+        int                     compressLevel_;
+    };
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <chrono>
+
+#include "LoopMetrics.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        typedef std::vector<LoopMetrics*> LoopList;
+
+        void appendHeader(std::string& out, const char* name, const char* help, const char* type)
+        {
+            out += "# HELP ";
+            out += name;
+            out += " ";
+            out += help;
+            out += "\n# TYPE ";
+            out += name;
+            out += " ";
+            out += type;
+            out += "\n";
+        }
+
+        void appendCounter(std::string& out, const char* name, const char* help,
+                           const LoopList& loops, Counter LoopMetrics::*member)
+        {
+            char buf[128];
+            appendHeader(out, name, help, "counter");
+
+            for(auto &pos : loops)
+            {
+                snprintf(buf, sizeof buf, "%s{loop=\"%d\"} %llu\n", name, pos->threadId,
+                         (unsigned long long)(pos->*member).value());
+                out += buf;
+            }
+        }
+
+        void appendGauge(std::string& out, const char* name, const char* help,
+                         const LoopList& loops, Gauge LoopMetrics::*member)
+        {
+            char buf[128];
+            appendHeader(out, name, help, "gauge");
+
+            for(auto &pos : loops)
+            {
+                snprintf(buf, sizeof buf, "%s{loop=\"%d\"} %lld\n", name, pos->threadId,
+                         (long long)(pos->*member).value());
+                out += buf;
+            }
+        }
+
+        // buckets are exported at powers of two [2^minExp, 2^maxExp],
+        // scale converts recorded integers to the exported unit
+        void appendHistogram(std::string& out, const char* name, const char* help,
+                             const LoopList& loops, Histogram LoopMetrics::*member,
+                             double scale, int minExp, int maxExp)
+        {
+            char buf[160];
+            appendHeader(out, name, help, "histogram");
+
+            for(auto &pos : loops)
+            {
+                const Histogram& histogram = pos->*member;
+                uint64_t cumulative = 0;
+                int index = 0;
+
+                for(int exp = minExp; exp <= maxExp; ++exp)
+                {
+                    uint64_t bound = (static_cast<uint64_t>(1) << exp) - 1;
+                    int last = Histogram::bucketIndex(bound);
+
+                    for(; index <= last; ++index)
+                    {
+                        cumulative += histogram.bucketCount(index);
+                    }
+
+                    if(scale == 1.0)
+                    {
+                        snprintf(buf, sizeof buf, "%s_bucket{loop=\"%d\",le=\"%llu\"} %llu\n",
+                                 name, pos->threadId, (unsigned long long)bound,
+                                 (unsigned long long)cumulative);
+                    }
+                    else
+                    {
+                        snprintf(buf, sizeof buf, "%s_bucket{loop=\"%d\",le=\"%g\"} %llu\n",
+                                 name, pos->threadId, (bound + 1) * scale,
+                                 (unsigned long long)cumulative);
+                    }
+
+                    out += buf;
+                }
+
+                snprintf(buf, sizeof buf, "%s_bucket{loop=\"%d\",le=\"+Inf\"} %llu\n",
+                         name, pos->threadId, (unsigned long long)histogram.count());
+                out += buf;
+                snprintf(buf, sizeof buf, "%s_sum{loop=\"%d\"} %g\n",
+                         name, pos->threadId, histogram.sum() * scale);
+                out += buf;
+                snprintf(buf, sizeof buf, "%s_count{loop=\"%d\"} %llu\n",
+                         name, pos->threadId, (unsigned long long)histogram.count());
+                out += buf;
+            }
+        }
+    }
+
+    LoopMetrics::LoopMetrics(int threadIdArg)
+        : threadId(threadIdArg)
+    {
+        MetricsRegistry::instance().add(this);
+    }
+
+    LoopMetrics::~LoopMetrics()
+    {
+        MetricsRegistry::instance().remove(this);
+    }
+
+    int64_t LoopMetrics::nowNanos()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    MetricsRegistry& MetricsRegistry::instance()
+    {
+        static MetricsRegistry s_registry;
+        return s_registry;
+    }
+
+    void MetricsRegistry::add(LoopMetrics* metrics)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loops_.push_back(metrics);
+    }
+
+    void MetricsRegistry::remove(LoopMetrics* metrics)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for(auto it = loops_.begin(); it != loops_.end(); ++it)
+        {
+            if(*it == metrics)
+            {
+                loops_.erase(it);
+                break;
+            }
+        }
+    }
+
+    std::string MetricsRegistry::scrape()
+    {
+        // holding the mutex keeps a loop from destructing while it is read
+        std::lock_guard<std::mutex> lock(mutex_);
+        const LoopList& loops = loops_;
+        std::string out;
+        out.reserve(16 * 1024);
+
+        appendCounter(out, "muduo_loop_iterations_total",
+                      "Event loop iterations.", loops, &LoopMetrics::iterations);
+        appendCounter(out, "muduo_loop_poll_events_total",
+                      "Active channels returned by the poller.", loops, &LoopMetrics::pollEventsTotal);
+        appendCounter(out, "muduo_loop_functors_total",
+                      "Pending functors executed.", loops, &LoopMetrics::functorsTotal);
+        appendCounter(out, "muduo_loop_timers_fired_total",
+                      "Timer callbacks run.", loops, &LoopMetrics::timersFired);
+        appendCounter(out, "muduo_loop_read_bytes_total",
+                      "Bytes read from connections.", loops, &LoopMetrics::bytesRead);
+        appendCounter(out, "muduo_loop_written_bytes_total",
+                      "Bytes written to connections.", loops, &LoopMetrics::bytesWritten);
+        appendCounter(out, "muduo_loop_spin_polls_total",
+                      "Busy poll iterations without events.", loops, &LoopMetrics::spinPolls);
+        appendCounter(out, "muduo_loop_spin_hits_total",
+                      "Busy poll iterations with events.", loops, &LoopMetrics::spinHits);
+        appendCounter(out, "muduo_loop_spin_nanoseconds_total",
+                      "Time spent polling in busy poll iterations without events.", loops,
+                      &LoopMetrics::spinNanos);
+        appendCounter(out, "muduo_loop_throttles_total",
+                      "Connection reads and writes paused by a rate limiter.", loops,
+                      &LoopMetrics::throttles);
+        appendCounter(out, "muduo_loop_compress_input_bytes_total",
+                      "Response bodies and message payloads compressed.", loops,
+                      &LoopMetrics::compressInBytes);
+        appendCounter(out, "muduo_loop_compress_output_bytes_total",
+                      "Compressed bytes sent in their place.", loops,
+                      &LoopMetrics::compressOutBytes);
+
+        appendGauge(out, "muduo_loop_functor_queue_depth",
+                    "Functors taken by the last pending functor run.", loops,
+                    &LoopMetrics::functorQueueDepth);
+        appendGauge(out, "muduo_loop_functors_deferred",
+                    "Functors the functor budget left for the next iteration.", loops,
+                    &LoopMetrics::functorsDeferred);
+        appendGauge(out, "muduo_loop_channels",
+                    "Channels registered in the poller.", loops, &LoopMetrics::channels);
+        appendGauge(out, "muduo_loop_timers",
+                    "Active timers.", loops, &LoopMetrics::timers);
+        appendGauge(out, "muduo_loop_connections",
+                    "Established TCP connections.", loops, &LoopMetrics::connections);
+        appendGauge(out, "muduo_loop_input_buffer_bytes",
+                    "Unconsumed bytes in connection input buffers.", loops,
+                    &LoopMetrics::inputBufferBytes);
+        appendGauge(out, "muduo_loop_output_buffer_bytes",
+                    "Unsent bytes in connection output buffers.", loops,
+                    &LoopMetrics::outputBufferBytes);
+
+        appendHistogram(out, "muduo_loop_poll_events",
+                        "Active channels per poll.", loops, &LoopMetrics::pollEvents, 1.0, 0, 12);
+        appendHistogram(out, "muduo_loop_iteration_seconds",
+                        "Loop iteration time excluding the poll wait.", loops,
+                        &LoopMetrics::iterationNanos, 1e-9, 10, 34);
+        appendHistogram(out, "muduo_loop_callback_seconds",
+                        "Channel event callback time.", loops,
+                        &LoopMetrics::callbackNanos, 1e-9, 10, 34);
+
+        return out;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/Metrics.h"
+#include "base/NonCopyable.h"
+
+namespace MuduoPlus
+{
+    /// Counters of one EventLoop.
+    ///
+    /// Only the loop thread writes them, so the I/O path never takes a lock
+    /// or a locked instruction; MetricsRegistry reads all loops on scrape.
+    struct LoopMetrics : NonCopyable
+    {
+        explicit LoopMetrics(int threadId);
+        ~LoopMetrics();
+
+        static int64_t nowNanos();
+
+        const int   threadId;
+
+        Counter     iterations;
+        Counter     pollEventsTotal;
+        Counter     functorsTotal;
+        Counter     timersFired;
+        Counter     bytesRead;
+        Counter     bytesWritten;
+        Counter     spinPolls;          // busy poll iterations that found nothing
+        Counter     spinHits;           // busy poll iterations that found events
+        Counter     spinNanos;          // spent polling in the ones that found nothing
+        Counter     throttles;          // reads and writes paused by a rate limiter
+        Counter     compressInBytes;    // bodies and payloads given to zlib
+        Counter     compressOutBytes;   // what was sent of them instead
+
+        Gauge       functorQueueDepth;  // functors taken by the last doPendingFunctors
+        Gauge       functorsDeferred;   // of those, left over by the functor budget
+        Gauge       channels;
+        Gauge       timers;
+        Gauge       connections;
+        Gauge       inputBufferBytes;   // summed over the loop's connections
+        Gauge       outputBufferBytes;
+
+        Histogram   pollEvents;         // active channels per poll
+        Histogram   iterationNanos;     // poll return to end of iteration
+        Histogram   callbackNanos;      // one Channel::handleEvent
+    };
+
+    /// Process-wide list of LoopMetrics, rendered in Prometheus text format.
+    ///
+    /// The mutex only guards loop registration and scraping.
+    class MetricsRegistry : NonCopyable
+    {
+    public:
+        static MetricsRegistry& instance();
+
+        void add(LoopMetrics* metrics);
+        void remove(LoopMetrics* metrics);
+
+        /// Prometheus text exposition format 0.0.4.
+        std::string scrape();
+
+    private:
+        MetricsRegistry()
+        {
+        }
+
+        std::mutex                  mutex_;
+        std::vector<LoopMetrics*>   loops_;
+    };
+}
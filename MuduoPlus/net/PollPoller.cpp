@@ -0,0 +1,134 @@
+#include "PollPoller.h"
+#include "base/Logger.h"
+#include "EventLoop.h"
+
+namespace MuduoPlus
+{
+    PollPoller::PollPoller(EventLoop* loop)
+        : Poller(loop)
+    {
+    }
+
+    PollPoller::~PollPoller()
+    {
+    }
+
+    void PollPoller::poll(int timeoutMs, ChannelHolderList &activeChannelHolders)
+    {
+        LOG_DEBUG("fd total count %u", channelHolders_.size());
+
+        int numEvents = ::poll(pollfds_.data(), pollfds_.size(), timeoutMs);
+        int errorCode = GetLastErrorCode();
+
+        if(numEvents > 0)
+        {
+            LOG_DEBUG("poll %u events happended", numEvents);
+            fillActiveChannelHolders(numEvents, activeChannelHolders);
+        }
+        else if(numEvents == 0)
+        {
+            LOG_DEBUG("poll nothing happended");
+        }
+        else
+        {
+            // error happens, log uncommon ones
+            if(errorCode != EINTR)
+            {
+                LOG_PRINT(LogType_Error, "poll failed:%s", GetErrorText(errorCode).c_str());
+            }
+        }
+    }
+
+    void PollPoller::updateChannel(Channel* pChannel)
+    {
+        Poller::assertInLoopThread();
+
+        if(hasChannel(pChannel))
+        {
+            pollfds_[indexes_[pChannel->fd()]].events = static_cast<short>(pChannel->getEpEvents());
+        }
+        else
+        {
+            struct pollfd pfd;
+            pfd.fd = pChannel->fd();
+            pfd.events = static_cast<short>(pChannel->getEpEvents());
+            pfd.revents = 0;
+            pollfds_.push_back(pfd);
+            indexes_[pfd.fd] = static_cast<int>(pollfds_.size()) - 1;
+
+            // loop internal channels such as the wakeup channel have no owner
+            ChannelHolder holder;
+            holder.channel_ = pChannel;
+            holder.ower_ = pChannel->getOwner().lock();
+            channelHolders_[pfd.fd] = holder;
+        }
+    }
+
+    void PollPoller::removeChannel(Channel* pChannel)
+    {
+        Poller::assertInLoopThread();
+
+        auto count = channelHolders_.erase(pChannel->fd());
+        assert(count > 0);
+        (void)count;
+
+        auto it = indexes_.find(pChannel->fd());
+        assert(it != indexes_.end());
+        int index = it->second;
+        indexes_.erase(it);
+
+        // move the last slot into the hole, O(1) removal
+        if(index != static_cast<int>(pollfds_.size()) - 1)
+        {
+            pollfds_[index] = pollfds_.back();
+            indexes_[pollfds_[index].fd] = index;
+        }
+
+        pollfds_.pop_back();
+    }
+
+    void PollPoller::fillActiveChannelHolders(int numEvents, ChannelHolderList
+                                              &activeChannelHolders) const
+    {
+        for(auto pfd = pollfds_.begin(); pfd != pollfds_.end() && numEvents > 0; ++pfd)
+        {
+            if(pfd->revents == 0)
+            {
+                continue;
+            }
+
+            --numEvents;
+            auto it = channelHolders_.find(pfd->fd);
+
+            if(it == channelHolders_.end())
+            {
+                LOG_PRINT(LogType_Error, "can not find fd[%d] associate channel", pfd->fd);
+                continue;
+            }
+
+            int recvEvents = Channel::kNoneEvent;
+
+            if(pfd->revents & (POLLIN | POLLPRI | POLLRDHUP))
+            {
+                recvEvents |= Channel::kReadEvent;
+            }
+
+            if(pfd->revents & POLLOUT)
+            {
+                recvEvents |= Channel::kWriteEvent;
+            }
+
+            if(pfd->revents & (POLLERR | POLLHUP | POLLNVAL))
+            {
+                recvEvents |= Channel::kErrorEvent;
+            }
+
+            if(recvEvents)
+            {
+                LOG_DEBUG("recvEvents:%d", recvEvents);
+                it->second.channel_->setTrigeredEvents(recvEvents);
+                activeChannelHolders.push_back(it->second);
+            }
+        }
+    }
+}
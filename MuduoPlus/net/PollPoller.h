@@ -0,0 +1,36 @@
+#pragma once
+
+#include <poll.h>
+
+#include "Poller.h"
+#include "Channel.h"
+
+namespace MuduoPlus
+{
+    /// Poller on poll(2). Interest changes only touch the pollfd array, no
+    /// syscall, which wins over epoll_ctl when a loop has few descriptors.
+    class PollPoller : public Poller
+    {
+    public:
+        PollPoller(EventLoop* loop);
+        virtual ~PollPoller();
+
+        virtual const char* name() const
+        {
+            return "poll";
+        }
+
+        virtual void poll(int timeoutMs, ChannelHolderList &activeChannelHolders);
+        virtual void updateChannel(Channel* pChannel);
+        virtual void removeChannel(Channel* pChannel);
+
+    private:
+        void fillActiveChannelHolders(int numEvents, ChannelHolderList
+                                      &activeChannelHolders) const;
+
+        typedef std::vector<struct pollfd> PollFdList;
+
+        PollFdList          pollfds_;
+        std::map<int, int>  indexes_;       // fd to its slot in pollfds_
+    };
+}
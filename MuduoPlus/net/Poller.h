@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <map>
+#include <string>
 
 #include "EventLoop.h"
 #include "ChannelHolder.h"
@@ -18,16 +19,59 @@ namespace MuduoPlus
         Poller(EventLoop* loop);
         virtual ~Poller();
 
+        /// Backend name as accepted by newPoller.
+        virtual const char* name() const = 0;
+
         virtual void poll(int timeoutMs, ChannelHolderList &activeChannelHolders) = 0;
 
         virtual void updateChannel(Channel* channel) = 0;
 
         virtual void removeChannel(Channel* channel) = 0;
 
+        /// Lets the kernel spin on the device queue for usec while waiting,
+        /// false if the backend or the kernel can not.
+        virtual bool setBusyPoll(int usec)
+        {
+            return false;
+        }
+
+        /// True if the backend does the reads, accepts and sends of
+        /// channels in completion mode itself, see Channel::CompletionMode.
+        virtual bool completionIo() const
+        {
+            return false;
+        }
+
+#ifndef WIN32
+        /// Queues a send of vec for a channel in completion mode, its write
+        /// callback gets the result. The memory must stay unchanged until
+        /// then. False if the backend can not or a send is in flight.
+        virtual bool submitSend(Channel* channel, const struct iovec* vec, int count)
+        {
+            return false;
+        }
+#endif
+
         virtual bool hasChannel(Channel* channel) const;
 
+        size_t channelCount() const
+        {
+            return channelHolders_.size();
+        }
+
+        /// Backend by name: "epoll", "poll" and "uring" on Linux, "select"
+        /// on Windows. NULL if the name is unknown or the backend can not
+        /// be created on this system.
+        static Poller* newPoller(const std::string& backend, EventLoop* loop);
+
+        /// Backend of defaultBackend(), epoll or select when unavailable.
         static Poller* newDefaultPoller(EventLoop* loop);
 
+        /// Initially MUDUO_POLLER from the environment, else the platform
+        /// default. Applies to loops created afterwards.
+        static void setDefaultBackend(const std::string& backend);
+        static std::string defaultBackend();
+
         void assertInLoopThread() const
         {
             ownerLoop_->assertInLoopThread();
@@ -0,0 +1,94 @@
+#include "Resolver.h"
+#include "EventLoop.h"
+#include "base/Logger.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        // a lookup stuck on an unreachable name server holds its worker
+        // for the resolver timeout, seconds, the others keep going
+        const int kInstanceThreads = 4;
+    }
+
+    Resolver::Resolver(int numThreads)
+        : pool_("Resolver")
+    {
+        pool_.start(numThreads);
+    }
+
+    Resolver::~Resolver()
+    {
+        pool_.stop();
+    }
+
+    void Resolver::resolve(EventLoop* loop, const std::string& host, uint16_t port,
+                           const ResolveCallback& cb, int family)
+    {
+        std::vector<InetAddress> addrs = resolveNow(host, port, family, true);
+
+        if(!addrs.empty())
+        {
+            loop->runInLoop(std::bind(cb, addrs));
+            return;
+        }
+
+        pool_.run([ = ]()
+        {
+            std::vector<InetAddress> result = resolveNow(host, port, family);
+            loop->runInLoop(std::bind(cb, result));
+        });
+    }
+
+    std::vector<InetAddress> Resolver::resolveNow(const std::string& host, uint16_t port,
+            int family, bool numericOnly)
+    {
+        std::vector<InetAddress> addrs;
+        struct addrinfo hints;
+        struct addrinfo* result = NULL;
+        char service[16] = { 0 };
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = family;
+        hints.ai_socktype = SOCK_STREAM;    // one entry per address
+        hints.ai_flags = AI_NUMERICSERV | (numericOnly ? AI_NUMERICHOST : AI_ADDRCONFIG);
+        snprintf(service, sizeof(service), "%u", port);
+
+        // "[::1]" as written in URLs
+        std::string name = host;
+
+        if(name.size() > 2 && name[0] == '[' && name[name.size() - 1] == ']')
+        {
+            name = name.substr(1, name.size() - 2);
+        }
+
+        int ret = getaddrinfo(name.c_str(), service, &hints, &result);
+
+        if(ret != 0)
+        {
+            if(!numericOnly)
+            {
+                LOG_PRINT(LogType_Warn, "resolve %s failed:%s", host.c_str(), gai_strerror(ret));
+            }
+
+            return addrs;
+        }
+
+        for(struct addrinfo* ai = result; ai != NULL; ai = ai->ai_next)
+        {
+            if(ai->ai_family == AF_INET || ai->ai_family == AF_INET6)
+            {
+                addrs.push_back(InetAddress(ai->ai_addr, static_cast<socklen_t>(ai->ai_addrlen)));
+            }
+        }
+
+        freeaddrinfo(result);
+        return addrs;
+    }
+
+    Resolver& Resolver::instance()
+    {
+        static Resolver resolver(kInstanceThreads);
+        return resolver;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "base/NonCopyable.h"
+#include "base/ThreadPool.h"
+#include "net/InetAddress.h"
+
+namespace MuduoPlus
+{
+    class EventLoop;
+
+    /// Asynchronous host name resolution.
+    ///
+    /// getaddrinfo(3) blocks, so lookups run on worker threads and the
+    /// result is posted back to the caller's loop with runInLoop. Numeric
+    /// hosts are answered without a worker round trip.
+    class Resolver : NonCopyable
+    {
+    public:
+        /// Addresses in getaddrinfo order (RFC 6724 preference), empty on
+        /// failure.
+        typedef std::function<void(const std::vector<InetAddress>&)> ResolveCallback;
+
+        explicit Resolver(int numThreads = 1);
+        ~Resolver();
+
+        /// Thread safe. cb runs in loop, which must outlive the lookup.
+        /// family is AF_UNSPEC, AF_INET or AF_INET6.
+        void resolve(EventLoop* loop, const std::string& host, uint16_t port,
+                     const ResolveCallback& cb, int family = AF_UNSPEC);
+
+        /// Blocking lookup, what the workers run.
+        static std::vector<InetAddress> resolveNow(const std::string& host, uint16_t port,
+                int family = AF_UNSPEC, bool numericOnly = false);
+
+        /// Process wide resolver, started on first use. Its workers bound
+        /// the lookups in flight, more wait their turn.
+        static Resolver& instance();
+
+    private:
+        ThreadPool  pool_;
+    };
+}
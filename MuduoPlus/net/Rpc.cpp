@@ -0,0 +1,61 @@
+#include "Rpc.h"
+
+namespace MuduoPlus
+{
+    const char* rpcStatusName(RpcStatus status)
+    {
+        switch(status)
+        {
+            case kRpcOk:
+                return "ok";
+
+            case kRpcNoMethod:
+                return "no such method";
+
+            case kRpcBadRequest:
+                return "bad request";
+
+            case kRpcBadResponse:
+                return "bad response";
+
+            case kRpcTimeout:
+                return "timeout";
+
+            default:
+                return "disconnected";
+        }
+    }
+
+    namespace Rpc
+    {
+        namespace
+        {
+            // a frame buffer grown past this is dropped after the big message
+            const size_t kMaxKeptBytes = 1024 * 1024;
+        }
+
+        Buffer* frameBuffer()
+        {
+            thread_local Buffer t_buffer;
+
+            if(t_buffer.internalCapacity() > kMaxKeptBytes)
+            {
+                Buffer().swap(t_buffer);
+            }
+
+            t_buffer.retrieveAll();
+            return &t_buffer;
+        }
+
+        void appendHeader(Buffer* buf, FrameKind kind, uint64_t id)
+        {
+            buf->appendInt8(static_cast<int8_t>(kind));
+            buf->appendInt64(static_cast<int64_t>(id));
+        }
+
+        void finishFrame(Buffer* buf)
+        {
+            buf->prependInt32(static_cast<int32_t>(buf->readableBytes()));
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+// Wire format and message encoding shared by RpcServer and RpcClient.
+//
+// Messages are classes with an intrusive Serialize, as for the archives of
+// the Serialize library, encoded with its BinaryOutputArchive straight into
+// the Buffer a frame is sent from:
+//
+//     struct AddRequest
+//     {
+//         int64_t a;
+//         int64_t b;
+//
+//         template <typename Archive>
+//         void Serialize(Archive& ar)
+//         {
+//             ar.Serialize("a", a);
+//             ar.Serialize("b", b);
+//         }
+//     };
+//
+// A frame is a 4 byte big endian length of the rest, a kind byte and the
+// 8 byte call id. Requests go on with a length byte and "service.method",
+// responses with an RpcStatus byte, the encoded message takes the rest.
+// Many calls are in flight on one connection, responses come back in the
+// order handlers finish and find their call by id.
+
+#include <string>
+
+#include "common.h"
+#include "traits.h"
+#include "BinaryInputArchive.h"
+#include "BinaryOutputArchive.h"
+#include "InputArchive.h"
+#include "OutputArchive.h"
+
+#include "Buffer.h"
+
+namespace MuduoPlus
+{
+    enum RpcStatus
+    {
+        kRpcOk,
+        kRpcNoMethod,       // the server has no such service.method
+        kRpcBadRequest,     // the server could not decode the request
+        kRpcBadResponse,    // the response did not decode
+        kRpcTimeout,        // no response before the call's deadline
+        kRpcDisconnected    // the connection closed with the call in flight
+    };
+
+    const char* rpcStatusName(RpcStatus status);
+
+    namespace Rpc
+    {
+        enum FrameKind
+        {
+            kRequest = 1,
+            kResponse = 2
+        };
+
+        static const size_t kHeaderLen = sizeof(int32_t);
+        static const size_t kMaxNameLen = 255;
+
+        /// Lets BinaryOutputArchive append to a Buffer, offsets are from
+        /// the Buffer's readable start.
+        class BufferSink
+        {
+        public:
+            BufferSink()
+                : buffer_(NULL)
+            {
+            }
+
+            explicit BufferSink(Buffer* buffer)
+                : buffer_(buffer)
+            {
+            }
+
+            void append(const char* data, size_t len)
+            {
+                buffer_->append(data, len);
+            }
+
+            size_t size() const
+            {
+                return buffer_->readableBytes();
+            }
+
+            char& operator[](size_t index)
+            {
+                return *(buffer_->beginWrite() - buffer_->readableBytes() + index);
+            }
+
+        private:
+            Buffer* buffer_;
+        };
+
+        /// Appends message to buf. The archives take non-const references,
+        /// writing only reads the message, though std::stack and std::deque
+        /// members are taken apart and put back.
+        template <typename Message>
+        void encode(const Message& message, Buffer* buf)
+        {
+            BufferSink sink(buf);
+            Serialization::OutputArchive<Serialization::BinaryOutputArchive<BufferSink> > archive(sink);
+            archive << const_cast<Message&>(message);
+        }
+
+        /// False if data is not a whole message.
+        template <typename Message>
+        bool decode(const char* data, size_t len, Message* message)
+        {
+            Serialization::InputArchive<Serialization::BinaryInputArchive> archive;
+            archive.Load(data, len);
+            archive >> *message;
+            return archive.Good();
+        }
+
+        /// An empty Buffer of this thread for building frames, its prepend
+        /// area takes the length.
+        Buffer* frameBuffer();
+
+        /// Appends a frame's kind and id to an empty buf.
+        void appendHeader(Buffer* buf, FrameKind kind, uint64_t id);
+
+        /// Puts the length in front of the finished frame in buf.
+        void finishFrame(Buffer* buf);
+    }
+}
@@ -0,0 +1,221 @@
+#include "base/Logger.h"
+
+#include "RpcClient.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        // kind and id, and the status
+        const size_t kResponseHeaderLen = sizeof(int8_t) + sizeof(int64_t) + sizeof(int8_t);
+    }
+
+    RpcClient::RpcClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& name)
+        : loop_(loop),
+          client_(loop, serverAddr, name),
+          timeoutSeconds_(0),
+          nextId_(1)
+    {
+        client_.setConnectionCallback(
+            std::bind(&RpcClient::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(
+            std::bind(&RpcClient::onMessage, this, std::placeholders::_1,
+                      std::placeholders::_2, std::placeholders::_3));
+        client_.enableRetry();
+    }
+
+    RpcClient::~RpcClient()
+    {
+        for(auto &pos : calls_)
+        {
+            if(pos.second.timed)
+            {
+                loop_->cancel(pos.second.timer);
+            }
+        }
+    }
+
+    void RpcClient::connect()
+    {
+        client_.connect();
+    }
+
+    void RpcClient::disconnect()
+    {
+        client_.disconnect();
+    }
+
+    bool RpcClient::appendName(Buffer* buf, const std::string& service, const std::string& method)
+    {
+        size_t len = service.size() + 1 + method.size();
+
+        if(len > Rpc::kMaxNameLen)
+        {
+            LOG_PRINT(LogType_Error, "RpcClient[%s] - method name %s.%s is too long",
+                      client_.name().c_str(), service.c_str(), method.c_str());
+            return false;
+        }
+
+        buf->appendInt8(static_cast<int8_t>(len));
+        buf->append(service.data(), service.size());
+        buf->append(".", 1);
+        buf->append(method.data(), method.size());
+        return true;
+    }
+
+    void RpcClient::send(uint64_t id, Buffer* frame, const ResponseCallback& cb,
+                         double timeoutSeconds)
+    {
+        if(loop_->isInLoopThread())
+        {
+            callInLoop(id, frame->peek(), frame->readableBytes(), cb, timeoutSeconds);
+            return;
+        }
+
+        std::string copy(frame->peek(), frame->readableBytes());
+        loop_->runInLoop([this, id, copy, cb, timeoutSeconds]()
+        {
+            callInLoop(id, copy.data(), copy.size(), cb, timeoutSeconds);
+        });
+    }
+
+    void RpcClient::callInLoop(uint64_t id, const char* frame, size_t len,
+                               const ResponseCallback& cb, double timeoutSeconds)
+    {
+        loop_->assertInLoopThread();
+
+        Call& call = calls_[id];
+        call.cb = cb;
+        call.timed = timeoutSeconds > 0;
+
+        if(call.timed)
+        {
+            call.timer = loop_->runAfter(timeoutSeconds, [this, id]()
+            {
+                auto it = calls_.find(id);
+
+                if(it != calls_.end())
+                {
+                    it->second.timed = false;
+                    finish(id, kRpcTimeout, NULL, 0);
+                }
+            });
+        }
+
+        if(connection_)
+        {
+            connection_->send(frame, static_cast<int>(len));
+        }
+        else
+        {
+            waiting_.append(frame, len);
+        }
+    }
+
+    void RpcClient::finish(uint64_t id, RpcStatus status, const char* data, size_t len)
+    {
+        auto it = calls_.find(id);
+
+        if(it == calls_.end())
+        {
+            return;
+        }
+
+        if(it->second.timed)
+        {
+            loop_->cancel(it->second.timer);
+        }
+
+        ResponseCallback cb;
+        cb.swap(it->second.cb);
+        calls_.erase(it);
+        cb(status, data, len);
+    }
+
+    void RpcClient::onConnection(const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+            connection_ = conn;
+
+            if(waiting_.readableBytes() > 0)
+            {
+                conn->send(waiting_.peek(), static_cast<int>(waiting_.readableBytes()));
+                waiting_.retrieveAll();
+            }
+
+            return;
+        }
+
+        LOG_PRINT(LogType_Info, "RpcClient[%s] - disconnected, %zu calls failed",
+                  client_.name().c_str(), calls_.size());
+        failCalls();
+    }
+
+    void RpcClient::failCalls()
+    {
+        connection_.reset();
+
+        // every call was sent on the connection, none can be answered now
+        std::vector<uint64_t> ids;
+        ids.reserve(calls_.size());
+
+        for(auto &pos : calls_)
+        {
+            ids.push_back(pos.first);
+        }
+
+        for(uint64_t id : ids)
+        {
+            finish(id, kRpcDisconnected, NULL, 0);
+        }
+    }
+
+    void RpcClient::closeBroken(const TcpConnectionPtr& conn)
+    {
+        // a forced close reports no down, fail the calls here
+        conn->forceClose();
+        failCalls();
+    }
+
+    void RpcClient::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        while(buf->readableBytes() >= Rpc::kHeaderLen && conn->connected())
+        {
+            size_t len = static_cast<uint32_t>(buf->peekInt32());
+
+            if(len < kResponseHeaderLen || len > INT32_MAX)
+            {
+                LOG_PRINT(LogType_Error, "RpcClient[%s] - invalid length %zu",
+                          client_.name().c_str(), len);
+                closeBroken(conn);
+                break;
+            }
+
+            if(buf->readableBytes() < Rpc::kHeaderLen + len)
+            {
+                break;
+            }
+
+            buf->retrieve(Rpc::kHeaderLen);
+            int8_t kind = buf->readInt8();
+            uint64_t id = static_cast<uint64_t>(buf->readInt64());
+            RpcStatus status = static_cast<RpcStatus>(buf->readInt8());
+            size_t payloadLen = len - kResponseHeaderLen;
+
+            if(kind != Rpc::kResponse)
+            {
+                LOG_PRINT(LogType_Error, "RpcClient[%s] - malformed response",
+                          client_.name().c_str());
+                closeBroken(conn);
+                break;
+            }
+
+            finish(id, status, buf->peek(), payloadLen);
+            buf->retrieve(payloadLen);
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/NonCopyable.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "Rpc.h"
+#include "TcpClient.h"
+#include "TimerId.h"
+
+namespace MuduoPlus
+{
+    /// Calls RpcServer methods over one connection, any number of calls in
+    /// flight at once. Every call gets exactly one callback, on the
+    /// client's loop, with the response or the reason it failed. Calls made
+    /// while the connection is down wait for it, the client reconnects
+    /// after losing it.
+    ///
+    ///     RpcClient client(&loop, InetAddress("127.0.0.1", 9981), "Calc");
+    ///     client.connect();
+    ///     client.call<AddRequest, AddResponse>("Calc", "add", req,
+    ///         [](RpcStatus status, const AddResponse& resp) { ... }, 0.5);
+    class RpcClient : NonCopyable
+    {
+    public:
+        RpcClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& name);
+        /// In the loop thread. Calls in flight are dropped without their
+        /// callbacks, do not destroy the client from one.
+        ~RpcClient();
+
+        /// Deadline of calls not given their own, 0 for none, the default.
+        void setTimeout(double seconds)
+        {
+            timeoutSeconds_ = seconds;
+        }
+
+        void connect();
+        void disconnect();
+
+        EventLoop* getLoop() const
+        {
+            return loop_;
+        }
+
+        /// For the settings RpcClient does not wrap, TLS.
+        TcpClient& tcpClient()
+        {
+            return client_;
+        }
+
+        /// Calls in flight and waiting for the connection. Loop thread only.
+        size_t pendingCalls() const
+        {
+            return calls_.size();
+        }
+
+        /// Thread safe. The request is encoded before call returns. A late
+        /// response of a call that timed out is dropped, the connection
+        /// stays up for the others.
+        template <typename Request, typename Response>
+        void call(const std::string& service, const std::string& method, const Request& request,
+                  const std::function<void(RpcStatus, const Response&)>& done,
+                  double timeoutSeconds = -1)
+        {
+            Buffer* buf = Rpc::frameBuffer();
+            uint64_t id = nextId_.fetch_add(1, std::memory_order_relaxed);
+            Rpc::appendHeader(buf, Rpc::kRequest, id);
+
+            ResponseCallback cb = [done](RpcStatus status, const char* data, size_t len)
+            {
+                Response response = Response();
+
+                if(status == kRpcOk && !Rpc::decode(data, len, &response))
+                {
+                    status = kRpcBadResponse;
+                }
+
+                done(status, response);
+            };
+
+            if(!appendName(buf, service, method))
+            {
+                loop_->runInLoop([cb]()
+                {
+                    cb(kRpcNoMethod, NULL, 0);
+                });
+                return;
+            }
+
+            Rpc::encode(request, buf);
+            Rpc::finishFrame(buf);
+            send(id, buf, cb, timeoutSeconds < 0 ? timeoutSeconds_ : timeoutSeconds);
+        }
+
+    private:
+        typedef std::function<void(RpcStatus, const char* data, size_t len)> ResponseCallback;
+
+        struct Call
+        {
+            ResponseCallback cb;
+            TimerId timer;
+            bool timed;
+        };
+
+        bool appendName(Buffer* buf, const std::string& service, const std::string& method);
+        void send(uint64_t id, Buffer* frame, const ResponseCallback& cb, double timeoutSeconds);
+        void callInLoop(uint64_t id, const char* frame, size_t len, const ResponseCallback& cb,
+                        double timeoutSeconds);
+        void finish(uint64_t id, RpcStatus status, const char* data, size_t len);
+        void failCalls();
+        void closeBroken(const TcpConnectionPtr& conn);
+        void onConnection(const TcpConnectionPtr& conn);
+        void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+
+        EventLoop* loop_;
+        TcpClient client_;
+        double timeoutSeconds_;
+        std::atomic<uint64_t> nextId_;
+        // loop thread only
+        TcpConnectionPtr connection_;
+        Buffer waiting_;        // frames of calls made while disconnected
+        std::unordered_map<uint64_t, Call> calls_;
+    };
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "base/Logger.h"
+
+#include "RpcServer.h"
+#include "Buffer.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        // kind and id, and the length of the method name
+        const size_t kRequestHeaderLen = sizeof(int8_t) + sizeof(int64_t) + sizeof(uint8_t);
+    }
+
+    RpcServer::RpcServer(EventLoop* loop, const InetAddress& listenAddr, const std::string& name,
+                         size_t maxMessageBytes)
+        : server_(loop, listenAddr, name),
+          maxMessageBytes_(std::min<size_t>(maxMessageBytes, INT32_MAX))
+    {
+        server_.setMessageCallback(std::bind(&RpcServer::onMessage, this, std::placeholders::_1,
+                                             std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void RpcServer::addMethod(const std::string& service, const std::string& method,
+                              const MethodHandler& handler)
+    {
+        std::string name = service + "." + method;
+
+        if(name.size() > Rpc::kMaxNameLen)
+        {
+            LOG_PRINT(LogType_Error, "RpcServer[%s] - method name %s is too long",
+                      server_.name().c_str(), name.c_str());
+            return;
+        }
+
+        methods_[name] = handler;
+    }
+
+    void RpcServer::sendStatus(const TcpConnectionPtr& conn, uint64_t id, RpcStatus status)
+    {
+        Buffer* buf = Rpc::frameBuffer();
+        Rpc::appendHeader(buf, Rpc::kResponse, id);
+        buf->appendInt8(static_cast<int8_t>(status));
+        Rpc::finishFrame(buf);
+        conn->send(buf->peek(), static_cast<int>(buf->readableBytes()));
+    }
+
+    void RpcServer::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        // reused by the calls on this thread, names fit without allocating
+        thread_local std::string t_name;
+
+        while(buf->readableBytes() >= Rpc::kHeaderLen && conn->connected())
+        {
+            size_t len = static_cast<uint32_t>(buf->peekInt32());
+
+            if(len < kRequestHeaderLen || len > maxMessageBytes_)
+            {
+                LOG_PRINT(LogType_Error, "RpcServer[%s] - invalid length %zu from %s",
+                          server_.name().c_str(), len, conn->name().c_str());
+                conn->forceClose();
+                break;
+            }
+
+            if(buf->readableBytes() < Rpc::kHeaderLen + len)
+            {
+                break;
+            }
+
+            const char* frame = buf->peek() + Rpc::kHeaderLen;
+            size_t nameLen = static_cast<uint8_t>(frame[sizeof(int8_t) + sizeof(int64_t)]);
+
+            if(frame[0] != Rpc::kRequest || kRequestHeaderLen + nameLen > len)
+            {
+                LOG_PRINT(LogType_Error, "RpcServer[%s] - malformed request from %s",
+                          server_.name().c_str(), conn->name().c_str());
+                conn->forceClose();
+                break;
+            }
+
+            buf->retrieve(Rpc::kHeaderLen + sizeof(int8_t));
+            uint64_t id = static_cast<uint64_t>(buf->readInt64());
+            buf->retrieve(sizeof(uint8_t));
+            t_name.assign(buf->peek(), nameLen);
+            buf->retrieve(nameLen);
+
+            size_t payloadLen = len - kRequestHeaderLen - nameLen;
+            auto it = methods_.find(t_name);
+
+            if(it == methods_.end())
+            {
+                LOG_PRINT(LogType_Warn, "RpcServer[%s] - no method %s for %s",
+                          server_.name().c_str(), t_name.c_str(), conn->name().c_str());
+                sendStatus(conn, id, kRpcNoMethod);
+            }
+            else
+            {
+                it->second(conn, id, buf->peek(), payloadLen);
+            }
+
+            buf->retrieve(payloadLen);
+        }
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "base/NonCopyable.h"
+#include "Rpc.h"
+#include "TcpConnection.h"
+#include "TcpServer.h"
+
+namespace MuduoPlus
+{
+    /// Answers one call, once, from any thread. A handler may keep a copy
+    /// to answer after it returned, the answer is dropped if the
+    /// connection is gone by then.
+    template <typename Response>
+    class RpcReply
+    {
+    public:
+        RpcReply(const TcpConnectionPtr& conn, uint64_t id)
+            : conn_(conn),
+              id_(id)
+        {
+        }
+
+        void operator()(const Response& response) const;
+
+    private:
+        std::weak_ptr<TcpConnection> conn_;
+        uint64_t id_;
+    };
+
+    /// Serves methods registered by service and method name to RpcClient.
+    /// Handlers run on the loop of the connection the request came on, the
+    /// calls of one connection are decoded in order but may be answered in
+    /// any order.
+    ///
+    ///     RpcServer server(&loop, InetAddress(9981), "Calc");
+    ///     server.registerMethod<AddRequest, AddResponse>("Calc", "add",
+    ///         [](const AddRequest& req, AddResponse* resp)
+    ///         {
+    ///             resp->sum = req.a + req.b;
+    ///         });
+    ///     server.start();
+    class RpcServer : NonCopyable
+    {
+    public:
+        RpcServer(EventLoop* loop, const InetAddress& listenAddr, const std::string& name,
+                  size_t maxMessageBytes = 64 * 1024 * 1024);
+
+        /// Answers with what handler left in the response when it returns.
+        /// Not thread safe, before @c start
+        template <typename Request, typename Response>
+        void registerMethod(const std::string& service, const std::string& method,
+                            const std::function<void(const Request&, Response*)>& handler)
+        {
+            addMethod(service, method,
+                      [handler](const TcpConnectionPtr& conn, uint64_t id, const char* data, size_t len)
+            {
+                Request request;
+
+                if(!Rpc::decode(data, len, &request))
+                {
+                    sendStatus(conn, id, kRpcBadRequest);
+                    return;
+                }
+
+                Response response;
+                handler(request, &response);
+                sendResponse(conn, id, response);
+            });
+        }
+
+        /// The handler answers through the reply, now or later.
+        /// Not thread safe, before @c start
+        template <typename Request, typename Response>
+        void registerAsyncMethod(const std::string& service, const std::string& method,
+                                 const std::function<void(const Request&, const RpcReply<Response>&)>& handler)
+        {
+            addMethod(service, method,
+                      [handler](const TcpConnectionPtr& conn, uint64_t id, const char* data, size_t len)
+            {
+                Request request;
+
+                if(!Rpc::decode(data, len, &request))
+                {
+                    sendStatus(conn, id, kRpcBadRequest);
+                    return;
+                }
+
+                handler(request, RpcReply<Response>(conn, id));
+            });
+        }
+
+        /// See TcpServer::setThreadNum.
+        void setThreadNum(int numThreads)
+        {
+            server_.setThreadNum(numThreads);
+        }
+
+        /// For the settings RpcServer does not wrap, TLS or idle timeouts.
+        TcpServer& tcpServer()
+        {
+            return server_;
+        }
+
+        void start()
+        {
+            server_.start();
+        }
+
+        /// Thread safe.
+        template <typename Response>
+        static void sendResponse(const TcpConnectionPtr& conn, uint64_t id, const Response& response)
+        {
+            Buffer* buf = Rpc::frameBuffer();
+            Rpc::appendHeader(buf, Rpc::kResponse, id);
+            buf->appendInt8(static_cast<int8_t>(kRpcOk));
+            Rpc::encode(response, buf);
+            Rpc::finishFrame(buf);
+            conn->send(buf->peek(), static_cast<int>(buf->readableBytes()));
+        }
+
+        /// A response without a message. Thread safe.
+        static void sendStatus(const TcpConnectionPtr& conn, uint64_t id, RpcStatus status);
+
+    private:
+        typedef std::function<void(const TcpConnectionPtr&, uint64_t id, const char* data,
+                                   size_t len)> MethodHandler;
+
+        void addMethod(const std::string& service, const std::string& method,
+                       const MethodHandler& handler);
+        void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+
+        TcpServer server_;
+        size_t maxMessageBytes_;
+        std::unordered_map<std::string, MethodHandler> methods_;  // by "service.method"
+    };
+
+    template <typename Response>
+    void RpcReply<Response>::operator()(const Response& response) const
+    {
+        if(TcpConnectionPtr conn = conn_.lock())
+        {
+            RpcServer::sendResponse(conn, id_, response);
+        }
+    }
+}
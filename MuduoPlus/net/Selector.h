@@ -10,6 +10,11 @@ namespace MuduoPlus
         Selector(EventLoop* loop);
         virtual ~Selector();
 
+        virtual const char* name() const
+        {
+            return "select";
+        }
+
         virtual void poll(int timeoutMs, ChannelHolderList &activeChannelHolders);
         virtual void updateChannel(Channel* channel);
         virtual void removeChannel(Channel* channel);
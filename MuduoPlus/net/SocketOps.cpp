@@ -3,6 +3,10 @@
 #include "base/Logger.h"
 #include <string.h>
 
+#ifdef MUDUO_HAVE_ZEROCOPY
+#include <linux/errqueue.h>
+#endif
+
 namespace SocketOps
 {
     socket_t    createSocket()
@@ -12,6 +16,20 @@ namespace SocketOps
         return  fd;
     }
 
+    socket_t    createSocket(int family, int type)
+    {
+        socket_t fd = socket(family, type, 0);
+
+        return  fd;
+    }
+
+    socket_t    createUdpSocket(int family)
+    {
+        socket_t fd = socket(family, SOCK_DGRAM, 0);
+
+        return  fd;
+    }
+
     void closeSocket(socket_t fd)
     {
 #ifndef WIN32
@@ -21,14 +39,14 @@ namespace SocketOps
 #endif
     }
 
-    int connect(socket_t fd, const struct sockaddr *sa)
+    int connect(socket_t fd, const struct sockaddr *sa, socklen_t len)
     {
-        return ::connect(fd, sa, sizeof(*sa));
+        return ::connect(fd, sa, len);
     }
 
-    bool bindSocket(socket_t fd, const struct sockaddr *sa)
+    bool bindSocket(socket_t fd, const struct sockaddr *sa, socklen_t len)
     {
-        if(bind(fd, sa, sizeof(*sa)) < 0)
+        if(bind(fd, sa, len) < 0)
         {
             return false;
         }
@@ -46,10 +64,9 @@ namespace SocketOps
         return true;
     }
 
-    socket_t accept(socket_t fd, struct sockaddr *addr)
+    socket_t accept(socket_t fd, struct sockaddr *addr, socklen_t* len)
     {
-        socklen_t   socklen = sizeof(*addr);
-        socket_t    newFd = accept(fd, addr, &socklen);
+        socket_t    newFd = ::accept(fd, addr, len);
 
         return      newFd;
     }
@@ -134,6 +151,35 @@ namespace SocketOps
 #endif
     }
 
+    int reusePort(socket_t fd)
+    {
+#if !defined(WIN32) && defined(SO_REUSEPORT)
+        int one = 1;
+        return setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void*)&one,
+                          (socklen_t)sizeof(one));
+#else
+        // no kernel load balancing, only one socket can bind the port
+        return -1;
+#endif
+    }
+
+    int setIpv6Only(socket_t fd, bool on)
+    {
+        int val = on ? 1 : 0;
+        return setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&val,
+                          (socklen_t)sizeof(val));
+    }
+
+    int setBusyPoll(socket_t fd, int usec)
+    {
+#if !defined(WIN32) && defined(SO_BUSY_POLL)
+        return setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, (char *)&usec,
+                          (socklen_t)sizeof(usec));
+#else
+        return -1;
+#endif
+    }
+
     int createSocketPair(socket_t fdPair[2])
     {
         if(!fdPair)
@@ -202,14 +248,14 @@ namespace SocketOps
             goto err;
         }
 
-        if(connect(connector, (struct sockaddr *) &connectAddr,
+        if(::connect(connector, (struct sockaddr *) &connectAddr,
                    sizeof(connectAddr)) < 0)
         {
             goto err;
         }
 
         size = sizeof(listenAddr);
-        acceptor = accept(listener, (struct sockaddr *) &listenAddr, &size);
+        acceptor = ::accept(listener, (struct sockaddr *) &listenAddr, &size);
 
         if(acceptor < 0)
         {
@@ -270,9 +316,9 @@ err:
         return false;
     }
 
-    sockaddr_in getPeerAddr(int sockfd)
+    MuduoPlus::InetAddress getPeerAddr(int sockfd)
     {
-        struct sockaddr_in peeraddr;
+        struct sockaddr_storage peeraddr;
         memset(&peeraddr, 0, sizeof(peeraddr));
 
         socklen_t addrlen = static_cast<socklen_t>(sizeof(peeraddr));
@@ -282,12 +328,14 @@ err:
             assert(false);
         }
 
-        return peeraddr;
+        return MuduoPlus::InetAddress((sockaddr*)(&peeraddr), addrlen);
     }
 
-    sockaddr_in getLocalAddr(int sockfd)
+    MuduoPlus::InetAddress getLocalAddr(int sockfd)
     {
-        struct sockaddr_in localaddr = { 0 };
+        struct sockaddr_storage localaddr;
+        memset(&localaddr, 0, sizeof(localaddr));
+
         socklen_t addrlen = static_cast<socklen_t>(sizeof localaddr);
 
         if(::getsockname(sockfd, (sockaddr *)(&localaddr), &addrlen) < 0)
@@ -295,7 +343,7 @@ err:
             assert(false);
         }
 
-        return localaddr;
+        return MuduoPlus::InetAddress((sockaddr*)(&localaddr), addrlen);
     }
 
     int getSocketError(socket_t fd)
@@ -316,4 +364,101 @@ err:
             return optval;
         }
     }
+
+#ifndef WIN32
+
+    int writev(socket_t fd, const struct iovec* vec, int count)
+    {
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = const_cast<struct iovec*>(vec);
+        msg.msg_iovlen = count;
+
+        return static_cast<int>(::sendmsg(fd, &msg, MSG_NOSIGNAL));
+    }
+
+    int sendWithFd(socket_t fd, const void* buff, int count, int passFd)
+    {
+        char control[CMSG_SPACE(sizeof(int))];
+        struct iovec vec;
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        memset(control, 0, sizeof(control));
+        vec.iov_base = const_cast<void*>(buff);
+        vec.iov_len = count;
+        msg.msg_iov = &vec;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &passFd, sizeof(int));
+
+        return static_cast<int>(::sendmsg(fd, &msg, MSG_NOSIGNAL));
+    }
+
+#endif
+
+#ifdef MUDUO_HAVE_ZEROCOPY
+
+    int setZeroCopy(socket_t fd, bool on)
+    {
+        int val = on ? 1 : 0;
+        return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &val, (socklen_t)sizeof(val));
+    }
+
+    int sendZeroCopy(socket_t fd, const void* buff, int count)
+    {
+        return static_cast<int>(::send(fd, buff, count, MSG_ZEROCOPY | MSG_NOSIGNAL));
+    }
+
+    int readZeroCopyCompletions(socket_t fd, const ZeroCopyCallback& cb)
+    {
+        int count = 0;
+
+        while(true)
+        {
+            char control[128];
+            struct msghdr msg;
+
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            if(::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            {
+                break;
+            }
+
+            for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+                    cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if(!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+                        !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+                {
+                    continue;
+                }
+
+                struct sock_extended_err err;
+                memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+
+                if(err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                {
+                    continue;
+                }
+
+                cb(err.ee_info, err.ee_data, (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+#endif
 }
\ No newline at end of file
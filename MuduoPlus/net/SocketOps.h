@@ -1,8 +1,14 @@
 #pragma once
 
 #include <stdint.h>
+#include <functional>
 
 #include "base/define.h"
+#include "InetAddress.h"
+
+#if !defined(WIN32) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define MUDUO_HAVE_ZEROCOPY
+#endif
 
 namespace SocketOps
 {
@@ -39,11 +45,15 @@ namespace SocketOps
     }
 
     socket_t    createSocket();
+    /// family AF_INET, AF_INET6 or AF_UNIX, type SOCK_STREAM or SOCK_SEQPACKET
+    socket_t    createSocket(int family, int type);
+    socket_t    createUdpSocket(int family = AF_INET);
     void        closeSocket(socket_t fd);
-    int         connect(socket_t fd, const struct sockaddr *sa);
-    bool        bindSocket(socket_t fd, const struct sockaddr *sa);
+    int         connect(socket_t fd, const struct sockaddr *sa, socklen_t len);
+    bool        bindSocket(socket_t fd, const struct sockaddr *sa, socklen_t len);
     bool        listen(socket_t fd);
-    socket_t    accept(socket_t fd, struct sockaddr *addr);
+    /// len is the size of addr on input and of the peer address on output
+    socket_t    accept(socket_t fd, struct sockaddr *addr, socklen_t* len);
     int         send(socket_t fd, const void* buff, int count);
     int         secv(socket_t fd, char *buff, int count);
 
@@ -52,9 +62,37 @@ namespace SocketOps
     void        shutdownWrite(int fd);
     void        setTcpNoDelay(int fd, bool on);
     int         reuseListenSocket(socket_t fd);
+    int         reusePort(socket_t fd);
+    /// IPV6_V6ONLY, off lets an AF_INET6 socket bound to [::] take IPv4
+    /// peers as ::ffff:a.b.c.d
+    int         setIpv6Only(socket_t fd, bool on);
+    /// SO_BUSY_POLL, microseconds a blocking read spins on the device
+    /// queue, raising it above net.core.busy_read needs CAP_NET_ADMIN
+    int         setBusyPoll(socket_t fd, int usec);
     int         createSocketPair(socket_t fdPair[2]);
-    sockaddr_in getPeerAddr(int sockfd);
-    sockaddr_in getLocalAddr(int sockfd);
+    MuduoPlus::InetAddress getPeerAddr(int sockfd);
+    MuduoPlus::InetAddress getLocalAddr(int sockfd);
     int         getSocketError(socket_t fd);
 
+#ifndef WIN32
+    /// gathering write, MSG_NOSIGNAL like sendWithFd
+    int         writev(socket_t fd, const struct iovec* vec, int count);
+    /// send(2) that also passes passFd with SCM_RIGHTS, count must be > 0
+    int         sendWithFd(socket_t fd, const void* buff, int count, int passFd);
+#endif
+
+#ifdef MUDUO_HAVE_ZEROCOPY
+    /// SO_ZEROCOPY, TCP and UDP only, needs Linux 4.14
+    int         setZeroCopy(socket_t fd, bool on);
+    /// send(2) with MSG_ZEROCOPY, buff must stay unchanged until the kernel
+    /// reports the send complete
+    int         sendZeroCopy(socket_t fd, const void* buff, int count);
+
+    /// Drains MSG_ZEROCOPY notifications from the error queue, cb gets each
+    /// inclusive range of completed send numbers and whether the kernel
+    /// copied the data after all. Returns the number of notifications.
+    typedef std::function<void(uint32_t lo, uint32_t hi, bool copied)> ZeroCopyCallback;
+    int         readZeroCopyCompletions(socket_t fd, const ZeroCopyCallback& cb);
+#endif
+
 }
\ No newline at end of file
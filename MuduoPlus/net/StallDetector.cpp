@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+#include "StallDetector.h"
+#include "LoopMetrics.h"
+#include "base/Logger.h"
+
+#ifndef WIN32
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+namespace MuduoPlus
+{
+#ifndef WIN32
+    namespace
+    {
+        // delivered to the loop thread while it is stalled
+        const int kStackSignal = SIGUSR2;
+        const int kWatchIntervalMs = 5;
+
+        thread_local StallDetector* t_detector = nullptr;
+    }
+
+    /// One thread for all detectors, it only wakes up every kWatchIntervalMs.
+    class StallWatchdog : NonCopyable
+    {
+    public:
+        static StallWatchdog& instance()
+        {
+            static StallWatchdog s_watchdog;
+            return s_watchdog;
+        }
+
+        void add(StallDetector* detector)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            detectors_.push_back(detector);
+
+            if(!thread_.joinable())
+            {
+                thread_ = std::thread(std::bind(&StallWatchdog::threadFunc, this));
+            }
+        }
+
+        void remove(StallDetector* detector)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            detectors_.erase(std::remove(detectors_.begin(), detectors_.end(), detector),
+                             detectors_.end());
+        }
+
+    private:
+        StallWatchdog()
+            : running_(true)
+        {
+        }
+
+        ~StallWatchdog()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                running_ = false;
+            }
+
+            cond_.notify_one();
+
+            if(thread_.joinable())
+            {
+                thread_.join();
+            }
+        }
+
+        void threadFunc()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            while(running_)
+            {
+                cond_.wait_for(lock, std::chrono::milliseconds(kWatchIntervalMs));
+                int64_t now = LoopMetrics::nowNanos();
+
+                for(auto &pos : detectors_)
+                {
+                    int64_t since = pos->busySince_.load(std::memory_order_relaxed);
+
+                    // one sample per stalled iteration
+                    if(since != 0 && since != pos->sampledSince_ && pos->isSlow(now - since))
+                    {
+                        pos->sampledSince_ = since;
+                        pthread_kill(pos->thread_, kStackSignal);
+                    }
+                }
+            }
+        }
+
+        std::mutex                  mutex_;
+        std::condition_variable     cond_;
+        std::vector<StallDetector*> detectors_;
+        std::thread                 thread_;
+        bool                        running_;
+    };
+#endif
+
+    StallDetector::StallDetector()
+        : thresholdNanos_(0),
+          busySince_(0),
+          stallCount_(0),
+          stackTrace_(false)
+    {
+#ifndef WIN32
+        thread_ = pthread_self();
+        sampledSince_ = 0;
+        frameCount_.store(0);
+        t_detector = this;
+#endif
+    }
+
+    StallDetector::~StallDetector()
+    {
+        enableStackTrace(false);
+#ifndef WIN32
+
+        if(t_detector == this)
+        {
+            t_detector = nullptr;
+        }
+
+#endif
+    }
+
+    void StallDetector::setThreshold(int64_t micros)
+    {
+        thresholdNanos_.store(micros * 1000, std::memory_order_relaxed);
+    }
+
+    void StallDetector::enableStackTrace(bool on)
+    {
+        if(on == stackTrace_)
+        {
+            return;
+        }
+
+#ifdef WIN32
+        LOG_PRINT(LogType_Warn, "StallDetector stack traces are not supported on this platform");
+#else
+
+        if(on)
+        {
+            static std::once_flag s_installed;
+            std::call_once(s_installed, []()
+            {
+                // the first backtrace() loads libgcc, keep that out of the handler
+                void* frame[1];
+                backtrace(frame, 1);
+
+                struct sigaction action;
+                memset(&action, 0, sizeof(action));
+                action.sa_handler = &StallDetector::handleStackSignal;
+                action.sa_flags = SA_RESTART;
+                sigemptyset(&action.sa_mask);
+                sigaction(kStackSignal, &action, nullptr);
+            });
+
+            StallWatchdog::instance().add(this);
+        }
+        else
+        {
+            StallWatchdog::instance().remove(this);
+        }
+
+        stackTrace_ = on;
+#endif
+    }
+
+    std::vector<SlowCallback> StallDetector::topOffenders() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return top_;
+    }
+
+    void StallDetector::beginIteration(int64_t nowNanos)
+    {
+        if(enabled())
+        {
+            busySince_.store(nowNanos, std::memory_order_relaxed);
+        }
+    }
+
+    void StallDetector::endIteration(int64_t nowNanos)
+    {
+        int64_t since = busySince_.load(std::memory_order_relaxed);
+
+        if(since == 0)
+        {
+            return;
+        }
+
+        busySince_.store(0, std::memory_order_relaxed);
+
+        if(isSlow(nowNanos - since))
+        {
+            stallCount_.store(stallCount_.load(std::memory_order_relaxed) + 1,
+                              std::memory_order_relaxed);
+            LOG_PRINT(LogType_Warn, "EventLoop iteration blocked for %lld us",
+                      (long long)(nowNanos - since) / 1000);
+        }
+
+#ifndef WIN32
+
+        if(frameCount_.load(std::memory_order_relaxed) > 0)
+        {
+            logStack();
+        }
+
+#endif
+    }
+
+    void StallDetector::recordSlow(const std::string& name, int64_t nanos)
+    {
+        LOG_PRINT(LogType_Warn, "slow callback %s took %lld us", name.c_str(),
+                  (long long)nanos / 1000);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find_if(top_.begin(), top_.end(), [&](const SlowCallback & entry)
+        {
+            return entry.name == name;
+        });
+
+        if(it != top_.end())
+        {
+            if(nanos <= it->nanos)
+            {
+                return;
+            }
+
+            top_.erase(it);
+        }
+        else if(top_.size() >= static_cast<size_t>(kTopCount) && nanos <= top_.back().nanos)
+        {
+            return;
+        }
+
+        SlowCallback entry;
+        entry.name = name;
+        entry.nanos = nanos;
+        entry.when = Timestamp::now();
+
+        auto pos = std::find_if(top_.begin(), top_.end(), [&](const SlowCallback & other)
+        {
+            return other.nanos < nanos;
+        });
+        top_.insert(pos, entry);
+
+        if(top_.size() > static_cast<size_t>(kTopCount))
+        {
+            top_.pop_back();
+        }
+    }
+
+#ifndef WIN32
+    void StallDetector::handleStackSignal(int)
+    {
+        StallDetector* detector = t_detector;
+
+        if(detector && detector->frameCount_.load(std::memory_order_relaxed) == 0)
+        {
+            int savedErrno = errno;
+            detector->frameCount_.store(backtrace(detector->frames_, kMaxFrames),
+                                        std::memory_order_relaxed);
+            errno = savedErrno;
+        }
+    }
+
+    void StallDetector::logStack()
+    {
+        int count = frameCount_.load(std::memory_order_relaxed);
+        char** symbols = backtrace_symbols(frames_, count);
+
+        LOG_PRINT(LogType_Warn, "EventLoop stack while stalled:");
+
+        for(int i = 0; symbols && i < count; ++i)
+        {
+            LOG_PRINT(LogType_Warn, "    #%d %s", i, symbols[i]);
+        }
+
+        free(symbols);
+        frameCount_.store(0, std::memory_order_relaxed);
+    }
+#else
+    void StallDetector::handleStackSignal(int)
+    {
+    }
+
+    void StallDetector::logStack()
+    {
+    }
+#endif
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/NonCopyable.h"
+#include "base/Timestamp.h"
+
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+namespace MuduoPlus
+{
+    struct SlowCallback
+    {
+        std::string name;       // channel name and fd, functor or timer type
+        int64_t     nanos;
+        Timestamp   when;
+    };
+
+    /// Finds the callbacks that block an EventLoop.
+    ///
+    /// The loop times every channel callback, pending functor and timer
+    /// and reports the ones slower than the threshold. With stack traces
+    /// enabled a watchdog thread signals the loop thread while an iteration
+    /// is still running over the threshold, so the logged stack is the one
+    /// that blocks, not the one after it. Stack traces are Linux only and
+    /// use SIGUSR2, a sleeping callback may see EINTR when it is sampled.
+    class StallDetector : NonCopyable
+    {
+    public:
+        static const int kTopCount = 16;
+        static const int kMaxFrames = 64;
+
+        StallDetector();
+        ~StallDetector();
+
+        /// 0 disables detection, which is the default.
+        void setThreshold(int64_t micros);
+        void enableStackTrace(bool on);
+
+        bool enabled() const
+        {
+            return thresholdNanos_.load(std::memory_order_relaxed) > 0;
+        }
+
+        bool isSlow(int64_t nanos) const
+        {
+            int64_t threshold = thresholdNanos_.load(std::memory_order_relaxed);
+            return threshold > 0 && nanos >= threshold;
+        }
+
+        /// Slowest callbacks seen so far, slowest first. Thread safe.
+        std::vector<SlowCallback> topOffenders() const;
+
+        uint64_t stallCount() const
+        {
+            return stallCount_.load(std::memory_order_relaxed);
+        }
+
+        // called by the loop thread
+        void beginIteration(int64_t nowNanos);
+        void endIteration(int64_t nowNanos);
+        void recordSlow(const std::string& name, int64_t nanos);
+
+    private:
+        friend class StallWatchdog;
+
+        static void handleStackSignal(int signo);
+        void logStack();
+
+        std::atomic<int64_t>        thresholdNanos_;
+        std::atomic<int64_t>        busySince_;     // start of the running iteration, 0 when idle
+        std::atomic<uint64_t>       stallCount_;
+        bool                        stackTrace_;
+
+        mutable std::mutex          mutex_;
+        std::vector<SlowCallback>   top_;
+
+#ifndef WIN32
+        pthread_t                   thread_;
+        int64_t                     sampledSince_;  // watchdog thread only
+        void*                       frames_[kMaxFrames];
+        std::atomic<int>            frameCount_;
+#endif
+    };
+}
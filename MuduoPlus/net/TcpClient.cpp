@@ -30,11 +30,31 @@ namespace MuduoPlus
           retry_(false),
           connect_(true),
           nextConnId_(1)
+    {
+        init();
+    }
+
+    TcpClient::TcpClient(EventLoop* loop,
+                         const std::string& host,
+                         uint16_t port,
+                         const std::string& nameArg)
+        : loop_(loop),
+          connector_(new Connector(loop, host, port)),
+          name_(nameArg),
+          connectionCallback_(defaultConnectionCallback),
+          messageCallback_(defaultMessageCallback),
+          retry_(false),
+          connect_(true),
+          nextConnId_(1)
+    {
+        init();
+    }
+
+    void TcpClient::init()
     {
         connector_->setNewConnectionCallback(
             std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
 
-        // FIXME setConnectFailedCallback
         LOG_PRINT(LogType_Info, "TcpClient::TcpClient[%s] - connector %p",
                   name_.c_str(), connector_.get());
     }
@@ -77,7 +97,7 @@ namespace MuduoPlus
     {
         // FIXME: check state
         LOG_PRINT(LogType_Info, "TcpClient::connect[%s] - connecting to %s",
-                  name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+                  name_.c_str(), connector_->serverName().c_str());
 
         connect_ = true;
         connector_->start();
@@ -86,17 +106,31 @@ namespace MuduoPlus
     void TcpClient::disconnect()
     {
         connect_ = false;
+        TcpConnectionPtr conn;
 
         {
             LockGuarder(mutex_);
+            conn = connection_;
+        }
 
-            if(connection_)
-            {
-                connection_->gracefulClose();
-            }
+        // in the loop thread the close runs right away and removeConnection
+        // takes the mutex
+        if(conn)
+        {
+            conn->gracefulClose();
         }
     }
 
+    void TcpClient::setSocketType(int type)
+    {
+        connector_->setSocketType(type);
+    }
+
+    void TcpClient::setConnectFailedCallback(const std::function<void()>& cb)
+    {
+        connector_->setConnectFailedCallback(cb);
+    }
+
     void TcpClient::stop()
     {
         connect_ = false;
@@ -107,7 +141,7 @@ namespace MuduoPlus
     {
         loop_->assertInLoopThread();
         InetAddress peerAddr(SocketOps::getPeerAddr(sockfd));
-        char buf[32];
+        char buf[128];
         snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
         ++nextConnId_;
         std::string connName = name_ + buf;
@@ -124,6 +158,15 @@ namespace MuduoPlus
         conn->setConnectionCallback(connectionCallback_);
         conn->setMessageCallback(messageCallback_);
         conn->setWriteCompleteCallback(writeCompleteCallback_);
+        conn->setFdCallback(fdCallback_);
+#ifdef MUDUO_HAVE_OPENSSL
+
+        if(tlsContext_)
+        {
+            conn->setTlsContext(tlsContext_, tlsServerName_);
+        }
+
+#endif
         conn->setCloseCallback(
             std::bind(&TcpClient::removeConnection, this, std::placeholders::_1)); // FIXME: unsafe
         {
@@ -149,7 +192,7 @@ namespace MuduoPlus
         if(retry_ && connect_)
         {
             LOG_PRINT(LogType_Info, "TcpClient::connect[%s] - Reconnecting to %s",
-                      name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+                      name_.c_str(), connector_->serverName().c_str());
 
             connector_->restart();
         }
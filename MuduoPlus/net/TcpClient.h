@@ -17,10 +17,17 @@ namespace MuduoPlus
     {
     public:
         // TcpClient(EventLoop* loop);
-        // TcpClient(EventLoop* loop, const string& host, uint16_t port);
         TcpClient(EventLoop* loop,
                   const InetAddress& serverAddr,
                   const std::string& nameArg);
+        /// host is resolved off the loop thread by Resolver on connect and
+        /// again on every reconnect. Lookups of all clients share the few
+        /// workers of Resolver::instance(), behind slow name servers they
+        /// queue and connecting takes as long.
+        TcpClient(EventLoop* loop,
+                  const std::string& host,
+                  uint16_t port,
+                  const std::string& nameArg);
         ~TcpClient();  // force out-line dtor, for scoped_ptr members.
 
         void connect();
@@ -72,7 +79,35 @@ namespace MuduoPlus
             writeCompleteCallback_ = cb;
         }
 
+        /// Set callback for descriptors passed over unix connections.
+        /// Not thread safe.
+        void setFdCallback(const FdCallback& cb)
+        {
+            fdCallback_ = cb;
+        }
+
+        /// SOCK_STREAM by default, SOCK_SEQPACKET for unix addresses.
+        /// Must be called before @c connect
+        void setSocketType(int type);
+
+        /// Called in the loop thread each time a round of connect attempts
+        /// failed, connect() keeps retrying unless stop() is called.
+        void setConnectFailedCallback(const std::function<void()>& cb);
+
+#ifdef MUDUO_HAVE_OPENSSL
+        /// Connects with TLS, the connection callback runs once the
+        /// handshake finished. serverName is sent as SNI and checked against
+        /// the server's certificate, usually the host connected to.
+        /// Not thread safe, before @c connect
+        void setTlsContext(const TlsContextPtr& context, const std::string& serverName)
+        {
+            tlsContext_ = context;
+            tlsServerName_ = serverName;
+        }
+#endif
+
     private:
+        void init();
         /// Not thread safe, but in loop
         void newConnection(int sockfd);
         /// Not thread safe, but in loop
@@ -84,12 +119,17 @@ namespace MuduoPlus
         ConnectionCallback connectionCallback_;
         MessageCallback messageCallback_;
         WriteCompleteCallback writeCompleteCallback_;
+        FdCallback fdCallback_;
         bool retry_;   // atomic
         bool connect_; // atomic
         // always in loop thread
         int nextConnId_;
         std::mutex mutex_;
         TcpConnectionPtr connection_; // @GuardedBy mutex_
+#ifdef MUDUO_HAVE_OPENSSL
+        TlsContextPtr tlsContext_;
+        std::string tlsServerName_;
+#endif
     };
 
 }
\ No newline at end of file
@@ -1,10 +1,46 @@
+#include <algorithm>
+#include <limits.h>
+
 #include "base/Logger.h"
 #include "TcpConnection.h"
 #include "Channel.h"
+#include "DeadlineWheel.h"
 #include "EventLoop.h"
 
 namespace MuduoPlus
 {
+    namespace
+    {
+        // moves *next to from + micros if that is earlier, micros 0 is off
+        void earliestDeadline(Timestamp* next, Timestamp from, int64_t micros)
+        {
+            if(micros > 0)
+            {
+                Timestamp deadline(from.microSecondsSinceEpoch() + micros);
+
+                if(!next->valid() || deadline < *next)
+                {
+                    *next = deadline;
+                }
+            }
+        }
+
+        const char* deadlineName(DeadlineKind kind)
+        {
+            switch(kind)
+            {
+            case kDeadlineReadIdle:
+                return "read idle";
+
+            case kDeadlineWriteIdle:
+                return "write idle";
+
+            default:
+                return "lifetime";
+            }
+        }
+    }
+
     void defaultConnectionCallback(const TcpConnectionPtr& conn)
     {
         LOG_PRINT(LogType_Info, "%s -> %s is %s", conn->localAddress().toIpPort().c_str(),
@@ -31,7 +67,34 @@ namespace MuduoPlus
           localAddr_(localAddr),
           peerAddr_(peerAddr),
           highWaterMark_(64 * 1024 * 1024),
-          reading_(true)
+          lowWaterMark_(0),
+          aboveHighWaterMark_(false),
+          reading_(true),
+          reportedInputBytes_(0),
+          reportedOutputBytes_(0),
+          bytesSent_(0),
+          segmentBytes_(0),
+          completionIo_(false),
+          inputHeld_(false),
+          inputEnded_(false),
+          heldInputQueued_(false),
+          zeroCopyEnabled_(false),
+          zeroCopyCopied_(false),
+          zeroCopyThreshold_(0),
+          zeroCopySeq_(0),
+          flushQueued_(false),
+          readIdleMicros_(0),
+          writeIdleMicros_(0),
+          lifetimeMicros_(0),
+          readThrottled_(false),
+          writeThrottled_(false),
+          messagesThrottled_(false),
+          sendQueueLimit_(0),
+          overflowPolicy_(kOverflowDrop),
+          droppedSends_(0),
+          outputBytes_(0),
+          crossThreadBytes_(0),
+          blockedSenders_(0)
     {
         channel_->setReadCallback(
             std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
@@ -40,6 +103,7 @@ namespace MuduoPlus
         channel_->setErrorCallback(
             std::bind(&TcpConnection::handleError, this));
         channel_->setEndCallback(std::bind(&TcpConnection::handleEnd, this));
+        channel_->setName(name_);
 
         SocketOps::setKeepAlive(fd_, true);
     }
@@ -73,11 +137,17 @@ namespace MuduoPlus
             }
             else
             {
+                // counts the message in crossThreadBytes_
+                waitForSendQueue(message.size());
+
+                // the caller's memory is gone by the time the loop runs it
                 auto selfPtr = shared_from_this();
+                std::string data = message.as_string();
 
                 loop_->runInLoop([ = ]()
                 {
-                    selfPtr->sendInLoop(message.as_string());
+                    selfPtr->crossThreadBytes_ -= data.size();
+                    selfPtr->sendInLoop(data);
                 });
             }
         }
@@ -98,10 +168,146 @@ namespace MuduoPlus
 
     void TcpConnection::sendInLoop(const StringPiece& message)
     {
-        sendInLoop(message.data(), message.size());
+        if(admitSend(message.size()))
+        {
+            sendInLoop(message.data(), message.size());
+        }
+    }
+
+    bool TcpConnection::admitSend(size_t len)
+    {
+        size_t limit = sendQueueLimit_.load(std::memory_order_relaxed);
+        size_t pending = pendingOutputBytes();
+
+        if(limit == 0 || pending == 0 || pending + len <= limit
+                || overflowPolicy_ == kOverflowBlock)
+        {
+            return true;
+        }
+
+        if(overflowPolicy_ == kOverflowClose)
+        {
+            LOG_PRINT(LogType_Warn, "TcpConnection[%s] send queue over %u bytes, closing",
+                      name_.c_str(), (unsigned)limit);
+            forceClose();
+        }
+        else
+        {
+            droppedSends_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return false;
+    }
+
+    void TcpConnection::waitForSendQueue(size_t len)
+    {
+        size_t limit = sendQueueLimit_.load(std::memory_order_relaxed);
+
+        // a thread running a loop is never blocked, its own connections and
+        // timers would stall and two relays sending to each other deadlock,
+        // its messages are queued over the limit instead
+        if(limit == 0 || overflowPolicy_ != kOverflowBlock
+                || EventLoop::getEventLoopOfCurrentThread() != NULL)
+        {
+            crossThreadBytes_ += len;
+            return;
+        }
+
+        // the room is taken under the lock, so senders woken together do
+        // not all pass on the same free bytes
+        std::unique_lock<std::mutex> lock(sendQueueMutex_);
+        ++blockedSenders_;
+        sendQueueCond_.wait(lock, [ &]()
+        {
+            return state_ != kConnected || outputBytes_ + crossThreadBytes_ < limit;
+        });
+        --blockedSenders_;
+        crossThreadBytes_ += len;
+    }
+
+    void TcpConnection::setSendQueueLimit(size_t bytes, OverflowPolicy policy)
+    {
+        overflowPolicy_ = policy;
+        sendQueueLimit_ = bytes;
+
+        if(loop_->isInLoopThread())
+        {
+            outputBytes_ = pendingOutputBytes();
+        }
+    }
+
+    void TcpConnection::checkHighWaterMark(size_t oldLen, size_t newLen)
+    {
+        if(newLen < highWaterMark_ || oldLen >= highWaterMark_)
+        {
+            return;
+        }
+
+        if(highWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), newLen));
+        }
+
+        if(!aboveHighWaterMark_)
+        {
+            aboveHighWaterMark_ = true;
+
+            if(TcpConnectionPtr source = backpressureSource_.lock())
+            {
+                source->stopRead();
+            }
+        }
+    }
+
+    void TcpConnection::checkLowWaterMark()
+    {
+        size_t pending = pendingOutputBytes();
+
+        if(!aboveHighWaterMark_ || pending > lowWaterMark_)
+        {
+            return;
+        }
+
+        aboveHighWaterMark_ = false;
+
+        if(lowWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(lowWaterMarkCallback_, shared_from_this(), pending));
+        }
+
+        if(TcpConnectionPtr source = backpressureSource_.lock())
+        {
+            source->startRead();
+        }
     }
 
     void TcpConnection::sendInLoop(const void* data, int len)
+    {
+#ifdef MUDUO_HAVE_OPENSSL
+
+        // once the kernel encrypts, plaintext goes to the socket as is
+        if(tls_ && !tls_->kernelTx())
+        {
+            if(len > 0 && state_ != kDisconnected)
+            {
+                if(tls_->write(data, static_cast<size_t>(len)))
+                {
+                    writeTlsOutput();
+                }
+                else
+                {
+                    sockErrorOccurred_ = true;
+                }
+            }
+
+            return;
+        }
+
+#endif
+        writeInLoop(data, len);
+    }
+
+    void TcpConnection::writeInLoop(const void* data, int len)
     {
         if(len <= 0)
         {
@@ -118,15 +324,18 @@ namespace MuduoPlus
 
         int sendCount = 0;
         int remainCount = len;
+        bool deferred = loop_->deferredFlush();
 
         // if no thing in output queue, try writing directly
-        if(!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+        if(!deferred && !completionIo_ && !writeThrottled_ && !channel_->isWriting()
+                && outputBuffer_.readableBytes() == 0 && outputSegments_.empty())
         {
             sendCount = SocketOps::send(channel_->fd(), data, len);
 
             if(sendCount >= 0)
             {
                 remainCount = len - sendCount;
+                wrote(sendCount);
 
                 if(remainCount == 0 && writeCompleteCallback_)
                 {
@@ -148,28 +357,42 @@ namespace MuduoPlus
 
         if(!sockErrorOccurred_ && remainCount > 0)
         {
-            size_t oldLen = outputBuffer_.readableBytes();
+            size_t oldLen = pendingOutputBytes();
+            checkHighWaterMark(oldLen, oldLen + remainCount);
 
-            if(oldLen + remainCount >= highWaterMark_
-                    && oldLen < highWaterMark_
-                    && highWaterMarkCallback_)
+            if(outputSegments_.empty())
             {
-                loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remainCount));
+                outputBuffer_.append(static_cast<const char*>(data) + sendCount, remainCount);
+            }
+            else
+            {
+                std::shared_ptr<std::string> copy =
+                    std::make_shared<std::string>(static_cast<const char*>(data) + sendCount, remainCount);
+                OutputSegment segment = { copy, copy->data(), copy->size(), 0, false };
+                outputSegments_.push_back(segment);
+                segmentBytes_ += remainCount;
             }
-
-            outputBuffer_.append(static_cast<const char*>(data) + sendCount, remainCount);
 
             if(!channel_->isWriting())
             {
-                channel_->enableWriting();
+                if(deferred)
+                {
+                    queueFlush();
+                }
+                else
+                {
+                    enableWriting();
+                }
             }
+
+            updateBufferMetrics();
         }
 
         if(!sockErrorOccurred_)
         {
             if(remainCount == 0)
             {
-                LOG_PRINT(LogType_Debug, "send over");
+                LOG_DEBUG("send over");
 
                 if(state_ == kDisconnecting)
                 {
@@ -179,161 +402,1145 @@ namespace MuduoPlus
         }
     }
 
-    void TcpConnection::gracefulClose()
+    void TcpConnection::sendFd(int fd, const StringPiece& message)
     {
-        if(state_ == kConnected)
+#ifndef WIN32
+        assert(message.size() > 0);
+
+        if(state_ != kConnected || message.size() <= 0)
+        {
+            return;
+        }
+
+        // the duplicate lives until the kernel has taken it
+        int passFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+
+        if(passFd < 0)
+        {
+            LOG_PRINT(LogType_Error, "dup fd[%d] failed:%s", fd, GetLastErrorText().c_str());
+            return;
+        }
+
+        if(loop_->isInLoopThread())
+        {
+            sendFdInLoop(passFd, message.as_string());
+        }
+        else
         {
-            setState(kDisconnecting);
             auto selfPtr = shared_from_this();
+            std::string data = message.as_string();
 
             loop_->runInLoop([ = ]()
             {
-                selfPtr->shutdownInLoop();
+                selfPtr->sendFdInLoop(passFd, data);
             });
         }
+
+#else
+        LOG_PRINT(LogType_Error, "fd passing needs unix sockets");
+#endif
     }
 
-    void TcpConnection::shutdownInLoop()
+    void TcpConnection::sendFdInLoop(int fd, const std::string& message)
     {
-        if(state_ == kConnected && channel_->isWriting())
+#ifndef WIN32
+        loop_->assertInLoopThread();
+
+        if(state_ == kDisconnected || sockErrorOccurred_)
         {
+            LOG_PRINT(LogType_Warn, "disconnected, give up passing fd");
+            SocketOps::closeSocket(fd);
             return;
         }
 
-        loop_->assertInLoopThread();
-        assert(!channel_->isWriting());
-        userClosed_ = true;
-        //if (!channel_->isWriting())
+        // nothing queued, the descriptor can go right now
+        if(!channel_->isWriting() && !writeThrottled_ && outputBuffer_.readableBytes() == 0
+                && !flushQueued_)
         {
-            //SocketOps::ShutdownWrite(fd_);
-            releaseConnection();
+            int sendCount = SocketOps::sendWithFd(fd_, message.data(),
+                                                  static_cast<int>(message.size()), fd);
+
+            if(sendCount > 0)
+            {
+                SocketOps::closeSocket(fd);
+                wrote(sendCount);
+
+                if(static_cast<size_t>(sendCount) < message.size())
+                {
+                    sendInLoop(message.data() + sendCount,
+                               static_cast<int>(message.size()) - sendCount);
+                }
+                else if(writeCompleteCallback_)
+                {
+                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                }
+
+                return;
+            }
+
+            if(!ERR_RW_RETRIABLE(GetLastErrorCode()))
+            {
+                LOG_PRINT(LogType_Error, "fd[%d] passing fd failed:%s",
+                          fd_, GetLastErrorText().c_str());
+                SocketOps::closeSocket(fd);
+                sockErrorOccurred_ = true;
+                return;
+            }
         }
-    }
 
-    void TcpConnection::forceClose()
-    {
-        if(state_ == kConnected || state_ == kDisconnecting)
+        pendingFds_.push_back(std::make_pair(bytesSent_ + outputBuffer_.readableBytes(), fd));
+        outputBuffer_.append(message.data(), message.size());
+
+        if(!channel_->isWriting())
         {
-            setState(kDisconnecting);
-            loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+            enableWriting();
         }
+
+        updateBufferMetrics();
+#endif
     }
 
-    void TcpConnection::forceCloseWithDelay(double seconds)
+    void TcpConnection::sendShared(const SharedPayload& payload)
     {
-        if(state_ == kConnected || state_ == kDisconnecting)
+        if(payload)
         {
-            setState(kDisconnecting);
-            auto selfPtr = shared_from_this();
-            loop_->runAfter(seconds, [ = ]()
-            {
-                selfPtr->forceClose();
-            });
+            sendShared(payload, payload->data(), payload->size());
         }
     }
 
-    void TcpConnection::forceCloseInLoop()
-    {
-        loop_->assertInLoopThread();
-        userClosed_ = true;
-
-        releaseConnection();
-    }
-
-    void TcpConnection::releaseConnection()
+    void TcpConnection::sendShared(const std::shared_ptr<const void>& owner, const char* data,
+                                   size_t size)
     {
-        if(state_ == kConnected || state_ == kDisconnecting)
+        if(state_ == kConnected && size > 0)
         {
-            setState(kDisconnected);
-            channel_->disableAll();
-            channel_->remove();
-
-            if(closeCallback_)
+            if(loop_->isInLoopThread())
             {
-                closeCallback_(shared_from_this());
-                closeCallback_ = nullptr;
+                sendSharedInLoop(owner, data, size);
+            }
+            else
+            {
+                auto selfPtr = shared_from_this();
+
+                loop_->runInLoop([ = ]()
+                {
+                    selfPtr->sendSharedInLoop(owner, data, size);
+                });
             }
         }
     }
 
-    const char* TcpConnection::stateToString() const
+    void TcpConnection::sendSharedInLoop(const std::shared_ptr<const void>& owner, const char* data,
+                                         size_t size)
     {
-        switch(state_)
-        {
-            case kDisconnected:
-                return "kDisconnected";
+        loop_->assertInLoopThread();
 
-            case kConnecting:
-                return "kConnecting";
+        if(state_ == kDisconnected || sockErrorOccurred_)
+        {
+            LOG_PRINT(LogType_Warn, "disconnected, give up writing");
+            return;
+        }
 
-            case kConnected:
-                return "kConnected";
+#ifdef MUDUO_HAVE_OPENSSL
+        bool encrypting = tls_ && !tls_->kernelTx();
+#else
+        bool encrypting = false;
+#endif
+        bool zeroCopy = zeroCopyThreshold_ > 0 && !zeroCopyCopied_ && size >= zeroCopyThreshold_;
 
-            case kDisconnecting:
-                return "kDisconnecting";
+        if(!admitSend(size))
+        {
+            return;
+        }
 
-            default:
-                return "unknown state";
+        // descriptor passing counts offsets in outputBuffer_ only, TLS
+        // encrypts into it
+        if((localAddr_.isUnix() || encrypting) && size <= INT_MAX)
+        {
+            sendInLoop(data, static_cast<int>(size));
+            return;
         }
-    }
 
-    void TcpConnection::setTcpNoDelay(bool on)
-    {
-        SocketOps::setTcpNoDelay(fd_, on);
-    }
+        size_t oldLen = pendingOutputBytes();
+        checkHighWaterMark(oldLen, oldLen + size);
 
-    void TcpConnection::startRead()
-    {
-        auto selfPtr = shared_from_this();
+        OutputSegment segment = { owner, data, size, 0, zeroCopy };
+        outputSegments_.push_back(segment);
+        segmentBytes_ += size;
+        updateBufferMetrics();
 
-        loop_->runInLoop([ = ]()
+        // not writing means handleWrite is not draining the queue
+        if(!channel_->isWriting())
         {
-            selfPtr->startReadInLoop();
-        });
+            if(loop_->deferredFlush())
+            {
+                queueFlush();
+            }
+            else if(writeQueued())
+            {
+                if(writeCompleteCallback_)
+                {
+                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                }
+            }
+            else if(!sockErrorOccurred_)
+            {
+                enableWriting();
+            }
+        }
     }
 
-    void TcpConnection::startReadInLoop()
+    bool TcpConnection::writeQueued()
     {
-        loop_->assertInLoopThread();
-
-        if(!reading_ || !channel_->isReading())
+        if(writeThrottled_)
         {
-            channel_->enableReading();
-            reading_ = true;
+            return false;
         }
-    }
 
-    void TcpConnection::stopRead()
-    {
-        auto selfPtr = shared_from_this();
+#ifndef WIN32
 
-        loop_->runInLoop([ = ]()
+        // the poller sends, handleWrite gets the result
+        if(completionIo_)
         {
-            selfPtr->stopReadInLoop();
-        });
-    }
+            return submitQueued();
+        }
 
-    void TcpConnection::stopReadInLoop()
-    {
-        loop_->assertInLoopThread();
+#endif
 
-        if(reading_ || channel_->isReading())
+        // passed descriptors cut the buffer into separate writes
+        if(!pendingFds_.empty())
         {
-            channel_->disableReading();
-            reading_ = false;
+            return writeWithFds();
         }
-    }
 
-    void TcpConnection::connectEstablished()
-    {
-        auto selfPtr = shared_from_this();
-        assert(state_ == kConnecting);
+        while(outputBuffer_.readableBytes() > 0 || !outputSegments_.empty())
+        {
+            size_t total = 0;
+            int n = -1;
+
+#ifdef MUDUO_HAVE_ZEROCOPY
+
+            if(outputBuffer_.readableBytes() == 0 && outputSegments_.front().zeroCopy
+                    && !zeroCopyCopied_)
+            {
+                OutputSegment& segment = outputSegments_.front();
+                const char* data = segment.data + segment.offset;
+                total = std::min<size_t>(segment.size - segment.offset, INT_MAX);
+                n = SocketOps::sendZeroCopy(fd_, data, static_cast<int>(total));
+
+                if(n >= 0)
+                {
+                    zeroCopyInflight_.push_back(std::make_pair(zeroCopySeq_++, segment.owner));
+                }
+                else if(GetLastErrorCode() == ENOBUFS)
+                {
+                    // out of notification memory, copy this one
+                    n = SocketOps::send(fd_, data, static_cast<int>(total));
+                }
+            }
+            else
+#endif
+            {
+#ifndef WIN32
+                // the buffer and the plain segments behind it in one writev
+                struct iovec vec[kMaxWriteIovecs];
+                int count = 0;
+
+                if(outputBuffer_.readableBytes() > 0)
+                {
+                    vec[0].iov_base = const_cast<char*>(outputBuffer_.peek());
+                    vec[0].iov_len = std::min<size_t>(outputBuffer_.readableBytes(), INT_MAX);
+                    total = vec[0].iov_len;
+                    count = 1;
+                }
+
+                count = gatherSegments(vec, count, &total);
+                n = SocketOps::writev(fd_, vec, count);
+#else
+                const char* data = outputBuffer_.peek();
+                total = outputBuffer_.readableBytes();
+
+                if(total == 0)
+                {
+                    OutputSegment& segment = outputSegments_.front();
+                    data = segment.data + segment.offset;
+                    total = segment.size - segment.offset;
+                }
+
+                total = std::min<size_t>(total, INT_MAX);
+                n = SocketOps::send(fd_, data, static_cast<int>(total));
+#endif
+            }
+
+            if(n < 0)
+            {
+                if(!ERR_RW_RETRIABLE(GetLastErrorCode()))
+                {
+                    LOG_PRINT(LogType_Error, "fd[%d] send failed:%s", fd_, GetLastErrorText().c_str());
+                    sockErrorOccurred_ = true;
+                }
+
+                return false;
+            }
+
+            retrieveOutput(n);
+            wrote(n);
+            checkLowWaterMark();
+            updateBufferMetrics();
+
+            if(static_cast<size_t>(n) < total)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+#ifndef WIN32
+    int TcpConnection::gatherSegments(struct iovec* vec, int count, size_t* total)
+    {
+        // the plain segments up to a zero copy one, behind what vec holds
+        for(auto it = outputSegments_.begin();
+                it != outputSegments_.end() && count < kMaxWriteIovecs; ++it)
+        {
+            size_t len = it->size - it->offset;
+
+            if((it->zeroCopy && !zeroCopyCopied_) || (count > 0 && *total + len > INT_MAX))
+            {
+                break;
+            }
+
+            vec[count].iov_base = const_cast<char*>(it->data + it->offset);
+            vec[count].iov_len = std::min<size_t>(len, INT_MAX);
+            *total += vec[count].iov_len;
+            ++count;
+        }
+
+        return count;
+    }
+
+    bool TcpConnection::submitQueued()
+    {
+        // one send at a time, the memory it points to stays unchanged
+        // until handleWrite got the result
+        if(channel_->isWriting() || sockErrorOccurred_)
+        {
+            return false;
+        }
+
+        if(inflightBuffer_.readableBytes() == 0)
+        {
+            inflightBuffer_.swap(outputBuffer_);
+        }
+
+        struct iovec vec[kMaxWriteIovecs];
+        int count = 0;
+        size_t total = 0;
+
+        if(inflightBuffer_.readableBytes() > 0)
+        {
+            vec[0].iov_base = const_cast<char*>(inflightBuffer_.peek());
+            vec[0].iov_len = std::min<size_t>(inflightBuffer_.readableBytes(), INT_MAX);
+            total = vec[0].iov_len;
+            count = 1;
+        }
+
+        // output appended meanwhile comes before the segments
+        if(outputBuffer_.readableBytes() == 0)
+        {
+            count = gatherSegments(vec, count, &total);
+        }
+
+        if(count == 0)
+        {
+            return true;
+        }
+
+        if(!loop_->submitSend(channel_.get(), vec, count))
+        {
+            LOG_PRINT(LogType_Error, "fd[%d] send not submitted", fd_);
+            sockErrorOccurred_ = true;
+            return false;
+        }
+
+        channel_->enableWriting();
+        return false;
+    }
+#endif
+
+    bool TcpConnection::completeSend()
+    {
+        int n = channel_->writeResult();
+        channel_->disableWriting();
+
+        if(n < 0)
+        {
+            if(!ERR_RW_RETRIABLE(-n))
+            {
+                LOG_PRINT(LogType_Error, "fd[%d] send failed:%s", fd_, GetErrorText(-n).c_str());
+                sockErrorOccurred_ = true;
+                return false;
+            }
+
+            n = 0;
+        }
+
+        retrieveOutput(n);
+        wrote(n);
+        checkLowWaterMark();
+        updateBufferMetrics();
+        return true;
+    }
+
+    void TcpConnection::retrieveOutput(size_t n)
+    {
+        // a completed send came from inflightBuffer_
+        Buffer& sent = completionIo_ ? inflightBuffer_ : outputBuffer_;
+        size_t fromBuffer = std::min(n, sent.readableBytes());
+        sent.retrieve(fromBuffer);
+        n -= fromBuffer;
+
+        while(n > 0)
+        {
+            OutputSegment& segment = outputSegments_.front();
+            size_t len = std::min(n, segment.size - segment.offset);
+            segment.offset += len;
+            segmentBytes_ -= len;
+            n -= len;
+
+            if(segment.offset == segment.size)
+            {
+                outputSegments_.pop_front();
+            }
+        }
+    }
+
+    bool TcpConnection::writeWithFds()
+    {
+        size_t len = outputBuffer_.readableBytes();
+        int passFd = -1;
+
+        // a passed descriptor goes with the first byte of its message,
+        // so a write stops right before the next one
+        if(!pendingFds_.empty())
+        {
+            if(pendingFds_.front().first == bytesSent_)
+            {
+                passFd = pendingFds_.front().second;
+
+                if(pendingFds_.size() > 1)
+                {
+                    len = std::min<size_t>(len, pendingFds_[1].first - bytesSent_);
+                }
+            }
+            else
+            {
+                len = std::min<size_t>(len, pendingFds_.front().first - bytesSent_);
+            }
+        }
+
+#ifndef WIN32
+        int n = passFd >= 0
+                ? SocketOps::sendWithFd(channel_->fd(), outputBuffer_.peek(), static_cast<int>(len), passFd)
+                : SocketOps::send(channel_->fd(), outputBuffer_.peek(), static_cast<int>(len));
+#else
+        int n = SocketOps::send(channel_->fd(), outputBuffer_.peek(), static_cast<int>(len));
+#endif
+
+        if(n > 0)
+        {
+            if(passFd >= 0)
+            {
+                SocketOps::closeSocket(passFd);
+                pendingFds_.pop_front();
+            }
+
+            outputBuffer_.retrieve(n);
+            wrote(n);
+            checkLowWaterMark();
+            updateBufferMetrics();
+        }
+        else
+        {
+            if(!ERR_RW_RETRIABLE(GetLastErrorCode()))
+            {
+                sockErrorOccurred_ = true;
+                LOG_PRINT(LogType_Error, "TcpConnection::handleWrite");
+            }
+        }
+
+        return outputBuffer_.readableBytes() == 0;
+    }
+
+    void TcpConnection::flush()
+    {
+        auto selfPtr = shared_from_this();
+
+        loop_->runInLoop([ = ]()
+        {
+            selfPtr->flushInLoop();
+        });
+    }
+
+    void TcpConnection::queueFlush()
+    {
+        if(!flushQueued_)
+        {
+            flushQueued_ = true;
+            loop_->runAtIterationEnd(std::bind(&TcpConnection::flushInLoop, shared_from_this()));
+        }
+    }
+
+    void TcpConnection::flushInLoop()
+    {
+        loop_->assertInLoopThread();
+        flushQueued_ = false;
+
+        // while writing handleWrite drains the queue
+        if(state_ == kDisconnected || sockErrorOccurred_ || channel_->isWriting()
+                || pendingOutputBytes() == 0)
+        {
+            return;
+        }
+
+        if(writeQueued())
+        {
+            if(writeCompleteCallback_)
+            {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+
+            if(state_ == kDisconnecting)
+            {
+                shutdownInLoop();
+            }
+        }
+        else if(!sockErrorOccurred_)
+        {
+            enableWriting();
+        }
+    }
+
+    bool TcpConnection::setZeroCopyThreshold(size_t threshold)
+    {
+        loop_->assertInLoopThread();
+
+        // the socket error queue with the completions is not polled then
+        if(completionIo_ && threshold > 0)
+        {
+            return false;
+        }
+
+#ifdef MUDUO_HAVE_OPENSSL
+
+        // kernel TLS takes no MSG_ZEROCOPY, OpenSSL copies anyway
+        if(tls_ && threshold > 0)
+        {
+            return false;
+        }
+
+#endif
+#ifdef MUDUO_HAVE_ZEROCOPY
+
+        if(threshold > 0 && !zeroCopyEnabled_)
+        {
+            if(localAddr_.isUnix() || SocketOps::setZeroCopy(fd_, true) < 0)
+            {
+                LOG_PRINT(LogType_Warn, "TcpConnection[%s] SO_ZEROCOPY not supported:%s",
+                          name_.c_str(), GetLastErrorText().c_str());
+                return false;
+            }
+
+            zeroCopyEnabled_ = true;
+        }
+
+        zeroCopyThreshold_ = threshold;
+        return true;
+#else
+        return threshold == 0;
+#endif
+    }
+
+    void TcpConnection::handleZeroCopyCompletion(uint32_t lo, uint32_t hi, bool copied)
+    {
+        if(copied && !zeroCopyCopied_)
+        {
+            LOG_PRINT(LogType_Info, "TcpConnection[%s] kernel copied zero copy sends, "
+                      "using plain sends", name_.c_str());
+            zeroCopyCopied_ = true;
+        }
+
+        // [lo, hi] may wrap around
+        for(auto it = zeroCopyInflight_.begin(); it != zeroCopyInflight_.end();)
+        {
+            if(it->first - lo <= hi - lo)
+            {
+                it = zeroCopyInflight_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void TcpConnection::closePendingFds()
+    {
+        for(auto &pos : pendingFds_)
+        {
+            SocketOps::closeSocket(pos.second);
+        }
+
+        pendingFds_.clear();
+    }
+
+    void TcpConnection::gracefulClose()
+    {
+        if(state_ == kConnected)
+        {
+            setState(kDisconnecting);
+            auto selfPtr = shared_from_this();
+
+            loop_->runInLoop([ = ]()
+            {
+                selfPtr->shutdownInLoop();
+            });
+        }
+    }
+
+    void TcpConnection::shutdownInLoop()
+    {
+#ifdef MUDUO_HAVE_OPENSSL
+
+        // close_notify goes out after the queued output
+        if(tls_ && state_ == kDisconnecting)
+        {
+            tls_->shutdown();
+            writeTlsOutput();
+        }
+
+#endif
+
+        // handleWrite, the deferred flush or the last zero copy completion
+        // calls again
+        if(channel_->isWriting() || flushQueued_ || !zeroCopyInflight_.empty()
+                || (writeThrottled_ && pendingOutputBytes() > 0))
+        {
+            return;
+        }
+
+        loop_->assertInLoopThread();
+        assert(!channel_->isWriting());
+#ifdef MUDUO_HAVE_OPENSSL
+
+        // with the output written the kernel can encrypt close_notify
+        if(tls_ && state_ == kDisconnecting)
+        {
+            tls_->shutdownKernelTx(fd_);
+        }
+
+#endif
+        userClosed_ = true;
+        //if (!channel_->isWriting())
+        {
+            //SocketOps::ShutdownWrite(fd_);
+            releaseConnection();
+        }
+    }
+
+    void TcpConnection::forceClose()
+    {
+        if(state_ == kConnected || state_ == kDisconnecting)
+        {
+            setState(kDisconnecting);
+            loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+        }
+    }
+
+    void TcpConnection::setReadIdleTimeout(double seconds)
+    {
+        readIdleMicros_ = static_cast<int64_t>(seconds * Timestamp::kMicroSecPerSec);
+        armDeadlines();
+    }
+
+    void TcpConnection::setWriteIdleTimeout(double seconds)
+    {
+        writeIdleMicros_ = static_cast<int64_t>(seconds * Timestamp::kMicroSecPerSec);
+        armDeadlines();
+    }
+
+    void TcpConnection::setLifetime(double seconds)
+    {
+        lifetimeMicros_ = static_cast<int64_t>(seconds * Timestamp::kMicroSecPerSec);
+        armDeadlines();
+    }
+
+    void TcpConnection::armDeadlines()
+    {
+        // a graceful close waits for throttled output
+        if(state_ != kConnected && state_ != kDisconnecting)
+        {
+            return;
+        }
+
+        Timestamp next = throttledUntil_;
+
+        if(state_ == kConnected)
+        {
+            earliestDeadline(&next, lastReadTime_, readIdleMicros_);
+            earliestDeadline(&next, lastWriteTime_, writeIdleMicros_);
+            earliestDeadline(&next, establishedTime_, lifetimeMicros_);
+        }
+
+        // an entry that comes up earlier rechecks then, a later one is
+        // left in the wheel and ignored
+        if(!next.valid() || (armedDeadline_.valid() && !(next < armedDeadline_)))
+        {
+            return;
+        }
+
+        armedDeadline_ = next;
+        loop_->deadlineWheel().add(shared_from_this(), next);
+    }
+
+    void TcpConnection::checkDeadlines(Timestamp armed, Timestamp now)
+    {
+        if(!(armed == armedDeadline_))
+        {
+            return;
+        }
+
+        armedDeadline_ = Timestamp::invalid();
+
+        if(state_ == kDisconnected)
+        {
+            return;
+        }
+
+        if(throttledUntil_.valid() && !(now < throttledUntil_))
+        {
+            throttledUntil_ = Timestamp::invalid();
+            resumeThrottled();
+        }
+
+        if(lifetimeMicros_ > 0 && microSecondDifference(now, establishedTime_) >= lifetimeMicros_)
+        {
+            lifetimeMicros_ = 0;
+            fireDeadline(kDeadlineLifetime);
+        }
+
+        if(readIdleMicros_ > 0 && microSecondDifference(now, lastReadTime_) >= readIdleMicros_)
+        {
+            lastReadTime_ = now;
+            fireDeadline(kDeadlineReadIdle);
+        }
+
+        if(writeIdleMicros_ > 0 && microSecondDifference(now, lastWriteTime_) >= writeIdleMicros_)
+        {
+            lastWriteTime_ = now;
+            fireDeadline(kDeadlineWriteIdle);
+        }
+
+        armDeadlines();
+    }
+
+    void TcpConnection::fireDeadline(DeadlineKind kind)
+    {
+        if(state_ != kConnected)
+        {
+            return;
+        }
+
+        if(deadlineCallback_)
+        {
+            deadlineCallback_(shared_from_this(), kind);
+        }
+        else
+        {
+            LOG_PRINT(LogType_Info, "TcpConnection[%s] %s deadline passed, closing",
+                      name_.c_str(), deadlineName(kind));
+            forceClose();
+        }
+    }
+
+    void TcpConnection::addRateLimiter(RateLimitKind kind, const TokenBucketPtr& bucket)
+    {
+        rateLimiters_[kind].push_back(bucket);
+    }
+
+    bool TcpConnection::chargeMessages(size_t n)
+    {
+        loop_->assertInLoopThread();
+        int64_t wait = chargeLimiters(kLimitMessages, n);
+
+        if(wait == 0)
+        {
+            return true;
+        }
+
+        messagesThrottled_ = true;
+        throttleRead(wait);
+        return false;
+    }
+
+    void TcpConnection::wrote(size_t n)
+    {
+        bytesSent_ += n;
+        lastWriteTime_ = loop_->cachedNow();
+        loop_->metrics().bytesWritten.add(n);
+
+        if(!rateLimiters_[kLimitWriteBytes].empty())
+        {
+            int64_t wait = chargeLimiters(kLimitWriteBytes, n);
+
+            if(wait > 0)
+            {
+                throttleWrite(wait);
+            }
+        }
+    }
+
+    int64_t TcpConnection::chargeLimiters(RateLimitKind kind, size_t n)
+    {
+        int64_t wait = 0;
+
+        for(auto &bucket : rateLimiters_[kind])
+        {
+            wait = std::max(wait, bucket->take(static_cast<double>(n), loop_->cachedNow()));
+        }
+
+        return wait;
+    }
+
+    size_t TcpConnection::readAllowance()
+    {
+        double allowance = 0;
+        bool first = true;
+
+        for(auto &bucket : rateLimiters_[kLimitReadBytes])
+        {
+            double available = bucket->available(loop_->cachedNow());
+
+            if(first || available < allowance)
+            {
+                allowance = available;
+                first = false;
+            }
+        }
+
+        // 0 for no cap, one read at least, a shared bucket drained by other
+        // connections goes into debt
+        if(allowance >= TokenBucket::kUnlimited)
+        {
+            return 0;
+        }
+
+        return allowance < 1 ? 1 : static_cast<size_t>(allowance);
+    }
+
+    void TcpConnection::throttleRead(int64_t waitMicros)
+    {
+        if(!readThrottled_)
+        {
+            readThrottled_ = true;
+            loop_->metrics().throttles.add(1);
+
+            if(channel_->isReading())
+            {
+                channel_->disableReading();
+            }
+        }
+
+        extendThrottle(waitMicros);
+    }
+
+    void TcpConnection::throttleWrite(int64_t waitMicros)
+    {
+        if(!writeThrottled_)
+        {
+            writeThrottled_ = true;
+            loop_->metrics().throttles.add(1);
+
+            // a send in flight still reports to handleWrite
+            if(channel_->isWriting() && !completionIo_)
+            {
+                channel_->disableWriting();
+            }
+        }
+
+        extendThrottle(waitMicros);
+    }
+
+    void TcpConnection::extendThrottle(int64_t waitMicros)
+    {
+        Timestamp until(loop_->cachedNow().microSecondsSinceEpoch() + waitMicros);
+
+        if(!throttledUntil_.valid() || throttledUntil_ < until)
+        {
+            throttledUntil_ = until;
+        }
+
+        armDeadlines();
+    }
+
+    void TcpConnection::resumeThrottled()
+    {
+        // a shared bucket may have been drained by other connections since
+        if(readThrottled_)
+        {
+            int64_t wait = std::max(chargeLimiters(kLimitReadBytes, 0),
+                                    chargeLimiters(kLimitMessages, 0));
+
+            if(wait > 0)
+            {
+                extendThrottle(wait);
+            }
+            else
+            {
+                readThrottled_ = false;
+
+                if(reading_ && state_ == kConnected)
+                {
+                    channel_->enableReading();
+                    deliverHeldInput();
+                }
+
+                if(messagesThrottled_)
+                {
+                    messagesThrottled_ = false;
+
+                    if(inputBuffer_.readableBytes() > 0)
+                    {
+                        messageCallback_(shared_from_this(), &inputBuffer_, loop_->pollReturnTime());
+                    }
+                }
+            }
+        }
+
+        if(writeThrottled_ && state_ != kDisconnected)
+        {
+            int64_t wait = chargeLimiters(kLimitWriteBytes, 0);
+
+            if(wait > 0)
+            {
+                extendThrottle(wait);
+            }
+            else
+            {
+                writeThrottled_ = false;
+
+                if(pendingOutputBytes() > 0 && !channel_->isWriting())
+                {
+                    enableWriting();
+                }
+            }
+        }
+    }
+
+    void TcpConnection::enableWriting()
+    {
+        // resumeThrottled enables it once the write limiters refilled
+        if(writeThrottled_)
+        {
+            return;
+        }
+
+        // queued as an SQE, the next poll hands it to the kernel
+        if(completionIo_)
+        {
+            if(!channel_->isWriting())
+            {
+                writeQueued();
+            }
+        }
+        else
+        {
+            channel_->enableWriting();
+        }
+    }
+
+    void TcpConnection::forceCloseWithDelay(double seconds)
+    {
+        if(state_ == kConnected || state_ == kDisconnecting)
+        {
+            setState(kDisconnecting);
+            auto selfPtr = shared_from_this();
+            loop_->runAfter(seconds, [ = ]()
+            {
+                selfPtr->forceClose();
+            });
+        }
+    }
+
+    void TcpConnection::forceCloseInLoop()
+    {
+        loop_->assertInLoopThread();
+        userClosed_ = true;
+
+        releaseConnection();
+    }
+
+    void TcpConnection::releaseConnection()
+    {
+        if(state_ == kConnected || state_ == kDisconnecting)
+        {
+            setState(kDisconnected);
+            channel_->disableAll();
+            channel_->remove();
+            closePendingFds();
+
+            LoopMetrics& metrics = loop_->metrics();
+            metrics.connections.add(-1);
+            metrics.inputBufferBytes.add(-static_cast<int64_t>(reportedInputBytes_));
+            metrics.outputBufferBytes.add(-static_cast<int64_t>(reportedOutputBytes_));
+            reportedInputBytes_ = 0;
+            reportedOutputBytes_ = 0;
+
+            // nothing drains the output any more
+            TcpConnectionPtr source = backpressureSource_.lock();
+
+            if(aboveHighWaterMark_ && source)
+            {
+                source->startRead();
+            }
+
+            if(blockedSenders_ > 0)
+            {
+                std::lock_guard<std::mutex> lock(sendQueueMutex_);
+                sendQueueCond_.notify_all();
+            }
+
+            if(closeCallback_)
+            {
+                closeCallback_(shared_from_this());
+                closeCallback_ = nullptr;
+            }
+        }
+    }
+
+    const char* TcpConnection::stateToString() const
+    {
+        switch(state_)
+        {
+            case kDisconnected:
+                return "kDisconnected";
+
+            case kConnecting:
+                return "kConnecting";
+
+            case kConnected:
+                return "kConnected";
+
+            case kDisconnecting:
+                return "kDisconnecting";
+
+            default:
+                return "unknown state";
+        }
+    }
+
+    void TcpConnection::setTcpNoDelay(bool on)
+    {
+        if(localAddr_.isUnix())
+        {
+            return;
+        }
+
+        SocketOps::setTcpNoDelay(fd_, on);
+    }
+
+    void TcpConnection::startRead()
+    {
+        auto selfPtr = shared_from_this();
+
+        loop_->runInLoop([ = ]()
+        {
+            selfPtr->startReadInLoop();
+        });
+    }
+
+    void TcpConnection::startReadInLoop()
+    {
+        loop_->assertInLoopThread();
+
+        if(!reading_ || !channel_->isReading())
+        {
+            // a throttled read resumes with resumeThrottled
+            if(!readThrottled_)
+            {
+                channel_->enableReading();
+            }
+
+            reading_ = true;
+            deliverHeldInput();
+        }
+    }
+
+    void TcpConnection::stopRead()
+    {
+        auto selfPtr = shared_from_this();
+
+        loop_->runInLoop([ = ]()
+        {
+            selfPtr->stopReadInLoop();
+        });
+    }
+
+    void TcpConnection::stopReadInLoop()
+    {
+        loop_->assertInLoopThread();
+
+        if(reading_ || channel_->isReading())
+        {
+            channel_->disableReading();
+            reading_ = false;
+        }
+    }
+
+    void TcpConnection::connectEstablished()
+    {
+        auto selfPtr = shared_from_this();
+        assert(state_ == kConnecting);
         setState(kConnected);
         loop_->assertInLoopThread();
         channel_->setOwner(selfPtr);
+
+        // descriptor passing needs recvmsg and sendmsg of its own
+        if(loop_->completionIo() && !localAddr_.isUnix())
+        {
+            completionIo_ = true;
+            channel_->setCompletionMode(Channel::kCompletionRecv);
+        }
+
         channel_->enableReading();
         channel_->enableErroring();
+        loop_->metrics().connections.add(1);
+
+        if(loop_->kernelBusyPoll() > 0 && !localAddr_.isUnix() &&
+                SocketOps::setBusyPoll(channel_->fd(), loop_->kernelBusyPoll()) < 0)
+        {
+            LOG_PRINT(LogType_Warn, "SO_BUSY_POLL failed:%s", GetLastErrorText().c_str());
+        }
+
+        establishedTime_ = loop_->cachedNow();
+        lastReadTime_ = establishedTime_;
+        lastWriteTime_ = establishedTime_;
+        armDeadlines();
+#ifdef MUDUO_HAVE_OPENSSL
 
+        // the connection is up for the user once the handshake finished
+        if(tls_)
+        {
+            if(tls_->start() == TlsSession::kFailed)
+            {
+                sockErrorOccurred_ = true;
+            }
+
+            writeTlsOutput();
+            return;
+        }
+
+#endif
         connectionCallback_(selfPtr);
     }
 
@@ -347,8 +1554,12 @@ namespace MuduoPlus
         }*/
 
         assert(state_ == kDisconnected);
+        bool reportedUp = true;
+#ifdef MUDUO_HAVE_OPENSSL
+        reportedUp = !tls_ || tls_->established();
+#endif
 
-        if(!userClosed_)
+        if(!userClosed_ && reportedUp)
         {
             connectionCallback_(shared_from_this());
         }
@@ -362,15 +1573,232 @@ namespace MuduoPlus
         }
 
         loop_->assertInLoopThread();
-        bool ret = inputBuffer_.readFd(channel_->fd());
+#ifdef MUDUO_HAVE_OPENSSL
+        Buffer* readBuffer = tls_ ? tls_->cipherInput() : &inputBuffer_;
+#else
+        Buffer* readBuffer = &inputBuffer_;
+#endif
+        size_t oldLen = readBuffer->readableBytes();
+        bool ret = true;
+        bool paused = false;
+        bool ended = false;
+
+        if(completionIo_)
+        {
+            // received by the poller, also what was on its way when reading
+            // stopped
+            paused = !channel_->isReading();
+            bool limited = loop_->readBudget() > 0 || !rateLimiters_[kLimitReadBytes].empty();
+            Buffer* received = limited ? &heldInput_ : readBuffer;
+
+            for(auto &completion : channel_->readCompletions())
+            {
+                if(completion.result > 0)
+                {
+                    received->append(completion.data, completion.result);
+                }
+                else if(completion.result == 0 || !ERR_RW_RETRIABLE(-completion.result))
+                {
+                    ended = completion.result == 0;
+                    ret = false;
+                }
+            }
+
+            // the recv is already done, only what the read budget and the
+            // limiters allow is handed on
+            if(limited && !readThrottled_)
+            {
+                takeHeldInput(readBuffer);
+            }
+        }
+        else
+        {
+            size_t maxBytes = loop_->readBudget();
+
+            // readFd reads until the socket is empty, which may never be with
+            // a fast peer, stop at what the limiters still allow
+            if(!rateLimiters_[kLimitReadBytes].empty())
+            {
+                size_t allowance = readAllowance();
+
+                if(allowance > 0 && (maxBytes == 0 || allowance < maxBytes))
+                {
+                    maxBytes = allowance;
+                }
+            }
+
+#ifndef WIN32
+            // readv would make the kernel drop passed descriptors
+            ret = readBuffer->readFd(channel_->fd(), localAddr_.isUnix() ? &receivedFds_ : NULL,
+                                     maxBytes);
+#else
+            ret = readBuffer->readFd(channel_->fd());
+#endif
+        }
+
+        size_t n = readBuffer->readableBytes() - oldLen;
+        loop_->metrics().bytesRead.add(n);
+        lastReadTime_ = loop_->cachedNow();
+
+        if(n > 0 && !rateLimiters_[kLimitReadBytes].empty())
+        {
+            int64_t wait = chargeLimiters(kLimitReadBytes, n);
+
+            if(wait > 0)
+            {
+                throttleRead(wait);
+            }
+        }
+
+        queueHeldInput();
+
+        for(auto fd : receivedFds_)
+        {
+            if(fdCallback_)
+            {
+                fdCallback_(shared_from_this(), fd);
+            }
+            else
+            {
+                SocketOps::closeSocket(fd);
+            }
+        }
+
+        receivedFds_.clear();
+
+        // data that came along with the end of the stream goes first
+        if(ret || n > 0)
+        {
+            if(paused)
+            {
+                inputHeld_ = true;
+            }
+            else
+            {
+                deliverInput(receiveTime);
+            }
+        }
+
+        if(!ret)
+        {
+            // the answers to the last messages are still queued, sends
+            // are never done right away here, or input is held back
+            if(ended && (pendingOutputBytes() > 0 || heldInput_.readableBytes() > 0))
+            {
+                inputEnded_ = true;
+            }
+            else
+            {
+                sockErrorOccurred_ = true;
+            }
+        }
+
+        if(state_ != kDisconnected)
+        {
+            updateBufferMetrics();
+        }
+    }
 
-        if(ret)
+    void TcpConnection::deliverInput(Timestamp receiveTime)
+    {
+#ifdef MUDUO_HAVE_OPENSSL
+        // a read that only advanced the handshake has no message
+        bool message = !tls_ || readTls();
+#else
+        bool message = true;
+#endif
+
+        if(message)
         {
             messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
         }
-        else
+    }
+
+    void TcpConnection::deliverHeldInput()
+    {
+        if(state_ == kDisconnected || !channel_->isReading())
         {
-            sockErrorOccurred_ = true;
+            return;
+        }
+
+        if(heldInput_.readableBytes() > 0)
+        {
+#ifdef MUDUO_HAVE_OPENSSL
+            Buffer* readBuffer = tls_ ? tls_->cipherInput() : &inputBuffer_;
+#else
+            Buffer* readBuffer = &inputBuffer_;
+#endif
+            size_t n = takeHeldInput(readBuffer);
+            loop_->metrics().bytesRead.add(n);
+            int64_t wait = chargeLimiters(kLimitReadBytes, n);
+
+            if(wait > 0)
+            {
+                throttleRead(wait);
+            }
+
+            queueHeldInput();
+            inputHeld_ = true;
+        }
+
+        if(inputHeld_)
+        {
+            inputHeld_ = false;
+            deliverInput(loop_->pollReturnTime());
+
+            if(state_ != kDisconnected)
+            {
+                updateBufferMetrics();
+            }
+        }
+
+        // the peer's end of stream waited for the held input
+        if(inputEnded_ && state_ != kDisconnected && heldInput_.readableBytes() == 0 &&
+           pendingOutputBytes() == 0)
+        {
+            releaseConnection();
+        }
+    }
+
+    size_t TcpConnection::takeHeldInput(Buffer* readBuffer)
+    {
+        size_t n = heldInput_.readableBytes();
+        size_t budget = loop_->readBudget();
+
+        if(budget > 0 && budget < n)
+        {
+            n = budget;
+        }
+
+        if(!rateLimiters_[kLimitReadBytes].empty())
+        {
+            size_t allowance = readAllowance();
+
+            if(allowance > 0 && allowance < n)
+            {
+                n = allowance;
+            }
+        }
+
+        readBuffer->append(heldInput_.peek(), n);
+        heldInput_.retrieve(n);
+        return n;
+    }
+
+    void TcpConnection::queueHeldInput()
+    {
+        // a throttled read goes on with resumeThrottled, one that stopped
+        // with startRead
+        if(heldInput_.readableBytes() > 0 && !heldInputQueued_ && !readThrottled_ &&
+           channel_->isReading())
+        {
+            heldInputQueued_ = true;
+            auto selfPtr = shared_from_this();
+            loop_->queueInLoop([selfPtr]()
+            {
+                selfPtr->heldInputQueued_ = false;
+                selfPtr->deliverHeldInput();
+            });
         }
     }
 
@@ -385,38 +1813,33 @@ namespace MuduoPlus
 
         if(channel_->isWriting())
         {
-            size_t n = SocketOps::send(channel_->fd(),
-                                       outputBuffer_.peek(),
-                                       outputBuffer_.readableBytes());
+            // the rest goes out with the next send
+            if(completionIo_ && !completeSend())
+            {
+                return;
+            }
 
-            if(n > 0)
+            if(writeQueued())
             {
-                outputBuffer_.retrieve(n);
+                channel_->disableWriting();
 
-                if(outputBuffer_.readableBytes() == 0)
+                if(writeCompleteCallback_)
                 {
-                    channel_->disableWriting();
-
-                    if(writeCompleteCallback_)
-                    {
-                        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-                    }
-
-                    if(state_ == kDisconnecting)
-                    {
-                        shutdownInLoop();
-                    }
+                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                }
 
-                    LOG_PRINT(LogType_Error, "TcpConnection::send all data");
+                if(state_ == kDisconnecting)
+                {
+                    shutdownInLoop();
                 }
-            }
-            else
-            {
-                if(!ERR_RW_RETRIABLE(GetLastErrorCode()))
+
+                // handleEnd closes now
+                if(inputEnded_ && heldInput_.readableBytes() == 0)
                 {
                     sockErrorOccurred_ = true;
-                    LOG_PRINT(LogType_Error, "TcpConnection::handleWrite");
                 }
+
+                LOG_DEBUG("TcpConnection::send all data");
             }
         }
         else
@@ -430,6 +1853,29 @@ namespace MuduoPlus
         loop_->assertInLoopThread();
         //assert(state_ == kConnected || state_ == kDisconnecting);
 
+#ifdef MUDUO_HAVE_ZEROCOPY
+
+        // MSG_ZEROCOPY completions raise POLLERR too, only a pending socket
+        // error means the connection is broken
+        if(zeroCopyEnabled_ && state_ != kDisconnected)
+        {
+            int completions = SocketOps::readZeroCopyCompletions(fd_,
+                              std::bind(&TcpConnection::handleZeroCopyCompletion, this,
+                                        std::placeholders::_1, std::placeholders::_2,
+                                        std::placeholders::_3));
+
+            if(completions > 0 && SocketOps::getSocketError(fd_) == 0)
+            {
+                if(state_ == kDisconnecting)
+                {
+                    shutdownInLoop();
+                }
+
+                return;
+            }
+        }
+
+#endif
         sockErrorOccurred_ = true;
     }
 
@@ -445,4 +1891,96 @@ namespace MuduoPlus
             closeCallback_ = nullptr;*/
         }
     }
+
+    void TcpConnection::updateBufferMetrics()
+    {
+        LoopMetrics& metrics = loop_->metrics();
+        size_t inputBytes = inputBuffer_.readableBytes() + heldInput_.readableBytes();
+        size_t outputBytes = outputBuffer_.readableBytes() + inflightBuffer_.readableBytes();
+
+        metrics.inputBufferBytes.add(static_cast<int64_t>(inputBytes) -
+                                     static_cast<int64_t>(reportedInputBytes_));
+        metrics.outputBufferBytes.add(static_cast<int64_t>(outputBytes) -
+                                      static_cast<int64_t>(reportedOutputBytes_));
+        reportedInputBytes_ = inputBytes;
+        reportedOutputBytes_ = outputBytes;
+
+        // mirrored without a limit too, so one set from another thread
+        // does not start from a stale 0, seq_cst against blockedSenders_
+        // only while a limit is set
+        if(sendQueueLimit_.load(std::memory_order_relaxed) == 0)
+        {
+            outputBytes_.store(pendingOutputBytes(), std::memory_order_relaxed);
+        }
+        else
+        {
+            outputBytes_ = pendingOutputBytes();
+
+            if(blockedSenders_ > 0)
+            {
+                std::lock_guard<std::mutex> lock(sendQueueMutex_);
+                sendQueueCond_.notify_all();
+            }
+        }
+    }
+
+#ifdef MUDUO_HAVE_OPENSSL
+
+    void TcpConnection::setTlsContext(const TlsContextPtr& context, const std::string& serverName)
+    {
+        assert(state_ == kConnecting);
+        tls_.reset(new TlsSession(context, serverName));
+    }
+
+    bool TcpConnection::readTls()
+    {
+        size_t oldLen = inputBuffer_.readableBytes();
+        TlsSession::Result result = tls_->read(&inputBuffer_);
+        writeTlsOutput();
+
+        if(result == TlsSession::kEstablished)
+        {
+            tlsEstablished();
+        }
+        else if(result == TlsSession::kFailed)
+        {
+            sockErrorOccurred_ = true;
+            return false;
+        }
+        else if(result == TlsSession::kClosed)
+        {
+            // like a read of 0, after what came with close_notify
+            sockErrorOccurred_ = true;
+        }
+
+        return state_ != kDisconnected && tls_->established() &&
+               inputBuffer_.readableBytes() > oldLen;
+    }
+
+    void TcpConnection::writeTlsOutput()
+    {
+        Buffer* output = tls_->cipherOutput();
+
+        if(output->readableBytes() > 0)
+        {
+            writeInLoop(output->peek(), static_cast<int>(output->readableBytes()));
+            output->retrieveAll();
+        }
+    }
+
+    void TcpConnection::tlsEstablished()
+    {
+        LOG_PRINT(LogType_Info, "TcpConnection[%s] %s %s", name_.c_str(), tls_->protocol(),
+                  tls_->cipher());
+
+        // what the kernel encrypts must come after the handshake bytes
+        if(pendingOutputBytes() == 0 && tls_->enableKernelTx(fd_))
+        {
+            LOG_PRINT(LogType_Info, "TcpConnection[%s] kernel TLS sending", name_.c_str());
+        }
+
+        connectionCallback_(shared_from_this());
+    }
+
+#endif
 }
\ No newline at end of file
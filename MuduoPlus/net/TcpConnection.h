@@ -3,6 +3,10 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
 
 #include "base/types.h"
 #include "base/NonCopyable.h"
@@ -13,16 +17,25 @@
 #include "CallBack.h"
 #include "InetAddress.h"
 #include "Buffer.h"
+#include "TokenBucket.h"
+
+#ifdef MUDUO_HAVE_OPENSSL
+#include "TlsContext.h"
+#endif
 
 namespace MuduoPlus
 {
     class Channel;
+    class DeadlineWheel;
     class EventLoop;
 
     class TcpConnection : NonCopyable,
         public std::enable_shared_from_this<TcpConnection>
     {
     public:
+        /// Read only payload shared with the caller, see sendShared.
+        typedef std::shared_ptr<const std::string> SharedPayload;
+
         /// Constructs a TcpConnection with a connected sockfd
         ///
         /// User should not create this object.
@@ -65,6 +78,47 @@ namespace MuduoPlus
         void send(const void* data, int len);
         void send(const StringPiece& message);
         //void send(Buffer* message);  // this one will swap data
+        /// Unix connections only. Passes a duplicate of fd with SCM_RIGHTS
+        /// along with the first byte of message, which must not be empty and
+        /// is queued after data sent before. The caller keeps fd.
+        void sendFd(int fd, const StringPiece& message);
+        /// Queues payload by reference instead of copying it into the output
+        /// buffer. With zero copy on and payload at least the threshold the
+        /// kernel sends the pages in place (MSG_ZEROCOPY) and the reference
+        /// is held until the socket error queue reports the send complete.
+        /// Thread safe.
+        void sendShared(const SharedPayload& payload);
+        /// Queues size bytes at data by reference, like a SharedPayload.
+        /// owner keeps them alive and unchanged until it is released, e.g.
+        /// a cache item pinned while its value is being sent. Thread safe.
+        void sendShared(const std::shared_ptr<const void>& owner, const char* data, size_t size);
+        /// Writes what a deferred flush loop queued right away instead of at
+        /// the end of the iteration, for latency critical messages. Thread
+        /// safe.
+        void flush();
+        /// Opts in to MSG_ZEROCOPY for sendShared payloads of at least
+        /// threshold bytes, 0 turns it off again. In the loop thread, e.g.
+        /// from the connection callback. False where the socket can not do
+        /// it (old kernel, unix socket, Windows, a loop doing completion
+        /// I/O). When the kernel reports it
+        /// had to copy anyway (loopback, no scatter-gather NIC) the
+        /// connection goes back to plain sends, which are cheaper then.
+        bool setZeroCopyThreshold(size_t threshold);
+        /// Output not sent yet, buffered and shared payloads.
+        size_t pendingOutputBytes() const
+        {
+            return outputBuffer_.readableBytes() + inflightBuffer_.readableBytes() + segmentBytes_;
+        }
+        /// True once the kernel reported copying zero copy sends.
+        bool zeroCopyCopied() const
+        {
+            return zeroCopyCopied_;
+        }
+        /// Zero copy payloads the kernel has not released yet.
+        size_t zeroCopyInflight() const
+        {
+            return zeroCopyInflight_.size();
+        }
         void gracefulClose(); // NOT thread safe, no simultaneous calling
         // void shutdownAndForceCloseAfter(double seconds); // NOT thread safe, no simultaneous calling
         void forceClose();
@@ -101,12 +155,100 @@ namespace MuduoPlus
             writeCompleteCallback_ = cb;
         }
 
+        /// Descriptors received over a unix connection go to cb before the
+        /// message callback of the same read. Without it they are closed.
+        void setFdCallback(const FdCallback& cb)
+        {
+            fdCallback_ = cb;
+        }
+
         void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
         {
             highWaterMarkCallback_ = cb;
             highWaterMark_ = highWaterMark;
         }
 
+        /// cb runs once the output that crossed the high water mark drained
+        /// to lowWaterMark or below.
+        void setLowWaterMarkCallback(const LowWaterMarkCallback& cb, size_t lowWaterMark)
+        {
+            lowWaterMarkCallback_ = cb;
+            lowWaterMark_ = lowWaterMark;
+        }
+
+        /// Stops reading from source while the output of this connection is
+        /// above the high water mark and starts again at the low one, so a
+        /// relay runs at the pace of the slower side. For a proxy call it on
+        /// both connections with the other one. In the loop thread.
+        void setBackpressureSource(const TcpConnectionPtr& source)
+        {
+            backpressureSource_ = source;
+        }
+
+        /// Deadlines on the loop's DeadlineWheel, checked to within a tenth
+        /// of a second. Read idle passes seconds after the last read, write
+        /// idle seconds after the last write to the socket and lifetime
+        /// seconds after the connection was established, 0 turns one off,
+        /// the default. A passed deadline calls the deadline callback, which
+        /// may send a heartbeat and gets called again after another idle
+        /// period, or force closes the connection without one. Before the
+        /// connection is established or in the loop thread.
+        void setReadIdleTimeout(double seconds);
+        void setWriteIdleTimeout(double seconds);
+        void setLifetime(double seconds);
+        void setDeadlineCallback(const DeadlineCallback& cb)
+        {
+            deadlineCallback_ = cb;
+        }
+
+        /// Charges reads (kLimitReadBytes), socket writes (kLimitWriteBytes)
+        /// or decoded messages (kLimitMessages) to bucket as well, the same
+        /// bucket on several connections caps them together. A bucket in
+        /// debt pauses reading or writing until the loop's DeadlineWheel
+        /// finds it refilled, give it a burst of at least a tenth of a
+        /// second of its rate. Before the connection is established or in
+        /// the loop thread.
+        void addRateLimiter(RateLimitKind kind, const TokenBucketPtr& bucket);
+        /// Charges n decoded messages, for a codec in the message callback.
+        /// False once a kLimitMessages limiter is in debt, the codec should
+        /// stop decoding then, reading pauses and the message callback runs
+        /// again on the buffered input when the limiter refilled.
+        bool chargeMessages(size_t n = 1);
+
+        /// What send does with a message beyond the send queue limit.
+        enum OverflowPolicy
+        {
+            kOverflowDrop,      // the message is discarded, see droppedSends
+            kOverflowClose,     // the connection is force closed
+            kOverflowBlock      // callers in threads without a loop wait for room
+        };
+
+        /// Caps the output waiting for the kernel at bytes, 0 (the default)
+        /// for no cap. Only a message that finds output queued is refused,
+        /// one larger than the cap still goes out on an idle connection.
+        /// kOverflowBlock does not block a thread running an EventLoop, the
+        /// connection's own or another one, e.g. of a relay, its sends are
+        /// queued anyway. Thread safe.
+        void setSendQueueLimit(size_t bytes, OverflowPolicy policy);
+        /// Messages refused under kOverflowDrop.
+        uint64_t droppedSends() const
+        {
+            return droppedSends_.load(std::memory_order_relaxed);
+        }
+
+#ifdef MUDUO_HAVE_OPENSSL
+        /// Speaks TLS on this connection, TcpServer and TcpClient call it
+        /// before connectEstablished. The connection callback then runs once
+        /// the handshake finished, a failed handshake closes the connection
+        /// without one. serverName is what a client verifies.
+        void setTlsContext(const TlsContextPtr& context, const std::string& serverName);
+        /// NULL without TLS.
+        const TlsSession* tlsSession() const
+        {
+            return tls_.get();
+        }
+#endif
+
         /// Advanced interface
         Buffer* inputBuffer()
         {
@@ -131,12 +273,41 @@ namespace MuduoPlus
 
     private:
         enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
+        static const int kMaxWriteIovecs = 64;
+        struct OutputSegment
+        {
+            std::shared_ptr<const void> owner;
+            const char*     data;
+            size_t          size;
+            size_t          offset;     // bytes written so far
+            bool            zeroCopy;
+        };
+
         void handleRead(Timestamp receiveTime);
         void handleWrite();
         void handleError();
         void handleEnd();
         void sendInLoop(const StringPiece& message);
         void sendInLoop(const void* data, int len);
+        void writeInLoop(const void* data, int len);
+        void sendFdInLoop(int fd, const std::string& message);
+        void sendSharedInLoop(const std::shared_ptr<const void>& owner, const char* data, size_t size);
+        bool writeQueued();
+        bool writeWithFds();
+#ifndef WIN32
+        int  gatherSegments(struct iovec* vec, int count, size_t* total);
+        bool submitQueued();
+#endif
+        bool completeSend();
+        void deliverInput(Timestamp receiveTime);
+        void deliverHeldInput();
+        size_t takeHeldInput(Buffer* readBuffer);
+        void queueHeldInput();
+        void retrieveOutput(size_t n);
+        void queueFlush();
+        void flushInLoop();
+        void handleZeroCopyCompletion(uint32_t lo, uint32_t hi, bool copied);
+        void closePendingFds();
         void shutdownInLoop();
         // void shutdownAndForceCloseInLoop(double seconds);
         void forceCloseInLoop();
@@ -148,6 +319,29 @@ namespace MuduoPlus
         const char* stateToString() const;
         void startReadInLoop();
         void stopReadInLoop();
+        void updateBufferMetrics();
+        bool admitSend(size_t len);
+        void waitForSendQueue(size_t len);
+        void checkHighWaterMark(size_t oldLen, size_t newLen);
+        void checkLowWaterMark();
+        void armDeadlines();
+        void checkDeadlines(Timestamp armed, Timestamp now);
+        void fireDeadline(DeadlineKind kind);
+        void wrote(size_t n);
+        int64_t chargeLimiters(RateLimitKind kind, size_t n);
+        size_t readAllowance();
+        void throttleRead(int64_t waitMicros);
+        void throttleWrite(int64_t waitMicros);
+        void extendThrottle(int64_t waitMicros);
+        void resumeThrottled();
+        void enableWriting();
+#ifdef MUDUO_HAVE_OPENSSL
+        bool readTls();
+        void writeTlsOutput();
+        void tlsEstablished();
+#endif
+
+        friend class DeadlineWheel;
 
         EventLoop* loop_;
         const std::string name_;
@@ -163,12 +357,80 @@ namespace MuduoPlus
         MessageCallback messageCallback_;
         WriteCompleteCallback writeCompleteCallback_;
         HighWaterMarkCallback highWaterMarkCallback_;
+        LowWaterMarkCallback lowWaterMarkCallback_;
         CloseCallback closeCallback_;
+        FdCallback fdCallback_;
+        DeadlineCallback deadlineCallback_;
         size_t highWaterMark_;
+        size_t lowWaterMark_;
+        bool aboveHighWaterMark_;   // crossed the high mark, not drained to the low one yet
+        std::weak_ptr<TcpConnection> backpressureSource_;
         Buffer inputBuffer_;
         Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
         bool    reading_;
         Any     context_;
+        // buffer sizes last added to the loop's gauges
+        size_t  reportedInputBytes_;
+        size_t  reportedOutputBytes_;
+        // bytes written to the socket so far, and duplicated descriptors
+        // waiting for the output byte at that stream offset
+        uint64_t    bytesSent_;
+        std::deque<std::pair<uint64_t, int> > pendingFds_;
+        std::vector<int>    receivedFds_;
+        // output queued behind outputBuffer_ once a shared payload waits,
+        // later sends go here too to keep the byte order
+        std::deque<OutputSegment> outputSegments_;
+        size_t  segmentBytes_;
+        // the loop's poller reads and sends, see Channel::CompletionMode.
+        // A send in flight owns inflightBuffer_, output queued meanwhile
+        // comes after it. Input that arrived after reading stopped waits
+        // for it to start again, the peer's end of stream for the output
+        // to be sent. Input past the read budget or the read limiters'
+        // allowance waits in heldInput_ for a later iteration
+        bool    completionIo_;
+        bool    inputHeld_;
+        bool    inputEnded_;
+        bool    heldInputQueued_;
+        Buffer  inflightBuffer_;
+        Buffer  heldInput_;
+        // MSG_ZEROCOPY state, inflight payloads carry the send number the
+        // kernel reports back when it is done with them
+        bool    zeroCopyEnabled_;
+        bool    zeroCopyCopied_;
+        size_t  zeroCopyThreshold_;
+        uint32_t zeroCopySeq_;
+        std::deque<std::pair<uint32_t, std::shared_ptr<const void> > > zeroCopyInflight_;
+        bool    flushQueued_;   // flushInLoop waits for the iteration end
+        // deadlines in microseconds, 0 when off, and the activity times
+        // they count from, on the loop's cached monotonic clock
+        int64_t     readIdleMicros_;
+        int64_t     writeIdleMicros_;
+        int64_t     lifetimeMicros_;
+        Timestamp   establishedTime_;
+        Timestamp   lastReadTime_;
+        Timestamp   lastWriteTime_;
+        Timestamp   armedDeadline_;     // of the wheel entry that counts, invalid without one
+        // rate limiting, paused directions resume at throttledUntil_
+        std::vector<TokenBucketPtr> rateLimiters_[kLimitKindCount];
+        bool        readThrottled_;
+        bool        writeThrottled_;
+        bool        messagesThrottled_; // the message callback runs again on resume
+        Timestamp   throttledUntil_;
+        // send queue limit, outputBytes_ mirrors pendingOutputBytes() for
+        // senders blocked in other threads
+        std::atomic<size_t> sendQueueLimit_;
+        std::atomic<int>    overflowPolicy_;
+        std::atomic<uint64_t> droppedSends_;
+        std::atomic<size_t> outputBytes_;
+        std::atomic<size_t> crossThreadBytes_;  // sent from other threads, not in the loop yet
+        std::atomic<int>    blockedSenders_;
+        std::mutex          sendQueueMutex_;
+        std::condition_variable sendQueueCond_;
+#ifdef MUDUO_HAVE_OPENSSL
+        // reads go to its cipher input, sends through it until the kernel
+        // took over encryption
+        std::unique_ptr<TlsSession> tls_;
+#endif
     };
 
     typedef std::shared_ptr<TcpConnection> TcpConnectionPtr;
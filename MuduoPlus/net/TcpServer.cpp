@@ -22,6 +22,11 @@ namespace MuduoPlus
           threadPool_(new EventLoopThreadPool(loop, name_)),
           connectionCallback_(defaultConnectionCallback),
           messageCallback_(defaultMessageCallback),
+          readIdleTimeout_(0),
+          writeIdleTimeout_(0),
+          lifetime_(0),
+          connectionRates_(),
+          connectionBursts_(),
           nextConnId_(1)
     {
         acceptor_->setNewConnectionCallback(
@@ -51,6 +56,16 @@ namespace MuduoPlus
         threadPool_->setThreadNum(numThreads);
     }
 
+    void TcpServer::setSocketType(int type)
+    {
+        acceptor_->setSocketType(type);
+    }
+
+    void TcpServer::setDualStack(bool on)
+    {
+        acceptor_->setDualStack(on);
+    }
+
     void TcpServer::start()
     {
         if(started_.fetch_and(1) == 0)
@@ -85,11 +100,52 @@ namespace MuduoPlus
         conn->setConnectionCallback(connectionCallback_);
         conn->setMessageCallback(messageCallback_);
         conn->setWriteCompleteCallback(writeCompleteCallback_);
+        conn->setFdCallback(fdCallback_);
+        conn->setDeadlineCallback(deadlineCallback_);
+        conn->setReadIdleTimeout(readIdleTimeout_);
+        conn->setWriteIdleTimeout(writeIdleTimeout_);
+        conn->setLifetime(lifetime_);
+#ifdef MUDUO_HAVE_OPENSSL
+
+        if(tlsContext_)
+        {
+            conn->setTlsContext(tlsContext_, std::string());
+        }
+
+#endif
+
+        for(int kind = 0; kind < kLimitKindCount; ++kind)
+        {
+            if(connectionRates_[kind] > 0)
+            {
+                conn->addRateLimiter(static_cast<RateLimitKind>(kind),
+                                     std::make_shared<TokenBucket>(connectionRates_[kind],
+                                                                   connectionBursts_[kind]));
+            }
+
+            if(serverLimiters_[kind])
+            {
+                conn->addRateLimiter(static_cast<RateLimitKind>(kind), serverLimiters_[kind]);
+            }
+        }
+
         conn->setCloseCallback(
             std::bind(&TcpServer::removeConnection, this, std::placeholders::_1)); // FIXME: unsafe
         ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
     }
 
+    void TcpServer::setServerRateLimit(RateLimitKind kind, double rate, double burst)
+    {
+        if(serverLimiters_[kind])
+        {
+            serverLimiters_[kind]->setRate(rate, burst);
+        }
+        else
+        {
+            serverLimiters_[kind] = std::make_shared<TokenBucket>(rate, burst);
+        }
+    }
+
     void TcpServer::removeConnection(const TcpConnectionPtr& conn)
     {
         // FIXME: unsafe
@@ -8,6 +8,11 @@
 #include "base/NonCopyable.h"
 #include "CallBack.h"
 #include "InetAddress.h"
+#include "TokenBucket.h"
+
+#ifdef MUDUO_HAVE_OPENSSL
+#include "TlsContext.h"
+#endif
 
 namespace MuduoPlus
 {
@@ -97,6 +102,61 @@ namespace MuduoPlus
             writeCompleteCallback_ = cb;
         }
 
+        /// Set callback for descriptors passed over unix connections.
+        /// Not thread safe.
+        void setFdCallback(const FdCallback& cb)
+        {
+            fdCallback_ = cb;
+        }
+
+        /// Read idle, write idle and lifetime deadlines of new connections
+        /// in seconds, 0 for none, see TcpConnection::setReadIdleTimeout.
+        /// Not thread safe.
+        void setIdleTimeouts(double readIdle, double writeIdle, double lifetime)
+        {
+            readIdleTimeout_ = readIdle;
+            writeIdleTimeout_ = writeIdle;
+            lifetime_ = lifetime;
+        }
+
+        /// Set callback for passed deadlines, without one they force close.
+        /// Not thread safe.
+        void setDeadlineCallback(const DeadlineCallback& cb)
+        {
+            deadlineCallback_ = cb;
+        }
+
+        /// Gives every new connection its own token bucket for kind of rate
+        /// per second and burst, rate 0 for none, see
+        /// TcpConnection::addRateLimiter. Not thread safe.
+        void setConnectionRateLimit(RateLimitKind kind, double rate, double burst)
+        {
+            connectionRates_[kind] = rate;
+            connectionBursts_[kind] = burst;
+        }
+
+        /// Charges all new connections together to one token bucket for
+        /// kind. Changing the rate later also applies to the connections
+        /// charged so far. Not thread safe.
+        void setServerRateLimit(RateLimitKind kind, double rate, double burst);
+
+        /// SOCK_STREAM by default, SOCK_SEQPACKET for unix addresses.
+        /// Must be called before @c start
+        void setSocketType(int type);
+
+        /// Whether a server on an IPv6 address also accepts IPv4 peers,
+        /// true by default. Must be called before @c start
+        void setDualStack(bool on);
+
+#ifdef MUDUO_HAVE_OPENSSL
+        /// Accepts TLS only, the connection callback runs once a client's
+        /// handshake finished. Not thread safe, before @c start
+        void setTlsContext(const TlsContextPtr& context)
+        {
+            tlsContext_ = context;
+        }
+#endif
+
     private:
         /// Not thread safe, but in loop
         void newConnection(int sockfd, const InetAddress& peerAddr);
@@ -115,10 +175,21 @@ namespace MuduoPlus
         ConnectionCallback connectionCallback_;
         MessageCallback messageCallback_;
         WriteCompleteCallback writeCompleteCallback_;
+        FdCallback fdCallback_;
+        DeadlineCallback deadlineCallback_;
+        double readIdleTimeout_;
+        double writeIdleTimeout_;
+        double lifetime_;
+        double connectionRates_[kLimitKindCount];
+        double connectionBursts_[kLimitKindCount];
+        TokenBucketPtr serverLimiters_[kLimitKindCount];
         ThreadInitCallback threadInitCallback_;
         std::atomic<int32_t> started_;
         // always in loop thread
         int nextConnId_;
         ConnectionMap connections_;
+#ifdef MUDUO_HAVE_OPENSSL
+        TlsContextPtr tlsContext_;
+#endif
     };
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <limits.h>
+#include <stdio.h>
 
 #include "TimerQueue.h"
 #include "EventLoop.h"
@@ -43,21 +44,9 @@ namespace MuduoPlus
     void TimerQueue::addTimerInLoop(Timer* timer)
     {
         loop_->assertInLoopThread();
-        bool earliestChanged = insert(timer);
-
-        if(earliestChanged)
-        {
-            Timestamp stamp = timer->expiration();
-
-            if((int64_t)stamp.milliSecondFromNow() <= INT_MAX)
-            {
-                loop_->resetPollTimeOut((int)stamp.milliSecondFromNow());
-            }
-            else
-            {
-                loop_->resetPollTimeOut(INT_MAX);
-            }
-        }
+        // the next poll timeout includes it, a timer added from another
+        // thread got here through a functor that woke the loop
+        insert(timer);
     }
 
     void TimerQueue::cancelInLoop(TimerId timerId)
@@ -75,6 +64,7 @@ namespace MuduoPlus
             (void)n;
             delete it->first; // FIXME: no delete please
             activeTimers_.erase(it);
+            loop_->metrics().timers.set(timers_.size());
         }
         else if(callingExpiredTimers_)
         {
@@ -84,23 +74,65 @@ namespace MuduoPlus
         assert(timers_.size() == activeTimers_.size());
     }
 
-    void TimerQueue::timeOut()
+    int TimerQueue::pollTimeout(Timestamp now) const
+    {
+        if(timers_.empty())
+        {
+            return INT_MAX;
+        }
+
+        int64_t micros = microSecondDifference(timers_.begin()->first, now);
+
+        if(micros <= 0)
+        {
+            return 0;
+        }
+
+        int64_t msec = (micros + Timestamp::kMicroSecPerMilliSec - 1) / Timestamp::kMicroSecPerMilliSec;
+        return msec < INT_MAX ? static_cast<int>(msec) : INT_MAX;
+    }
+
+    void TimerQueue::timeOut(Timestamp now)
     {
         loop_->assertInLoopThread();
-        Timestamp now(Timestamp::now());
+
+        if(timers_.empty() || now < timers_.begin()->first)
+        {
+            return;
+        }
 
         std::vector<Entry> expired = getExpired(now);
 
         callingExpiredTimers_ = true;
         cancelingTimers_.clear();
 
+        StallDetector& detector = loop_->stallDetector();
+        bool timing = detector.enabled();
+
         // safe to callback outside critical section
         for(std::vector<Entry>::iterator it = expired.begin();
                 it != expired.end(); ++it)
         {
+            if(!timing)
+            {
+                it->second->run();
+                continue;
+            }
+
+            int64_t start = LoopMetrics::nowNanos();
             it->second->run();
+            int64_t nanos = LoopMetrics::nowNanos() - start;
+
+            if(detector.isSlow(nanos))
+            {
+                char buf[32];
+                snprintf(buf, sizeof buf, "timer#%lld", (long long)it->second->sequence());
+                detector.recordSlow(buf, nanos);
+            }
         }
 
+        loop_->metrics().timersFired.add(expired.size());
+
         callingExpiredTimers_ = false;
 
         reset(expired, now);
@@ -135,8 +167,6 @@ namespace MuduoPlus
 
     void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
     {
-        Timestamp nextExpire;
-
         for(std::vector<Entry>::const_iterator it = expired.begin();
                 it != expired.end(); ++it)
         {
@@ -155,26 +185,7 @@ namespace MuduoPlus
             }
         }
 
-        if(!timers_.empty())
-        {
-            nextExpire = timers_.begin()->second->expiration();
-        }
-
-        if(nextExpire.valid())
-        {
-            if((int64_t)nextExpire.milliSecondFromNow() <= INT_MAX)
-            {
-                loop_->resetPollTimeOut((int)nextExpire.milliSecondFromNow());
-            }
-            else
-            {
-                loop_->resetPollTimeOut(INT_MAX);
-            }
-        }
-        else
-        {
-            loop_->resetPollTimeOut(INT_MAX);
-        }
+        loop_->metrics().timers.set(timers_.size());
     }
 
     bool TimerQueue::insert(Timer* timer)
@@ -205,6 +216,7 @@ namespace MuduoPlus
         }
 
         assert(timers_.size() == activeTimers_.size());
+        loop_->metrics().timers.set(timers_.size());
 
         return earliestChanged;
     }
@@ -16,15 +16,24 @@ namespace MuduoPlus
     class Timer;
     class TimerId;
 
+    /// Timers ordered by monotonic expiration, see Timestamp::monotonic.
+    /// The loop asks for its poll timeout before every poll and runs the
+    /// expired timers with its cached time after it.
     class TimerQueue : NonCopyable
     {
     public:
         TimerQueue(EventLoop* loop);
         ~TimerQueue();
 
+        /// when is monotonic.
         TimerId addTimer(const TimerCallback& cb, Timestamp when, double interval);
         void    cancel(TimerId timerId);
-        void    timeOut();
+        /// Runs the timers expired at now.
+        void    timeOut(Timestamp now);
+        /// Milliseconds from now until the earliest timer, rounded up so
+        /// poll does not return before it, INT_MAX without timers. now is
+        /// the loop's read at the end of the iteration, not a fresh one.
+        int     pollTimeout(Timestamp now) const;
 
     private:
 
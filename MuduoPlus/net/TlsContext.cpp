@@ -0,0 +1,603 @@
+#include <algorithm>
+#include <string.h>
+#include <limits.h>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <linux/tls.h>
+#endif
+
+#include "base/Logger.h"
+#include "TlsContext.h"
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        // BIOs over the session's cipher Buffers, reads that find nothing
+        // ask OpenSSL to retry like a non-blocking socket would
+        int bufferWrite(BIO* bio, const char* data, int len)
+        {
+            static_cast<Buffer*>(BIO_get_data(bio))->append(data, static_cast<size_t>(len));
+            return len;
+        }
+
+        int bufferRead(BIO* bio, char* data, int len)
+        {
+            Buffer* buf = static_cast<Buffer*>(BIO_get_data(bio));
+            BIO_clear_retry_flags(bio);
+
+            if(buf->readableBytes() == 0)
+            {
+                BIO_set_retry_read(bio);
+                return -1;
+            }
+
+            size_t n = std::min(buf->readableBytes(), static_cast<size_t>(len));
+            memcpy(data, buf->peek(), n);
+            buf->retrieve(n);
+            return static_cast<int>(n);
+        }
+
+        long bufferCtrl(BIO*, int cmd, long, void*)
+        {
+            return cmd == BIO_CTRL_FLUSH ? 1 : 0;
+        }
+
+        int bufferCreate(BIO* bio)
+        {
+            BIO_set_init(bio, 1);
+            return 1;
+        }
+
+        BIO_METHOD* newBufferMethod()
+        {
+            BIO_METHOD* method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK,
+                                              "MuduoPlus Buffer");
+            BIO_meth_set_write(method, bufferWrite);
+            BIO_meth_set_read(method, bufferRead);
+            BIO_meth_set_ctrl(method, bufferCtrl);
+            BIO_meth_set_create(method, bufferCreate);
+            return method;
+        }
+
+        BIO* newBufferBio(Buffer* buf)
+        {
+            static BIO_METHOD* method = newBufferMethod();
+            BIO* bio = BIO_new(method);
+            BIO_set_data(bio, buf);
+            return bio;
+        }
+
+        void logSslErrors(const char* what)
+        {
+            char text[256];
+            unsigned long code = ERR_get_error();
+
+            if(code == 0)
+            {
+                LOG_PRINT(LogType_Error, "TLS %s failed", what);
+            }
+
+            for(; code != 0; code = ERR_get_error())
+            {
+                ERR_error_string_n(code, text, sizeof text);
+                LOG_PRINT(LogType_Error, "TLS %s failed: %s", what, text);
+            }
+        }
+
+        bool decodeHex(const char* hex, std::string* out)
+        {
+            out->clear();
+
+            for(; hex[0] != '\0' && hex[1] != '\0'; hex += 2)
+            {
+                char byte[3] = { hex[0], hex[1], '\0' };
+                char* end = NULL;
+                out->push_back(static_cast<char>(strtol(byte, &end, 16)));
+
+                if(*end != '\0')
+                {
+                    return false;
+                }
+            }
+
+            return !out->empty();
+        }
+
+        /// TLS records in buf from offset on, OpenSSL appends whole ones.
+        uint64_t countRecords(const Buffer& buf, size_t offset)
+        {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(buf.peek()) + offset;
+            size_t left = buf.readableBytes() - offset;
+            uint64_t count = 0;
+
+            while(left >= 5)
+            {
+                size_t len = 5 + ((static_cast<size_t>(p[3]) << 8) | p[4]);
+                len = std::min(len, left);
+                p += len;
+                left -= len;
+                ++count;
+            }
+
+            return count;
+        }
+
+#ifdef __linux__
+        // HKDF-Expand-Label of RFC 8446 with an empty context
+        bool expandLabel(const EVP_MD* md, const std::string& secret, const char* label,
+                         unsigned char* out, size_t len)
+        {
+            std::string fullLabel = std::string("tls13 ") + label;
+            std::string info;
+            info.push_back(static_cast<char>(len >> 8));
+            info.push_back(static_cast<char>(len & 0xff));
+            info.push_back(static_cast<char>(fullLabel.size()));
+            info += fullLabel;
+            info.push_back('\0');
+
+            EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
+            bool ok = pctx != NULL && EVP_PKEY_derive_init(pctx) > 0 &&
+                      EVP_PKEY_CTX_hkdf_mode(pctx, EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0 &&
+                      EVP_PKEY_CTX_set_hkdf_md(pctx, md) > 0 &&
+                      EVP_PKEY_CTX_set1_hkdf_key(pctx, reinterpret_cast<const unsigned char*>(secret.data()),
+                                                 static_cast<int>(secret.size())) > 0 &&
+                      EVP_PKEY_CTX_add1_hkdf_info(pctx, reinterpret_cast<const unsigned char*>(info.data()),
+                                                  static_cast<int>(info.size())) > 0 &&
+                      EVP_PKEY_derive(pctx, out, &len) > 0;
+            EVP_PKEY_CTX_free(pctx);
+            return ok;
+        }
+#endif
+    }
+
+    TlsContextPtr TlsContext::newServer(const std::string& certFile, const std::string& keyFile)
+    {
+        SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+
+        if(ctx == NULL || SSL_CTX_use_certificate_chain_file(ctx, certFile.c_str()) != 1 ||
+                SSL_CTX_use_PrivateKey_file(ctx, keyFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+                SSL_CTX_check_private_key(ctx) != 1)
+        {
+            LOG_PRINT(LogType_Error, "TlsContext::newServer - can not use %s and %s",
+                      certFile.c_str(), keyFile.c_str());
+            logSslErrors("setup");
+            SSL_CTX_free(ctx);
+            return TlsContextPtr();
+        }
+
+        return TlsContextPtr(new TlsContext(ctx, true));
+    }
+
+    TlsContextPtr TlsContext::newClient(const std::string& caFile)
+    {
+        SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+        bool loaded = ctx != NULL && (caFile.empty() ? SSL_CTX_set_default_verify_paths(ctx) :
+                                      SSL_CTX_load_verify_locations(ctx, caFile.c_str(), NULL)) == 1;
+
+        if(!loaded)
+        {
+            LOG_PRINT(LogType_Error, "TlsContext::newClient - can not load CA certificates %s",
+                      caFile.c_str());
+            logSslErrors("setup");
+            SSL_CTX_free(ctx);
+            return TlsContextPtr();
+        }
+
+        TlsContextPtr context(new TlsContext(ctx, false));
+        context->setVerifyPeer(true);
+        return context;
+    }
+
+    TlsContext::TlsContext(ssl_ctx_st* ctx, bool server)
+        : ctx_(ctx),
+          server_(server),
+          kernelTls_(false)
+    {
+        SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+        // idle connections give their 34KB of record buffers back
+        SSL_CTX_set_mode(ctx_, SSL_MODE_RELEASE_BUFFERS);
+#ifdef __linux__
+        setKernelTls(true);
+#endif
+    }
+
+    TlsContext::~TlsContext()
+    {
+        SSL_CTX_free(ctx_);
+    }
+
+    void TlsContext::setVerifyPeer(bool on)
+    {
+        SSL_CTX_set_verify(ctx_, on ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, NULL);
+    }
+
+    void TlsContext::setKernelTls(bool on)
+    {
+        kernelTls_ = on;
+        // the traffic secret comes from the key log, OpenSSL has no getter
+        SSL_CTX_set_keylog_callback(ctx_, on ? &TlsSession::keylogCallback : NULL);
+
+        if(server_)
+        {
+            SSL_CTX_set_num_tickets(ctx_, on ? 0 : 2);
+        }
+    }
+
+    TlsSession::TlsSession(const TlsContextPtr& context, const std::string& serverName)
+        : context_(context),
+          ssl_(SSL_new(context->native())),
+          recordsWritten_(0),
+          established_(false),
+          kernelTx_(false)
+    {
+        SSL_set_app_data(ssl_, this);
+        SSL_set_bio(ssl_, newBufferBio(&cipherInput_), newBufferBio(&cipherOutput_));
+
+        if(context->isServer())
+        {
+            SSL_set_accept_state(ssl_);
+            return;
+        }
+
+        SSL_set_connect_state(ssl_);
+
+        // no SNI for address literals, the certificate names the address
+        if(!serverName.empty() &&
+                X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl_), serverName.c_str()) != 1)
+        {
+            SSL_set_tlsext_host_name(ssl_, serverName.c_str());
+            SSL_set1_host(ssl_, serverName.c_str());
+        }
+    }
+
+    TlsSession::~TlsSession()
+    {
+        OPENSSL_cleanse(&writeSecret_[0], writeSecret_.size());
+        SSL_free(ssl_);
+    }
+
+    void TlsSession::keylogCallback(const ssl_st* ssl, const char* line)
+    {
+        TlsSession* session = static_cast<TlsSession*>(SSL_get_app_data(ssl));
+        const char* label = SSL_is_server(ssl) ? "SERVER_TRAFFIC_SECRET_0 " : "CLIENT_TRAFFIC_SECRET_0 ";
+        size_t labelLen = strlen(label);
+
+        // "<label> <client random> <secret>"
+        if(session != NULL && strncmp(line, label, labelLen) == 0)
+        {
+            const char* secret = strchr(line + labelLen, ' ');
+
+            if(secret == NULL || !decodeHex(secret + 1, &session->writeSecret_))
+            {
+                session->writeSecret_.clear();
+            }
+        }
+    }
+
+    TlsSession::Result TlsSession::start()
+    {
+        return context_->isServer() ? kAgain : handshake();
+    }
+
+    TlsSession::Result TlsSession::handshake()
+    {
+        ERR_clear_error();
+        int ret = SSL_do_handshake(ssl_);
+
+        if(ret == 1)
+        {
+            established_ = true;
+            return flushPending() ? kEstablished : kFailed;
+        }
+
+        int err = SSL_get_error(ssl_, ret);
+
+        if(err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+        {
+            return kAgain;
+        }
+
+        long verify = SSL_get_verify_result(ssl_);
+
+        if(verify != X509_V_OK)
+        {
+            LOG_PRINT(LogType_Error, "TLS handshake - certificate: %s",
+                      X509_verify_cert_error_string(verify));
+        }
+
+        logSslErrors("handshake");
+        return kFailed;
+    }
+
+    TlsSession::Result TlsSession::read(Buffer* plain)
+    {
+        Result result = kAgain;
+        bool wasEstablished = established_;
+        size_t oldOutput = cipherOutput_.readableBytes();
+
+        if(!established_)
+        {
+            result = handshake();
+
+            if(result != kEstablished)
+            {
+                return result;
+            }
+        }
+
+        for(;;)
+        {
+            plain->ensureWritableBytes(16 * 1024);
+            ERR_clear_error();
+            int n = SSL_read(ssl_, plain->beginWrite(),
+                             static_cast<int>(std::min<size_t>(plain->writableBytes(), INT_MAX)));
+
+            if(n > 0)
+            {
+                plain->hasWritten(n);
+                continue;
+            }
+
+            int err = SSL_get_error(ssl_, n);
+
+            if(err == SSL_ERROR_ZERO_RETURN)
+            {
+                return kClosed;
+            }
+
+            if(err != SSL_ERROR_WANT_READ)
+            {
+                logSslErrors("read");
+                return kFailed;
+            }
+
+            break;
+        }
+
+        // a key update the peer asked for would go out under keys the
+        // kernel does not know
+        if(kernelTx_ && cipherOutput_.readableBytes() > 0)
+        {
+            LOG_PRINT(LogType_Error, "TLS read - peer asked for a key update, not possible with kernel TLS");
+            return kFailed;
+        }
+
+        // before the kernel took over the reply moved to the next keys,
+        // which the key log does not give, so it never takes over
+        if(wasEstablished && cipherOutput_.readableBytes() > oldOutput && !writeSecret_.empty())
+        {
+            OPENSSL_cleanse(&writeSecret_[0], writeSecret_.size());
+            writeSecret_.clear();
+        }
+
+        return result;
+    }
+
+    bool TlsSession::write(const void* data, size_t len)
+    {
+        assert(!kernelTx_);
+
+        if(!established_)
+        {
+            pending_.append(static_cast<const char*>(data), len);
+            return true;
+        }
+
+        const char* ptr = static_cast<const char*>(data);
+        size_t oldOutput = cipherOutput_.readableBytes();
+
+        while(len > 0)
+        {
+            int chunk = static_cast<int>(std::min<size_t>(len, INT_MAX));
+            ERR_clear_error();
+            int n = SSL_write(ssl_, ptr, chunk);
+
+            if(n <= 0)
+            {
+                logSslErrors("write");
+                return false;
+            }
+
+            ptr += n;
+            len -= n;
+        }
+
+        // the kernel goes on from the sequence number after these
+        recordsWritten_ += countRecords(cipherOutput_, oldOutput);
+        return true;
+    }
+
+    bool TlsSession::flushPending()
+    {
+        std::string pending;
+        pending.swap(pending_);
+        return write(pending.data(), pending.size());
+    }
+
+    void TlsSession::shutdown()
+    {
+        if(established_ && !kernelTx_ && (SSL_get_shutdown(ssl_) & SSL_SENT_SHUTDOWN) == 0)
+        {
+            ERR_clear_error();
+            SSL_shutdown(ssl_);
+        }
+    }
+
+    void TlsSession::shutdownKernelTx(int fd)
+    {
+        if(!kernelTx_ || (SSL_get_shutdown(ssl_) & SSL_SENT_SHUTDOWN) != 0)
+        {
+            return;
+        }
+
+        SSL_set_shutdown(ssl_, SSL_get_shutdown(ssl_) | SSL_SENT_SHUTDOWN);
+#if defined(__linux__) && defined(TLS_SET_RECORD_TYPE)
+        // a warning level close_notify alert, the kernel encrypts it as a
+        // record of the type given in the control message
+        char alert[2] = { 1, 0 };
+        char control[CMSG_SPACE(sizeof(unsigned char))];
+        struct iovec iov;
+        struct msghdr msg;
+        memset(control, 0, sizeof control);
+        memset(&msg, 0, sizeof msg);
+        iov.iov_base = alert;
+        iov.iov_len = sizeof alert;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_TLS;
+        cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+        *CMSG_DATA(cmsg) = 21;     // alert
+
+        if(::sendmsg(fd, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof alert))
+        {
+            return;
+        }
+#else
+        (void)fd;
+#endif
+        LOG_PRINT(LogType_Warn, "TLS shutdown - close_notify not sent, the peer sees a truncated stream");
+    }
+
+    bool TlsSession::enableKernelTx(int fd)
+    {
+#if defined(__linux__) && defined(TCP_ULP) && defined(TLS_1_3_VERSION)
+        const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl_);
+
+        if(kernelTx_ || !context_->kernelTls() || SSL_version(ssl_) != TLS1_3_VERSION ||
+                writeSecret_.empty() || cipher == NULL)
+        {
+            return false;
+        }
+
+        union
+        {
+            tls12_crypto_info_aes_gcm_128       aes128;
+            tls12_crypto_info_aes_gcm_256       aes256;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+            tls12_crypto_info_chacha20_poly1305 chacha;
+#endif
+        } info;
+        unsigned char key[32];
+        unsigned char iv[12];
+        size_t keyLen = 0;
+        size_t infoLen = 0;
+        memset(&info, 0, sizeof info);
+
+        switch(SSL_CIPHER_get_id(cipher) & 0xffff)
+        {
+        case 0x1301:    // TLS_AES_128_GCM_SHA256
+            keyLen = 16;
+            infoLen = sizeof info.aes128;
+            info.aes128.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+            break;
+
+        case 0x1302:    // TLS_AES_256_GCM_SHA384
+            keyLen = 32;
+            infoLen = sizeof info.aes256;
+            info.aes256.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+            break;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+
+        case 0x1303:    // TLS_CHACHA20_POLY1305_SHA256
+            keyLen = 32;
+            infoLen = sizeof info.chacha;
+            info.chacha.info.cipher_type = TLS_CIPHER_CHACHA20_POLY1305;
+            break;
+#endif
+
+        default:
+            return false;
+        }
+
+        const EVP_MD* md = SSL_CIPHER_get_handshake_digest(cipher);
+        bool derived = md != NULL && expandLabel(md, writeSecret_, "key", key, keyLen) &&
+                       expandLabel(md, writeSecret_, "iv", iv, sizeof iv);
+        OPENSSL_cleanse(&writeSecret_[0], writeSecret_.size());
+        writeSecret_.clear();
+
+        // the version sits at the same place in all of them, the record
+        // sequence goes on after the records OpenSSL wrote, data sent
+        // during the handshake, servers send no tickets
+        info.aes128.info.version = TLS_1_3_VERSION;
+        unsigned char recordSeq[8];
+
+        for(int i = 0; i < 8; ++i)
+        {
+            recordSeq[i] = static_cast<unsigned char>(recordsWritten_ >> (56 - 8 * i));
+        }
+
+        if(info.aes128.info.cipher_type == TLS_CIPHER_AES_GCM_128)
+        {
+            memcpy(info.aes128.key, key, keyLen);
+            memcpy(info.aes128.salt, iv, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+            memcpy(info.aes128.iv, iv + TLS_CIPHER_AES_GCM_128_SALT_SIZE, TLS_CIPHER_AES_GCM_128_IV_SIZE);
+            memcpy(info.aes128.rec_seq, recordSeq, sizeof recordSeq);
+        }
+        else if(info.aes256.info.cipher_type == TLS_CIPHER_AES_GCM_256)
+        {
+            memcpy(info.aes256.key, key, keyLen);
+            memcpy(info.aes256.salt, iv, TLS_CIPHER_AES_GCM_256_SALT_SIZE);
+            memcpy(info.aes256.iv, iv + TLS_CIPHER_AES_GCM_256_SALT_SIZE, TLS_CIPHER_AES_GCM_256_IV_SIZE);
+            memcpy(info.aes256.rec_seq, recordSeq, sizeof recordSeq);
+        }
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+        else
+        {
+            memcpy(info.chacha.key, key, keyLen);
+            memcpy(info.chacha.iv, iv, sizeof iv);
+            memcpy(info.chacha.rec_seq, recordSeq, sizeof recordSeq);
+        }
+#endif
+
+        OPENSSL_cleanse(key, sizeof key);
+        OPENSSL_cleanse(iv, sizeof iv);
+
+        // without the tls module the socket stays as it was, a failing
+        // TLS_TX leaves the ULP passing data through unchanged
+        bool ok = derived && ::setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof "tls") == 0 &&
+                  ::setsockopt(fd, SOL_TLS, TLS_TX, &info, static_cast<socklen_t>(infoLen)) == 0;
+        OPENSSL_cleanse(&info, sizeof info);
+
+        if(!ok)
+        {
+            LOG_DEBUG("kernel TLS unavailable, OpenSSL keeps encrypting");
+            return false;
+        }
+
+        kernelTx_ = true;
+        return true;
+#else
+        (void)fd;
+        return false;
+#endif
+    }
+
+    const char* TlsSession::protocol() const
+    {
+        return SSL_get_version(ssl_);
+    }
+
+    const char* TlsSession::cipher() const
+    {
+        return SSL_get_cipher_name(ssl_);
+    }
+}
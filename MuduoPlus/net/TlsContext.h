@@ -0,0 +1,150 @@
+#pragma once
+
+// TLS over TcpConnection, built with MUDUO_WITH_OPENSSL when OpenSSL is
+// found. OpenSSL runs on the connection's loop over its Buffers, after the
+// handshake a TLS 1.3 session's sending side moves to the kernel (kTLS), so
+// writes go out as plaintext writev and zero copy is possible again.
+//
+//     TlsContextPtr tls = TlsContext::newServer("cert.pem", "key.pem");
+//     server.setTlsContext(tls);
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "base/NonCopyable.h"
+#include "Buffer.h"
+
+struct ssl_st;
+struct ssl_ctx_st;
+
+namespace MuduoPlus
+{
+    class TlsContext;
+    typedef std::shared_ptr<TlsContext> TlsContextPtr;
+
+    /// Certificates and settings shared by the connections of a server or
+    /// client. Set up before connections use it, then thread safe.
+    class TlsContext : NonCopyable
+    {
+    public:
+        /// NULL with the reason logged if the files do not load or match.
+        static TlsContextPtr newServer(const std::string& certFile, const std::string& keyFile);
+        /// Verifies servers against caFile, or the system's store when
+        /// empty, and the host name given to TcpClient::setTlsContext.
+        static TlsContextPtr newClient(const std::string& caFile = std::string());
+
+        ~TlsContext();
+
+        bool isServer() const
+        {
+            return server_;
+        }
+
+        /// Clients only, false accepts any certificate, for tests.
+        void setVerifyPeer(bool on);
+
+        /// Hands the sending side of TLS 1.3 sessions to the kernel after
+        /// the handshake, on by default. Where the kernel lacks the tls ULP
+        /// or the session can not be offloaded OpenSSL keeps encrypting.
+        /// Servers stop issuing session tickets while it is on, they would
+        /// be written under keys the kernel has taken over.
+        void setKernelTls(bool on);
+
+        bool kernelTls() const
+        {
+            return kernelTls_;
+        }
+
+        ssl_ctx_st* native() const
+        {
+            return ctx_;
+        }
+
+    private:
+        TlsContext(ssl_ctx_st* ctx, bool server);
+
+        ssl_ctx_st* ctx_;
+        bool server_;
+        bool kernelTls_;
+    };
+
+    /// The TLS state of one connection, TcpConnection drives it in its
+    /// loop thread. Ciphertext read from the socket goes into
+    /// cipherInput(), what has to go to the socket collects in
+    /// cipherOutput().
+    class TlsSession : NonCopyable
+    {
+    public:
+        enum Result
+        {
+            kAgain,         // nothing more to do until more input arrives
+            kEstablished,   // the handshake just finished
+            kClosed,        // the peer sent close_notify
+            kFailed         // handshake or record error, logged
+        };
+
+        /// serverName is sent as SNI and verified by clients, may be empty.
+        TlsSession(const TlsContextPtr& context, const std::string& serverName);
+        ~TlsSession();
+
+        Buffer* cipherInput()
+        {
+            return &cipherInput_;
+        }
+
+        Buffer* cipherOutput()
+        {
+            return &cipherOutput_;
+        }
+
+        bool established() const
+        {
+            return established_;
+        }
+
+        /// True once the kernel encrypts what is written to the socket.
+        bool kernelTx() const
+        {
+            return kernelTx_;
+        }
+
+        /// Starts a client's handshake, a server waits for the hello.
+        Result start();
+        /// Advances the handshake and decrypts cipherInput() into plain.
+        Result read(Buffer* plain);
+        /// Encrypts data into cipherOutput(). Data written before the
+        /// handshake finished goes out right after it. False on error.
+        bool write(const void* data, size_t len);
+        /// Queues close_notify into cipherOutput(), once.
+        void shutdown();
+        /// close_notify once the kernel encrypts, sent to fd as an alert
+        /// record, after all output was written to it.
+        void shutdownKernelTx(int fd);
+        /// Moves the sending side to the kernel, in the TLS state it has now,
+        /// so everything cipherOutput() held must be written to fd before.
+        bool enableKernelTx(int fd);
+
+        /// Negotiated protocol and cipher, e.g. "TLSv1.3".
+        const char* protocol() const;
+        const char* cipher() const;
+
+    private:
+        friend class TlsContext;
+
+        static void keylogCallback(const ssl_st* ssl, const char* line);
+        Result handshake();
+        bool flushPending();
+
+        TlsContextPtr context_;
+        ssl_st* ssl_;
+        Buffer cipherInput_;
+        Buffer cipherOutput_;
+        std::string pending_;       // plaintext written during the handshake
+        std::string writeSecret_;   // TLS 1.3 traffic secret, for kTLS only
+        uint64_t recordsWritten_;   // under it by OpenSSL, kTLS's first sequence number
+        bool established_;
+        bool kernelTx_;
+    };
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <math.h>
+
+#include "TokenBucket.h"
+
+namespace MuduoPlus
+{
+    TokenBucket::TokenBucket(double rate, double burst)
+        : rate_(rate),
+          burst_(burst),
+          tokens_(burst)
+    {
+    }
+
+    void TokenBucket::setRate(double rate, double burst)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rate_ = rate;
+        burst_ = burst;
+        tokens_ = std::min(tokens_, burst_);
+    }
+
+    int64_t TokenBucket::take(double n, Timestamp now)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if(rate_ <= 0)
+        {
+            return 0;
+        }
+
+        refill(now);
+        tokens_ -= n;
+
+        if(tokens_ >= 0)
+        {
+            return 0;
+        }
+
+        return static_cast<int64_t>(ceil(-tokens_ * Timestamp::kMicroSecPerSec / rate_));
+    }
+
+    double TokenBucket::available(Timestamp now)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if(rate_ <= 0)
+        {
+            return kUnlimited;
+        }
+
+        refill(now);
+        return tokens_;
+    }
+
+    void TokenBucket::refill(Timestamp now)
+    {
+        // loops sharing the bucket have slightly different cached times
+        if(refilled_.valid() && refilled_ < now)
+        {
+            tokens_ += rate_ * microSecondDifference(now, refilled_) / Timestamp::kMicroSecPerSec;
+            tokens_ = std::min(tokens_, burst_);
+        }
+
+        if(!refilled_.valid() || refilled_ < now)
+        {
+            refilled_ = now;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+
+#include "base/NonCopyable.h"
+#include "base/Timestamp.h"
+
+namespace MuduoPlus
+{
+    /// What a rate limiter of a connection counts, see
+    /// TcpConnection::addRateLimiter.
+    enum RateLimitKind
+    {
+        kLimitReadBytes,
+        kLimitWriteBytes,
+        kLimitMessages,     // charged by the codec, see TcpConnection::chargeMessages
+        kLimitKindCount
+    };
+
+    /// Token bucket on the monotonic clock, refilled at rate tokens per
+    /// second up to burst. A take larger than what is left goes into debt,
+    /// the taker then waits until the bucket is paid back, so reads and
+    /// writes of any size keep the average rate. A rate of 0 lets all
+    /// through. One bucket may be shared by connections on several loops.
+    /// Thread safe.
+    class TokenBucket : NonCopyable
+    {
+    public:
+        static constexpr double kUnlimited = 1e18;  // available() at rate 0
+
+        TokenBucket(double rate, double burst);
+
+        void setRate(double rate, double burst);
+
+        /// Takes n tokens at now, returns the microseconds until the bucket
+        /// is out of debt again, 0 when it is not in debt.
+        int64_t take(double n, Timestamp now);
+        /// Microseconds until the bucket is out of debt, 0 when it is not.
+        int64_t waitMicros(Timestamp now)
+        {
+            return take(0, now);
+        }
+        /// Tokens left at now, negative in debt.
+        double available(Timestamp now);
+
+    private:
+        void refill(Timestamp now);
+
+        std::mutex  mutex_;
+        double      rate_;
+        double      burst_;
+        double      tokens_;
+        Timestamp   refilled_;
+    };
+
+    typedef std::shared_ptr<TokenBucket> TokenBucketPtr;
+}
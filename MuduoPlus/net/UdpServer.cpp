@@ -0,0 +1,62 @@
+#include <assert.h>
+
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "base/Logger.h"
+
+namespace MuduoPlus
+{
+    UdpServer::UdpServer(EventLoop* loop, const InetAddress& bindAddr, const std::string& nameArg)
+        : loop_(loop),
+          bindAddr_(bindAddr),
+          name_(nameArg),
+          threadPool_(new EventLoopThreadPool(loop, name_)),
+          batchSize_(UdpSocket::kDefaultBatchSize),
+          maxDatagramSize_(UdpSocket::kDefaultMaxDatagramSize)
+    {
+        started_ = 0;
+    }
+
+    UdpServer::~UdpServer()
+    {
+        loop_->assertInLoopThread();
+        LOG_PRINT(LogType_Info, "UdpServer::~UdpServer [%s] destructing", name_.c_str());
+
+        for(auto &socket : sockets_)
+        {
+            socket->getLoop()->runInLoop(std::bind(&UdpSocket::close, socket));
+        }
+    }
+
+    void UdpServer::setThreadNum(int numThreads)
+    {
+        assert(0 <= numThreads);
+        threadPool_->setThreadNum(numThreads);
+    }
+
+    void UdpServer::start()
+    {
+        if(started_.fetch_add(1) != 0)
+        {
+            return;
+        }
+
+        loop_->assertInLoopThread();
+        threadPool_->start(threadInitCallback_);
+
+        std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+        bool reusePort = loops.size() > 1;
+
+        for(size_t i = 0; i < loops.size(); ++i)
+        {
+            UdpSocketPtr socket = std::make_shared<UdpSocket>(
+                                      loops[i], bindAddr_, name_ + "#" + std::to_string(i), reusePort);
+            socket->setBatchSize(batchSize_);
+            socket->setMaxDatagramSize(maxDatagramSize_);
+            socket->setDatagramCallback(datagramCallback_);
+            sockets_.push_back(socket);
+            loops[i]->runInLoop(std::bind(&UdpSocket::open, socket));
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/NonCopyable.h"
+#include "UdpSocket.h"
+
+namespace MuduoPlus
+{
+    class EventLoop;
+    class EventLoopThreadPool;
+
+    /// UDP server sharded over loops.
+    ///
+    /// Every loop of the pool binds its own socket to the same address with
+    /// SO_REUSEPORT, the kernel spreads peers over them by address hash so a
+    /// peer keeps talking to the same loop and no datagram crosses threads.
+    /// Sharding needs a fixed port, with port 0 each socket gets another one.
+    class UdpServer : NonCopyable
+    {
+    public:
+        typedef std::function<void(EventLoop*)> ThreadInitCallback;
+
+        UdpServer(EventLoop* loop, const InetAddress& bindAddr, const std::string& nameArg);
+        ~UdpServer();
+
+        const std::string& name() const
+        {
+            return name_;
+        }
+        EventLoop* getLoop() const
+        {
+            return loop_;
+        }
+
+        /// Same meaning as TcpServer::setThreadNum, one socket per thread.
+        /// Must be called before @c start
+        void setThreadNum(int numThreads);
+        void setThreadInitCallback(const ThreadInitCallback& cb)
+        {
+            threadInitCallback_ = cb;
+        }
+        /// Called in the loop of the socket that received the batch.
+        /// Not thread safe.
+        void setDatagramCallback(const DatagramCallback& cb)
+        {
+            datagramCallback_ = cb;
+        }
+        /// Datagrams per recvmmsg/sendmmsg, before @c start
+        void setBatchSize(size_t batchSize)
+        {
+            batchSize_ = batchSize;
+        }
+        /// Before @c start
+        void setMaxDatagramSize(size_t size)
+        {
+            maxDatagramSize_ = size;
+        }
+
+        /// Harmless to call multiple times, in loop thread.
+        void start();
+
+        /// One socket per loop, valid after calling start()
+        const std::vector<UdpSocketPtr>& sockets() const
+        {
+            return sockets_;
+        }
+
+    private:
+        EventLoop*                              loop_;
+        InetAddress                             bindAddr_;
+        const std::string                       name_;
+        std::shared_ptr<EventLoopThreadPool>    threadPool_;
+        DatagramCallback                        datagramCallback_;
+        ThreadInitCallback                      threadInitCallback_;
+        size_t                                  batchSize_;
+        size_t                                  maxDatagramSize_;
+        std::atomic<int32_t>                    started_;
+        std::vector<UdpSocketPtr>               sockets_;
+    };
+}
@@ -0,0 +1,454 @@
+#include <assert.h>
+
+#include "UdpSocket.h"
+#include "SocketOps.h"
+#include "EventLoop.h"
+#include "base/Logger.h"
+
+#ifndef WIN32
+#include <netinet/udp.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        // kernel limits of one GSO send
+        const size_t kMaxGsoSegments = 64;
+        const size_t kMaxGsoBytes = 65000;
+    }
+
+    const size_t UdpSocket::kDefaultBatchSize;
+    const size_t UdpSocket::kDefaultMaxDatagramSize;
+    const size_t UdpSocket::kDefaultMaxPending;
+
+    UdpSocket::UdpSocket(EventLoop* loop, const InetAddress& bindAddr,
+                         const std::string& name, bool reusePort)
+        : loop_(loop),
+          bindAddr_(bindAddr),
+          name_(name),
+          reusePort_(reusePort),
+          fd_(-1),
+          batchSize_(kDefaultBatchSize),
+          maxDatagramSize_(kDefaultMaxDatagramSize),
+          maxPending_(kDefaultMaxPending),
+          gsoSupported_(false),
+          flushQueued_(false)
+    {
+    }
+
+    UdpSocket::~UdpSocket()
+    {
+        if(fd_ >= 0)
+        {
+            SocketOps::closeSocket(fd_);
+        }
+    }
+
+    bool UdpSocket::open()
+    {
+        loop_->assertInLoopThread();
+        assert(fd_ < 0);
+
+        socket_t fd = SocketOps::createUdpSocket(bindAddr_.family());
+
+        if(fd < 0)
+        {
+            LOG_PRINT(LogType_Error, "create udp socket failed:%s %s:%d",
+                      GetLastErrorText().c_str(), __FUNCTION__, __LINE__);
+            return false;
+        }
+
+        SocketOps::reuseListenSocket(fd);
+
+        if(reusePort_ && SocketOps::reusePort(fd) < 0)
+        {
+            LOG_PRINT(LogType_Error, "enable SO_REUSEPORT failed:%s %s:%d",
+                      GetLastErrorText().c_str(), __FUNCTION__, __LINE__);
+            SocketOps::closeSocket(fd);
+            return false;
+        }
+
+        if(!SocketOps::bindSocket(fd, &bindAddr_.getSockAddr(), bindAddr_.getSockAddrLen()) ||
+                !SocketOps::setSocketNoneBlocking(fd))
+        {
+            LOG_PRINT(LogType_Error, "bind udp socket %s failed:%s %s:%d",
+                      bindAddr_.toIpPort().c_str(), GetLastErrorText().c_str(),
+                      __FUNCTION__, __LINE__);
+            SocketOps::closeSocket(fd);
+            return false;
+        }
+
+        fd_ = fd;
+
+        // port 0 binds an ephemeral port
+        if(bindAddr_.port() == 0)
+        {
+            bindAddr_ = SocketOps::getLocalAddr(fd_);
+        }
+
+        recvBuffer_.resize(batchSize_ * maxDatagramSize_);
+        received_.reserve(batchSize_);
+
+#ifndef WIN32
+        int segment = 0;
+        socklen_t len = sizeof(segment);
+        gsoSupported_ = ::getsockopt(fd_, SOL_UDP, UDP_SEGMENT, &segment, &len) == 0;
+
+        recvHeaders_.resize(batchSize_);
+        recvIovecs_.resize(batchSize_);
+        recvAddrs_.resize(batchSize_);
+
+        for(size_t i = 0; i < batchSize_; ++i)
+        {
+            recvIovecs_[i].iov_base = &recvBuffer_[i * maxDatagramSize_];
+            recvIovecs_[i].iov_len = maxDatagramSize_;
+            memset(&recvHeaders_[i], 0, sizeof(recvHeaders_[i]));
+            recvHeaders_[i].msg_hdr.msg_iov = &recvIovecs_[i];
+            recvHeaders_[i].msg_hdr.msg_iovlen = 1;
+            recvHeaders_[i].msg_hdr.msg_name = &recvAddrs_[i];
+        }
+
+        sendHeaders_.resize(batchSize_);
+        sendIovecs_.resize(batchSize_);
+        sendControl_.resize(batchSize_ * CMSG_SPACE(sizeof(uint16_t)));
+#endif
+
+        channelPtr_ = std::make_shared<Channel>(loop_, fd_);
+        channelPtr_->setReadCallback(std::bind(&UdpSocket::handleRead, this,
+                                               std::placeholders::_1));
+        channelPtr_->setWriteCallback(std::bind(&UdpSocket::handleWrite, this));
+        channelPtr_->setErrorCallback(std::bind(&UdpSocket::handleError, this));
+        channelPtr_->setOwner(shared_from_this());
+        channelPtr_->setName("UdpSocket " + name_);
+        channelPtr_->enableReading();
+
+        LOG_PRINT(LogType_Info, "UdpSocket %s bound at %s gso:%d", name_.c_str(),
+                  bindAddr_.toIpPort().c_str(), gsoSupported_ ? 1 : 0);
+        return true;
+    }
+
+    void UdpSocket::close()
+    {
+        loop_->assertInLoopThread();
+
+        if(fd_ < 0)
+        {
+            return;
+        }
+
+        channelPtr_->disableAll();
+        channelPtr_->remove();
+        SocketOps::closeSocket(fd_);
+        fd_ = -1;
+
+        datagramsDropped_.add(pending_.size());
+        pending_.clear();
+    }
+
+    void UdpSocket::sendTo(const InetAddress& peer, const void* data, size_t len)
+    {
+        PendingDatagram datagram;
+        datagram.peer = peer;
+        datagram.data.assign(static_cast<const char*>(data), len);
+        datagram.segmentSize = 0;
+        post(datagram);
+    }
+
+    void UdpSocket::sendSegments(const InetAddress& peer, const void* data, size_t len,
+                                 size_t segmentSize)
+    {
+        assert(segmentSize > 0);
+        const char* begin = static_cast<const char*>(data);
+        // without GSO every segment is a datagram of its own
+        size_t segments = gsoSupported_ ? std::min(kMaxGsoSegments, kMaxGsoBytes / segmentSize) : 1;
+        size_t chunk = std::max<size_t>(segments, 1) * segmentSize;
+
+        for(size_t offset = 0; offset < len; offset += chunk)
+        {
+            size_t size = std::min(chunk, len - offset);
+
+            if(size <= segmentSize)
+            {
+                sendTo(peer, begin + offset, size);
+                continue;
+            }
+
+            PendingDatagram datagram;
+            datagram.peer = peer;
+            datagram.data.assign(begin + offset, size);
+            datagram.segmentSize = segmentSize;
+            post(datagram);
+        }
+    }
+
+    void UdpSocket::post(PendingDatagram& datagram)
+    {
+        if(loop_->isInLoopThread())
+        {
+            enqueue(datagram);
+        }
+        else
+        {
+            UdpSocketPtr self = shared_from_this();
+            loop_->runInLoop([self, datagram]() mutable
+            {
+                self->enqueue(datagram);
+            });
+        }
+    }
+
+    void UdpSocket::enqueue(PendingDatagram& datagram)
+    {
+        loop_->assertInLoopThread();
+
+        if(fd_ < 0 || pending_.size() >= maxPending_)
+        {
+            datagramsDropped_.add(1);
+            return;
+        }
+
+        pending_.push_back(std::move(datagram));
+
+        // flush once at the end of this iteration, or on writable
+        if(!flushQueued_ && !channelPtr_->isWriting())
+        {
+            flushQueued_ = true;
+            loop_->queueInLoop(std::bind(&UdpSocket::flush, shared_from_this()));
+        }
+    }
+
+    void UdpSocket::flush()
+    {
+        loop_->assertInLoopThread();
+        flushQueued_ = false;
+
+        while(fd_ >= 0 && !pending_.empty())
+        {
+            int sent = sendBatch(std::min(pending_.size(), batchSize_));
+
+            if(sent > 0)
+            {
+                pending_.erase(pending_.begin(), pending_.begin() + sent);
+            }
+            else if(sent == 0)
+            {
+                // socket buffer full, go on when writable
+                if(!channelPtr_->isWriting())
+                {
+                    channelPtr_->enableWriting();
+                }
+
+                return;
+            }
+            else
+            {
+                // the first datagram can not be sent, e.g. EMSGSIZE
+                pending_.pop_front();
+                datagramsDropped_.add(1);
+            }
+        }
+
+        if(fd_ >= 0 && channelPtr_->isWriting())
+        {
+            channelPtr_->disableWriting();
+        }
+    }
+
+    int UdpSocket::sendBatch(size_t count)
+    {
+        size_t bytes = 0;
+        size_t datagrams = 0;
+        int sent = 0;
+
+#ifndef WIN32
+        for(size_t i = 0; i < count; ++i)
+        {
+            PendingDatagram& datagram = pending_[i];
+            msghdr& hdr = sendHeaders_[i].msg_hdr;
+
+            memset(&sendHeaders_[i], 0, sizeof(sendHeaders_[i]));
+            sendIovecs_[i].iov_base = &datagram.data[0];
+            sendIovecs_[i].iov_len = datagram.data.size();
+            hdr.msg_iov = &sendIovecs_[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_name = &datagram.peer.getSockAddr();
+            hdr.msg_namelen = datagram.peer.getSockAddrLen();
+
+            if(datagram.segmentSize > 0)
+            {
+                hdr.msg_control = &sendControl_[i * CMSG_SPACE(sizeof(uint16_t))];
+                hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t segmentSize = static_cast<uint16_t>(datagram.segmentSize);
+                memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+            }
+        }
+
+        sent = ::sendmmsg(fd_, sendHeaders_.data(), static_cast<unsigned>(count), 0);
+
+        if(sent < 0)
+        {
+            int errorCode = GetLastErrorCode();
+
+            if(ERR_RW_RETRIABLE(errorCode) || errorCode == ENOBUFS)
+            {
+                return 0;
+            }
+
+            LOG_PRINT(LogType_Error, "UdpSocket %s sendmmsg failed:%s", name_.c_str(),
+                      GetErrorText(errorCode).c_str());
+            return -1;
+        }
+
+        for(int i = 0; i < sent; ++i)
+        {
+            const PendingDatagram& datagram = pending_[i];
+            bytes += datagram.data.size();
+            datagrams += datagram.segmentSize > 0
+                         ? (datagram.data.size() + datagram.segmentSize - 1) / datagram.segmentSize
+                         : 1;
+        }
+
+#else
+
+        for(size_t i = 0; i < count; ++i, ++sent)
+        {
+            PendingDatagram& datagram = pending_[i];
+
+            if(::sendto(fd_, datagram.data.data(), static_cast<int>(datagram.data.size()), 0,
+                        &datagram.peer.getSockAddr(), datagram.peer.getSockAddrLen()) < 0)
+            {
+                int errorCode = GetLastErrorCode();
+
+                if(sent > 0 || ERR_RW_RETRIABLE(errorCode))
+                {
+                    break;
+                }
+
+                LOG_PRINT(LogType_Error, "UdpSocket %s sendto failed:%s", name_.c_str(),
+                          GetErrorText(errorCode).c_str());
+                return -1;
+            }
+
+            bytes += datagram.data.size();
+            ++datagrams;
+        }
+
+#endif
+        datagramsSent_.add(datagrams);
+        loop_->metrics().bytesWritten.add(bytes);
+        return sent;
+    }
+
+    void UdpSocket::handleRead(Timestamp receiveTime)
+    {
+        loop_->assertInLoopThread();
+
+        // bounded so one busy socket can not starve the loop, level
+        // triggered polling brings us back for the rest
+        for(int round = 0; round < kMaxReadRounds && fd_ >= 0; ++round)
+        {
+            size_t bytes = 0;
+            int count = 0;
+            received_.clear();
+
+#ifndef WIN32
+
+            for(size_t i = 0; i < batchSize_; ++i)
+            {
+                recvHeaders_[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+                recvHeaders_[i].msg_hdr.msg_flags = 0;
+            }
+
+            count = ::recvmmsg(fd_, recvHeaders_.data(), static_cast<unsigned>(batchSize_),
+                               MSG_DONTWAIT, NULL);
+
+            if(count < 0)
+            {
+                int errorCode = GetLastErrorCode();
+
+                if(!ERR_RW_RETRIABLE(errorCode))
+                {
+                    LOG_PRINT(LogType_Error, "UdpSocket %s recvmmsg failed:%s", name_.c_str(),
+                              GetErrorText(errorCode).c_str());
+                }
+
+                break;
+            }
+
+            for(int i = 0; i < count; ++i)
+            {
+                if(recvHeaders_[i].msg_hdr.msg_flags & MSG_TRUNC)
+                {
+                    datagramsDropped_.add(1);
+                    continue;
+                }
+
+                Datagram datagram;
+                datagram.data = static_cast<const char*>(recvIovecs_[i].iov_base);
+                datagram.size = recvHeaders_[i].msg_len;
+                datagram.peer = InetAddress((sockaddr*)&recvAddrs_[i],
+                                            recvHeaders_[i].msg_hdr.msg_namelen);
+                received_.push_back(datagram);
+                bytes += datagram.size;
+            }
+
+#else
+
+            for(; count < static_cast<int>(batchSize_); ++count)
+            {
+                sockaddr_storage addr;
+                int addrLen = sizeof(addr);
+                char* slot = &recvBuffer_[count * maxDatagramSize_];
+                int n = ::recvfrom(fd_, slot, static_cast<int>(maxDatagramSize_), 0,
+                                   (sockaddr*)&addr, &addrLen);
+
+                if(n < 0)
+                {
+                    break;
+                }
+
+                Datagram datagram;
+                datagram.data = slot;
+                datagram.size = n;
+                datagram.peer = InetAddress((sockaddr*)&addr, addrLen);
+                received_.push_back(datagram);
+                bytes += n;
+            }
+
+#endif
+            datagramsReceived_.add(received_.size());
+            loop_->metrics().bytesRead.add(bytes);
+
+            if(!received_.empty() && datagramCallback_)
+            {
+                datagramCallback_(shared_from_this(), received_, receiveTime);
+            }
+
+            if(count < static_cast<int>(batchSize_))
+            {
+                break;
+            }
+        }
+    }
+
+    void UdpSocket::handleWrite()
+    {
+        flush();
+    }
+
+    void UdpSocket::handleError()
+    {
+        int errorCode = SocketOps::getSocketError(fd_);
+        LOG_PRINT(LogType_Warn, "UdpSocket %s error:%s", name_.c_str(),
+                  GetErrorText(errorCode).c_str());
+    }
+}
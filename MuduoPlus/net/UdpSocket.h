@@ -0,0 +1,172 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <deque>
+#include <vector>
+
+#include "base/define.h"
+#include "base/Metrics.h"
+#include "base/NonCopyable.h"
+#include "base/Timestamp.h"
+#include "net/Channel.h"
+#include "net/InetAddress.h"
+
+#ifndef WIN32
+#include <sys/socket.h>
+#endif
+
+namespace MuduoPlus
+{
+    class EventLoop;
+    class UdpSocket;
+
+    typedef std::shared_ptr<UdpSocket> UdpSocketPtr;
+
+    /// One received datagram, data points into the socket's receive batch
+    /// and is only valid during the callback.
+    struct Datagram
+    {
+        const char*     data;
+        size_t          size;
+        InetAddress     peer;
+    };
+
+    typedef std::function < void(const UdpSocketPtr&, const std::vector<Datagram>&,
+                                 Timestamp) > DatagramCallback;
+
+    /// Bound UDP socket on a Channel.
+    ///
+    /// Reads drain the socket with recvmmsg into a batch allocated once, the
+    /// whole batch goes to one callback. Sends are queued and flushed with
+    /// sendmmsg once per loop iteration, so the replies of a batch leave in
+    /// one syscall. Without recvmmsg/sendmmsg (Windows) it falls back to one
+    /// datagram per call.
+    class UdpSocket : NonCopyable, public std::enable_shared_from_this<UdpSocket>
+    {
+    public:
+        static const size_t kDefaultBatchSize = 64;
+        static const size_t kDefaultMaxDatagramSize = 2048;
+        static const size_t kDefaultMaxPending = 4096;
+
+        UdpSocket(EventLoop* loop, const InetAddress& bindAddr,
+                  const std::string& name, bool reusePort = false);
+        ~UdpSocket();
+
+        /// Before open().
+        void setBatchSize(size_t batchSize)
+        {
+            batchSize_ = batchSize;
+        }
+        /// Before open(), longer datagrams are dropped.
+        void setMaxDatagramSize(size_t size)
+        {
+            maxDatagramSize_ = size;
+        }
+        /// Datagrams queued beyond this while the socket is not writable
+        /// are dropped.
+        void setMaxPending(size_t maxPending)
+        {
+            maxPending_ = maxPending;
+        }
+        void setDatagramCallback(const DatagramCallback& cb)
+        {
+            datagramCallback_ = cb;
+        }
+
+        /// Creates and binds the socket, in the loop thread.
+        bool open();
+        /// Stops reading and closes the socket, in the loop thread.
+        void close();
+
+        /// Thread safe, the datagram is copied.
+        void sendTo(const InetAddress& peer, const void* data, size_t len);
+        /// One buffer holding datagrams of segmentSize bytes each (the last
+        /// may be shorter), split by the kernel with UDP GSO where
+        /// available and by sendmmsg otherwise.
+        void sendSegments(const InetAddress& peer, const void* data, size_t len,
+                          size_t segmentSize);
+
+        EventLoop* getLoop() const
+        {
+            return loop_;
+        }
+        const std::string& name() const
+        {
+            return name_;
+        }
+        const InetAddress& bindAddress() const
+        {
+            return bindAddr_;
+        }
+        bool isOpen() const
+        {
+            return fd_ >= 0;
+        }
+
+        uint64_t datagramsReceived() const
+        {
+            return datagramsReceived_.value();
+        }
+        uint64_t datagramsSent() const
+        {
+            return datagramsSent_.value();
+        }
+        uint64_t datagramsDropped() const
+        {
+            return datagramsDropped_.value();
+        }
+
+    private:
+        struct PendingDatagram
+        {
+            InetAddress     peer;
+            std::string     data;
+            size_t          segmentSize;    // 0 for a single datagram
+        };
+
+        static const int kMaxReadRounds = 16;  // recvmmsg calls per read event
+
+        void post(PendingDatagram& datagram);
+        void enqueue(PendingDatagram& datagram);
+        void handleRead(Timestamp receiveTime);
+        void handleWrite();
+        void handleError();
+        void flush();
+        int  sendBatch(size_t count);
+
+        EventLoop*                  loop_;
+        InetAddress                 bindAddr_;
+        std::string                 name_;
+        bool                        reusePort_;
+        socket_t                    fd_;
+        std::shared_ptr<Channel>    channelPtr_;
+        DatagramCallback            datagramCallback_;
+
+        size_t                      batchSize_;
+        size_t                      maxDatagramSize_;
+        size_t                      maxPending_;
+        bool                        gsoSupported_;
+        bool                        flushQueued_;
+
+        // receive batch, allocated by open()
+        std::vector<char>           recvBuffer_;
+        std::vector<Datagram>       received_;
+#ifndef WIN32
+        std::vector<struct mmsghdr> recvHeaders_;
+        std::vector<struct iovec>   recvIovecs_;
+        std::vector<sockaddr_storage> recvAddrs_;
+        // send batch
+        std::vector<struct mmsghdr> sendHeaders_;
+        std::vector<struct iovec>   sendIovecs_;
+        std::vector<char>           sendControl_;
+#endif
+
+        std::deque<PendingDatagram> pending_;      // sent ones popped after each batch
+
+        Counter                     datagramsReceived_;
+        Counter                     datagramsSent_;
+        Counter                     datagramsDropped_;
+    };
+}
@@ -0,0 +1,663 @@
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "WebSocket.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "base/Logger.h"
+
+namespace MuduoPlus
+{
+    namespace
+    {
+        // the peer has this long to answer our close frame
+        const double kCloseTimeout = 2.0;
+
+        uint32_t rotateLeft(uint32_t x, int n)
+        {
+            return (x << n) | (x >> (32 - n));
+        }
+
+        // SHA-1 is only used for the handshake, RFC 3174
+        void sha1(const std::string& input, uint8_t digest[20])
+        {
+            uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+            std::string message(input);
+            uint64_t bits = static_cast<uint64_t>(input.size()) * 8;
+            message += static_cast<char>(0x80);
+
+            while(message.size() % 64 != 56)
+            {
+                message += static_cast<char>(0);
+            }
+
+            for(int i = 7; i >= 0; --i)
+            {
+                message += static_cast<char>(bits >> (i * 8));
+            }
+
+            for(size_t chunk = 0; chunk < message.size(); chunk += 64)
+            {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(message.data()) + chunk;
+                uint32_t w[80];
+
+                for(int i = 0; i < 16; ++i)
+                {
+                    w[i] = static_cast<uint32_t>(p[i * 4]) << 24 | p[i * 4 + 1] << 16 |
+                           p[i * 4 + 2] << 8 | p[i * 4 + 3];
+                }
+
+                for(int i = 16; i < 80; ++i)
+                {
+                    w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+                }
+
+                uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+                for(int i = 0; i < 80; ++i)
+                {
+                    uint32_t f, k;
+
+                    if(i < 20)
+                    {
+                        f = (b & c) | (~b & d);
+                        k = 0x5A827999;
+                    }
+                    else if(i < 40)
+                    {
+                        f = b ^ c ^ d;
+                        k = 0x6ED9EBA1;
+                    }
+                    else if(i < 60)
+                    {
+                        f = (b & c) | (b & d) | (c & d);
+                        k = 0x8F1BBCDC;
+                    }
+                    else
+                    {
+                        f = b ^ c ^ d;
+                        k = 0xCA62C1D6;
+                    }
+
+                    uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
+                    e = d;
+                    d = c;
+                    c = rotateLeft(b, 30);
+                    b = a;
+                    a = temp;
+                }
+
+                h[0] += a;
+                h[1] += b;
+                h[2] += c;
+                h[3] += d;
+                h[4] += e;
+            }
+
+            for(int i = 0; i < 20; ++i)
+            {
+                digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+            }
+        }
+
+        std::string base64(const uint8_t* data, size_t len)
+        {
+            static const char kAlphabet[] =
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            std::string out;
+
+            for(size_t i = 0; i < len; i += 3)
+            {
+                uint32_t group = data[i] << 16;
+                group |= i + 1 < len ? data[i + 1] << 8 : 0;
+                group |= i + 2 < len ? data[i + 2] : 0;
+
+                out += kAlphabet[(group >> 18) & 0x3F];
+                out += kAlphabet[(group >> 12) & 0x3F];
+                out += i + 1 < len ? kAlphabet[(group >> 6) & 0x3F] : '=';
+                out += i + 2 < len ? kAlphabet[group & 0x3F] : '=';
+            }
+
+            return out;
+        }
+
+        // RFC 3629, overlong forms, surrogates and code points past
+        // U+10FFFF are rejected
+        bool validUtf8(const char* data, size_t len)
+        {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+            const uint8_t* end = p + len;
+
+            while(p < end)
+            {
+                uint64_t word;
+
+                // ASCII eight bytes at a time
+                if(end - p >= 8 && (memcpy(&word, p, 8), (word & 0x8080808080808080ULL) == 0))
+                {
+                    p += 8;
+                    continue;
+                }
+
+                uint8_t c = *p;
+                size_t more = 0;
+                uint8_t low = 0x80;
+                uint8_t high = 0xBF;
+
+                if(c < 0x80)
+                {
+                    ++p;
+                    continue;
+                }
+                else if(c >= 0xC2 && c <= 0xDF)
+                {
+                    more = 1;
+                }
+                else if(c >= 0xE0 && c <= 0xEF)
+                {
+                    more = 2;
+                    low = c == 0xE0 ? 0xA0 : low;
+                    high = c == 0xED ? 0x9F : high;
+                }
+                else if(c >= 0xF0 && c <= 0xF4)
+                {
+                    more = 3;
+                    low = c == 0xF0 ? 0x90 : low;
+                    high = c == 0xF4 ? 0x8F : high;
+                }
+                else
+                {
+                    return false;
+                }
+
+                if(static_cast<size_t>(end - p) <= more || p[1] < low || p[1] > high)
+                {
+                    return false;
+                }
+
+                for(size_t i = 2; i <= more; ++i)
+                {
+                    if((p[i] & 0xC0) != 0x80)
+                    {
+                        return false;
+                    }
+                }
+
+                p += more + 1;
+            }
+
+            return true;
+        }
+
+        // RFC 6455 7.4, 1005, 1006 and 1015 are never sent, 1004 and the
+        // rest below 3000 are not assigned
+        bool validCloseCode(uint16_t code)
+        {
+            return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1014) ||
+                   (code >= 3000 && code <= 4999);
+        }
+    }
+
+    WebSocketConnection::WebSocketConnection(const TcpConnectionPtr& conn,
+            const WebSocketOptions& options,
+            const WebSocketMessageCallback& messageCallback,
+            const WebSocketCloseCallback& closeCallback)
+        : conn_(conn),
+          options_(options),
+          messageCallback_(messageCallback),
+          closeCallback_(closeCallback),
+          fragmentsOpcode_(kContinuation),
+          closeSent_(false),
+          closed_(false)
+    {
+    }
+
+    WebSocketConnection::~WebSocketConnection()
+    {
+    }
+
+    std::string WebSocketConnection::acceptKey(const std::string& key)
+    {
+        uint8_t digest[20];
+        sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+        return base64(digest, sizeof digest);
+    }
+
+    void WebSocketConnection::mask(char* data, size_t len, const uint8_t key[4])
+    {
+        size_t i = 0;
+        uint32_t key32;
+        memcpy(&key32, key, 4);
+
+        // i stays a multiple of 4, the key lines up with the data
+#if defined(__SSE2__)
+        __m128i key128 = _mm_set1_epi32(static_cast<int>(key32));
+
+        for(; i + 16 <= len; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, key128));
+        }
+#elif defined(__ARM_NEON)
+        uint8x16_t key128 = vreinterpretq_u8_u32(vdupq_n_u32(key32));
+
+        for(; i + 16 <= len; i += 16)
+        {
+            uint8_t* p = reinterpret_cast<uint8_t*>(data + i);
+            vst1q_u8(p, veorq_u8(vld1q_u8(p), key128));
+        }
+#endif
+
+        uint64_t key64 = static_cast<uint64_t>(key32) << 32 | key32;
+
+        for(; i + 8 <= len; i += 8)
+        {
+            uint64_t v;
+            memcpy(&v, data + i, 8);
+            v ^= key64;
+            memcpy(data + i, &v, 8);
+        }
+
+        for(; i < len; ++i)
+        {
+            data[i] ^= key[i & 3];
+        }
+    }
+
+    void WebSocketConnection::appendFrame(std::string* out, Opcode opcode, const StringPiece& payload)
+    {
+        uint64_t len = static_cast<uint64_t>(payload.size());
+        char header[10];
+        size_t headerLen = 2;
+        header[0] = static_cast<char>(0x80 | opcode);
+
+        if(len < 126)
+        {
+            header[1] = static_cast<char>(len);
+        }
+        else if(len <= 0xFFFF)
+        {
+            header[1] = 126;
+            header[2] = static_cast<char>(len >> 8);
+            header[3] = static_cast<char>(len);
+            headerLen = 4;
+        }
+        else
+        {
+            header[1] = 127;
+
+            for(int i = 0; i < 8; ++i)
+            {
+                header[2 + i] = static_cast<char>(len >> (56 - i * 8));
+            }
+
+            headerLen = 10;
+        }
+
+        out->reserve(out->size() + headerLen + payload.size());
+        out->append(header, headerLen);
+        out->append(payload.data(), payload.size());
+    }
+
+    TcpConnection::SharedPayload WebSocketConnection::encodeFrame(Opcode opcode, const StringPiece& payload)
+    {
+        std::shared_ptr<std::string> frame = std::make_shared<std::string>();
+        appendFrame(frame.get(), opcode, payload);
+        return frame;
+    }
+
+    void WebSocketConnection::broadcast(const std::vector<WebSocketConnectionPtr>& conns,
+                                        const StringPiece& message, bool binary)
+    {
+        TcpConnection::SharedPayload frame = encodeFrame(binary ? kBinary : kText, message);
+
+        for(auto &conn : conns)
+        {
+            conn->sendFrame(frame);
+        }
+    }
+
+    void WebSocketConnection::send(const StringPiece& message, bool binary)
+    {
+        if(closeSent_)
+        {
+            return;
+        }
+
+        std::string frame;
+        appendFrame(&frame, binary ? kBinary : kText, message);
+        conn_->send(frame);
+    }
+
+    void WebSocketConnection::sendFrame(const TcpConnection::SharedPayload& frame)
+    {
+        if(!closeSent_)
+        {
+            conn_->sendShared(frame);
+        }
+    }
+
+    void WebSocketConnection::close(uint16_t code, const StringPiece& reason)
+    {
+        conn_->getLoop()->runInLoop(std::bind(&WebSocketConnection::closeInLoop,
+                                              shared_from_this(), code, reason.as_string()));
+    }
+
+    void WebSocketConnection::closeInLoop(uint16_t code, const std::string& reason)
+    {
+        if(closeSent_ || !conn_->connected())
+        {
+            return;
+        }
+
+        closeSent_ = true;
+        std::string payload;
+        payload += static_cast<char>(code >> 8);
+        payload += static_cast<char>(code);
+        payload.append(reason, 0, 123);    // control frames carry 125 bytes
+
+        std::string frame;
+        appendFrame(&frame, kClose, payload);
+        conn_->send(frame);
+
+        // the peer answers with its close frame, or loses the connection
+        std::weak_ptr<WebSocketConnection> weakSelf(shared_from_this());
+        conn_->getLoop()->runAfter(kCloseTimeout, [weakSelf]()
+        {
+            if(WebSocketConnectionPtr self = weakSelf.lock())
+            {
+                self->shutdown(false);
+            }
+        });
+    }
+
+    void WebSocketConnection::shutdown(bool graceful)
+    {
+        if(graceful)
+        {
+            conn_->gracefulClose();
+        }
+        else
+        {
+            conn_->forceClose();
+        }
+
+        // a close from this side skips the connection callback
+        handleClose();
+    }
+
+    void WebSocketConnection::start()
+    {
+        EventLoop* loop = conn_->getLoop();
+        lastReceive_ = loop->cachedNow();
+
+        if(options_.pingInterval > 0)
+        {
+            std::weak_ptr<WebSocketConnection> weakSelf(shared_from_this());
+            pingTimer_ = loop->runEvery(options_.pingInterval, [weakSelf]()
+            {
+                if(WebSocketConnectionPtr self = weakSelf.lock())
+                {
+                    self->checkAlive();
+                }
+            });
+        }
+    }
+
+    void WebSocketConnection::checkAlive()
+    {
+        EventLoop* loop = conn_->getLoop();
+        Timestamp now = loop->cachedNow();
+
+        if(closed_ || closeSent_ || pingSentAt_.valid() ||
+                secondDifference(now, lastReceive_) < options_.pingInterval)
+        {
+            return;
+        }
+
+        std::string frame;
+        appendFrame(&frame, kPing, StringPiece());
+        conn_->send(frame);
+        pingSentAt_ = now;
+
+        // anything received since the ping answers it
+        std::weak_ptr<WebSocketConnection> weakSelf(shared_from_this());
+        loop->runAfter(options_.pongTimeout, [weakSelf, now]()
+        {
+            WebSocketConnectionPtr self = weakSelf.lock();
+
+            if(self && self->pingSentAt_ == now && !self->closed_)
+            {
+                LOG_PRINT(LogType_Info, "WebSocketConnection[%s] - no pong, closing",
+                          self->conn_->name().c_str());
+                self->shutdown(false);
+            }
+        });
+    }
+
+    void WebSocketConnection::handleData(Buffer* buf)
+    {
+        lastReceive_ = conn_->getLoop()->cachedNow();
+        pingSentAt_ = Timestamp::invalid();
+
+        // a frame is taken once it arrived whole, until then it waits in buf
+        while(buf->readableBytes() >= 2 && conn_->connected())
+        {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(buf->peek());
+            size_t readable = buf->readableBytes();
+            bool fin = (p[0] & 0x80) != 0;
+            int opcode = p[0] & 0x0F;
+            uint64_t len = p[1] & 0x7F;
+            size_t header = 2;
+
+            // no extensions are negotiated, client frames are masked
+            if((p[0] & 0x70) != 0 || (p[1] & 0x80) == 0)
+            {
+                closeInLoop(kProtocolError, "bad frame header");
+                shutdown(true);
+                break;
+            }
+
+            if(len == 126)
+            {
+                if(readable < 4)
+                {
+                    break;
+                }
+
+                len = p[2] << 8 | p[3];
+                header = 4;
+            }
+            else if(len == 127)
+            {
+                if(readable < 10)
+                {
+                    break;
+                }
+
+                len = 0;
+
+                for(int i = 2; i < 10; ++i)
+                {
+                    len = len << 8 | p[i];
+                }
+
+                header = 10;
+            }
+
+            if(len > options_.maxMessageBytes)
+            {
+                closeInLoop(kMessageTooBig, "message too big");
+                shutdown(true);
+                break;
+            }
+
+            if(readable < header + 4 + len)
+            {
+                break;
+            }
+
+            uint8_t key[4];
+            memcpy(key, p + header, 4);
+            char* payload = const_cast<char*>(buf->peek()) + header + 4;
+            mask(payload, static_cast<size_t>(len), key);
+
+            bool more = handleFrame(fin, opcode, payload, static_cast<size_t>(len));
+            buf->retrieve(header + 4 + static_cast<size_t>(len));
+
+            if(!more)
+            {
+                break;
+            }
+        }
+
+        if(!conn_->connected())
+        {
+            buf->retrieveAll();
+        }
+    }
+
+    bool WebSocketConnection::handleFrame(bool fin, int opcode, char* payload, size_t len)
+    {
+        if(opcode >= kClose)
+        {
+            if(!fin || len > 125 || (opcode != kClose && opcode != kPing && opcode != kPong))
+            {
+                closeInLoop(kProtocolError, "bad control frame");
+                shutdown(true);
+                return false;
+            }
+
+            if(opcode == kPing && !closeSent_)
+            {
+                std::string frame;
+                appendFrame(&frame, kPong, StringPiece(payload, static_cast<int>(len)));
+                conn_->send(frame);
+            }
+            else if(opcode == kClose)
+            {
+                // answer with the same code, then the server closes the TCP connection
+                uint16_t code = kNormalClosure;
+
+                if(len == 1)
+                {
+                    code = kProtocolError;
+                }
+                else if(len >= 2)
+                {
+                    code = static_cast<uint16_t>(static_cast<uint8_t>(payload[0]) << 8 |
+                                                 static_cast<uint8_t>(payload[1]));
+
+                    if(!validCloseCode(code))
+                    {
+                        code = kProtocolError;
+                    }
+                    else if(!validUtf8(payload + 2, len - 2))
+                    {
+                        code = kInvalidPayload;
+                    }
+                }
+
+                closeInLoop(code, std::string());
+                shutdown(true);
+                return false;
+            }
+
+            return true;
+        }
+
+        // data that crosses our close frame is dropped
+        if(closeSent_)
+        {
+            return true;
+        }
+
+        if(opcode == kText || opcode == kBinary)
+        {
+            if(fragmentsOpcode_ != kContinuation)
+            {
+                closeInLoop(kProtocolError, "message interleaved with fragments");
+                shutdown(true);
+                return false;
+            }
+
+            if(fin)
+            {
+                if(opcode == kText && !validUtf8(payload, len))
+                {
+                    closeInLoop(kInvalidPayload, "invalid UTF-8");
+                    shutdown(true);
+                    return false;
+                }
+
+                messageCallback_(shared_from_this(), StringPiece(payload, static_cast<int>(len)),
+                                 opcode == kBinary);
+            }
+            else
+            {
+                fragmentsOpcode_ = opcode;
+                fragments_.assign(payload, len);
+            }
+        }
+        else if(opcode == kContinuation && fragmentsOpcode_ != kContinuation)
+        {
+            if(fragments_.size() + len > options_.maxMessageBytes)
+            {
+                closeInLoop(kMessageTooBig, "message too big");
+                shutdown(true);
+                return false;
+            }
+
+            fragments_.append(payload, len);
+
+            if(fin)
+            {
+                if(fragmentsOpcode_ == kText && !validUtf8(fragments_.data(), fragments_.size()))
+                {
+                    closeInLoop(kInvalidPayload, "invalid UTF-8");
+                    shutdown(true);
+                    return false;
+                }
+
+                messageCallback_(shared_from_this(), StringPiece(fragments_), fragmentsOpcode_ == kBinary);
+                fragmentsOpcode_ = kContinuation;
+                fragments_.clear();
+            }
+        }
+        else
+        {
+            closeInLoop(kProtocolError, "unexpected opcode");
+            shutdown(true);
+            return false;
+        }
+
+        return true;
+    }
+
+    void WebSocketConnection::handleClose()
+    {
+        if(closed_)
+        {
+            return;
+        }
+
+        closed_ = true;
+        conn_->getLoop()->cancel(pingTimer_);
+
+        // the context of the connection holds this
+        if(conn_->getContext().Is<WebSocketConnectionPtr>())
+        {
+            conn_->setContext(Any());
+        }
+
+        if(closeCallback_)
+        {
+            closeCallback_(shared_from_this());
+        }
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/any.h"
+#include "base/NonCopyable.h"
+#include "base/StringPiece.h"
+#include "CallBack.h"
+#include "TcpConnection.h"
+#include "TimerId.h"
+
+namespace MuduoPlus
+{
+    class Buffer;
+    class HttpRequest;
+    class WebSocketConnection;
+
+    typedef std::shared_ptr<WebSocketConnection> WebSocketConnectionPtr;
+    typedef std::function<void(const WebSocketConnectionPtr&, const HttpRequest&)> WebSocketOpenCallback;
+    /// message points into the input buffer or the reassembled fragments,
+    /// it is valid during the callback only.
+    typedef std::function<void(const WebSocketConnectionPtr&, const StringPiece& message,
+                               bool binary)> WebSocketMessageCallback;
+    typedef std::function<void(const WebSocketConnectionPtr&)> WebSocketCloseCallback;
+
+    struct WebSocketOptions
+    {
+        WebSocketOptions()
+            : maxMessageBytes(16 * 1024 * 1024),
+              pingInterval(30),
+              pongTimeout(10)
+        {
+        }
+
+        size_t maxMessageBytes;     // larger messages close with 1009
+        double pingInterval;        // a connection silent this long is pinged, 0 for never
+        double pongTimeout;         // and closed if still silent this much later
+    };
+
+    /// Server side of an RFC 6455 connection, made by HttpServer from an
+    /// upgrade request.
+    ///
+    /// Frames are unmasked in place in the input buffer, a message in one
+    /// frame reaches the callback without a copy, fragments are joined.
+    /// Pings are answered, close frames complete the closing handshake.
+    /// Text messages and close reasons that are not UTF-8 close with 1007,
+    /// close codes a peer may not send with 1002.
+    class WebSocketConnection : NonCopyable,
+        public std::enable_shared_from_this<WebSocketConnection>
+    {
+    public:
+        enum Opcode
+        {
+            kContinuation = 0x0,
+            kText = 0x1,
+            kBinary = 0x2,
+            kClose = 0x8,
+            kPing = 0x9,
+            kPong = 0xA,
+        };
+
+        enum CloseCode
+        {
+            kNormalClosure = 1000,
+            kGoingAway = 1001,
+            kProtocolError = 1002,
+            kInvalidPayload = 1007,
+            kMessageTooBig = 1009,
+        };
+
+        WebSocketConnection(const TcpConnectionPtr& conn, const WebSocketOptions& options,
+                            const WebSocketMessageCallback& messageCallback,
+                            const WebSocketCloseCallback& closeCallback);
+        ~WebSocketConnection();
+
+        /// The Sec-WebSocket-Accept value for a Sec-WebSocket-Key.
+        static std::string acceptKey(const std::string& key);
+        /// XORs data with the 4 byte masking key, SIMD where available.
+        static void mask(char* data, size_t len, const uint8_t key[4]);
+        /// A whole unmasked frame, what a server sends.
+        static void appendFrame(std::string* out, Opcode opcode, const StringPiece& payload);
+        /// Encodes once, the bytes are shared by every sendFrame of it.
+        static TcpConnection::SharedPayload encodeFrame(Opcode opcode, const StringPiece& payload);
+        /// Sends one message to every connection from a single encoding.
+        /// Thread safe.
+        static void broadcast(const std::vector<WebSocketConnectionPtr>& conns,
+                              const StringPiece& message, bool binary = false);
+
+        const TcpConnectionPtr& connection() const
+        {
+            return conn_;
+        }
+
+        bool connected() const
+        {
+            return !closeSent_ && conn_->connected();
+        }
+
+        /// Thread safe.
+        void send(const StringPiece& message, bool binary = false);
+        /// A frame from encodeFrame, thread safe.
+        void sendFrame(const TcpConnection::SharedPayload& frame);
+        /// Starts the closing handshake, the peer has some seconds to answer.
+        /// Close through here rather than the TcpConnection, the close
+        /// callback runs either way. Thread safe.
+        void close(uint16_t code = kNormalClosure, const StringPiece& reason = StringPiece());
+
+        void setContext(const Any& context)
+        {
+            context_ = context;
+        }
+
+        Any& getContext()
+        {
+            return context_;
+        }
+
+        /// HttpServer feeds these, loop thread only.
+        void start();
+        void handleData(Buffer* buf);
+        void handleClose();
+
+    private:
+        bool handleFrame(bool fin, int opcode, char* payload, size_t len);
+        void closeInLoop(uint16_t code, const std::string& reason);
+        void shutdown(bool graceful);
+        void checkAlive();
+
+        TcpConnectionPtr conn_;
+        WebSocketOptions options_;
+        WebSocketMessageCallback messageCallback_;
+        WebSocketCloseCallback closeCallback_;
+        std::string fragments_;     // of the message being reassembled
+        int fragmentsOpcode_;       // kContinuation when none
+        std::atomic<bool> closeSent_; // set in the loop, read by the thread safe sends
+        bool closed_;
+        Timestamp lastReceive_;
+        Timestamp pingSentAt_;      // invalid once anything arrived since
+        TimerId pingTimer_;
+        Any context_;
+    };
+}
@@ -0,0 +1,637 @@
+// Connection handling of one Poller backend over loopback, ctest runs it
+// once per backend. The benchmarks exercise the same paths but can not
+// fail, this exits non zero when a case went wrong.
+//
+//  connect         TcpClient to TcpServer, both see the connection up
+//  echo            1 MiB in 64 KiB sends comes back unchanged
+//  halfClose       a peer sends, then shuts down its writing side, the
+//                  server gets the data, its echo still arrives and the
+//                  connection goes down
+//  peerReset       a peer resets the connection, the server drops it and
+//                  goes on serving
+//  timer           runAfter fires once not before its delay, runEvery
+//                  stops when cancelled
+//  removeChannel   a channel removes itself in its read callback and drops
+//                  its owner, it is not called again and the owner lives
+//                  until the iteration is over
+//  readBudget      with a loop read budget of 4 KiB no read event hands
+//                  more to the message callback, all data still arrives
+//  readLimit       a connection read rate limit hands no more than the
+//                  burst to the message callback at once and holds the
+//                  average rate
+//
+// A backend the system can not provide exits with 77, which ctest reports
+// as skipped.
+//
+// usage: ConnectionTest [poller=epoll] [port=20200]
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "base/Logger.h"
+#include "base/NonCopyable.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "net/TcpClient.h"
+#include "net/TcpServer.h"
+#include "TestCommon.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    const int kSkipped = 77;
+
+    void printLog(LogType type, const char* format, ...)
+    {
+        va_list args;
+        fprintf(stderr, "%s ", logTypeName(type));
+        va_start(args, format);
+        vfprintf(stderr, format, args);
+        va_end(args);
+        fputc('\n', stderr);
+    }
+
+    std::string pattern(size_t size)
+    {
+        std::string data(size, '\0');
+
+        for(size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<char>((i * 131 + i / 7) % 253);
+        }
+
+        return data;
+    }
+
+    /// Blocking loopback socket with a receive timeout, -1 if it does not
+    /// connect.
+    int connectTo(uint16_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        struct timeval timeout = { 5, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+
+        if(::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    /// Everything fd receives until the peer closes or the timeout.
+    std::string readAll(int fd)
+    {
+        std::string data;
+        char buf[4096];
+        ssize_t n = 0;
+
+        while((n = ::read(fd, buf, sizeof buf)) > 0)
+        {
+            data.append(buf, n);
+        }
+
+        return data;
+    }
+
+    // cases share one echo server, counting the connections coming and
+    // going. Objects live until the process exits, TcpServer and TcpClient
+    // may only go away in their loops.
+    class EchoServer : NonCopyable
+    {
+    public:
+        EchoServer(EventLoop* loop, uint16_t port)
+            : loop_(loop),
+              server_(loop, InetAddress("127.0.0.1", port), "ConnectionTest"),
+              up_(0),
+              down_(0)
+        {
+            server_.setConnectionCallback(
+                std::bind(&EchoServer::onConnection, this, std::placeholders::_1));
+            server_.setMessageCallback(
+                std::bind(&EchoServer::onMessage, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+        }
+
+        void start()
+        {
+            std::atomic<bool> listening(false);
+            loop_->runInLoop([&]()
+            {
+                server_.start();
+                listening = true;
+            });
+            CHECK(Test::waitFor([&]()
+            {
+                return listening.load();
+            }));
+        }
+
+        int up() const
+        {
+            return up_.load();
+        }
+        int down() const
+        {
+            return down_.load();
+        }
+
+    private:
+        void onConnection(const TcpConnectionPtr& conn)
+        {
+            ++(conn->connected() ? up_ : down_);
+        }
+
+        void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+        {
+            conn->send(buf->peek(), static_cast<int>(buf->readableBytes()));
+            buf->retrieveAll();
+        }
+
+        EventLoop*          loop_;
+        TcpServer           server_;
+        std::atomic<int>    up_;
+        std::atomic<int>    down_;
+    };
+
+    class EchoClient : NonCopyable
+    {
+    public:
+        EchoClient(EventLoop* loop, uint16_t port)
+            : loop_(loop),
+              client_(loop, InetAddress("127.0.0.1", port), "ConnectionTestClient"),
+              payload_(pattern(1024 * 1024)),
+              connected_(false),
+              done_(false)
+        {
+            client_.setConnectionCallback(
+                std::bind(&EchoClient::onConnection, this, std::placeholders::_1));
+            client_.setMessageCallback(
+                std::bind(&EchoClient::onMessage, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+        }
+
+        void run(EchoServer* server)
+        {
+            loop_->runInLoop([this]()
+            {
+                client_.connect();
+            });
+
+            // connect
+            CHECK(Test::waitFor([&]()
+            {
+                return connected_.load() && server->up() == 1;
+            }));
+
+            // echo
+            CHECK(Test::waitFor([this]()
+            {
+                return done_.load();
+            }));
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                CHECK(received_ == payload_);
+            }
+
+            loop_->runInLoop([this]()
+            {
+                client_.disconnect();
+            });
+            CHECK(Test::waitFor([&]()
+            {
+                return server->down() == 1;
+            }));
+        }
+
+    private:
+        void onConnection(const TcpConnectionPtr& conn)
+        {
+            if(!conn->connected())
+            {
+                return;
+            }
+
+            connected_ = true;
+            const size_t kChunk = 64 * 1024;
+
+            for(size_t offset = 0; offset < payload_.size(); offset += kChunk)
+            {
+                conn->send(payload_.data() + offset, static_cast<int>(kChunk));
+            }
+        }
+
+        void onMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            received_.append(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+
+            if(received_.size() >= payload_.size())
+            {
+                done_ = true;
+            }
+        }
+
+        EventLoop*          loop_;
+        TcpClient           client_;
+        const std::string   payload_;
+        std::mutex          mutex_;
+        std::string         received_;
+        std::atomic<bool>   connected_;
+        std::atomic<bool>   done_;
+    };
+
+    // takes what comes in, counting the most one read event handed over
+    class SinkServer : NonCopyable
+    {
+    public:
+        SinkServer(EventLoop* loop, uint16_t port, const char* name)
+            : loop_(loop),
+              server_(loop, InetAddress("127.0.0.1", port), name),
+              largest_(0),
+              total_(0)
+        {
+            server_.setMessageCallback(
+                std::bind(&SinkServer::onMessage, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+        }
+
+        void start()
+        {
+            std::atomic<bool> listening(false);
+            loop_->runInLoop([&]()
+            {
+                server_.start();
+                listening = true;
+            });
+            CHECK(Test::waitFor([&]()
+            {
+                return listening.load();
+            }));
+        }
+
+        /// Before start().
+        void setReadLimit(double rate, double burst)
+        {
+            server_.setConnectionRateLimit(kLimitReadBytes, rate, burst);
+        }
+
+        size_t largest() const
+        {
+            return largest_.load();
+        }
+        size_t total() const
+        {
+            return total_.load();
+        }
+
+    private:
+        void onMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+        {
+            size_t n = buf->readableBytes();
+
+            if(n > largest_.load())
+            {
+                largest_ = n;
+            }
+
+            total_ += n;
+            buf->retrieveAll();
+        }
+
+        EventLoop*              loop_;
+        TcpServer               server_;
+        std::atomic<size_t>     largest_;
+        std::atomic<size_t>     total_;
+    };
+
+    /// Writes size bytes to sink in one blocking write, true once it took
+    /// them all.
+    bool sendToSink(SinkServer* sink, uint16_t port, size_t size)
+    {
+        int fd = connectTo(port);
+
+        if(fd < 0)
+        {
+            return false;
+        }
+
+        std::string data = pattern(size);
+        bool written = ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(size);
+        bool arrived = written && Test::waitFor([&]()
+        {
+            return sink->total() >= size;
+        });
+        ::close(fd);
+        return arrived;
+    }
+
+    void testHalfClose(EchoServer* server, uint16_t port)
+    {
+        int down = server->down();
+        int fd = connectTo(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        CHECK(::write(fd, "half", 4) == 4);
+        ::shutdown(fd, SHUT_WR);
+        CHECK(readAll(fd) == "half");
+        CHECK(Test::waitFor([&]()
+        {
+            return server->down() == down + 1;
+        }));
+        ::close(fd);
+    }
+
+    void testPeerReset(EchoServer* server, uint16_t port)
+    {
+        int up = server->up();
+        int down = server->down();
+        int fd = connectTo(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        CHECK(Test::waitFor([&]()
+        {
+            return server->up() == up + 1;
+        }));
+
+        // a zero linger close sends RST
+        struct linger linger = { 1, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, sizeof linger);
+        ::close(fd);
+        CHECK(Test::waitFor([&]()
+        {
+            return server->down() == down + 1;
+        }));
+
+        fd = connectTo(port);
+        CHECK(fd >= 0);
+
+        if(fd >= 0)
+        {
+            CHECK(::write(fd, "again", 5) == 5);
+            ::shutdown(fd, SHUT_WR);
+            CHECK(readAll(fd) == "again");
+            ::close(fd);
+        }
+    }
+
+    void testTimer(EventLoop* loop)
+    {
+        std::atomic<int64_t> firedAfter(-1);
+        std::atomic<int> onceCount(0);
+        std::atomic<int> everyCount(0);
+        int64_t start = Test::nowMicros();
+
+        loop->runAfter(0.05, [&]()
+        {
+            firedAfter = Test::nowMicros() - start;
+            ++onceCount;
+        });
+
+        std::shared_ptr<TimerId> every(new TimerId);
+        loop->runInLoop([&, every]()
+        {
+            *every = loop->runEvery(0.01, [&, every]()
+            {
+                if(++everyCount == 3)
+                {
+                    loop->cancel(*every);
+                }
+            });
+        });
+
+        CHECK(Test::waitFor([&]()
+        {
+            return onceCount.load() == 1 && everyCount.load() >= 3;
+        }));
+        CHECK(firedAfter.load() >= 50 * 1000);
+
+        // a late firing would show up by now
+        Test::sleepMs(100);
+        CHECK(onceCount.load() == 1);
+        CHECK(everyCount.load() == 3);
+    }
+
+    // owns a pipe and the channel reading it, held by shared_ptr so the
+    // poller keeps it alive for the iteration
+    struct PipeOwner
+    {
+        explicit PipeOwner(EventLoop* loop)
+            : channel(NULL)
+        {
+            if(::pipe(fds) == 0)
+            {
+                channel = new Channel(loop, fds[0]);
+            }
+        }
+
+        ~PipeOwner()
+        {
+            delete channel;
+            ::close(fds[0]);
+            ::close(fds[1]);
+        }
+
+        int fds[2];
+        Channel* channel;
+    };
+
+    void testRemoveChannel(EventLoop* loop)
+    {
+        std::shared_ptr<PipeOwner> owner(new PipeOwner(loop));
+        std::weak_ptr<PipeOwner> weakOwner = owner;
+        std::shared_ptr<PipeOwner>* holder = new std::shared_ptr<PipeOwner>(owner);
+        std::atomic<int> calls(0);
+        std::atomic<bool> aliveInCallback(false);
+        std::atomic<bool> ready(false);
+        CHECK(owner->channel != NULL);
+
+        if(owner->channel == NULL)
+        {
+            delete holder;
+            return;
+        }
+
+        loop->runInLoop([&, holder]()
+        {
+            Channel* channel = (*holder)->channel;
+            channel->setOwner(*holder);
+            // leaves the byte in the pipe, a channel still polled would be
+            // called again
+            channel->setReadCallback([&, holder, channel](Timestamp)
+            {
+                ++calls;
+                channel->disableAll();
+                channel->remove();
+                holder->reset();
+                // only the poller's reference is left
+                aliveInCallback = !weakOwner.expired() && channel->fd() >= 0;
+            });
+            channel->enableReading();
+            ready = true;
+        });
+
+        CHECK(Test::waitFor([&]()
+        {
+            return ready.load();
+        }));
+        int writeFd = owner->fds[1];
+        owner.reset();
+        CHECK(::write(writeFd, "x", 1) == 1);
+        CHECK(Test::waitFor([&]()
+        {
+            return calls.load() == 1;
+        }));
+        CHECK(aliveInCallback.load());
+        CHECK(Test::waitFor([&]()
+        {
+            return weakOwner.expired();
+        }));
+
+        // the loop still runs after it
+        std::atomic<bool> ran(false);
+        loop->runInLoop([&]()
+        {
+            ran = true;
+        });
+        CHECK(Test::waitFor([&]()
+        {
+            return ran.load();
+        }));
+        CHECK(calls.load() == 1);
+        delete holder;
+    }
+
+    void testReadBudget(EventLoop* loop, SinkServer* sink, uint16_t port)
+    {
+        const size_t kBudget = 4096;
+        std::atomic<bool> set(false);
+        loop->runInLoop([&]()
+        {
+            loop->setReadBudget(kBudget);
+            set = true;
+        });
+        CHECK(Test::waitFor([&]()
+        {
+            return set.load();
+        }));
+
+        sink->start();
+        // the write fills the socket buffer far past the budget
+        CHECK(sendToSink(sink, port, 1024 * 1024));
+        CHECK(sink->largest() > 0 && sink->largest() <= kBudget);
+
+        set = false;
+        loop->runInLoop([&]()
+        {
+            loop->setReadBudget(0);
+            set = true;
+        });
+        CHECK(Test::waitFor([&]()
+        {
+            return set.load();
+        }));
+    }
+
+    void testReadLimit(SinkServer* sink, uint16_t port)
+    {
+        const double kRate = 256 * 1024;
+        const double kBurst = 32 * 1024;
+        const size_t kSize = 256 * 1024;
+        sink->setReadLimit(kRate, kBurst);
+        sink->start();
+
+        int64_t start = Test::nowMicros();
+        CHECK(sendToSink(sink, port, kSize));
+        int64_t elapsed = Test::nowMicros() - start;
+        CHECK(sink->largest() > 0 && sink->largest() <= kBurst);
+        // all but the burst at the rate, with slack for the wheel
+        CHECK(elapsed >= static_cast<int64_t>((kSize - kBurst) / kRate * 0.8 * 1e6));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string backend = "epoll";
+    uint16_t port = 20200;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strncmp(argv[i], "poller=", 7) == 0)
+        {
+            backend = argv[i] + 7;
+        }
+        else if(strncmp(argv[i], "port=", 5) == 0)
+        {
+            port = static_cast<uint16_t>(atoi(argv[i] + 5));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [poller=epoll] [port=20200]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    LogPrinter = printLog;
+    setLogLevel(LogType_Warn);
+
+    EventLoopThread serverThread(EventLoopThread::ThreadInitCallback(), backend);
+    EventLoopThread clientThread(EventLoopThread::ThreadInitCallback(), backend);
+    EventLoop* serverLoop = serverThread.startLoop();
+    EventLoop* clientLoop = clientThread.startLoop();
+
+    // EventLoop falls back to the default backend
+    if(backend != serverLoop->pollerName())
+    {
+        printf("ConnectionTest: poller %s not available, skipped\n", backend.c_str());
+        fflush(stdout);
+        _Exit(kSkipped);
+    }
+
+    EchoServer server(serverLoop, port);
+    server.start();
+
+    EchoClient client(clientLoop, port);
+    client.run(&server);
+    testHalfClose(&server, port);
+    testPeerReset(&server, port);
+    testTimer(serverLoop);
+    testRemoveChannel(serverLoop);
+
+    SinkServer budgetSink(serverLoop, static_cast<uint16_t>(port + 1), "ConnectionTestBudget");
+    testReadBudget(serverLoop, &budgetSink, static_cast<uint16_t>(port + 1));
+    SinkServer limitSink(serverLoop, static_cast<uint16_t>(port + 2), "ConnectionTestLimit");
+    testReadLimit(&limitSink, static_cast<uint16_t>(port + 2));
+
+    Test::finish(("ConnectionTest " + backend).c_str());
+}
@@ -0,0 +1,263 @@
+// HttpResponseParser on responses fed in pieces, no sockets involved.
+//
+//  split           a response split at every byte, and fed a byte at a
+//                  time, parses the same as in one piece, for bodies
+//                  framed by Content-Length, chunks with extensions and
+//                  trailers, and the end of the connection
+//  interim         1xx responses before the final one are skipped, 101
+//                  is final
+//  noBody          HEAD, 204 and 304 end with the headers
+//  badSizes        signed, overflowing and malformed lengths and chunk
+//                  sizes fail
+//  bodyLimit       a body over kMaxBodyBytes fails however it is framed
+//
+// usage: HttpResponseParserTest
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "net/Buffer.h"
+#include "net/HttpResponseParser.h"
+#include "TestCommon.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    const char kChunked[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5;name=value\r\n"
+        "hello\r\n"
+        "1A\r\n"
+        "abcdefghijklmnopqrstuvwxyz\r\n"
+        "0\r\n"
+        "Trailer: dropped\r\n"
+        "\r\n";
+
+    struct Result
+    {
+        Result()
+            : ok(false),
+              gotAll(false),
+              status(0),
+              keepAlive(false)
+        {
+        }
+
+        bool operator==(const Result& that) const
+        {
+            return ok == that.ok && gotAll == that.gotAll && status == that.status &&
+                   keepAlive == that.keepAlive && body == that.body;
+        }
+
+        bool ok;
+        bool gotAll;
+        int status;
+        bool keepAlive;
+        std::string body;
+    };
+
+    /// Feeds the pieces, the last piece may be followed by the end of the
+    /// connection.
+    Result parse(const std::vector<std::string>& pieces, bool closed = false, bool head = false)
+    {
+        HttpResponseParser parser;
+        parser.reset(head);
+        Buffer buf;
+        Result result;
+        result.ok = true;
+
+        for(const std::string& piece : pieces)
+        {
+            buf.append(piece.data(), piece.size());
+
+            if(!parser.parse(&buf))
+            {
+                result.ok = false;
+                return result;
+            }
+        }
+
+        result.gotAll = closed ? parser.finishOnClose() : parser.gotAll();
+        result.status = parser.response().statusCode();
+        result.keepAlive = parser.keepAlive();
+        result.body = parser.response().bodyAsString();
+        return result;
+    }
+
+    Result parse(const std::string& response, bool closed = false, bool head = false)
+    {
+        return parse(std::vector<std::string>(1, response), closed, head);
+    }
+
+    /// The head, then piece count times, false once a parse failed.
+    bool feedUntilFailure(const std::string& head, const std::string& piece, size_t count)
+    {
+        HttpResponseParser parser;
+        Buffer buf;
+        buf.append(head);
+        bool ok = parser.parse(&buf);
+
+        for(size_t i = 0; i < count && ok; ++i)
+        {
+            buf.append(piece.data(), piece.size());
+            ok = parser.parse(&buf);
+        }
+
+        return ok;
+    }
+
+    void checkSplits(const std::string& response, bool closed)
+    {
+        Result whole = parse(response, closed);
+        CHECK(whole.ok && whole.gotAll);
+
+        for(size_t cut = 1; cut < response.size(); ++cut)
+        {
+            std::vector<std::string> pieces;
+            pieces.push_back(response.substr(0, cut));
+            pieces.push_back(response.substr(cut));
+            CHECK(parse(pieces, closed) == whole);
+        }
+
+        std::vector<std::string> bytes;
+
+        for(char c : response)
+        {
+            bytes.push_back(std::string(1, c));
+        }
+
+        CHECK(parse(bytes, closed) == whole);
+    }
+
+    void testSplit()
+    {
+        Result chunked = parse(kChunked);
+        CHECK(chunked.ok && chunked.gotAll);
+        CHECK(chunked.status == 200 && chunked.keepAlive);
+        CHECK(chunked.body == "helloabcdefghijklmnopqrstuvwxyz");
+        checkSplits(kChunked, false);
+
+        std::string length = "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n0123456789";
+        CHECK(parse(length).body == "0123456789");
+        checkSplits(length, false);
+
+        // the body ends with the connection
+        std::string untilClose = "HTTP/1.0 200 OK\r\n\r\nsome body";
+        Result closed = parse(untilClose, true);
+        CHECK(closed.body == "some body" && !closed.keepAlive);
+        CHECK(!parse(untilClose, false).gotAll);
+        checkSplits(untilClose, true);
+
+        // a pipelined second response stays in the buffer
+        HttpResponseParser parser;
+        Buffer buf;
+        buf.append(length + length);
+        CHECK(parser.parse(&buf) && parser.gotAll());
+        CHECK(buf.readableBytes() == length.size());
+    }
+
+    void testInterim()
+    {
+        std::string response =
+            "HTTP/1.1 100 Continue\r\n\r\n"
+            "HTTP/1.1 103 Early Hints\r\nLink: </style.css>\r\n\r\n"
+            "HTTP/1.1 201 Created\r\nContent-Length: 2\r\n\r\nok";
+        Result result = parse(response);
+        CHECK(result.ok && result.gotAll);
+        CHECK(result.status == 201 && result.body == "ok");
+        checkSplits(response, false);
+
+        Result upgrade = parse("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n\r\n");
+        CHECK(upgrade.ok && upgrade.gotAll && upgrade.status == 101);
+    }
+
+    void testNoBody()
+    {
+        Result head = parse("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\n", false, true);
+        CHECK(head.ok && head.gotAll && head.body.empty());
+
+        Result noContent = parse("HTTP/1.1 204 No Content\r\n\r\n");
+        CHECK(noContent.ok && noContent.gotAll);
+
+        Result notModified = parse("HTTP/1.1 304 Not Modified\r\nContent-Length: 5\r\n\r\n");
+        CHECK(notModified.ok && notModified.gotAll);
+    }
+
+    void testBadSizes()
+    {
+        const char* kLengths[] = { "-1", "+5", " -0", "18446744073709551616",
+                                   "99999999999999999999999", "abc", "5x", ""
+                                 };
+
+        for(const char* length : kLengths)
+        {
+            std::string response = std::string("HTTP/1.1 200 OK\r\nContent-Length: ") +
+                                   length + "\r\n\r\nhello";
+
+            // an empty value is no Content-Length, the body runs to the close
+            if(*length == '\0')
+            {
+                CHECK(parse(response).ok && !parse(response).gotAll);
+            }
+            else
+            {
+                CHECK(!parse(response).ok);
+            }
+        }
+
+        const char* kChunkSizes[] = { "-1", "+5", "10000000000000000", "xyz", "5x" };
+
+        for(const char* size : kChunkSizes)
+        {
+            std::string response = std::string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n") +
+                                   size + "\r\nhello\r\n0\r\n\r\n";
+            CHECK(!parse(response).ok);
+        }
+
+        CHECK(!parse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhelloXX0\r\n\r\n").ok);
+        CHECK(!parse("HTTP/1.1 2x0 OK\r\n\r\n").ok);
+        CHECK(!parse("HTTP/1.1 200 OK\r\nno colon\r\n\r\n").ok);
+    }
+
+    void testBodyLimit()
+    {
+        const size_t kMax = HttpResponseParser::kMaxBodyBytes;
+        char length[32];
+
+        snprintf(length, sizeof length, "%zu", kMax + 1);
+        CHECK(!parse(std::string("HTTP/1.1 200 OK\r\nContent-Length: ") + length + "\r\n\r\n").ok);
+        snprintf(length, sizeof length, "%zu", kMax);
+        Result atLimit = parse(std::string("HTTP/1.1 200 OK\r\nContent-Length: ") + length + "\r\n\r\n");
+        CHECK(atLimit.ok && !atLimit.gotAll);
+
+        // chunks that add up past the limit, only their sizes are needed
+        char chunk[32];
+        snprintf(chunk, sizeof chunk, "%zx\r\n", kMax + 1);
+        CHECK(!parse(std::string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n") + chunk).ok);
+
+        // 1 MiB at a time, the parse fails once the body would pass the limit
+        std::string piece(1024 * 1024, 'x');
+        snprintf(chunk, sizeof chunk, "%zx\r\n", piece.size());
+        CHECK(!feedUntilFailure("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n",
+                                chunk + piece + "\r\n", kMax / piece.size() + 1));
+        // and a body running to the close
+        CHECK(!feedUntilFailure("HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n",
+                                piece, kMax / piece.size() + 1));
+    }
+}
+
+int main()
+{
+    testSplit();
+    testInterim();
+    testNoBody();
+    testBadSizes();
+    testBodyLimit();
+
+    Test::finish("HttpResponseParserTest");
+}
@@ -0,0 +1,474 @@
+// BinaryInputArchive on malformed messages, and the request framing of
+// RpcServer over loopback with a blocking socket writing raw frames.
+//
+//  roundTrip       a message decodes to what was encoded
+//  truncated       every prefix of an encoded message fails to decode
+//  overCount       an array count past the bytes left, or past the items
+//                  that follow, fails to decode, as do string lengths past
+//                  the end and varints that do not end
+//  split           a request written a byte at a time is answered once
+//  pipelined       requests in one write are answered in order, by id
+//  noMethod        an unknown method is answered with kRpcNoMethod, a
+//                  request that does not decode with kRpcBadRequest, the
+//                  connection stays up
+//  badFrames       a length shorter than the request header or above the
+//                  server's limit, a frame that is no request and a method
+//                  name longer than the frame close the connection
+//
+// usage: RpcTest [port=20240]
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "base/Logger.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "net/RpcServer.h"
+#include "TestCommon.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    const size_t kMaxMessageBytes = 1024;
+
+    void printLog(LogType type, const char* format, ...)
+    {
+        va_list args;
+        fprintf(stderr, "%s ", logTypeName(type));
+        va_start(args, format);
+        vfprintf(stderr, format, args);
+        va_end(args);
+        fputc('\n', stderr);
+    }
+
+    struct Record
+    {
+        Record()
+            : id(0),
+              ratio(0),
+              flag(false)
+        {
+        }
+
+        bool operator==(const Record& that) const
+        {
+            return id == that.id && name == that.name && values == that.values &&
+                   ratio == that.ratio && flag == that.flag;
+        }
+
+        int64_t                 id;
+        std::string             name;
+        std::vector<int32_t>    values;
+        double                  ratio;
+        bool                    flag;
+
+        template <typename Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Serialize("id", id);
+            ar.Serialize("name", name);
+            ar.Serialize("values", values);
+            ar.Serialize("ratio", ratio);
+            ar.Serialize("flag", flag);
+        }
+    };
+
+    struct AddRequest
+    {
+        int64_t a;
+        int64_t b;
+
+        template <typename Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Serialize("a", a);
+            ar.Serialize("b", b);
+        }
+    };
+
+    struct AddResponse
+    {
+        int64_t sum;
+
+        template <typename Archive>
+        void Serialize(Archive& ar)
+        {
+            ar.Serialize("sum", sum);
+        }
+    };
+
+    std::string encode(const Record& record)
+    {
+        Buffer buf;
+        Rpc::encode(record, &buf);
+        return buf.retrieveAllAsString();
+    }
+
+    bool decode(const std::string& data, Record* record)
+    {
+        return Rpc::decode(data.data(), data.size(), record);
+    }
+
+    Record sample()
+    {
+        Record record;
+        record.id = 5;
+        record.name = "sample";
+        record.values.push_back(1);
+        record.values.push_back(-300);
+        record.values.push_back(70000);
+        record.ratio = 0.25;
+        record.flag = true;
+        return record;
+    }
+
+    void testRoundTrip()
+    {
+        Record decoded;
+        CHECK(decode(encode(sample()), &decoded));
+        CHECK(decoded == sample());
+
+        Record empty;
+        Record decodedEmpty;
+        CHECK(decode(encode(empty), &decodedEmpty));
+        CHECK(decodedEmpty == empty);
+    }
+
+    void testTruncated()
+    {
+        std::string data = encode(sample());
+
+        for(size_t len = 0; len < data.size(); ++len)
+        {
+            Record decoded;
+            CHECK(!decode(data.substr(0, len), &decoded));
+        }
+    }
+
+    void testOverCount()
+    {
+        // id in one byte, then name as a length and its bytes, then the
+        // 4 byte little endian count of values
+        std::string data = encode(sample());
+        size_t countAt = 1 + 1 + sample().name.size();
+
+        // past the bytes left
+        std::string patched = data;
+        patched[countAt] = static_cast<char>(0xFF);
+        patched[countAt + 1] = static_cast<char>(0xFF);
+        Record decoded;
+        CHECK(!decode(patched, &decoded));
+
+        patched = data;
+        patched[countAt + 3] = static_cast<char>(0x80);
+        CHECK(!decode(patched, &decoded));
+
+        // within the bytes left, the extra items eat the fields behind them
+        patched = data;
+        patched[countAt] = static_cast<char>(sample().values.size() + 6);
+        CHECK(!decode(patched, &decoded));
+
+        // a string longer than the message, and one past 64 bits
+        patched = data;
+        patched[1] = 0x7F;
+        CHECK(!decode(patched, &decoded));
+
+        patched = data;
+        patched.replace(1, 1, std::string(10, static_cast<char>(0xFF)));
+        CHECK(!decode(patched, &decoded));
+
+        // a varint that does not end
+        CHECK(!decode(std::string(12, static_cast<char>(0x80)), &decoded));
+    }
+
+    /// Blocking loopback socket with a receive timeout, -1 if it does not
+    /// connect.
+    int connectTo(uint16_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        struct timeval timeout = { 5, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+
+        if(::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    bool writeAll(int fd, const std::string& data)
+    {
+        return ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size());
+    }
+
+    /// Exactly n bytes, false on close or timeout.
+    bool readExact(int fd, char* out, size_t n)
+    {
+        while(n > 0)
+        {
+            ssize_t got = ::read(fd, out, n);
+
+            if(got <= 0)
+            {
+                return false;
+            }
+
+            out += got;
+            n -= static_cast<size_t>(got);
+        }
+
+        return true;
+    }
+
+    /// A request frame as RpcClient builds it, payload is the encoded
+    /// message.
+    std::string requestFrame(uint64_t id, const std::string& method, const std::string& payload)
+    {
+        Buffer buf;
+        Rpc::appendHeader(&buf, Rpc::kRequest, id);
+        buf.appendInt8(static_cast<int8_t>(method.size()));
+        buf.append(method);
+        buf.append(payload);
+        Rpc::finishFrame(&buf);
+        return buf.retrieveAllAsString();
+    }
+
+    std::string addFrame(uint64_t id, int64_t a, int64_t b)
+    {
+        AddRequest request = { a, b };
+        Buffer buf;
+        Rpc::encode(request, &buf);
+        return requestFrame(id, "Calc.add", buf.retrieveAllAsString());
+    }
+
+    struct Response
+    {
+        uint64_t id;
+        int status;
+        std::string payload;
+    };
+
+    /// The next response frame, false if none came.
+    bool readResponse(int fd, Response* response)
+    {
+        char header[4 + 1 + 8 + 1];
+
+        if(!readExact(fd, header, sizeof header))
+        {
+            return false;
+        }
+
+        Buffer buf;
+        buf.append(header, sizeof header);
+        size_t len = static_cast<uint32_t>(buf.readInt32());
+
+        if(buf.readInt8() != Rpc::kResponse || len < sizeof header - 4)
+        {
+            return false;
+        }
+
+        response->id = static_cast<uint64_t>(buf.readInt64());
+        response->status = buf.readInt8();
+        response->payload.assign(len - (sizeof header - 4), '\0');
+        return response->payload.empty() ||
+               readExact(fd, &response->payload[0], response->payload.size());
+    }
+
+    int64_t sumOf(const Response& response)
+    {
+        AddResponse sum = { -1 };
+        CHECK(Rpc::decode(response.payload.data(), response.payload.size(), &sum));
+        return sum.sum;
+    }
+
+    /// True if the server closed fd.
+    bool closedByServer(int fd)
+    {
+        char byte;
+        return ::read(fd, &byte, 1) <= 0 && errno != EAGAIN && errno != EWOULDBLOCK;
+    }
+
+    void testSplit(uint16_t port)
+    {
+        int fd = connectTo(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        std::string frame = addFrame(7, 40, 2);
+
+        for(char c : frame)
+        {
+            CHECK(::write(fd, &c, 1) == 1);
+        }
+
+        Response response;
+        CHECK(readResponse(fd, &response));
+        CHECK(response.id == 7 && response.status == kRpcOk && sumOf(response) == 42);
+        ::close(fd);
+    }
+
+    void testPipelined(uint16_t port)
+    {
+        int fd = connectTo(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        std::string frames;
+
+        for(int i = 0; i < 100; ++i)
+        {
+            frames += addFrame(1000 + i, i, i * 2);
+        }
+
+        CHECK(writeAll(fd, frames));
+
+        for(int i = 0; i < 100; ++i)
+        {
+            Response response;
+            CHECK(readResponse(fd, &response));
+            CHECK(response.id == static_cast<uint64_t>(1000 + i) && response.status == kRpcOk);
+            CHECK(sumOf(response) == i * 3);
+        }
+
+        ::close(fd);
+    }
+
+    void testNoMethod(uint16_t port)
+    {
+        int fd = connectTo(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        Response response;
+        CHECK(writeAll(fd, requestFrame(1, "Calc.sub", std::string())));
+        CHECK(readResponse(fd, &response));
+        CHECK(response.id == 1 && response.status == kRpcNoMethod && response.payload.empty());
+
+        // one varint of two
+        CHECK(writeAll(fd, requestFrame(2, "Calc.add", std::string(1, '\x02'))));
+        CHECK(readResponse(fd, &response));
+        CHECK(response.id == 2 && response.status == kRpcBadRequest);
+
+        CHECK(writeAll(fd, addFrame(3, 1, 1)));
+        CHECK(readResponse(fd, &response));
+        CHECK(response.id == 3 && sumOf(response) == 2);
+        ::close(fd);
+    }
+
+    void testBadFrames(uint16_t port)
+    {
+        std::vector<std::string> frames;
+
+        // shorter than kind, id and name length
+        frames.push_back(std::string("\0\0\0\x09", 4) + std::string(9, '\0'));
+        // above the limit, only the length is sent
+        frames.push_back(std::string("\0\0\x04\x01", 4));
+        // a response sent to the server
+        std::string frame = addFrame(1, 1, 1);
+        frame[4] = Rpc::kResponse;
+        frames.push_back(frame);
+        // the name runs past the frame
+        frame = addFrame(1, 1, 1);
+        frame[4 + 1 + 8] = static_cast<char>(0xFF);
+        frames.push_back(frame);
+
+        for(const std::string& bad : frames)
+        {
+            int fd = connectTo(port);
+            CHECK(fd >= 0);
+
+            if(fd < 0)
+            {
+                return;
+            }
+
+            CHECK(writeAll(fd, bad));
+            CHECK(closedByServer(fd));
+            ::close(fd);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    uint16_t port = 20240;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strncmp(argv[i], "port=", 5) == 0)
+        {
+            port = static_cast<uint16_t>(atoi(argv[i] + 5));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [port=20240]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // the bad frames are logged as errors
+    LogPrinter = printLog;
+    setLogLevel(LogType_Fatal);
+
+    testRoundTrip();
+    testTruncated();
+    testOverCount();
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    RpcServer server(serverLoop, InetAddress("127.0.0.1", port), "RpcTest", kMaxMessageBytes);
+    server.registerMethod<AddRequest, AddResponse>("Calc", "add",
+            [](const AddRequest & request, AddResponse * response)
+    {
+        response->sum = request.a + request.b;
+    });
+
+    std::atomic<bool> listening(false);
+    serverLoop->runInLoop([&]()
+    {
+        server.start();
+        listening = true;
+    });
+    CHECK(Test::waitFor([&]()
+    {
+        return listening.load();
+    }));
+
+    testSplit(port);
+    testPipelined(port);
+    testNoMethod(port);
+    testBadFrames(port);
+
+    Test::finish("RpcTest");
+}
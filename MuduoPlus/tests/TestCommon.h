@@ -0,0 +1,81 @@
+#pragma once
+
+// Helpers shared by the tests.
+//
+// A test is a program that runs its cases over loopback and exits non zero
+// when a CHECK failed, ctest runs them.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+namespace MuduoPlus
+{
+    namespace Test
+    {
+        inline std::atomic<int>& failures()
+        {
+            static std::atomic<int> count(0);
+            return count;
+        }
+
+        inline void fail(const char* file, int line, const char* what)
+        {
+            fprintf(stderr, "FAILED %s:%d: %s\n", file, line, what);
+            ++failures();
+        }
+
+        inline int64_t nowMicros()
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        inline void sleepMs(int ms)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        }
+
+        /// Polls done every millisecond, false if it did not turn true in time.
+        inline bool waitFor(const std::function<bool()>& done, int timeoutMs = 5000)
+        {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+            while(!done())
+            {
+                if(std::chrono::steady_clock::now() > deadline)
+                {
+                    return false;
+                }
+
+                sleepMs(1);
+            }
+
+            return true;
+        }
+
+        /// Loop threads are still running when the cases are done and the
+        /// library has no orderly shutdown for them, so skip the teardown.
+        inline void finish(const char* name)
+        {
+            int count = failures().load();
+            printf("%s: %s\n", name, count == 0 ? "passed" : "FAILED");
+            fflush(stdout);
+            fflush(stderr);
+            _Exit(count == 0 ? 0 : 1);
+        }
+    }
+}
+
+// counts a failure and goes on, so one run reports all of them
+#define CHECK(cond) \
+    do \
+    { \
+        if (!(cond)) \
+            MuduoPlus::Test::fail(__FILE__, __LINE__, #cond); \
+    } while (0)
@@ -0,0 +1,346 @@
+// TLS over loopback with a self signed certificate made at start.
+//
+//  echo        the client sends before the handshake finished, the server
+//              is held busy meanwhile, then more after it, the echo must
+//              come back unchanged. Data written by OpenSSL before kernel
+//              TLS took over moves its record sequence, the peer fails with
+//              bad_record_mac if it is not continued.
+//  closeNotify a plain OpenSSL client gets an echo, then the server closes
+//              and the client must read close_notify, not a bare FIN.
+//
+// Where the kernel has the tls ULP both cases run on kernel TLS, the line
+// printed at the end tells which.
+//
+// usage: TlsTest [port=20190]
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "base/Logger.h"
+#include "base/NonCopyable.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "net/TcpClient.h"
+#include "net/TcpServer.h"
+#include "net/TlsContext.h"
+#include "TestCommon.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    std::atomic<int> g_kernelTx(0);
+
+    void printLog(LogType type, const char* format, ...)
+    {
+        char line[512];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(line, sizeof line, format, args);
+        va_end(args);
+
+        if(strstr(line, "kernel TLS sending") != NULL)
+        {
+            ++g_kernelTx;
+        }
+        else if(type >= LogType_Warn)
+        {
+            fprintf(stderr, "%s %s\n", logTypeName(type), line);
+        }
+    }
+
+    /// An EC P-256 key and a certificate for localhost signed with it.
+    bool writeSelfSigned(const std::string& certFile, const std::string& keyFile)
+    {
+        EVP_PKEY* key = NULL;
+        EVP_PKEY_CTX* keyCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+        bool ok = keyCtx != NULL && EVP_PKEY_keygen_init(keyCtx) > 0 &&
+                  EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyCtx, NID_X9_62_prime256v1) > 0 &&
+                  EVP_PKEY_keygen(keyCtx, &key) > 0;
+        EVP_PKEY_CTX_free(keyCtx);
+
+        X509* cert = ok ? X509_new() : NULL;
+        ok = cert != NULL && X509_set_version(cert, 2) &&
+             ASN1_INTEGER_set(X509_get_serialNumber(cert), 1) &&
+             X509_gmtime_adj(X509_getm_notBefore(cert), 0) != NULL &&
+             X509_gmtime_adj(X509_getm_notAfter(cert), 86400) != NULL &&
+             X509_set_pubkey(cert, key);
+
+        if(ok)
+        {
+            X509_NAME* name = X509_get_subject_name(cert);
+            ok = X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                            reinterpret_cast<const unsigned char*>("localhost"),
+                                            -1, -1, 0) &&
+                 X509_set_issuer_name(cert, name) && X509_sign(cert, key, EVP_sha256()) > 0;
+        }
+
+        FILE* out = ok ? fopen(certFile.c_str(), "w") : NULL;
+        ok = out != NULL && PEM_write_X509(out, cert);
+
+        if(out != NULL)
+        {
+            fclose(out);
+        }
+
+        out = ok ? fopen(keyFile.c_str(), "w") : NULL;
+        ok = out != NULL && PEM_write_PrivateKey(out, key, NULL, NULL, 0, NULL, NULL);
+
+        if(out != NULL)
+        {
+            fclose(out);
+        }
+
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        return ok;
+    }
+
+    std::string pattern(size_t size, size_t seed)
+    {
+        std::string data(size, '\0');
+
+        for(size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<char>((i * 31 + seed) % 251);
+        }
+
+        return data;
+    }
+
+    void echo(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        conn->send(buf->peek(), static_cast<int>(buf->readableBytes()));
+        buf->retrieveAll();
+    }
+
+    // the cases live until the process exits, TcpServer and TcpClient may
+    // only go away in their loops
+    class EchoCase : NonCopyable
+    {
+    public:
+        EchoCase(EventLoop* serverLoop, EventLoop* clientLoop, const TlsContextPtr& serverTls,
+                 uint16_t port)
+            : serverLoop_(serverLoop),
+              clientLoop_(clientLoop),
+              server_(serverLoop, InetAddress("127.0.0.1", port), "TlsTestEcho"),
+              client_(clientLoop, InetAddress("127.0.0.1", port), "TlsTestEchoClient"),
+              early_(pattern(1000, 1)),
+              late_(pattern(256 * 1024, 2)),
+              done_(false)
+        {
+            server_.setTlsContext(serverTls);
+            server_.setMessageCallback(echo);
+
+            TlsContextPtr clientTls = TlsContext::newClient();
+            clientTls->setVerifyPeer(false);
+            client_.setTlsContext(clientTls, "localhost");
+            client_.setConnectionCallback(
+                std::bind(&EchoCase::onConnection, this, std::placeholders::_1));
+            client_.setMessageCallback(
+                std::bind(&EchoCase::onMessage, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+        }
+
+        void run()
+        {
+            // listens, then keeps the handshake from finishing while the
+            // client connects and sends, the kernel completes the connect
+            serverLoop_->runInLoop([this]()
+            {
+                server_.start();
+                clientLoop_->runInLoop([this]()
+                {
+                    client_.connect();
+                });
+                Test::sleepMs(300);
+            });
+
+            CHECK(Test::waitFor([this]()
+            {
+                TcpConnectionPtr conn = client_.connection();
+                return conn && conn->connected();
+            }));
+
+            if(TcpConnectionPtr conn = client_.connection())
+            {
+                conn->send(early_);
+            }
+
+            CHECK(Test::waitFor([this]()
+            {
+                return done_.load();
+            }));
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            CHECK(received_ == early_ + late_);
+        }
+
+    private:
+        void onConnection(const TcpConnectionPtr& conn)
+        {
+            if(conn->connected())
+            {
+                conn->send(late_);
+            }
+        }
+
+        void onMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            received_.append(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+
+            if(received_.size() >= early_.size() + late_.size())
+            {
+                done_ = true;
+            }
+        }
+
+        EventLoop*          serverLoop_;
+        EventLoop*          clientLoop_;
+        TcpServer           server_;
+        TcpClient           client_;
+        const std::string   early_;     // sent before the handshake finished
+        const std::string   late_;      // sent from the connection callback
+        std::mutex          mutex_;
+        std::string         received_;
+        std::atomic<bool>   done_;
+    };
+
+    class CloseNotifyCase : NonCopyable
+    {
+    public:
+        CloseNotifyCase(EventLoop* serverLoop, const TlsContextPtr& serverTls, uint16_t port)
+            : serverLoop_(serverLoop),
+              server_(serverLoop, InetAddress("127.0.0.1", port), "TlsTestCloseNotify"),
+              port_(port)
+        {
+            server_.setTlsContext(serverTls);
+            server_.setMessageCallback([](const TcpConnectionPtr & conn, Buffer * buf, Timestamp)
+            {
+                echo(conn, buf, Timestamp());
+                conn->gracefulClose();
+            });
+        }
+
+        void run()
+        {
+            serverLoop_->runInLoop([this]()
+            {
+                server_.start();
+            });
+
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof addr);
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port_);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            struct timeval timeout = { 5, 0 };
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+            bool connected = false;
+
+            // the server loop opens the listening socket
+            for(int i = 0; i < 100 && !connected; ++i)
+            {
+                connected = ::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) == 0;
+
+                if(!connected)
+                {
+                    Test::sleepMs(10);
+                }
+            }
+
+            CHECK(connected);
+
+            SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+            SSL* ssl = SSL_new(ctx);
+            SSL_set_fd(ssl, fd);
+            CHECK(SSL_connect(ssl) == 1);
+            CHECK(SSL_write(ssl, "hello", 5) == 5);
+
+            std::string received;
+            char buf[256];
+            int n = 0;
+
+            while((n = SSL_read(ssl, buf, sizeof buf)) > 0)
+            {
+                received.append(buf, n);
+            }
+
+            CHECK(received == "hello");
+            CHECK(SSL_get_error(ssl, n) == SSL_ERROR_ZERO_RETURN);
+
+            SSL_free(ssl);
+            SSL_CTX_free(ctx);
+            ::close(fd);
+        }
+
+    private:
+        EventLoop*  serverLoop_;
+        TcpServer   server_;
+        uint16_t    port_;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    uint16_t port = 20190;
+
+    if(argc > 1 && strncmp(argv[1], "port=", 5) == 0)
+    {
+        port = static_cast<uint16_t>(atoi(argv[1] + 5));
+    }
+
+    LogPrinter = printLog;
+    setLogLevel(LogType_Info);
+
+    std::string prefix = "/tmp/TlsTest-" + std::to_string(getpid());
+    std::string certFile = prefix + "-cert.pem";
+    std::string keyFile = prefix + "-key.pem";
+
+    if(!writeSelfSigned(certFile, keyFile))
+    {
+        fprintf(stderr, "TlsTest: could not make a certificate\n");
+        return 1;
+    }
+
+    TlsContextPtr serverTls = TlsContext::newServer(certFile, keyFile);
+    unlink(certFile.c_str());
+    unlink(keyFile.c_str());
+
+    if(!serverTls)
+    {
+        fprintf(stderr, "TlsTest: could not load the certificate\n");
+        return 1;
+    }
+
+    EventLoopThread serverThread;
+    EventLoopThread clientThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    EventLoop* clientLoop = clientThread.startLoop();
+
+    EchoCase echoCase(serverLoop, clientLoop, serverTls, port);
+    echoCase.run();
+    CloseNotifyCase closeNotifyCase(serverLoop, serverTls, static_cast<uint16_t>(port + 1));
+    closeNotifyCase.run();
+
+    printf("TlsTest: kernel TLS on %d connections\n", g_kernelTx.load());
+    Test::finish("TlsTest");
+}
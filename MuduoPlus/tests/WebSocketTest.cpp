@@ -0,0 +1,572 @@
+// WebSocket frame handling of HttpServer over loopback. A blocking socket
+// plays the client and writes the frames byte for byte, an echo handler
+// sends every message back.
+//
+//  mask            WebSocketConnection::mask matches a byte wise XOR for
+//                  every length and offset around the SIMD blocks
+//  lengths         messages of 0 to 65536 bytes come back unchanged, over
+//                  the 7 bit, 16 bit and 64 bit length forms and the
+//                  lengths around the SIMD blocks of the unmasking
+//  truncated       a frame arriving a few bytes at a time is delivered
+//                  once, when it is whole
+//  fragments       a text message in fragments, with a character split
+//                  between them, comes back as one message
+//  oversized       a frame longer than maxMessageBytes closes with 1009
+//                  before its payload arrived
+//  unmasked        a client frame without a mask closes with 1002
+//  invalidUtf8     text that is not UTF-8 closes with 1007
+//  close           a close frame is answered with its code, a 1 byte
+//                  payload and codes a peer may not send with 1002, a
+//                  reason that is not UTF-8 with 1007
+//
+// usage: WebSocketTest [port=20230]
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <string>
+
+#include "base/Logger.h"
+#include "base/NonCopyable.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "net/HttpServer.h"
+#include "net/WebSocket.h"
+#include "TestCommon.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    const size_t kMaxMessageBytes = 128 * 1024;
+    const uint8_t kKey[4] = { 0x37, 0xFA, 0x21, 0x3D };
+
+    void printLog(LogType type, const char* format, ...)
+    {
+        va_list args;
+        fprintf(stderr, "%s ", logTypeName(type));
+        va_start(args, format);
+        vfprintf(stderr, format, args);
+        va_end(args);
+        fputc('\n', stderr);
+    }
+
+    std::string pattern(size_t size)
+    {
+        std::string data(size, '\0');
+
+        for(size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<char>((i * 131 + i / 7) % 253);
+        }
+
+        return data;
+    }
+
+    /// A masked client frame, the length in the shortest form.
+    std::string clientFrame(int opcode, const std::string& payload, bool fin = true)
+    {
+        std::string frame;
+        size_t len = payload.size();
+        frame += static_cast<char>((fin ? 0x80 : 0) | opcode);
+
+        if(len < 126)
+        {
+            frame += static_cast<char>(0x80 | len);
+        }
+        else if(len <= 0xFFFF)
+        {
+            frame += static_cast<char>(0x80 | 126);
+            frame += static_cast<char>(len >> 8);
+            frame += static_cast<char>(len);
+        }
+        else
+        {
+            frame += static_cast<char>(0x80 | 127);
+
+            for(int i = 0; i < 8; ++i)
+            {
+                frame += static_cast<char>(static_cast<uint64_t>(len) >> (56 - i * 8));
+            }
+        }
+
+        frame.append(reinterpret_cast<const char*>(kKey), 4);
+
+        for(size_t i = 0; i < len; ++i)
+        {
+            frame += static_cast<char>(payload[i] ^ kKey[i % 4]);
+        }
+
+        return frame;
+    }
+
+    std::string closePayload(uint16_t code, const std::string& reason = std::string())
+    {
+        std::string payload;
+        payload += static_cast<char>(code >> 8);
+        payload += static_cast<char>(code);
+        return payload + reason;
+    }
+
+    bool writeAll(int fd, const std::string& data)
+    {
+        return ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size());
+    }
+
+    /// Exactly n bytes, false on close or timeout.
+    bool readExact(int fd, char* out, size_t n)
+    {
+        while(n > 0)
+        {
+            ssize_t got = ::read(fd, out, n);
+
+            if(got <= 0)
+            {
+                return false;
+            }
+
+            out += got;
+            n -= static_cast<size_t>(got);
+        }
+
+        return true;
+    }
+
+    /// One unmasked server frame, -1 for the opcode when none arrived.
+    int readFrame(int fd, std::string* payload)
+    {
+        uint8_t header[2];
+
+        if(!readExact(fd, reinterpret_cast<char*>(header), 2) || (header[1] & 0x80) != 0)
+        {
+            return -1;
+        }
+
+        uint64_t len = header[1] & 0x7F;
+        size_t extra = len == 126 ? 2 : len == 127 ? 8 : 0;
+        uint8_t bytes[8];
+
+        if(extra > 0)
+        {
+            if(!readExact(fd, reinterpret_cast<char*>(bytes), extra))
+            {
+                return -1;
+            }
+
+            len = 0;
+
+            for(size_t i = 0; i < extra; ++i)
+            {
+                len = len << 8 | bytes[i];
+            }
+        }
+
+        payload->assign(static_cast<size_t>(len), '\0');
+
+        if(len > 0 && !readExact(fd, &(*payload)[0], static_cast<size_t>(len)))
+        {
+            return -1;
+        }
+
+        return header[0] & 0x0F;
+    }
+
+    /// The code of the close frame that should come next, 0 when it did
+    /// not, and checks the server closes the connection behind it.
+    uint16_t readClose(int fd)
+    {
+        std::string payload;
+
+        if(readFrame(fd, &payload) != WebSocketConnection::kClose || payload.size() < 2)
+        {
+            return 0;
+        }
+
+        char byte;
+        CHECK(::read(fd, &byte, 1) == 0);
+        return static_cast<uint16_t>(static_cast<uint8_t>(payload[0]) << 8 |
+                                     static_cast<uint8_t>(payload[1]));
+    }
+
+    /// A blocking socket past the upgrade handshake, -1 if that failed.
+    int openWebSocket(uint16_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        struct timeval timeout = { 5, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+
+        if(::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) != 0 ||
+                !writeAll(fd, "GET /ws HTTP/1.1\r\n"
+                          "Host: 127.0.0.1\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                          "Sec-WebSocket-Version: 13\r\n\r\n"))
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        // byte by byte, the first frame may follow the response
+        std::string response;
+        char byte;
+
+        while(response.size() < 4 || response.compare(response.size() - 4, 4, "\r\n\r\n") != 0)
+        {
+            if(::read(fd, &byte, 1) != 1)
+            {
+                ::close(fd);
+                return -1;
+            }
+
+            response += byte;
+        }
+
+        if(response.compare(0, 12, "HTTP/1.1 101") != 0 ||
+                response.find("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == std::string::npos)
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    // every message goes back as it came. Objects live until the process
+    // exits, HttpServer may only go away in its loop.
+    class EchoServer : NonCopyable
+    {
+    public:
+        EchoServer(EventLoop* loop, uint16_t port)
+            : loop_(loop),
+              server_(loop, InetAddress("127.0.0.1", port), "WebSocketTest"),
+              messages_(0)
+        {
+            WebSocketOptions options;
+            options.maxMessageBytes = kMaxMessageBytes;
+            server_.setWebSocketHandler("/ws", WebSocketOpenCallback(),
+                                        std::bind(&EchoServer::onMessage, this, std::placeholders::_1,
+                                                  std::placeholders::_2, std::placeholders::_3),
+                                        WebSocketCloseCallback(), options);
+        }
+
+        void start()
+        {
+            std::atomic<bool> listening(false);
+            loop_->runInLoop([&]()
+            {
+                server_.start();
+                listening = true;
+            });
+            CHECK(Test::waitFor([&]()
+            {
+                return listening.load();
+            }));
+        }
+
+        int messages() const
+        {
+            return messages_.load();
+        }
+
+    private:
+        void onMessage(const WebSocketConnectionPtr& ws, const StringPiece& message, bool binary)
+        {
+            ++messages_;
+            ws->send(message, binary);
+        }
+
+        EventLoop*          loop_;
+        HttpServer          server_;
+        std::atomic<int>    messages_;
+    };
+
+    void testMask()
+    {
+        std::string data = pattern(100);
+
+        for(size_t offset = 0; offset < 4; ++offset)
+        {
+            for(size_t len = 0; len + offset <= data.size(); ++len)
+            {
+                std::string masked = data;
+                WebSocketConnection::mask(&masked[offset], len, kKey);
+                bool same = true;
+
+                for(size_t i = 0; i < data.size(); ++i)
+                {
+                    char expected = data[i];
+
+                    if(i >= offset && i < offset + len)
+                    {
+                        expected = static_cast<char>(expected ^ kKey[(i - offset) % 4]);
+                    }
+
+                    same = same && masked[i] == expected;
+                }
+
+                CHECK(same);
+            }
+        }
+    }
+
+    void testLengths(uint16_t port)
+    {
+        const size_t kLengths[] = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 33, 125, 126, 127,
+                                    65535, 65536, 100000
+                                  };
+        int fd = openWebSocket(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        for(size_t len : kLengths)
+        {
+            std::string payload = pattern(len);
+            std::string echoed;
+            CHECK(writeAll(fd, clientFrame(WebSocketConnection::kBinary, payload)));
+            CHECK(readFrame(fd, &echoed) == WebSocketConnection::kBinary);
+            CHECK(echoed == payload);
+        }
+
+        ::close(fd);
+    }
+
+    void testTruncated(EchoServer* server, uint16_t port)
+    {
+        int fd = openWebSocket(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        // the 16 bit length, split inside the header, the key and the payload
+        std::string payload = pattern(300);
+        std::string frame = clientFrame(WebSocketConnection::kBinary, payload);
+        const size_t kCuts[] = { 1, 3, 6, 9, 150 };
+        int messages = server->messages();
+        size_t sent = 0;
+
+        for(size_t cut : kCuts)
+        {
+            CHECK(writeAll(fd, frame.substr(sent, cut - sent)));
+            sent = cut;
+            Test::sleepMs(20);
+            CHECK(server->messages() == messages);
+        }
+
+        std::string echoed;
+        CHECK(writeAll(fd, frame.substr(sent)));
+        CHECK(readFrame(fd, &echoed) == WebSocketConnection::kBinary);
+        CHECK(echoed == payload);
+        CHECK(server->messages() == messages + 1);
+        ::close(fd);
+    }
+
+    void testFragments(uint16_t port)
+    {
+        int fd = openWebSocket(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        // U+00E9 and U+20AC split between the fragments, a ping in between
+        std::string text = "caf\xC3\xA9 \xE2\x82\xAC";
+        CHECK(writeAll(fd, clientFrame(WebSocketConnection::kText, text.substr(0, 4), false)));
+        CHECK(writeAll(fd, clientFrame(WebSocketConnection::kPing, "p")));
+        CHECK(writeAll(fd, clientFrame(WebSocketConnection::kContinuation, text.substr(4, 3), false)));
+        CHECK(writeAll(fd, clientFrame(WebSocketConnection::kContinuation, text.substr(7))));
+
+        std::string payload;
+        CHECK(readFrame(fd, &payload) == WebSocketConnection::kPong);
+        CHECK(payload == "p");
+        CHECK(readFrame(fd, &payload) == WebSocketConnection::kText);
+        CHECK(payload == text);
+        ::close(fd);
+    }
+
+    void testOversized(uint16_t port)
+    {
+        int fd = openWebSocket(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        // only the header of a 1 TiB frame
+        std::string header = "\x82\xFF";
+
+        for(int i = 0; i < 8; ++i)
+        {
+            header += static_cast<char>((1ULL << 40) >> (56 - i * 8));
+        }
+
+        CHECK(writeAll(fd, header));
+        CHECK(readClose(fd) == WebSocketConnection::kMessageTooBig);
+        ::close(fd);
+
+        fd = openWebSocket(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        CHECK(writeAll(fd, clientFrame(WebSocketConnection::kBinary, pattern(kMaxMessageBytes + 1))));
+        CHECK(readClose(fd) == WebSocketConnection::kMessageTooBig);
+        ::close(fd);
+    }
+
+    void testUnmasked(uint16_t port)
+    {
+        int fd = openWebSocket(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        CHECK(writeAll(fd, std::string("\x82\x03" "abc", 5)));
+        CHECK(readClose(fd) == WebSocketConnection::kProtocolError);
+        ::close(fd);
+    }
+
+    void testInvalidUtf8(uint16_t port)
+    {
+        // a stray continuation byte, an overlong '/', a surrogate, past
+        // U+10FFFF, a character cut off at the end
+        const char* kInvalid[] = { "a\x80", "\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80",
+                                   "0123456789\xE2\x82"
+                                 };
+
+        for(const char* text : kInvalid)
+        {
+            int fd = openWebSocket(port);
+            CHECK(fd >= 0);
+
+            if(fd < 0)
+            {
+                return;
+            }
+
+            CHECK(writeAll(fd, clientFrame(WebSocketConnection::kText, text)));
+            CHECK(readClose(fd) == WebSocketConnection::kInvalidPayload);
+            ::close(fd);
+        }
+
+        // the same checks on a reassembled message
+        int fd = openWebSocket(port);
+        CHECK(fd >= 0);
+
+        if(fd < 0)
+        {
+            return;
+        }
+
+        CHECK(writeAll(fd, clientFrame(WebSocketConnection::kText, "ok \xE2", false)));
+        CHECK(writeAll(fd, clientFrame(WebSocketConnection::kContinuation, "\x82")));
+        CHECK(readClose(fd) == WebSocketConnection::kInvalidPayload);
+        ::close(fd);
+    }
+
+    void testClose(uint16_t port)
+    {
+        struct Case
+        {
+            std::string payload;
+            uint16_t answer;
+        };
+
+        const Case kCases[] =
+        {
+            { std::string(), WebSocketConnection::kNormalClosure },
+            { closePayload(1000, "bye"), 1000 },
+            { closePayload(1001), 1001 },
+            { closePayload(4000), 4000 },
+            { std::string("\x03", 1), WebSocketConnection::kProtocolError },
+            { closePayload(999), WebSocketConnection::kProtocolError },
+            { closePayload(1004), WebSocketConnection::kProtocolError },
+            { closePayload(1005), WebSocketConnection::kProtocolError },
+            { closePayload(1006), WebSocketConnection::kProtocolError },
+            { closePayload(1015), WebSocketConnection::kProtocolError },
+            { closePayload(2999), WebSocketConnection::kProtocolError },
+            { closePayload(5000), WebSocketConnection::kProtocolError },
+            { closePayload(1000, "\xFF"), WebSocketConnection::kInvalidPayload },
+        };
+
+        for(const Case& c : kCases)
+        {
+            int fd = openWebSocket(port);
+            CHECK(fd >= 0);
+
+            if(fd < 0)
+            {
+                return;
+            }
+
+            CHECK(writeAll(fd, clientFrame(WebSocketConnection::kClose, c.payload)));
+            CHECK(readClose(fd) == c.answer);
+            ::close(fd);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    uint16_t port = 20230;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strncmp(argv[i], "port=", 5) == 0)
+        {
+            port = static_cast<uint16_t>(atoi(argv[i] + 5));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [port=20230]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    LogPrinter = printLog;
+    setLogLevel(LogType_Warn);
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    EchoServer server(serverLoop, port);
+    server.start();
+
+    testMask();
+    testLengths(port);
+    testTruncated(&server, port);
+    testFragments(port);
+    testOversized(port);
+    testUnmasked(port);
+    testInvalidUtf8(port);
+    testClose(port);
+
+    Test::finish("WebSocketTest");
+}
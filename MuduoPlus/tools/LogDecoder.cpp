@@ -0,0 +1,354 @@
+// Offline decoder for BinaryLogging output.
+//
+// usage: LogDecoder [-s] <dict file> <blog file>...
+//   -s  sort the records of each file by time, the staging rings of
+//       different threads are drained in batches so they interleave.
+//
+// Prints the same line layout as AsyncLogging, followed by the call site.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/LogRecord.h"
+#include "base/Logger.h"
+#include "base/Timestamp.h"
+
+using namespace MuduoPlus;
+
+namespace
+{
+    struct Arg
+    {
+        Arg()
+            : type(0), i(0), u(0), d(0.0)
+        {
+        }
+
+        int         type;
+        int64_t     i;
+        uint64_t    u;
+        double      d;
+        std::string s;
+
+        long long asInt() const
+        {
+            return type == LogRecord::kDouble ? (long long)d :
+                   type == LogRecord::kInt64 ? (long long)i : (long long)u;
+        }
+
+        unsigned long long asUint() const
+        {
+            return type == LogRecord::kDouble ? (unsigned long long)d :
+                   type == LogRecord::kInt64 ? (unsigned long long)i : (unsigned long long)u;
+        }
+
+        double asDouble() const
+        {
+            return type == LogRecord::kDouble ? d :
+                   type == LogRecord::kInt64 ? (double)i : (double)u;
+        }
+    };
+
+    struct Record
+    {
+        LogRecord::Header   header;
+        std::vector<Arg>    args;
+    };
+
+    bool parseArgs(const char* p, const char* end, std::vector<Arg>& args)
+    {
+        while(p < end)
+        {
+            Arg arg;
+            arg.type = static_cast<uint8_t>(*p++);
+
+            switch(arg.type)
+            {
+                case LogRecord::kInt64:
+                case LogRecord::kUint64:
+                case LogRecord::kDouble:
+                case LogRecord::kPointer:
+                    if(end - p < 8)
+                    {
+                        return false;
+                    }
+
+                    memcpy(&arg.i, p, 8);
+                    memcpy(&arg.u, p, 8);
+                    memcpy(&arg.d, p, 8);
+                    p += 8;
+                    break;
+
+                case LogRecord::kString:
+                {
+                    uint32_t len = 0;
+
+                    if(end - p < 4)
+                    {
+                        return false;
+                    }
+
+                    memcpy(&len, p, 4);
+                    p += 4;
+
+                    if((uint32_t)(end - p) < len)
+                    {
+                        return false;
+                    }
+
+                    arg.s.assign(p, len);
+                    p += len;
+                    break;
+                }
+
+                default:
+                    return false;
+            }
+
+            args.push_back(arg);
+        }
+
+        return true;
+    }
+
+    // re-run printf one conversion at a time with the recorded argument
+    std::string formatMessage(const std::string& format, const std::vector<Arg>& args)
+    {
+        std::string out;
+        size_t next = 0;
+        char buf[2048];
+
+        for(size_t i = 0; i < format.size(); ++i)
+        {
+            if(format[i] != '%')
+            {
+                out += format[i];
+                continue;
+            }
+
+            if(i + 1 < format.size() && format[i + 1] == '%')
+            {
+                out += '%';
+                ++i;
+                continue;
+            }
+
+            std::string spec = "%";
+            size_t j = i + 1;
+
+            while(j < format.size() && strchr("-+ #0", format[j]))
+            {
+                spec += format[j++];
+            }
+
+            while(j < format.size() && (isdigit(format[j]) || format[j] == '.' || format[j] == '*'))
+            {
+                if(format[j] == '*')
+                {
+                    spec += std::to_string(next < args.size() ? args[next].asInt() : 0);
+                    ++next;
+                }
+                else
+                {
+                    spec += format[j];
+                }
+
+                ++j;
+            }
+
+            // length modifiers are replaced by the width of the recorded value
+            while(j < format.size() && strchr("hlLqjzt", format[j]))
+            {
+                ++j;
+            }
+
+            if(j >= format.size())
+            {
+                out += format.substr(i);
+                break;
+            }
+
+            char conv = format[j];
+            i = j;
+
+            if(conv == 'n')
+            {
+                continue;
+            }
+
+            if(next >= args.size())
+            {
+                out += "<?>";
+                continue;
+            }
+
+            const Arg& arg = args[next++];
+
+            switch(conv)
+            {
+                case 'd':
+                case 'i':
+                    snprintf(buf, sizeof buf, (spec + "lld").c_str(), arg.asInt());
+                    break;
+
+                case 'u':
+                case 'o':
+                case 'x':
+                case 'X':
+                    snprintf(buf, sizeof buf, (spec + "ll" + conv).c_str(), arg.asUint());
+                    break;
+
+                case 'c':
+                    snprintf(buf, sizeof buf, (spec + "c").c_str(), (int)arg.asInt());
+                    break;
+
+                case 's':
+                    snprintf(buf, sizeof buf, (spec + "s").c_str(),
+                             arg.type == LogRecord::kString ? arg.s.c_str() : "<?>");
+                    break;
+
+                case 'p':
+                    snprintf(buf, sizeof buf, (spec + "p").c_str(), (void*)(uintptr_t)arg.u);
+                    break;
+
+                default:
+                    snprintf(buf, sizeof buf, (spec + conv).c_str(), arg.asDouble());
+                    break;
+            }
+
+            out += buf;
+        }
+
+        return out;
+    }
+
+    void printRecord(const Record& record, const std::vector<LogRecord::FormatEntry>& formats)
+    {
+        Timestamp stamp(record.header.microSeconds);
+        int micro = static_cast<int>(record.header.microSeconds % Timestamp::kMicroSecPerSec);
+        std::string time = Timestamp::fromUnixTime(stamp.secondsSinceEpoch()).toFormattedString(false);
+
+        if(record.header.formatId >= formats.size() || formats[record.header.formatId].format.empty())
+        {
+            printf("%s.%06d %d ????? <unknown format id %u>\n", time.c_str(), micro,
+                   record.header.tid, record.header.formatId);
+            return;
+        }
+
+        const LogRecord::FormatEntry& entry = formats[record.header.formatId];
+        const char* file = strrchr(entry.file.c_str(), '/');
+        file = file ? file + 1 : entry.file.c_str();
+
+        printf("%s.%06d %d %s %s - %s:%d\n", time.c_str(), micro, record.header.tid,
+               logTypeName(static_cast<LogType>(entry.type)),
+               formatMessage(entry.format, record.args).c_str(), file, entry.line);
+    }
+
+    bool decodeFile(const char* path, const std::vector<LogRecord::FormatEntry>& formats, bool sortByTime)
+    {
+        FILE* fp = fopen(path, "rb");
+
+        if(!fp)
+        {
+            fprintf(stderr, "open %s failed\n", path);
+            return false;
+        }
+
+        std::vector<Record> records;
+        std::vector<char> body;
+
+        while(true)
+        {
+            Record record;
+
+            if(fread(&record.header, sizeof record.header, 1, fp) != 1)
+            {
+                break;
+            }
+
+            if(record.header.length < sizeof record.header
+                    || record.header.length > LogRecord::kMaxRecordSize)
+            {
+                fprintf(stderr, "%s: corrupted record at offset %ld\n", path, ftell(fp));
+                break;
+            }
+
+            body.resize(record.header.length - sizeof record.header);
+
+            if(!body.empty() && fread(&body[0], 1, body.size(), fp) != body.size())
+            {
+                break;
+            }
+
+            if(!body.empty())
+            {
+                parseArgs(&body[0], &body[0] + body.size(), record.args);
+            }
+
+            if(sortByTime)
+            {
+                records.push_back(record);
+            }
+            else
+            {
+                printRecord(record, formats);
+            }
+        }
+
+        fclose(fp);
+
+        std::stable_sort(records.begin(), records.end(), [](const Record & lhs, const Record & rhs)
+        {
+            return lhs.header.microSeconds < rhs.header.microSeconds;
+        });
+
+        for(auto &pos : records)
+        {
+            printRecord(pos, formats);
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int argi = 1;
+    bool sortByTime = false;
+
+    if(argi < argc && strcmp(argv[argi], "-s") == 0)
+    {
+        sortByTime = true;
+        ++argi;
+    }
+
+    if(argc - argi < 2)
+    {
+        fprintf(stderr, "usage: %s [-s] <dict file> <blog file>...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<LogRecord::FormatEntry> formats;
+
+    if(!LogRecord::loadFormats(argv[argi], formats))
+    {
+        fprintf(stderr, "load formats from %s failed\n", argv[argi]);
+        return 1;
+    }
+
+    int ret = 0;
+
+    for(++argi; argi < argc; ++argi)
+    {
+        if(!decodeFile(argv[argi], formats, sortByTime))
+        {
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "common.h"
+#include "traits.h"
+
+namespace Serialization
+{
+    // Reads what BinaryOutputArchive wrote, with the same type definitions.
+    // Fields are positional, so every tag is taken to be present. A message
+    // that ends early or carries a count larger than its bytes stops the
+    // read, the rest keeps default values and Good() turns false.
+    class BinaryInputArchive
+    {
+    public:
+        BinaryInputArchive() : m_data(nullptr), m_end(nullptr), m_good(false){}
+        ~BinaryInputArchive(){}
+
+    public:
+        bool Load(const std::string text)
+        {
+            m_text = text;
+            return Load(m_text.data(), m_text.size());
+        }
+
+        /// Reads in place, data has to outlive the archive.
+        bool Load(const char *data, size_t len)
+        {
+            m_data = data;
+            m_end = data + len;
+            m_good = true;
+            return true;
+        }
+
+        bool LoadFromFile(std::string filename)
+        {
+            std::ifstream in(filename.c_str(), std::ios::binary);
+
+            if (!in)
+            {
+                return false;
+            }
+
+            std::stringstream strstream;
+            strstream << in.rdbuf();
+
+            return Load(strstream.str());
+        }
+
+        bool Good() const
+        {
+            return m_good;
+        }
+
+        bool CheckTagNodeExist(const char *tag)
+        {
+            (void)tag;
+            return m_good;
+        }
+
+        bool ItemHasTag(int index, const char *tag)
+        {
+            (void)index;
+            (void)tag;
+            return m_good;
+        }
+
+        void StartObject(const char *tag)
+        {
+            (void)tag;
+        }
+
+        void EndObject(const char *tag)
+        {
+            (void)tag;
+        }
+
+        int StartArray(const char *tag)
+        {
+            (void)tag;
+
+            if (!Need(4))
+            {
+                return 0;
+            }
+
+            uint32_t count = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                count |= static_cast<uint32_t>(static_cast<unsigned char>(m_data[i])) << (8 * i);
+            }
+
+            m_data += 4;
+
+            // items take a byte at least, a larger count is a corrupt message
+            if (count > static_cast<size_t>(m_end - m_data))
+            {
+                m_good = false;
+                return 0;
+            }
+
+            return static_cast<int>(count);
+        }
+
+        void EndArray(const char *tag)
+        {
+            (void)tag;
+        }
+
+        void StartItem(int index)
+        {
+            (void)index;
+        }
+
+        void EndItem()
+        {
+        }
+
+    public:
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, void>::type
+            Serialize(const char *tag, T &value)
+        {
+            (void)tag;
+            uint64_t v;
+
+            if (ReadVarint(&v))
+            {
+                value = static_cast<T>(static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1));
+            }
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, void>::type
+            Serialize(const char *tag, T &value)
+        {
+            (void)tag;
+            uint64_t v;
+
+            if (ReadVarint(&v))
+            {
+                value = static_cast<T>(v);
+            }
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_floating_point<T>::value, void>::type
+            Serialize(const char *tag, T &value)
+        {
+            (void)tag;
+
+            if (sizeof(T) == sizeof(float))
+            {
+                uint32_t bits;
+                float f;
+
+                if (ReadFixed(&bits))
+                {
+                    memcpy(&f, &bits, sizeof f);
+                    value = f;
+                }
+            }
+            else
+            {
+                uint64_t bits;
+                double d;
+
+                if (ReadFixed(&bits))
+                {
+                    memcpy(&d, &bits, sizeof d);
+                    value = static_cast<T>(d);
+                }
+            }
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_enum<T>::value, void>::type
+            Serialize(const char* tag, T& value)
+        {
+            int64_t v = 0;
+            Serialize(tag, v);
+            value = static_cast<T>(v);
+        }
+
+        void inline Serialize(const char *tag, bool &value)
+        {
+            (void)tag;
+
+            if (Need(1))
+            {
+                value = *m_data++ != 0;
+            }
+        }
+
+        void inline Serialize(const char *tag, std::string &str)
+        {
+            (void)tag;
+            uint64_t len;
+
+            if (ReadVarint(&len) && Need(len))
+            {
+                str.assign(m_data, static_cast<size_t>(len));
+                m_data += len;
+            }
+        }
+
+    private:
+        bool Need(uint64_t len)
+        {
+            if (m_good && len <= static_cast<uint64_t>(m_end - m_data))
+            {
+                return true;
+            }
+
+            m_good = false;
+            return false;
+        }
+
+        bool ReadVarint(uint64_t *value)
+        {
+            uint64_t result = 0;
+
+            for (int shift = 0; shift < 64 && Need(1); shift += 7)
+            {
+                unsigned char byte = static_cast<unsigned char>(*m_data++);
+                result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+                if (!(byte & 0x80))
+                {
+                    *value = result;
+                    return true;
+                }
+            }
+
+            m_good = false;
+            return false;
+        }
+
+        template <typename T>
+        bool ReadFixed(T *value)
+        {
+            if (!Need(sizeof(T)))
+            {
+                return false;
+            }
+
+            T result = 0;
+            for (size_t i = 0; i < sizeof(T); i++)
+            {
+                result |= static_cast<T>(static_cast<unsigned char>(m_data[i])) << (8 * i);
+            }
+
+            m_data += sizeof(T);
+            *value = result;
+            return true;
+        }
+
+    private:
+        std::string     m_text;
+        const char     *m_data;
+        const char     *m_end;
+        bool            m_good;
+    };
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstring>
+
+#include "common.h"
+#include "traits.h"
+
+namespace Serialization
+{
+    // Compact binary encoding, for messages between programs sharing the
+    // type definitions rather than for files people read. Tags are not
+    // written, fields go in the order Serialize visits them:
+    //
+    //     integers     varint, signed ones zigzag encoded, enums as int64
+    //     float/double 4/8 bytes little endian
+    //     bool         1 byte
+    //     string       varint length, then the bytes
+    //     array        4 byte little endian item count, then the items
+    //     object       nothing, only its fields
+    //
+    // The sink is anything with append(const char*, size_t), size() and
+    // operator[], so an archive can write straight into a network buffer.
+    template <typename Sink = std::string>
+    class BinaryOutputArchive
+    {
+    public:
+        BinaryOutputArchive() : m_sink(&m_own){}
+        explicit BinaryOutputArchive(Sink &sink) : m_sink(&sink){}
+        ~BinaryOutputArchive(){}
+
+    public:
+        void StartArray(const char *tag)
+        {
+            (void)tag;
+            CountItem();
+
+            char count[4] = { 0 };
+            m_containers.push_back(m_sink->size());
+            m_counts.push_back(0);
+            m_sink->append(count, sizeof count);
+        }
+
+        void EndArray(const char *tag)
+        {
+            (void)tag;
+            assert(!m_counts.empty());
+
+            size_t pos = m_containers.back();
+            uint32_t count = m_counts.back();
+
+            for (int i = 0; i < 4; i++)
+            {
+                (*m_sink)[pos + i] = static_cast<char>(count >> (8 * i));
+            }
+
+            m_containers.pop_back();
+            m_counts.pop_back();
+        }
+
+        void StartObject(const char *tag)
+        {
+            (void)tag;
+            CountItem();
+            m_containers.push_back(SIZE_MAX);
+            m_counts.push_back(0);
+        }
+
+        void EndObject(const char *tag)
+        {
+            (void)tag;
+            m_containers.pop_back();
+            m_counts.pop_back();
+        }
+
+    public:
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, void>::type
+            Serialize(const char *tag, T &value)
+        {
+            (void)tag;
+            CountItem();
+            int64_t v = value;
+            WriteVarint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, void>::type
+            Serialize(const char *tag, T &value)
+        {
+            (void)tag;
+            CountItem();
+            WriteVarint(static_cast<uint64_t>(value));
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_floating_point<T>::value, void>::type
+            Serialize(const char *tag, T &value)
+        {
+            (void)tag;
+            CountItem();
+
+            if (sizeof(T) == sizeof(float))
+            {
+                float f = static_cast<float>(value);
+                uint32_t bits;
+                memcpy(&bits, &f, sizeof bits);
+                WriteFixed(bits, sizeof bits);
+            }
+            else
+            {
+                double d = static_cast<double>(value);
+                uint64_t bits;
+                memcpy(&bits, &d, sizeof bits);
+                WriteFixed(bits, sizeof bits);
+            }
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_enum<T>::value, void>::type
+            Serialize(const char* tag, T& value)
+        {
+            int64_t v = static_cast<int64_t>(value);
+            Serialize(tag, v);
+        }
+
+        void inline Serialize(const char *tag, bool value)
+        {
+            (void)tag;
+            CountItem();
+            char c = value ? 1 : 0;
+            m_sink->append(&c, 1);
+        }
+
+        void inline Serialize(const char *tag, const std::string &str)
+        {
+            (void)tag;
+            CountItem();
+            WriteVarint(str.size());
+            m_sink->append(str.data(), str.size());
+        }
+
+        std::string c_str()
+        {
+            return std::string(&(*m_sink)[0], m_sink->size());
+        }
+
+    private:
+        // values and objects directly inside an array are its items
+        void CountItem()
+        {
+            if (!m_containers.empty() && m_containers.back() != SIZE_MAX)
+            {
+                ++m_counts.back();
+            }
+        }
+
+        void WriteVarint(uint64_t value)
+        {
+            char bytes[10];
+            int n = 0;
+
+            while (value >= 0x80)
+            {
+                bytes[n++] = static_cast<char>((value & 0x7F) | 0x80);
+                value >>= 7;
+            }
+
+            bytes[n++] = static_cast<char>(value);
+            m_sink->append(bytes, n);
+        }
+
+        void WriteFixed(uint64_t value, size_t len)
+        {
+            char bytes[8];
+
+            for (size_t i = 0; i < len; i++)
+            {
+                bytes[i] = static_cast<char>(value >> (8 * i));
+            }
+
+            m_sink->append(bytes, len);
+        }
+
+    private:
+        Sink                    m_own;
+        Sink                   *m_sink;
+        std::vector<size_t>     m_containers;   // count offset of an array, SIZE_MAX for an object
+        std::vector<uint32_t>   m_counts;
+    };
+}
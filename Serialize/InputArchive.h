@@ -22,11 +22,23 @@ namespace Serialization
             return m_outArchive.Load(text);
         }
 
+        /// Backends reading in place, BinaryInputArchive.
+        bool Load(const char *data, size_t len)
+        {
+            return m_outArchive.Load(data, len);
+        }
+
         bool LoadFromFile(std::string filename)
         {
             return m_outArchive.LoadFromFile(filename);
         }        
 
+        /// False once a backend that tracks it met malformed input.
+        bool Good() const
+        {
+            return m_outArchive.Good();
+        }
+
         template <typename T>
         typename std::enable_if<is_signedBigInt<T>::value, void>::type
             inline Serialize(const char *tag, T &value)
@@ -17,6 +17,10 @@ namespace Serialization
         OutputArchive(){}
         ~OutputArchive(){}
 
+        /// For backends writing into a caller's buffer, BinaryOutputArchive.
+        template <typename Sink>
+        explicit OutputArchive(Sink &sink) : m_outArchive(sink){}
+
     public:
         template <typename T>
         typename std::enable_if<is_signedBigInt<T>::value, void>::type
@@ -16,6 +16,8 @@
 #include "XMLInputArchive.h"
 #include "YAMLOutputArchive.h"
 #include "YAMLInputArchive.h"
+#include "BinaryOutputArchive.h"
+#include "BinaryInputArchive.h"
 
 #include "OutputArchive.h"
 #include "InputArchive.h"
@@ -77,14 +79,17 @@ int main(int argc, char* argv[])
     Serialization::OutputArchive<Serialization::YamlOutputArchive, false> outputArchiveYaml;
     Serialization::OutputArchive<Serialization::JsonOutPutArchive, false> outputArchiveJson;
     Serialization::OutputArchive<Serialization::XmlOutPutArchive, false> outputArchiveXml;
+    Serialization::OutputArchive<Serialization::BinaryOutputArchive<>, false> outputArchiveBinary;
 
     outputArchiveYaml << foo;
     outputArchiveJson << foo;
     outputArchiveXml << foo;
+    outputArchiveBinary << foo;
     
     std::string sYaml = outputArchiveYaml.c_str();
     std::string sJson = outputArchiveJson.c_str();
     std::string sXml = outputArchiveXml.c_str();
+    std::string sBinary = outputArchiveBinary.c_str();
     foo.Clear();
 
     Serialization::InputArchive<Serialization::JsonInPutArchive, false>    iArchiveJson;
@@ -100,6 +105,11 @@ int main(int argc, char* argv[])
     iArchiveXml.Load(sXml);
     iArchiveXml >> foo;
 
+    foo.Clear();
+    Serialization::InputArchive<Serialization::BinaryInputArchive, false>  iArchiveBinary;
+    iArchiveBinary.Load(sBinary);
+    iArchiveBinary >> foo;
+
      getchar();
 
 	return 0;